@@ -0,0 +1,1345 @@
+/*
+ * bench.c: Benchmarks for the core data paths of VDR
+ *
+ * See the main source file 'vdr.c' for copyright information and
+ * how to reach the author.
+ *
+ * $Id$
+ */
+
+// Each benchmark repeatedly runs one batch of operations on synthetic data
+// (a generated TS stream, EIT sections and EPG events), until the given time
+// has elapsed. The results are written to stdout as one JSON object per line,
+// so that they can easily be compared between different builds. The "ns_per_op"
+// percentiles are taken over the individual batches. Benchmarks that can check
+// their results do so after they have been measured, and if any of them fails,
+// vdr-bench exits with 1.
+
+#include <getopt.h>
+#include <iconv.h>
+#include <inttypes.h>
+#include <sched.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include <unistd.h>
+#include "channels.h"
+#include "config.h"
+#include "epg.h"
+#include "font.h"
+#include "libsi/descriptor.h"
+#include "libsi/section.h"
+#include "osd.h"
+#include "recording.h"
+#include "remux.h"
+#include "ringbuffer.h"
+#include "skinlcars.h"
+#include "themes.h"
+#include "tools.h"
+#include "videodir.h"
+
+#define DEFAULTBENCHTIME  1.0 // seconds per benchmark
+#define WARMUPFRACTION    0.1 // part of the time used for warming up
+#define STREAMFRAMES      250 // 10 seconds at 25 fps
+#define GOPSIZE            12
+#define IFRAMESIZE      60000 // bytes
+#define PFRAMESIZE      15000 // bytes
+#define VPID              256
+#define APID              257
+#define INDEXFRAMES    180000 // 2 hours at 25 fps
+#define SCHEDULEEVENTS   5000
+#define EITEVENTS           6 // events per EIT section
+#define EITSECTIONS        50
+#define LOOKUPS          1000 // lookups per batch
+#define RECORDFILESIZE   MEGABYTE(64) // the file written by macro.record is started over at this size
+#define FRAMEBUFSIZE     (MAXFRAMESIZE * 5) // same as the ring buffer of cDvbPlayer
+#define FRAMEBUFFRAMES   1000
+#define FRAMEDATASIZE    KILOBYTE(64) // maximum size of the frames put into the frame ring buffers
+#define FRAMESPERBATCH   1000
+#define TEXTREPEAT          3 // a description consists of this many copies of a title
+#define TEXTSIZE          256 // SI texts have a length of at most 255 bytes
+#define CRCCHECKS        1000 // number of random buffers the CRC32 is checked with
+#define HASHOBJECTS     20000
+
+static unsigned int RandomSeed = 1;
+
+static int Random(int Max)
+{
+  return rand_r(&RandomSeed) % Max;
+}
+
+static uint64_t NowNs(void)
+{
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return uint64_t(ts.tv_sec) * 1000000000 + ts.tv_nsec;
+}
+
+static cString TempDirectory(const char *Parent = cVideoDirectory::Name())
+{
+  char *Name = strdup(AddDirectory(Parent, "vdr-bench-XXXXXX"));
+  cString Dir;
+  if (mkdtemp(Name))
+     Dir = Name;
+  else
+     LOG_ERROR_STR(Name);
+  free(Name);
+  return Dir;
+}
+
+// --- cBitWriter ------------------------------------------------------------
+
+class cBitWriter {
+private:
+  uchar *data;
+  int bits;
+public:
+  cBitWriter(uchar *Data) { data = Data; bits = 0; }
+  void PutBit(int Bit) { if (bits % 8 == 0) data[bits / 8] = 0; if (Bit) data[bits / 8] |= 0x80 >> (bits % 8); bits++; }
+  void PutBits(uint32_t Value, int Count) { while (Count--) PutBit((Value >> Count) & 1); }
+  void PutUe(uint32_t Value) { int n = 0; for (uint32_t v = ++Value; v > 1; v >>= 1) n++; PutBits(0, n); PutBits(Value, n + 1); }
+  int Finish(void) { PutBit(1); while (bits % 8) PutBit(0); return bits / 8; }
+       ///< Adds the RBSP trailing bits and returns the number of bytes written.
+  };
+
+// --- cBenchStream ----------------------------------------------------------
+
+// A synthetic H.264 stream with one audio track, including PAT/PMT in front
+// of every independent frame.
+
+class cBenchStream {
+private:
+  uchar *data;
+  int size;
+  int length;
+  uchar videoCounter;
+  uchar audioCounter;
+  void PutPacket(const uchar *Packet);
+  void PutPes(int Pid, const uchar *Pes, int Length, uchar &Counter);
+  int PesHeader(uchar *Data, uchar StreamId, int64_t Pts, int Length = 0);
+public:
+  cChannel channel;
+  cBenchStream(void);
+  ~cBenchStream();
+  const uchar *Data(void) const { return data; }
+  int Length(void) const { return length; }
+  };
+
+cBenchStream::cBenchStream(void)
+{
+  size = STREAMFRAMES * (IFRAMESIZE / GOPSIZE + PFRAMESIZE + 8 * TS_SIZE);
+  data = MALLOC(uchar, size);
+  length = 0;
+  videoCounter = audioCounter = 0;
+  channel.Parse("Bench:11000:H:S19.2E:27500:256=27:257=deu@3:0:0:1:1:1:0");
+  cPatPmtGenerator PatPmtGenerator(&channel);
+  uchar *Frame = MALLOC(uchar, IFRAMESIZE);
+  for (int i = 0; i < STREAMFRAMES; i++) {
+      bool Independent = i % GOPSIZE == 0;
+      int64_t Pts = PTSTICKS + int64_t(i) * PTSTICKS / 25;
+      if (Independent) {
+         PutPacket(PatPmtGenerator.GetPat());
+         int Index = 0;
+         while (uchar *pmt = PatPmtGenerator.GetPmt(Index))
+               PutPacket(pmt);
+         }
+      // Video:
+      uchar *p = Frame + PesHeader(Frame, 0xE0, Pts);
+      static const uchar Aud[] = { 0x00, 0x00, 0x00, 0x01, 0x09, 0x10 };
+      memcpy(p, Aud, sizeof(Aud));
+      p += sizeof(Aud);
+      if (Independent) {
+         static const uchar Sps[] = { 0x00, 0x00, 0x00, 0x01, 0x67, 77, 0x40, 40 };
+         memcpy(p, Sps, sizeof(Sps));
+         p += sizeof(Sps);
+         cBitWriter bw(p);
+         bw.PutUe(0);   // seq_parameter_set_id
+         bw.PutUe(0);   // log2_max_frame_num_minus4
+         bw.PutUe(0);   // pic_order_cnt_type
+         bw.PutUe(0);   // log2_max_pic_order_cnt_lsb_minus4
+         bw.PutUe(1);   // max_num_ref_frames
+         bw.PutBit(0);  // gaps_in_frame_num_value_allowed_flag
+         bw.PutUe(119); // pic_width_in_mbs_minus1
+         bw.PutUe(67);  // pic_height_in_map_units_minus1
+         bw.PutBit(1);  // frame_mbs_only_flag
+         bw.PutBit(1);  // direct_8x8_inference_flag
+         bw.PutBit(0);  // frame_cropping_flag
+         bw.PutBit(0);  // vui_parameters_present_flag
+         p += bw.Finish();
+         }
+      static const uchar Slice[] = { 0x00, 0x00, 0x00, 0x01 };
+      memcpy(p, Slice, sizeof(Slice));
+      p += sizeof(Slice);
+      *p++ = Independent ? 0x65 : 0x41;
+      cBitWriter bw(p);
+      bw.PutUe(0); // first_mb_in_slice
+      bw.PutUe(Independent ? 7 : 5); // slice_type (all I or all P)
+      p += bw.Finish();
+      int FrameSize = Independent ? IFRAMESIZE : PFRAMESIZE;
+      memset(p, 0x5A, Frame + FrameSize - p);
+      PutPes(VPID, Frame, FrameSize, videoCounter);
+      // Audio:
+      p = Frame + PesHeader(Frame, 0xC0, Pts, 170);
+      p[0] = 0xFF;
+      p[1] = 0xFD;
+      memset(p + 2, 0x33, 168);
+      PutPes(APID, Frame, p + 170 - Frame, audioCounter);
+      }
+  free(Frame);
+}
+
+cBenchStream::~cBenchStream()
+{
+  free(data);
+}
+
+void cBenchStream::PutPacket(const uchar *Packet)
+{
+  if (length + TS_SIZE <= size) {
+     memcpy(data + length, Packet, TS_SIZE);
+     length += TS_SIZE;
+     }
+}
+
+void cBenchStream::PutPes(int Pid, const uchar *Pes, int Length, uchar &Counter)
+{
+  bool PayloadStart = true;
+  while (Length > 0) {
+        uchar Packet[TS_SIZE];
+        int Payload = min(Length, TS_SIZE - 4);
+        Packet[0] = TS_SYNC_BYTE;
+        Packet[1] = (PayloadStart ? TS_PAYLOAD_START : 0x00) | (Pid >> 8);
+        Packet[2] = Pid & 0xFF;
+        Packet[3] = TS_PAYLOAD_EXISTS | (Counter++ & TS_CONT_CNT_MASK);
+        int Offset = 4;
+        if (Payload < TS_SIZE - 4) {
+           // stuffing in the adaptation field:
+           Packet[3] |= TS_ADAPT_FIELD_EXISTS;
+           Packet[4] = TS_SIZE - 5 - Payload;
+           if (Packet[4]) {
+              Packet[5] = 0x00;
+              memset(Packet + 6, 0xFF, Packet[4] - 1);
+              }
+           Offset = TS_SIZE - Payload;
+           }
+        memcpy(Packet + Offset, Pes, Payload);
+        PutPacket(Packet);
+        Pes += Payload;
+        Length -= Payload;
+        PayloadStart = false;
+        }
+}
+
+int cBenchStream::PesHeader(uchar *Data, uchar StreamId, int64_t Pts, int Length)
+{
+  int PesLength = Length ? Length + 8 : 0;
+  Data[0] = 0x00;
+  Data[1] = 0x00;
+  Data[2] = 0x01;
+  Data[3] = StreamId;
+  Data[4] = PesLength >> 8;
+  Data[5] = PesLength & 0xFF;
+  Data[6] = 0x80;
+  Data[7] = 0x80; // PTS only
+  Data[8] = 5;
+  Data[9] = 0x21 | ((Pts >> 29) & 0x0E);
+  Data[10] = Pts >> 22;
+  Data[11] = 0x01 | ((Pts >> 14) & 0xFE);
+  Data[12] = Pts >> 7;
+  Data[13] = 0x01 | ((Pts << 1) & 0xFE);
+  return 14;
+}
+
+static cBenchStream *BenchStream = NULL;
+
+static const cBenchStream *Stream(void)
+{
+  if (!BenchStream)
+     BenchStream = new cBenchStream;
+  return BenchStream;
+}
+
+// --- EIT sections ----------------------------------------------------------
+
+#define EITSTARTTIME 1577836800 // 2020-01-01 00:00 UTC
+#define EITSTARTMJD       58849
+
+static uchar Bcd(int n)
+{
+  return ((n / 10) << 4) | (n % 10);
+}
+
+static int PutShortText(uchar *Data, const char *Text)
+{
+  int l = strlen(Text);
+  Data[0] = l;
+  memcpy(Data + 1, Text, l);
+  return l + 1;
+}
+
+static int MakeEitSection(uchar *Data, int Section, int Version)
+{
+  static const char *Description = "Ein synthetischer Beschreibungstext, wie er in der erweiterten Ereignisbeschreibung "
+                                   "eines typischen Senders vorkommt. Er ist lang genug, um die Zeichensatzkonvertierung "
+                                   "und das Zusammensetzen der Texte ordentlich zu beschaeftigen.";
+  uchar *p = Data;
+  *p++ = 0x50; // schedule, actual TS
+  p += 2; // section length
+  *p++ = 0x00; // service id
+  *p++ = 0x01;
+  *p++ = 0xC1 | ((Version & 0x1F) << 1);
+  *p++ = Section;
+  *p++ = EITSECTIONS - 1;
+  *p++ = 0x04; // transport stream id
+  *p++ = 0xD2;
+  *p++ = 0x00; // original network id
+  *p++ = 0x01;
+  *p++ = EITSECTIONS - 1;
+  *p++ = 0x50;
+  for (int i = 0; i < EITEVENTS; i++) {
+      int EventId = Section * EITEVENTS + i + 1;
+      int Start = EventId * 1800; // seconds from EITSTARTTIME
+      *p++ = EventId >> 8;
+      *p++ = EventId & 0xFF;
+      int Mjd = EITSTARTMJD + Start / 86400;
+      int Seconds = Start % 86400;
+      *p++ = Mjd >> 8;
+      *p++ = Mjd & 0xFF;
+      *p++ = Bcd(Seconds / 3600);
+      *p++ = Bcd(Seconds / 60 % 60);
+      *p++ = Bcd(Seconds % 60);
+      *p++ = Bcd(0); // duration 00:30:00
+      *p++ = Bcd(30);
+      *p++ = Bcd(0);
+      uchar *LoopLength = p;
+      p += 2;
+      uchar *Loop = p;
+      // short event descriptor:
+      uchar *d = p;
+      *p++ = SI::ShortEventDescriptorTag;
+      p++;
+      memcpy(p, "deu", 3);
+      p += 3;
+      p += PutShortText(p, *cString::sprintf("Sendung Nummer %d", EventId));
+      p += PutShortText(p, "Folge mit einem kurzen Untertitel");
+      d[1] = p - d - 2;
+      // extended event descriptor:
+      d = p;
+      *p++ = SI::ExtendedEventDescriptorTag;
+      p++;
+      *p++ = 0x00; // descriptor_number, last_descriptor_number
+      memcpy(p, "deu", 3);
+      p += 3;
+      *p++ = 0; // length_of_items
+      p += PutShortText(p, Description);
+      d[1] = p - d - 2;
+      // content descriptor:
+      *p++ = SI::ContentDescriptorTag;
+      *p++ = 2;
+      *p++ = 0x10; // movie/drama
+      *p++ = 0x00;
+      int l = p - Loop;
+      LoopLength[0] = 0x80 | (l >> 8); // running status "not running"
+      LoopLength[1] = l & 0xFF;
+      }
+  int SectionLength = p - Data + 4 - 3;
+  Data[1] = 0xF0 | (SectionLength >> 8);
+  Data[2] = SectionLength & 0xFF;
+  uint32_t crc = SI::CRC32::crc32((const char *)Data, p - Data, 0xFFFFFFFF);
+  *p++ = crc >> 24;
+  *p++ = crc >> 16;
+  *p++ = crc >> 8;
+  *p++ = crc;
+  return p - Data;
+}
+
+// --- cBenchmark ------------------------------------------------------------
+
+class cBenchmark : public cListObject {
+private:
+  const char *name;
+public:
+  cBenchmark(const char *Name) { name = Name; }
+  const char *Name(void) const { return name; }
+  virtual bool Setup(void) { return true; }
+       ///< Prepares the data for this benchmark. Returns false if the benchmark
+       ///< can't be run in this environment.
+  virtual void Run(int &Operations, int64_t &Bytes) = 0;
+       ///< Runs one batch of the benchmarked operation. Operations and Bytes are
+       ///< initialized to 0 and shall be set to the number of operations and bytes
+       ///< processed in this batch.
+  virtual bool Verify(void) { return true; }
+       ///< Checks the results of the batches that have been run. Returns false
+       ///< if they were wrong, in which case the benchmark is reported as failed.
+  virtual void Teardown(void) {}
+  };
+
+// --- Remux -----------------------------------------------------------------
+
+class cBenchFrameDetector : public cBenchmark {
+private:
+  cFrameDetector *frameDetector;
+public:
+  cBenchFrameDetector(void) : cBenchmark("remux.framedetector") { frameDetector = NULL; }
+  virtual bool Setup(void) { frameDetector = new cFrameDetector(VPID, 0x1B); return true; }
+  virtual void Run(int &Operations, int64_t &Bytes) {
+    const uchar *p = Stream()->Data();
+    int l = Stream()->Length();
+    while (l > 0) {
+          int Count = frameDetector->Analyze(p, l);
+          if (!Count)
+             break;
+          if (frameDetector->NewFrame())
+             Operations++;
+          p += Count;
+          l -= Count;
+          }
+    Bytes = Stream()->Length();
+    }
+  virtual void Teardown(void) { delete frameDetector; }
+  };
+
+class cBenchTsToPes : public cBenchmark {
+private:
+  cTsToPes videoToPes;
+  cTsToPes audioToPes;
+public:
+  cBenchTsToPes(void) : cBenchmark("remux.tstopes") {}
+  virtual void Run(int &Operations, int64_t &Bytes) {
+    const uchar *p = Stream()->Data();
+    for (int l = Stream()->Length(); l >= TS_SIZE; l -= TS_SIZE, p += TS_SIZE) {
+        int Pid = TsPid(p);
+        cTsToPes *TsToPes = Pid == VPID ? &videoToPes : Pid == APID ? &audioToPes : NULL;
+        if (TsToPes) {
+           if (TsPayloadStart(p)) {
+              int Length;
+              while (TsToPes->GetPes(Length)) {
+                    Bytes += Length;
+                    Operations++;
+                    }
+              TsToPes->Reset();
+              }
+           TsToPes->PutTs(p, TS_SIZE);
+           }
+        }
+    }
+  };
+
+class cBenchParsePmt : public cBenchmark {
+private:
+  cPatPmtParser patPmtParser;
+  uchar pmt[MAX_PMT_TS][TS_SIZE];
+  int numPmtPackets;
+public:
+  cBenchParsePmt(void) : cBenchmark("remux.parsepmt") { numPmtPackets = 0; }
+  virtual bool Setup(void) {
+    cPatPmtGenerator PatPmtGenerator(&Stream()->channel);
+    int Index = 0;
+    while (uchar *p = PatPmtGenerator.GetPmt(Index))
+          memcpy(pmt[numPmtPackets++], p, TS_SIZE);
+    return numPmtPackets > 0;
+    }
+  virtual void Run(int &Operations, int64_t &Bytes) {
+    for (int i = 0; i < LOOKUPS; i++) {
+        patPmtParser.Reset(); // makes it parse the same PMT again
+        for (int j = 0; j < numPmtPackets; j++)
+            patPmtParser.ParsePmt(pmt[j], TS_SIZE);
+        }
+    Operations = LOOKUPS;
+    Bytes = int64_t(LOOKUPS) * numPmtPackets * TS_SIZE;
+    }
+  };
+
+// --- Ring buffer -----------------------------------------------------------
+
+class cBenchRingBuffer : public cBenchmark {
+private:
+  cRingBufferLinear *ringBuffer;
+public:
+  cBenchRingBuffer(void) : cBenchmark("ringbuffer.linear") { ringBuffer = NULL; }
+  virtual bool Setup(void) { ringBuffer = new cRingBufferLinear(MEGABYTE(4), TS_SIZE, true, "Bench"); return true; }
+  virtual void Run(int &Operations, int64_t &Bytes) {
+    const uchar *p = Stream()->Data();
+    int l = Stream()->Length();
+    while (l > 0) {
+          int n = ringBuffer->Put(p, min(l, KILOBYTE(64)));
+          p += n;
+          l -= n;
+          Bytes += n;
+          int Count;
+          while (uchar *b = ringBuffer->Get(Count)) {
+                Count -= Count % TS_SIZE;
+                if (!Count || *b != TS_SYNC_BYTE)
+                   break;
+                ringBuffer->Del(Count);
+                Operations += Count / TS_SIZE;
+                }
+          }
+    }
+  virtual void Teardown(void) { delete ringBuffer; }
+  };
+
+// --- Frame ring buffers ----------------------------------------------------
+
+// A producer thread puts frames of random size into the ring buffer, while the
+// benchmark takes them out and checks their size, sequence number and data,
+// the way cDvbPlayer uses its ring buffer. Each operation is one frame.
+
+class cBenchFrameBuffer : public cBenchmark, public cThread {
+private:
+  uchar *pattern;
+  unsigned int putSeed;
+  unsigned int getSeed;
+  int getSequence;
+  int errors;
+  int FrameSize(unsigned int &Seed) { return rand_r(&Seed) % FRAMEDATASIZE + 1; }
+  const uchar *FrameData(int Sequence) { return pattern + Sequence % 256; }
+protected:
+  virtual void CreateBuffer(void) = 0;
+  virtual void DeleteBuffer(void) = 0;
+  virtual bool PutFrame(const uchar *Data, int Count, int Sequence) = 0;
+  virtual cFrame *GetFrame(void) = 0;
+  virtual void DropFrame(cFrame *Frame) = 0;
+  virtual void Action(void) {
+    int Sequence = 0;
+    int Count = FrameSize(putSeed);
+    while (Running()) {
+          if (PutFrame(FrameData(Sequence), Count, Sequence)) {
+             Sequence++;
+             Count = FrameSize(putSeed);
+             }
+          else
+             sched_yield();
+          }
+    }
+public:
+  cBenchFrameBuffer(const char *Name) : cBenchmark(Name), cThread("bench frame producer") { pattern = NULL; putSeed = getSeed = 1; getSequence = errors = 0; }
+  virtual bool Setup(void) {
+    pattern = MALLOC(uchar, FRAMEDATASIZE + 256);
+    for (int i = 0; i < FRAMEDATASIZE + 256; i++)
+        pattern[i] = Random(256);
+    putSeed = getSeed = 1;
+    getSequence = errors = 0;
+    CreateBuffer();
+    Start();
+    return true;
+    }
+  virtual void Run(int &Operations, int64_t &Bytes) {
+    while (Operations < FRAMESPERBATCH) {
+          if (cFrame *Frame = GetFrame()) {
+             int Count = FrameSize(getSeed);
+             if (Frame->Index() != getSequence || Frame->Count() != Count || memcmp(Frame->Data(), FrameData(getSequence), Count))
+                errors++;
+             getSequence++;
+             Operations++;
+             Bytes += Frame->Count();
+             DropFrame(Frame);
+             }
+          else
+             sched_yield();
+          }
+    }
+  virtual bool Verify(void) {
+    if (errors)
+       fprintf(stderr, "%s: %d of %d frames were wrong\n", Name(), errors, getSequence);
+    return !errors;
+    }
+  virtual void Teardown(void) { Cancel(3); DeleteBuffer(); free(pattern); pattern = NULL; }
+  };
+
+class cBenchFrame : public cBenchFrameBuffer {
+private:
+  cRingBufferFrame *ringBuffer;
+  cFrame *frame;
+protected:
+  virtual void CreateBuffer(void) { ringBuffer = new cRingBufferFrame(FRAMEBUFSIZE); }
+  virtual void DeleteBuffer(void) { delete frame; frame = NULL; delete ringBuffer; ringBuffer = NULL; }
+  virtual bool PutFrame(const uchar *Data, int Count, int Sequence) {
+    if (!frame)
+       frame = new cFrame(Data, Count, ftVideo, Sequence);
+    if (ringBuffer->Put(frame)) {
+       frame = NULL;
+       return true;
+       }
+    return false;
+    }
+  virtual cFrame *GetFrame(void) { return ringBuffer->Get(); }
+  virtual void DropFrame(cFrame *Frame) { ringBuffer->Drop(Frame); }
+public:
+  cBenchFrame(void) : cBenchFrameBuffer("ringbuffer.frame") { ringBuffer = NULL; frame = NULL; }
+  };
+
+class cBenchFramePool : public cBenchFrameBuffer {
+private:
+  cRingBufferFramePool *ringBuffer;
+protected:
+  virtual void CreateBuffer(void) { ringBuffer = new cRingBufferFramePool(FRAMEBUFSIZE, FRAMEBUFFRAMES); }
+  virtual void DeleteBuffer(void) { delete ringBuffer; ringBuffer = NULL; }
+  virtual bool PutFrame(const uchar *Data, int Count, int Sequence) { return ringBuffer->Put(Data, Count, ftVideo, Sequence); }
+  virtual cFrame *GetFrame(void) { return ringBuffer->Get(); }
+  virtual void DropFrame(cFrame *Frame) { ringBuffer->Drop(Frame); }
+public:
+  cBenchFramePool(void) : cBenchFrameBuffer("ringbuffer.framepool") { ringBuffer = NULL; }
+  };
+
+// --- Index file ------------------------------------------------------------
+
+class cBenchIndexFile : public cBenchmark {
+protected:
+  cString directory;
+  cIndexFile *indexFile;
+  int last;
+public:
+  cBenchIndexFile(const char *Name) : cBenchmark(Name) { indexFile = NULL; last = -1; }
+  virtual bool Setup(void) {
+    directory = TempDirectory();
+    if (!*directory)
+       return false;
+    cIndexFile *IndexFile = new cIndexFile(directory, true);
+    for (int i = 0; i < INDEXFRAMES; i++)
+        IndexFile->Write(i % GOPSIZE == 0, 1 + i / 30000, off_t(i % 30000) * 20000);
+    delete IndexFile;
+    indexFile = new cIndexFile(directory, false);
+    last = indexFile->Last();
+    return indexFile->Ok() && last > 0;
+    }
+  virtual void Teardown(void) {
+    delete indexFile;
+    if (*directory)
+       RemoveFileOrDir(directory);
+    }
+  };
+
+class cBenchIndexGet : public cBenchIndexFile {
+public:
+  cBenchIndexGet(void) : cBenchIndexFile("index.get") {}
+  virtual void Run(int &Operations, int64_t &Bytes) {
+    uint16_t FileNumber;
+    off_t FileOffset;
+    for (int i = 0; i < LOOKUPS; i++)
+        indexFile->Get(Random(last), &FileNumber, &FileOffset);
+    Operations = LOOKUPS;
+    }
+  };
+
+class cBenchIndexIFrame : public cBenchIndexFile {
+public:
+  cBenchIndexIFrame(void) : cBenchIndexFile("index.iframe") {}
+  virtual void Run(int &Operations, int64_t &Bytes) {
+    for (int i = 0; i < LOOKUPS; i++) {
+        indexFile->GetNextIFrame(Random(last), i & 1);
+        indexFile->GetClosestIFrame(Random(last));
+        }
+    Operations = 2 * LOOKUPS;
+    }
+  };
+
+class cBenchIndexOffset : public cBenchIndexFile {
+public:
+  cBenchIndexOffset(void) : cBenchIndexFile("index.offset") {}
+  virtual void Run(int &Operations, int64_t &Bytes) {
+    for (int i = 0; i < LOOKUPS; i++) {
+        int Index = Random(last);
+        indexFile->Get(1 + Index / 30000, off_t(Index % 30000) * 20000);
+        }
+    Operations = LOOKUPS;
+    }
+  };
+
+// --- EPG -------------------------------------------------------------------
+
+class cBenchSchedule : public cBenchmark {
+protected:
+  cSchedule *schedule;
+  time_t start;
+public:
+  cBenchSchedule(const char *Name) : cBenchmark(Name) { schedule = NULL; start = 0; }
+  virtual bool Setup(void) {
+    schedule = new cSchedule(tChannelID(cSource::FromString("S19.2E"), 1, 1234, 1));
+    start = time(NULL) - SCHEDULEEVENTS / 2 * 1800;
+    for (int i = 0; i < SCHEDULEEVENTS; i++) {
+        cEvent *Event = new cEvent(i + 1);
+        Event->SetTitle(cString::sprintf("Event %d", i + 1));
+        Event->SetStartTime(start + i * 1800);
+        Event->SetDuration(1800);
+        schedule->AddEvent(Event);
+        }
+    schedule->Sort();
+    return true;
+    }
+  virtual void Teardown(void) { delete schedule; }
+  };
+
+class cBenchScheduleAround : public cBenchSchedule {
+public:
+  cBenchScheduleAround(void) : cBenchSchedule("epg.eventaround") {}
+  virtual void Run(int &Operations, int64_t &Bytes) {
+    for (int i = 0; i < LOOKUPS; i++)
+        schedule->GetEventAround(start + Random(SCHEDULEEVENTS * 1800));
+    Operations = LOOKUPS;
+    }
+  };
+
+class cBenchScheduleId : public cBenchSchedule {
+public:
+  cBenchScheduleId(void) : cBenchSchedule("epg.eventbyid") {}
+  virtual void Run(int &Operations, int64_t &Bytes) {
+    for (int i = 0; i < LOOKUPS; i++)
+        schedule->GetEvent(1 + Random(SCHEDULEEVENTS));
+    Operations = LOOKUPS;
+    }
+  };
+
+class cBenchSchedulePresent : public cBenchSchedule {
+public:
+  cBenchSchedulePresent(void) : cBenchSchedule("epg.present") {}
+  virtual void Run(int &Operations, int64_t &Bytes) {
+    for (int i = 0; i < LOOKUPS; i++) {
+        schedule->GetPresentEvent();
+        schedule->GetFollowingEvent();
+        }
+    Operations = 2 * LOOKUPS;
+    }
+  };
+
+// --- Hash ------------------------------------------------------------------
+
+// The keys are start times in steps of 5 minutes, like those of cSchedule's
+// eventsHashStartTime. Every result is checked.
+
+class cBenchHashObject : public cListObject {
+public:
+  unsigned int id;
+  cBenchHashObject(unsigned int Id) { id = Id; }
+  };
+
+static unsigned int HashKey(int Index)
+{
+  return EITSTARTTIME + Index * 300;
+}
+
+class cBenchHash : public cBenchmark {
+protected:
+  cList<cBenchHashObject> objects;
+  int errors;
+public:
+  cBenchHash(const char *Name) : cBenchmark(Name) { errors = 0; }
+  virtual bool Setup(void) {
+    errors = 0;
+    for (int i = 0; i < HASHOBJECTS; i++)
+        objects.Add(new cBenchHashObject(HashKey(i)));
+    return true;
+    }
+  virtual bool Verify(void) {
+    if (errors)
+       fprintf(stderr, "%s: %d wrong results\n", Name(), errors);
+    return !errors;
+    }
+  virtual void Teardown(void) { objects.Clear(); }
+  };
+
+// Looks up existing and (in every other case) non-existing keys.
+
+class cBenchHashGet : public cBenchHash {
+private:
+  cHash<cBenchHashObject> *hash;
+public:
+  cBenchHashGet(void) : cBenchHash("hash.get") { hash = NULL; }
+  virtual bool Setup(void) {
+    cBenchHash::Setup();
+    hash = new cHash<cBenchHashObject>;
+    for (cBenchHashObject *Object = objects.First(); Object; Object = objects.Next(Object))
+        hash->Add(Object, Object->id);
+    return true;
+    }
+  virtual void Run(int &Operations, int64_t &Bytes) {
+    for (int i = 0; i < LOOKUPS; i++) {
+        int Index = Random(HASHOBJECTS * 2);
+        cBenchHashObject *Object = hash->Get(HashKey(Index));
+        if (Index < HASHOBJECTS ? !Object || Object->id != HashKey(Index) : Object != NULL)
+           errors++;
+        }
+    Operations = LOOKUPS;
+    }
+  virtual void Teardown(void) { delete hash; hash = NULL; cBenchHash::Teardown(); }
+  };
+
+// Adds all objects to a new hash, which starts with the default size, and then
+// looks up and deletes each of them.
+
+class cBenchHashAddDel : public cBenchHash {
+public:
+  cBenchHashAddDel(void) : cBenchHash("hash.adddel") {}
+  virtual void Run(int &Operations, int64_t &Bytes) {
+    cHash<cBenchHashObject> Hash;
+    for (cBenchHashObject *Object = objects.First(); Object; Object = objects.Next(Object))
+        Hash.Add(Object, Object->id);
+    if (Hash.Count() != HASHOBJECTS)
+       errors++;
+    for (cBenchHashObject *Object = objects.First(); Object; Object = objects.Next(Object)) {
+        if (Hash.Get(Object->id) != Object)
+           errors++;
+        Hash.Del(Object, Object->id);
+        }
+    if (Hash.Count())
+       errors++;
+    Operations = HASHOBJECTS;
+    }
+  };
+
+// --- SI --------------------------------------------------------------------
+
+class cBenchEit : public cBenchmark {
+private:
+  uchar section[MAX_SECTION_SIZE];
+  int length;
+public:
+  cBenchEit(void) : cBenchmark("si.eit") { length = 0; }
+  virtual bool Setup(void) { length = MakeEitSection(section, 0, 0); return true; }
+  virtual void Run(int &Operations, int64_t &Bytes) {
+    char Buffer[256];
+    for (int i = 0; i < 100; i++) {
+        SI::EIT Eit(section, false);
+        if (!Eit.CheckCRCAndParse())
+           break;
+        SI::EIT::Event Event;
+        for (SI::Loop::Iterator it; Eit.eventLoop.getNext(Event, it); ) {
+            Event.getEventId();
+            Event.getStartTime();
+            Event.getDuration();
+            SI::Descriptor *d;
+            for (SI::Loop::Iterator it2; (d = Event.eventDescriptors.getNext(it2)); ) {
+                switch (d->getDescriptorTag()) {
+                  case SI::ShortEventDescriptorTag: {
+                       SI::ShortEventDescriptor *sed = (SI::ShortEventDescriptor *)d;
+                       sed->name.getText(Buffer, sizeof(Buffer));
+                       sed->text.getText(Buffer, sizeof(Buffer));
+                       }
+                       break;
+                  case SI::ExtendedEventDescriptorTag: {
+                       SI::ExtendedEventDescriptor *eed = (SI::ExtendedEventDescriptor *)d;
+                       eed->text.getText(Buffer, sizeof(Buffer));
+                       }
+                       break;
+                  default: ;
+                  }
+                delete d;
+                }
+            }
+        Operations++;
+        Bytes += length;
+        }
+    }
+  };
+
+// Calculates the CRC32 of sections of the given length. The results are checked
+// against a bitwise calculation for buffers of random length and alignment, both
+// for SI::CRC32::crc32() and for its table driven implementation, which crc32()
+// doesn't use for longer data if the CPU supports carry-less multiplication.
+
+static uint32_t BitwiseCrc32(const uchar *Data, int Length, uint32_t Crc)
+{
+  while (Length-- > 0) {
+        Crc ^= uint32_t(*Data++) << 24;
+        for (int i = 0; i < 8; i++)
+            Crc = (Crc & 0x80000000) ? (Crc << 1) ^ 0x04C11DB7 : Crc << 1;
+        }
+  return Crc;
+}
+
+class cCrc32Bytes : public SI::CRC32 {
+public:
+  static uint32_t Crc32(const uchar *Data, int Length, uint32_t Crc) { return crc32Bytes(Data, Length, Crc); }
+  };
+
+class cBenchCrc32 : public cBenchmark {
+private:
+  uchar data[MAX_SECTION_SIZE + 8];
+  int length;
+  uint32_t crc;
+public:
+  cBenchCrc32(const char *Name, int Length) : cBenchmark(Name) { length = Length; crc = 0; }
+  virtual bool Setup(void) {
+    for (uint i = 0; i < sizeof(data); i++)
+        data[i] = Random(256);
+    return true;
+    }
+  virtual void Run(int &Operations, int64_t &Bytes) {
+    for (int i = 0; i < LOOKUPS; i++)
+        crc ^= SI::CRC32::crc32((const char *)data, length, 0xFFFFFFFF);
+    Operations = LOOKUPS;
+    Bytes = int64_t(LOOKUPS) * length;
+    }
+  virtual bool Verify(void) {
+    for (int i = 0; i < CRCCHECKS; i++) {
+        int Offset = Random(8);
+        int Length = Random(MAX_SECTION_SIZE + 1);
+        uint32_t Crc = i ? rand_r(&RandomSeed) : 0xFFFFFFFF;
+        uint32_t Expected = BitwiseCrc32(data + Offset, Length, Crc);
+        uint32_t Actual = SI::CRC32::crc32((const char *)data + Offset, Length, Crc);
+        uint32_t Table = cCrc32Bytes::Crc32(data + Offset, Length, Crc);
+        if (Actual != Expected || Table != Expected) {
+           fprintf(stderr, "%s: CRC32 of %d bytes at offset %d from %08X is %08X/%08X instead of %08X\n", Name(), Length, Offset, Crc, Actual, Table, Expected);
+           return false;
+           }
+        }
+    return true;
+    }
+  };
+
+// Decodes the texts of EIT events in character tables that are typically used by
+// broadcasters, each as a short title and as a longer description. The original
+// UTF-8 texts are encoded with iconv, and the results of the last batch are
+// compared with them. The texts only contain characters that exist in their table.
+
+static const struct {
+  const char *prefix; // the bytes that select the character table in the text
+  int prefixLength;
+  const char *table;
+  const char *text; // UTF-8
+  } BenchTexts[] = {
+  { "",             0, "ISO6937",     "Gr\xC3\xBC\xC3\x9F" "e aus M\xC3\xBCnchen: \xC3\x9C" "berraschung \xC3\xA0 la carte f\xC3\xBCr Zuschauer" },
+  { "\x01",         1, "ISO-8859-5",  "\xD0\x9D\xD0\xBE\xD0\xB2\xD0\xBE\xD1\x81\xD1\x82\xD0\xB8 \xD0\xB8 \xD0\xBF\xD0\xBE\xD0\xB3\xD0\xBE\xD0\xB4\xD0\xB0 \xD0\xBD\xD0\xB0 \xD1\x81\xD0\xB5\xD0\xB3\xD0\xBE\xD0\xB4\xD0\xBD\xD1\x8F" },
+  { "\x05",         1, "ISO-8859-9",  "T\xC3\xBCrk\xC3\xA7" "e altyaz\xC4\xB1l\xC4\xB1 film: G\xC3\xBCne\xC5\x9Fli bir g\xC3\xBCn \xC4\xB0stanbul'da" },
+  { "\x0B",         1, "ISO-8859-15", "Prix: 20 \xE2\x82\xAC pour l'\xC5\x93uvre compl\xC3\xA8te" },
+  { "\x10\x00\x02", 3, "ISO-8859-2",  "P\xC5\x99\xC3\xADli\xC5\xA1 \xC5\xBElu\xC5\xA5ou\xC4\x8Dk\xC3\xBD k\xC5\xAF\xC5\x88 \xC3\xBAp\xC4\x9Bl \xC4\x8F\xC3\xA1" "belsk\xC3\xA9 \xC3\xB3" "dy" },
+  { "\x15",         1, "UTF-8",       "\xE6\x97\xA5\xE6\x9C\xAC\xE8\xAA\x9E\xE3\x81\xAE\xE3\x83\x8B\xE3\x83\xA5\xE3\x83\xBC\xE3\x82\xB9 und Gr\xC3\xBC\xC3\x9F" "e aus M\xC3\xBCnchen" },
+  };
+
+#define NUMBENCHTEXTS (int(sizeof(BenchTexts) / sizeof(BenchTexts[0])) * 2)
+
+class cBenchText : public cBenchmark {
+private:
+  uchar corpus[NUMBENCHTEXTS][TEXTSIZE];
+  SI::String texts[NUMBENCHTEXTS];
+  cStringList expected;
+  char results[NUMBENCHTEXTS][TEXTSIZE * 4];
+  bool Encode(int Index, const char *Text, uchar *Data, int &Length) {
+    iconv_t cd = iconv_open(BenchTexts[Index].table, "UTF-8");
+    if (cd == (iconv_t)-1) {
+       LOG_ERROR_STR(BenchTexts[Index].table);
+       return false;
+       }
+    memcpy(Data, BenchTexts[Index].prefix, BenchTexts[Index].prefixLength);
+    char *from = (char *)Text;
+    size_t fromLength = strlen(Text);
+    char *to = (char *)Data + BenchTexts[Index].prefixLength;
+    size_t toLength = TEXTSIZE - 1 - BenchTexts[Index].prefixLength;
+    bool Ok = iconv(cd, &from, &fromLength, &to, &toLength) != size_t(-1) && !fromLength;
+    iconv_close(cd);
+    Length = to - (char *)Data;
+    return Ok;
+    }
+public:
+  cBenchText(void) : cBenchmark("si.text") {}
+  virtual bool Setup(void) {
+    expected.Clear();
+    for (int i = 0; i < NUMBENCHTEXTS; i++) {
+        const char *Title = BenchTexts[i / 2].text;
+        cString Text = Title;
+        if (i % 2) {
+           for (int r = 1; r < TEXTREPEAT; r++)
+               Text = cString::sprintf("%s. %s", *Text, Title);
+           }
+        int Length;
+        if (!Encode(i / 2, Text, corpus[i], Length))
+           return false;
+        SI::CharArray Data;
+        Data.assign(corpus[i], Length, false);
+        texts[i].setData(Data, Length);
+        expected.Append(strdup(Text));
+        }
+    return true;
+    }
+  virtual void Run(int &Operations, int64_t &Bytes) {
+    for (int i = 0; i < NUMBENCHTEXTS; i++) {
+        texts[i].getText(results[i], sizeof(results[i]));
+        Bytes += texts[i].getLength();
+        }
+    Operations = NUMBENCHTEXTS;
+    }
+  virtual bool Verify(void) {
+    bool Ok = true;
+    for (int i = 0; i < NUMBENCHTEXTS; i++) {
+        if (strcmp(results[i], expected[i]) != 0) {
+           fprintf(stderr, "%s: %s: '%s' decoded as '%s'\n", Name(), BenchTexts[i / 2].table, expected[i], results[i]);
+           Ok = false;
+           }
+        }
+    return Ok;
+    }
+  };
+
+// --- Font ------------------------------------------------------------------
+
+class cBenchFont : public cBenchmark {
+private:
+  cFont *font;
+  cBitmap *bitmap;
+public:
+  cBenchFont(void) : cBenchmark("font.drawtext") { font = NULL; bitmap = NULL; }
+  virtual bool Setup(void) {
+    if (!*cFont::GetFontFileName(DefaultFontOsd))
+       return false; // no actual font available
+    font = cFont::CreateFont(DefaultFontOsd, 30);
+    bitmap = new cBitmap(1280, 40, 8);
+    return true;
+    }
+  virtual void Run(int &Operations, int64_t &Bytes) {
+    static const char *Text = "Die Sendung mit der Maus - Lach- und Sachgeschichten";
+    for (int i = 0; i < 100; i++) {
+        bitmap->DrawText(0, 0, Text, clrWhite, clrBlack, font);
+        Bytes += strlen(Text);
+        }
+    Operations = 100;
+    }
+  virtual void Teardown(void) { delete bitmap; delete font; }
+  };
+
+// --- OSD -------------------------------------------------------------------
+
+// A true color OSD that renders its pixmaps in memory, like an output device
+// would do before copying the result to the screen.
+
+class cBenchOsd : public cOsd {
+private:
+  int64_t *bytes;
+public:
+  cBenchOsd(int Left, int Top, uint Level, int64_t *Bytes) : cOsd(Left, Top, Level) { bytes = Bytes; }
+  virtual ~cBenchOsd() { SetActive(false); }
+  virtual void Flush(void) {
+    LOCK_PIXMAPS;
+    while (cPixmapMemory *pm = dynamic_cast<cPixmapMemory *>(RenderPixmaps())) {
+          *bytes += pm->ViewPort().Width() * pm->ViewPort().Height() * sizeof(tColor);
+          DestroyPixmap(pm);
+          }
+    }
+  };
+
+class cBenchOsdProvider : public cOsdProvider {
+private:
+  int64_t *bytes;
+protected:
+  virtual cOsd *CreateOsd(int Left, int Top, uint Level) { return new cBenchOsd(Left, Top, Level, bytes); }
+  virtual bool ProvidesTrueColor(void) { return true; }
+public:
+  cBenchOsdProvider(int64_t *Bytes) { bytes = Bytes; }
+  };
+
+// Updates the replay display of the LCARS skin once per second of a two hour
+// recording. The display is opened in "mode only" mode, since otherwise it
+// would need a primary device to show the audio track, but it is updated like
+// the full display. Bytes are the rendered parts of the OSD.
+
+class cBenchLcarsReplay : public cBenchmark {
+private:
+  int64_t bytes;
+  cSkin *skin;
+  cSkinDisplayReplay *displayReplay;
+  int current;
+public:
+  cBenchLcarsReplay(void) : cBenchmark("osd.lcarsreplay") { bytes = 0; skin = NULL; displayReplay = NULL; current = 0; }
+  virtual bool Setup(void) {
+    if (!*cFont::GetFontFileName(::Setup.FontOsd))
+       return false; // no actual font available
+    // The OSD size cOsdProvider::UpdateOsdSize() would set for a full HD device:
+    ::Setup.OSDLeft = int(round(1920 * ::Setup.OSDLeftP));
+    ::Setup.OSDTop = int(round(1080 * ::Setup.OSDTopP));
+    ::Setup.OSDWidth = int(round(1920 * ::Setup.OSDWidthP)) & ~0x07;
+    ::Setup.OSDHeight = int(round(1080 * ::Setup.OSDHeightP));
+    ::Setup.FontOsdSize = int(round(1080 * ::Setup.FontOsdSizeP));
+    ::Setup.FontSmlSize = int(round(1080 * ::Setup.FontSmlSizeP));
+    cFont::SetFont(fontOsd, ::Setup.FontOsd, ::Setup.FontOsdSize);
+    cFont::SetFont(fontSml, ::Setup.FontSml, min(::Setup.FontSmlSize, ::Setup.FontOsdSize));
+    cThemes::SetThemesDirectory(cVideoDirectory::Name());
+    new cBenchOsdProvider(&bytes);
+    skin = new cSkinLCARS;
+    displayReplay = skin->DisplayReplay(true);
+    displayReplay->SetMode(true, true, 1);
+    displayReplay->SetTotal(IndexToHMSF(INDEXFRAMES));
+    displayReplay->Flush();
+    return true;
+    }
+  virtual void Run(int &Operations, int64_t &Bytes) {
+    bytes = 0;
+    for (int i = 0; i < 100; i++) {
+        displayReplay->SetProgress(current, INDEXFRAMES);
+        displayReplay->SetCurrent(IndexToHMSF(current));
+        displayReplay->Flush();
+        current = (current + int(DEFAULTFRAMESPERSECOND)) % INDEXFRAMES;
+        }
+    Operations = 100;
+    Bytes = bytes;
+    }
+  virtual void Teardown(void) {
+    delete displayReplay;
+    if (skin)
+       Skins.Del(skin);
+    cOsdProvider::Shutdown();
+    }
+  };
+
+// --- Macro benchmarks ------------------------------------------------------
+
+// Simulates the data path of cRecorder: TS data goes through a ring buffer
+// and the frame detector, and is written into a recording with an index.
+
+class cBenchRecord : public cBenchmark {
+private:
+  cString directory;
+  cRingBufferLinear *ringBuffer;
+  cFrameDetector *frameDetector;
+  cIndexFile *indexFile;
+  cFileName *fileName;
+  cUnbufferedFile *recordFile;
+  off_t fileSize;
+public:
+  cBenchRecord(void) : cBenchmark("macro.record") { ringBuffer = NULL; frameDetector = NULL; indexFile = NULL; fileName = NULL; recordFile = NULL; fileSize = 0; }
+  virtual bool Setup(void) {
+    directory = TempDirectory();
+    if (!*directory)
+       return false;
+    ringBuffer = new cRingBufferLinear(MEGABYTE(20), MIN_TS_PACKETS_FOR_FRAME_DETECTOR * TS_SIZE, true, "Bench");
+    frameDetector = new cFrameDetector(VPID, 0x1B);
+    indexFile = new cIndexFile(directory, true);
+    fileName = new cFileName(directory, true);
+    recordFile = fileName->Open();
+    return recordFile != NULL;
+    }
+  virtual void Run(int &Operations, int64_t &Bytes) {
+    const uchar *p = Stream()->Data();
+    int l = Stream()->Length();
+    while (l > 0) {
+          int n = ringBuffer->Put(p, min(l, KILOBYTE(64)));
+          p += n;
+          l -= n;
+          // whatever is left in the ring buffer is processed in the next batch
+          int r;
+          while (uchar *b = ringBuffer->Get(r)) {
+                int Count = frameDetector->Analyze(b, r);
+                if (!Count)
+                   break;
+                if (frameDetector->NewFrame()) {
+                   indexFile->Write(frameDetector->IndependentFrame(), fileName->Number(), fileSize);
+                   Operations++;
+                   }
+                if (recordFile->Write(b, Count) < 0)
+                   return;
+                fileSize += Count;
+                Bytes += Count;
+                ringBuffer->Del(Count);
+                }
+          }
+    if (fileSize > RECORDFILESIZE) {
+       fileName->Close();
+       unlink(fileName->Name());
+       recordFile = fileName->SetOffset(1);
+       fileSize = 0;
+       }
+    }
+  virtual void Teardown(void) {
+    delete fileName;
+    delete indexFile;
+    delete frameDetector;
+    delete ringBuffer;
+    if (*directory)
+       RemoveFileOrDir(directory);
+    }
+  };
+
+// Simulates the EPG data path of cEIT: EIT sections are parsed and their
+// events are stored in a schedule.
+
+class cBenchEpg : public cBenchmark {
+private:
+  uchar sections[EITSECTIONS][MAX_SECTION_SIZE];
+  int lengths[EITSECTIONS];
+  cSchedule *schedule;
+public:
+  cBenchEpg(void) : cBenchmark("macro.epg") { schedule = NULL; }
+  virtual bool Setup(void) {
+    for (int i = 0; i < EITSECTIONS; i++)
+        lengths[i] = MakeEitSection(sections[i], i, 0);
+    schedule = new cSchedule(tChannelID(cSource::FromString("S19.2E"), 1, 1234, 1));
+    return true;
+    }
+  virtual void Run(int &Operations, int64_t &Bytes) {
+    char Buffer[256];
+    for (int i = 0; i < EITSECTIONS; i++) {
+        SI::EIT Eit(sections[i], false);
+        if (!Eit.CheckCRCAndParse())
+           break;
+        SI::EIT::Event SiEvent;
+        for (SI::Loop::Iterator it; Eit.eventLoop.getNext(SiEvent, it); ) {
+            cEvent *Event = (cEvent *)schedule->GetEvent(SiEvent.getEventId(), SiEvent.getStartTime());
+            if (!Event) {
+               Event = new cEvent(SiEvent.getEventId());
+               Event->SetStartTime(SiEvent.getStartTime());
+               Event->SetDuration(SiEvent.getDuration());
+               schedule->AddEvent(Event);
+               }
+            Event->SetTableID(Eit.getTableId());
+            Event->SetVersion(Eit.getVersionNumber());
+            SI::Descriptor *d;
+            for (SI::Loop::Iterator it2; (d = SiEvent.eventDescriptors.getNext(it2)); ) {
+                switch (d->getDescriptorTag()) {
+                  case SI::ShortEventDescriptorTag: {
+                       SI::ShortEventDescriptor *sed = (SI::ShortEventDescriptor *)d;
+                       Event->SetTitle(sed->name.getText(Buffer, sizeof(Buffer)));
+                       Event->SetShortText(sed->text.getText(Buffer, sizeof(Buffer)));
+                       }
+                       break;
+                  case SI::ExtendedEventDescriptorTag: {
+                       SI::ExtendedEventDescriptor *eed = (SI::ExtendedEventDescriptor *)d;
+                       Event->SetDescription(eed->text.getText(Buffer, sizeof(Buffer)));
+                       }
+                       break;
+                  default: ;
+                  }
+                delete d;
+                }
+            }
+        schedule->Sort();
+        Operations++;
+        Bytes += lengths[i];
+        }
+    }
+  virtual void Teardown(void) { delete schedule; }
+  };
+
+// --- Runner ----------------------------------------------------------------
+
+static int CompareNs(const void *a, const void *b)
+{
+  double d = *(const double *)a - *(const double *)b;
+  return d < 0 ? -1 : d > 0 ? 1 : 0;
+}
+
+static double Percentile(const cVector<double> &Samples, double Percent)
+{
+  if (Samples.Size() == 0)
+     return 0;
+  int i = int(Percent / 100 * (Samples.Size() - 1) + 0.5);
+  return Samples[i];
+}
+
+static bool Measure(cBenchmark *Benchmark, double Seconds)
+{
+  if (!Benchmark->Setup()) {
+     printf("{\"benchmark\":\"%s\",\"skipped\":true}\n", Benchmark->Name());
+     Benchmark->Teardown();
+     return true;
+     }
+  // Warm up:
+  uint64_t Start = NowNs();
+  while (NowNs() - Start < Seconds * WARMUPFRACTION * 1e9) {
+        int Operations = 0;
+        int64_t Bytes = 0;
+        Benchmark->Run(Operations, Bytes);
+        }
+  // Measure:
+  cVector<double> Samples(1000);
+  int64_t TotalOperations = 0;
+  int64_t TotalBytes = 0;
+  uint64_t TotalNs = 0;
+  while (TotalNs < Seconds * 1e9 || Samples.Size() < 10) {
+        int Operations = 0;
+        int64_t Bytes = 0;
+        uint64_t t = NowNs();
+        Benchmark->Run(Operations, Bytes);
+        t = NowNs() - t;
+        TotalNs += t;
+        TotalOperations += Operations;
+        TotalBytes += Bytes;
+        Samples.Append(Operations ? double(t) / Operations : double(t));
+        }
+  bool Ok = Benchmark->Verify();
+  Benchmark->Teardown();
+  qsort(&Samples[0], Samples.Size(), sizeof(double), CompareNs);
+  double s = TotalNs / 1e9;
+  printf("{\"benchmark\":\"%s\",\"batches\":%d,\"ops\":%" PRId64 ",\"seconds\":%.3f,\"ops_per_sec\":%.1f,\"mb_per_sec\":%.2f,"
+         "\"ns_per_op\":{\"min\":%.1f,\"p50\":%.1f,\"p90\":%.1f,\"p99\":%.1f,\"max\":%.1f}%s}\n",
+         Benchmark->Name(), Samples.Size(), TotalOperations, s, TotalOperations / s, TotalBytes / s / MEGABYTE(1),
+         Samples[0], Percentile(Samples, 50), Percentile(Samples, 90), Percentile(Samples, 99), Samples[Samples.Size() - 1], Ok ? "" : ",\"failed\":true");
+  fflush(stdout);
+  return Ok;
+}
+
+static bool Selected(const char *Name, int argc, char *argv[])
+{
+  if (optind >= argc)
+     return true;
+  for (int i = optind; i < argc; i++) {
+      if (startswith(Name, argv[i]))
+         return true;
+      }
+  return false;
+}
+
+int main(int argc, char *argv[])
+{
+  double Seconds = DEFAULTBENCHTIME;
+  bool List = false;
+  int c;
+  while ((c = getopt(argc, argv, "lt:")) != -1) {
+        switch (c) {
+          case 'l': List = true;
+                    break;
+          case 't': Seconds = atof(optarg);
+                    if (Seconds > 0)
+                       break;
+                    // fall through
+          default:  fprintf(stderr, "usage: vdr-bench [-l] [-t SECONDS] [NAME...]\n"
+                                    "  -l          list the available benchmarks and exit\n"
+                                    "  -t SECONDS  run each benchmark for SECONDS (default: %.1f)\n"
+                                    "  NAME        only run the benchmarks whose names start with NAME\n",
+                                    DEFAULTBENCHTIME);
+                    return 2;
+          }
+        }
+  SysLogLevel = 1;
+  SI::SetSystemCharacterTable("UTF-8"); // vdr uses the locale's character set
+  cList<cBenchmark> Benchmarks;
+  Benchmarks.Add(new cBenchFrameDetector);
+  Benchmarks.Add(new cBenchTsToPes);
+  Benchmarks.Add(new cBenchParsePmt);
+  Benchmarks.Add(new cBenchRingBuffer);
+  Benchmarks.Add(new cBenchFrame);
+  Benchmarks.Add(new cBenchFramePool);
+  Benchmarks.Add(new cBenchIndexGet);
+  Benchmarks.Add(new cBenchIndexIFrame);
+  Benchmarks.Add(new cBenchIndexOffset);
+  Benchmarks.Add(new cBenchScheduleAround);
+  Benchmarks.Add(new cBenchScheduleId);
+  Benchmarks.Add(new cBenchSchedulePresent);
+  Benchmarks.Add(new cBenchHashGet);
+  Benchmarks.Add(new cBenchHashAddDel);
+  Benchmarks.Add(new cBenchEit);
+  Benchmarks.Add(new cBenchText);
+  Benchmarks.Add(new cBenchCrc32("si.crc32", MAX_SECTION_SIZE));
+  Benchmarks.Add(new cBenchCrc32("si.crc32short", 32)); // about the size of a PAT or PMT section
+  Benchmarks.Add(new cBenchFont);
+  Benchmarks.Add(new cBenchLcarsReplay);
+  Benchmarks.Add(new cBenchRecord);
+  Benchmarks.Add(new cBenchEpg);
+  if (List) {
+     for (cBenchmark *b = Benchmarks.First(); b; b = Benchmarks.Next(b))
+         printf("%s\n", b->Name());
+     return 0;
+     }
+  const char *Tmp = getenv("TMPDIR");
+  cString Directory = TempDirectory(Tmp ? Tmp : "/tmp");
+  if (!*Directory)
+     return 1;
+  cVideoDirectory::SetName(Directory); // recordings are written into this directory
+  printf("{\"vdr\":\"%s\",\"compiler\":\"%s\",\"seconds\":%.1f}\n", VDRVERSION, __VERSION__, Seconds);
+  Stream();
+  bool Ok = true;
+  for (cBenchmark *b = Benchmarks.First(); b; b = Benchmarks.Next(b)) {
+      if (Selected(b->Name(), argc, argv) && !Measure(b, Seconds))
+         Ok = false;
+      }
+  delete BenchStream;
+  RemoveFileOrDir(Directory);
+  return Ok ? 0 : 1;
+}
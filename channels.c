@@ -836,16 +836,50 @@ public:
 // --- cChannels -------------------------------------------------------------
 
 cChannels cChannels::channels;
+cSnapshots<cChannels> cChannels::snapshots;
 int cChannels::maxNumber = 0;
 int cChannels::maxChannelNameLength = 0;
 int cChannels::maxShortChannelNameLength = 0;
 
+static unsigned int ChannelHashKey(int Nid, int Tid, int Sid = 0)
+{
+  return ((unsigned int)Nid * 0x9E3779B1 ^ (unsigned int)Tid) * 0x85EBCA77 ^ (unsigned int)Sid;
+}
+
 cChannels::cChannels(void)
 :cConfig<cChannel>("2 Channels")
 {
   modifiedByUser = 0;
 }
 
+cChannels::cChannels(const cChannels &Channels)
+{
+  modifiedByUser = Channels.modifiedByUser;
+  for (const cChannel *Channel = Channels.First(); Channel; Channel = Channels.Next(Channel)) {
+      cChannel *Copy = new cChannel(*Channel);
+      Add(Copy);
+      if (!Copy->GroupSep()) {
+         HashChannel(Copy);
+         AddToNumberIndex(Copy);
+         }
+      }
+  // The copies of linked channels must point to each other:
+  for (const cChannel *Channel = Channels.First(); Channel; Channel = Channels.Next(Channel)) {
+      if (const cLinkChannels *LinkChannels = Channel->LinkChannels()) {
+         cChannel *Copy = GetByChannelID(Channel->GetChannelID());
+         if (Copy && !Copy->linkChannels) {
+            Copy->linkChannels = new cLinkChannels;
+            for (const cLinkChannel *lc = LinkChannels->First(); lc; lc = LinkChannels->Next(lc)) {
+                if (cChannel *LinkCopy = GetByChannelID(lc->Channel()->GetChannelID())) {
+                   Copy->linkChannels->Add(new cLinkChannel(LinkCopy));
+                   LinkCopy->refChannel = Copy;
+                   }
+                }
+            }
+         }
+      }
+}
+
 const cChannels *cChannels::GetChannelsRead(cStateKey &StateKey, int TimeoutMs)
 {
   return channels.Lock(StateKey, false, TimeoutMs) ? &channels : NULL;
@@ -856,6 +890,11 @@ cChannels *cChannels::GetChannelsWrite(cStateKey &StateKey, int TimeoutMs)
   return channels.Lock(StateKey, true, TimeoutMs) ? &channels : NULL;
 }
 
+cSnapshot<cChannels> cChannels::GetChannelsSnapshot(void)
+{
+  return snapshots.Get(channels);
+}
+
 void cChannels::DeleteDuplicateChannels(void)
 {
   cList<cChannelSorter> ChannelSorter;
@@ -864,15 +903,31 @@ void cChannels::DeleteDuplicateChannels(void)
          ChannelSorter.Add(new cChannelSorter(Channel));
       }
   ChannelSorter.Sort();
-  cChannelSorter *cs = ChannelSorter.First();
-  while (cs) {
-        cChannelSorter *Next = ChannelSorter.Next(cs);
-        if (Next && cs->channelID == Next->channelID) {
-           dsyslog("deleting duplicate channel %s", *Next->channel->ToText());
-           Del(Next->channel);
-           }
-        cs = Next;
-        }
+  cVector<cChannel *> Duplicates;
+  for (cChannelSorter *cs = ChannelSorter.First(); cs; cs = ChannelSorter.Next(cs)) {
+      cChannelSorter *Next = ChannelSorter.Next(cs);
+      if (Next && cs->channelID == Next->channelID) {
+         dsyslog("deleting duplicate channel %s", *Next->channel->ToText());
+         Duplicates.Append(Next->channel);
+         }
+      }
+  if (Duplicates.Size()) {
+     // Removes any links to the duplicates in one pass over the list, rather than once per duplicate:
+     for (cChannel *Channel = First(); Channel; Channel = Next(Channel)) {
+         if (const cLinkChannels *LinkChannels = Channel->LinkChannels()) {
+            for (const cLinkChannel *lc = LinkChannels->First(); lc; ) {
+                const cLinkChannel *Next = LinkChannels->Next(lc);
+                if (Duplicates.IndexOf(lc->Channel()) >= 0)
+                   Channel->DelLinkChannel(lc->Channel());
+                lc = Channel->LinkChannels() ? Next : NULL;
+                }
+            }
+         }
+     for (int i = 0; i < Duplicates.Size(); i++) {
+         UnhashChannel(Duplicates[i]);
+         cList<cChannel>::Del(Duplicates[i]);
+         }
+     }
 }
 
 bool cChannels::Load(const char *FileName, bool AllowComments, bool MustExist)
@@ -889,11 +944,15 @@ bool cChannels::Load(const char *FileName, bool AllowComments, bool MustExist)
 void cChannels::HashChannel(cChannel *Channel)
 {
   channelsHashSid.Add(Channel, Channel->Sid());
+  channelsHashId.Add(Channel, ChannelHashKey(Channel->Nid(), Channel->Tid(), Channel->Sid()));
+  channelsHashTransponder.Add(Channel, ChannelHashKey(Channel->Nid(), Channel->Tid()));
 }
 
 void cChannels::UnhashChannel(cChannel *Channel)
 {
   channelsHashSid.Del(Channel, Channel->Sid());
+  channelsHashId.Del(Channel, ChannelHashKey(Channel->Nid(), Channel->Tid(), Channel->Sid()));
+  channelsHashTransponder.Del(Channel, ChannelHashKey(Channel->Nid(), Channel->Tid()));
 }
 
 int cChannels::GetNextGroup(int Idx) const
@@ -931,6 +990,9 @@ int cChannels::GetPrevNormal(int Idx) const
 void cChannels::ReNumber(void)
 {
   channelsHashSid.Clear();
+  channelsHashId.Clear();
+  channelsHashTransponder.Clear();
+  channelsByNumber.Clear();
   maxNumber = 0;
   int Number = 1;
   for (cChannel *Channel = First(); Channel; Channel = Next(Channel)) {
@@ -942,10 +1004,22 @@ void cChannels::ReNumber(void)
          HashChannel(Channel);
          maxNumber = Number;
          Channel->SetNumber(Number++);
+         AddToNumberIndex(Channel);
          }
       }
 }
 
+void cChannels::AddToNumberIndex(cChannel *Channel)
+{
+  int Number = Channel->Number();
+  if (Number > 0) {
+     while (channelsByNumber.Size() <= Number)
+           channelsByNumber.Append(NULL);
+     if (!channelsByNumber[Number])
+        channelsByNumber[Number] = Channel;
+     }
+}
+
 bool cChannels::MoveNeedsDecrement(cChannel *From, cChannel *To)
 {
   int Number = From->Number();
@@ -968,6 +1042,9 @@ bool cChannels::MoveNeedsDecrement(cChannel *From, cChannel *To)
 void cChannels::Del(cChannel *Channel)
 {
   UnhashChannel(Channel);
+  int Number = Channel->Number();
+  if (Number > 0 && Number < channelsByNumber.Size() && channelsByNumber[Number] == Channel)
+     channelsByNumber[Number] = NULL;
   for (cChannel *ch = First(); ch; ch = Next(ch))
       ch->DelLinkChannel(Channel);
   cList<cChannel>::Del(Channel);
@@ -975,58 +1052,61 @@ void cChannels::Del(cChannel *Channel)
 
 const cChannel *cChannels::GetByNumber(int Number, int SkipGap) const
 {
-  const cChannel *Previous = NULL;
-  for (const cChannel *Channel = First(); Channel; Channel = Next(Channel)) {
-      if (!Channel->GroupSep()) {
-         if (Channel->Number() == Number)
-            return Channel;
-         else if (SkipGap && Channel->Number() > Number)
-            return SkipGap > 0 ? Channel : Previous;
-         Previous = Channel;
+  int Size = channelsByNumber.Size();
+  if (Number >= Size)
+     return NULL;
+  if (Number > 0 && channelsByNumber[Number])
+     return channelsByNumber[Number];
+  if (SkipGap > 0) {
+     for (int n = max(Number + 1, 1); n < Size; n++) {
+         if (channelsByNumber[n])
+            return channelsByNumber[n];
          }
-      }
+     }
+  else if (SkipGap < 0) {
+     for (int n = Number - 1; n > 0; n--) {
+         if (channelsByNumber[n])
+            return channelsByNumber[n];
+         }
+     }
   return NULL;
 }
 
 const cChannel *cChannels::GetByServiceID(int Source, int Transponder, unsigned short ServiceID) const
 {
-  cList<cHashObject> *list = channelsHashSid.GetList(ServiceID);
-  if (list) {
-     for (cHashObject *hobj = list->First(); hobj; hobj = list->Next(hobj)) {
-         cChannel *Channel = (cChannel *)hobj->Object();
-         if (Channel->Sid() == ServiceID && Channel->Source() == Source && ISTRANSPONDER(Channel->Transponder(), Transponder))
-            return Channel;
-         }
-     }
+  int Index;
+  for (const cChannel *Channel = channelsHashSid.First(ServiceID, Index); Channel; Channel = channelsHashSid.Next(ServiceID, Index)) {
+      if (Channel->Source() == Source && ISTRANSPONDER(Channel->Transponder(), Transponder))
+         return Channel;
+      }
   return NULL;
 }
 
 const cChannel *cChannels::GetByChannelID(tChannelID ChannelID, bool TryWithoutRid, bool TryWithoutPolarization) const
 {
   int sid = ChannelID.Sid();
-  cList<cHashObject> *list = channelsHashSid.GetList(sid);
-  if (list) {
-     for (cHashObject *hobj = list->First(); hobj; hobj = list->Next(hobj)) {
-         cChannel *Channel = (cChannel *)hobj->Object();
-         if (Channel->Sid() == sid && Channel->GetChannelID() == ChannelID)
+  int Index;
+  // A channel with Nid and Tid 0 uses its transponder as Tid in its channel id:
+  for (int i = 0; i < (ChannelID.Nid() ? 1 : 2); i++) {
+      unsigned int Key = ChannelHashKey(ChannelID.Nid(), i ? 0 : ChannelID.Tid(), sid);
+      for (const cChannel *Channel = channelsHashId.First(Key, Index); Channel; Channel = channelsHashId.Next(Key, Index)) {
+          if (Channel->GetChannelID() == ChannelID)
+             return Channel;
+          }
+      }
+  if (TryWithoutRid) {
+     ChannelID.ClrRid();
+     for (const cChannel *Channel = channelsHashSid.First(sid, Index); Channel; Channel = channelsHashSid.Next(sid, Index)) {
+         if (Channel->GetChannelID().ClrRid() == ChannelID)
+            return Channel;
+         }
+     }
+  if (TryWithoutPolarization) {
+     ChannelID.ClrPolarization();
+     for (const cChannel *Channel = channelsHashSid.First(sid, Index); Channel; Channel = channelsHashSid.Next(sid, Index)) {
+         if (Channel->GetChannelID().ClrPolarization() == ChannelID)
             return Channel;
          }
-     if (TryWithoutRid) {
-        ChannelID.ClrRid();
-        for (cHashObject *hobj = list->First(); hobj; hobj = list->Next(hobj)) {
-            cChannel *Channel = (cChannel *)hobj->Object();
-            if (Channel->Sid() == sid && Channel->GetChannelID().ClrRid() == ChannelID)
-               return Channel;
-            }
-        }
-     if (TryWithoutPolarization) {
-        ChannelID.ClrPolarization();
-        for (cHashObject *hobj = list->First(); hobj; hobj = list->Next(hobj)) {
-            cChannel *Channel = (cChannel *)hobj->Object();
-            if (Channel->Sid() == sid && Channel->GetChannelID().ClrPolarization() == ChannelID)
-               return Channel;
-            }
-        }
      }
   return NULL;
 }
@@ -1036,7 +1116,9 @@ const cChannel *cChannels::GetByTransponderID(tChannelID ChannelID) const
   int source = ChannelID.Source();
   int nid = ChannelID.Nid();
   int tid = ChannelID.Tid();
-  for (const cChannel *Channel = First(); Channel; Channel = Next(Channel)) {
+  unsigned int Key = ChannelHashKey(nid, tid);
+  int Index;
+  for (const cChannel *Channel = channelsHashTransponder.First(Key, Index); Channel; Channel = channelsHashTransponder.Next(Key, Index)) {
       if (Channel->Tid() == tid && Channel->Nid() == nid && Channel->Source() == source)
          return Channel;
       }
@@ -1046,9 +1128,13 @@ const cChannel *cChannels::GetByTransponderID(tChannelID ChannelID) const
 bool cChannels::HasUniqueChannelID(const cChannel *NewChannel, const cChannel *OldChannel) const
 {
   tChannelID NewChannelID = NewChannel->GetChannelID();
-  for (const cChannel *Channel = First(); Channel; Channel = Next(Channel)) {
-      if (!Channel->GroupSep() && Channel != OldChannel && Channel->GetChannelID() == NewChannelID)
-         return false;
+  int Index;
+  for (int i = 0; i < (NewChannelID.Nid() ? 1 : 2); i++) {
+      unsigned int Key = ChannelHashKey(NewChannelID.Nid(), i ? 0 : NewChannelID.Tid(), NewChannelID.Sid());
+      for (const cChannel *Channel = channelsHashId.First(Key, Index); Channel; Channel = channelsHashId.Next(Key, Index)) {
+          if (!Channel->GroupSep() && Channel != OldChannel && Channel->GetChannelID() == NewChannelID)
+             return false;
+          }
       }
   return true;
 }
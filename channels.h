@@ -75,7 +75,7 @@ private:
   cChannel *channel;
 public:
   cLinkChannel(cChannel *Channel) { channel = Channel; }
-  cChannel *Channel(void) { return channel; }
+  cChannel *Channel(void) const { return channel; }
   };
 
 class cLinkChannels : public cList<cLinkChannel> {
@@ -85,6 +85,7 @@ class cSchedule;
 class cChannels;
 
 class cChannel : public cListObject {
+  friend class cChannels;
   friend class cSchedules;
   friend class cMenuEditChannel;
   friend class cDvbSourceParam;
@@ -208,20 +209,31 @@ public:
 class cChannels : public cConfig<cChannel> {
 private:
   static cChannels channels;
+  static cSnapshots<cChannels> snapshots;
   static int maxNumber;
   static int maxChannelNameLength;
   static int maxShortChannelNameLength;
   int modifiedByUser;
   cHash<cChannel> channelsHashSid;
+  cHash<cChannel> channelsHashId;          // by Nid, Tid and Sid
+  cHash<cChannel> channelsHashTransponder; // by Nid and Tid
+  cVector<cChannel *> channelsByNumber;    // the channel with number n (or NULL) is at index n
   void DeleteDuplicateChannels(void);
+  void AddToNumberIndex(cChannel *Channel);
 public:
   cChannels(void);
+  cChannels(const cChannels &Channels);
+      ///< Creates a full copy of the given Channels (which must be locked),
+      ///< which is not itself subject to locking. Used for snapshots.
   static const cChannels *GetChannelsRead(cStateKey &StateKey, int TimeoutMs = 0);
       ///< Gets the list of channels for read access.
       ///< See cTimers::GetTimersRead() for details.
   static cChannels *GetChannelsWrite(cStateKey &StateKey, int TimeoutMs = 0);
       ///< Gets the list of channels for write access.
       ///< See cTimers::GetTimersWrite() for details.
+  static cSnapshot<cChannels> GetChannelsSnapshot(void);
+      ///< Gets a read-only snapshot of the list of channels.
+      ///< See cTimers::GetTimersSnapshot() for details.
   static bool Load(const char *FileName, bool AllowComments = false, bool MustExist = false);
   void HashChannel(cChannel *Channel);
   void UnhashChannel(cChannel *Channel);
@@ -425,6 +425,7 @@ cSetup::cSetup(void)
   PauseKeyHandling = 2;
   PausePriority = 10;
   PauseLifetime = 1;
+  TimeshiftSize = 0;
   UseSubtitle = 1;
   UseVps = 0;
   VpsMargin = 120;
@@ -456,6 +457,7 @@ cSetup::cSetup(void)
   OSDMessageTime = 1;
   UseSmallFont = 1;
   AntiAlias = 1;
+  OSDRenderThreads = 0;
   strcpy(FontOsd, DefaultFontOsd);
   strcpy(FontSml, DefaultFontSml);
   strcpy(FontFix, DefaultFontFix);
@@ -467,7 +469,10 @@ cSetup::cSetup(void)
   FontFixSize = 20;
   MaxVideoFileSize = MAXVIDEOFILESIZEDEFAULT;
   SplitEditedFiles = 0;
+  MuxRecording = 0;
   DelTimeshiftRec = 0;
+  RemoveStepSize = 100;
+  RemoveStepDelay = 100;
   MinEventTimeout = 30;
   MinUserInactivity = 300;
   NextWakeupTime = 0;
@@ -653,6 +658,7 @@ bool cSetup::Parse(const char *Name, const char *Value)
   else if (!strcasecmp(Name, "PauseKeyHandling"))    PauseKeyHandling   = atoi(Value);
   else if (!strcasecmp(Name, "PausePriority"))       PausePriority      = atoi(Value);
   else if (!strcasecmp(Name, "PauseLifetime"))       PauseLifetime      = atoi(Value);
+  else if (!strcasecmp(Name, "TimeshiftSize"))       TimeshiftSize      = atoi(Value);
   else if (!strcasecmp(Name, "UseSubtitle"))         UseSubtitle        = atoi(Value);
   else if (!strcasecmp(Name, "UseVps"))              UseVps             = atoi(Value);
   else if (!strcasecmp(Name, "VpsMargin"))           VpsMargin          = atoi(Value);
@@ -684,6 +690,7 @@ bool cSetup::Parse(const char *Name, const char *Value)
   else if (!strcasecmp(Name, "OSDMessageTime"))      OSDMessageTime     = atoi(Value);
   else if (!strcasecmp(Name, "UseSmallFont"))        UseSmallFont       = atoi(Value);
   else if (!strcasecmp(Name, "AntiAlias"))           AntiAlias          = atoi(Value);
+  else if (!strcasecmp(Name, "OSDRenderThreads"))    OSDRenderThreads   = constrain(atoi(Value), 0, MAXOSDRENDERTHREADS);
   else if (!strcasecmp(Name, "FontOsd"))             Utf8Strn0Cpy(FontOsd, Value, MAXFONTNAME);
   else if (!strcasecmp(Name, "FontSml"))             Utf8Strn0Cpy(FontSml, Value, MAXFONTNAME);
   else if (!strcasecmp(Name, "FontFix"))             Utf8Strn0Cpy(FontFix, Value, MAXFONTNAME);
@@ -695,7 +702,10 @@ bool cSetup::Parse(const char *Name, const char *Value)
   else if (!strcasecmp(Name, "FontFixSize"))         FontFixSize        = atoi(Value);
   else if (!strcasecmp(Name, "MaxVideoFileSize"))    MaxVideoFileSize   = atoi(Value);
   else if (!strcasecmp(Name, "SplitEditedFiles"))    SplitEditedFiles   = atoi(Value);
+  else if (!strcasecmp(Name, "MuxRecording"))        MuxRecording       = atoi(Value);
   else if (!strcasecmp(Name, "DelTimeshiftRec"))     DelTimeshiftRec    = atoi(Value);
+  else if (!strcasecmp(Name, "RemoveStepSize"))      RemoveStepSize     = max(0, atoi(Value));
+  else if (!strcasecmp(Name, "RemoveStepDelay"))     RemoveStepDelay    = max(0, atoi(Value));
   else if (!strcasecmp(Name, "MinEventTimeout"))     MinEventTimeout    = atoi(Value);
   else if (!strcasecmp(Name, "MinUserInactivity"))   MinUserInactivity  = atoi(Value);
   else if (!strcasecmp(Name, "NextWakeupTime"))      NextWakeupTime     = atoi(Value);
@@ -785,6 +795,7 @@ bool cSetup::Save(void)
   Store("PauseKeyHandling",   PauseKeyHandling);
   Store("PausePriority",      PausePriority);
   Store("PauseLifetime",      PauseLifetime);
+  Store("TimeshiftSize",      TimeshiftSize);
   Store("UseSubtitle",        UseSubtitle);
   Store("UseVps",             UseVps);
   Store("VpsMargin",          VpsMargin);
@@ -816,6 +827,7 @@ bool cSetup::Save(void)
   Store("OSDMessageTime",     OSDMessageTime);
   Store("UseSmallFont",       UseSmallFont);
   Store("AntiAlias",          AntiAlias);
+  Store("OSDRenderThreads",   OSDRenderThreads);
   Store("FontOsd",            FontOsd);
   Store("FontSml",            FontSml);
   Store("FontFix",            FontFix);
@@ -827,7 +839,10 @@ bool cSetup::Save(void)
   Store("FontFixSize",        FontFixSize);
   Store("MaxVideoFileSize",   MaxVideoFileSize);
   Store("SplitEditedFiles",   SplitEditedFiles);
+  Store("MuxRecording",       MuxRecording);
   Store("DelTimeshiftRec",    DelTimeshiftRec);
+  Store("RemoveStepSize",     RemoveStepSize);
+  Store("RemoveStepDelay",    RemoveStepDelay);
   Store("MinEventTimeout",    MinEventTimeout);
   Store("MinUserInactivity",  MinUserInactivity);
   Store("NextWakeupTime",     NextWakeupTime);
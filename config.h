@@ -22,13 +22,13 @@
 
 // VDR's own version number:
 
-#define VDRVERSION  "2.5.1"
-#define VDRVERSNUM   20501  // Version * 10000 + Major * 100 + Minor
+#define VDRVERSION  "2.5.2"
+#define VDRVERSNUM   20502  // Version * 10000 + Major * 100 + Minor
 
 // The plugin API's version number:
 
-#define APIVERSION  "2.5.1"
-#define APIVERSNUM   20501  // Version * 10000 + Major * 100 + Minor
+#define APIVERSION  "2.5.2"
+#define APIVERSNUM   20502  // Version * 10000 + Major * 100 + Minor
 
 // When loading plugins, VDR searches them by their APIVERSION, which
 // may be smaller than VDRVERSION in case there have been no changes to
@@ -59,6 +59,8 @@
 #define MINOSDHEIGHT  324
 #define MAXOSDHEIGHT 1200
 
+#define MAXOSDRENDERTHREADS 16
+
 #define MaxFileName NAME_MAX // obsolete - use NAME_MAX directly instead!
 #define MaxSkinName 16
 #define MaxThemeName 16
@@ -306,6 +308,7 @@ public:
   int RecordKeyHandling;
   int PauseKeyHandling;
   int PausePriority, PauseLifetime;
+  int TimeshiftSize;
   int UseSubtitle;
   int UseVps;
   int VpsMargin;
@@ -328,6 +331,7 @@ public:
   int OSDMessageTime;
   int UseSmallFont;
   int AntiAlias;
+  int OSDRenderThreads;
   char FontOsd[MAXFONTNAME];
   char FontSml[MAXFONTNAME];
   char FontFix[MAXFONTNAME];
@@ -339,7 +343,10 @@ public:
   int FontFixSize;
   int MaxVideoFileSize;
   int SplitEditedFiles;
+  int MuxRecording;
   int DelTimeshiftRec;
+  int RemoveStepSize;
+  int RemoveStepDelay;
   int MinEventTimeout, MinUserInactivity;
   time_t NextWakeupTime;
   int MultiSpeedMode;
@@ -72,6 +72,11 @@ int cDevice::numDevices = 0;
 int cDevice::useDevice = 0;
 int cDevice::nextCardIndex = 0;
 int cDevice::currentChannel = 1;
+cMutex cDevice::zapStatsMutex;
+int cDevice::zapCount = 0;
+int cDevice::zapFailed = 0;
+uint64_t cDevice::zapTime = 0;
+uint64_t cDevice::maxZapTime = 0;
 cDevice *cDevice::device[MAXDEVICES] = { NULL };
 cDevice *cDevice::primaryDevice = NULL;
 cList<cDeviceHook> cDevice::deviceHooks;
@@ -79,6 +84,9 @@ cList<cDeviceHook> cDevice::deviceHooks;
 cDevice::cDevice(void)
 :patPmtParser(true)
 {
+  numPidHandles = MAXPIDHANDLES;
+  pidHandles = new cPidHandle[numPidHandles];
+
   cardIndex = nextCardIndex++;
   dsyslog("new device number %d (card index %d)", numDevices + 1, CardIndex() + 1);
 
@@ -108,9 +116,6 @@ cDevice::cDevice(void)
   dvbSubtitleConverter = NULL;
   autoSelectPreferredSubtitleLanguage = true;
 
-  for (int i = 0; i < MAXRECEIVERS; i++)
-      receiver[i] = NULL;
-
   if (numDevices < MAXDEVICES)
      device[numDevices++] = this;
   else
@@ -126,6 +131,7 @@ cDevice::~cDevice()
   if (this == primaryDevice)
      primaryDevice = NULL;
   Cancel(3);
+  delete[] pidHandles;
 }
 
 bool cDevice::WaitForAllDevicesReady(int Timeout)
@@ -530,13 +536,13 @@ void cDevice::GetOsdSize(int &Width, int &Height, double &PixelAspect)
   PixelAspect = 1.0;
 }
 
-//#define PRINTPIDS(s) { char b[500]; char *q = b; q += sprintf(q, "%d %s ", DeviceNumber() + 1, s); for (int i = 0; i < MAXPIDHANDLES; i++) q += sprintf(q, " %s%4d %d", i == ptOther ? "* " : "", pidHandles[i].pid, pidHandles[i].used); dsyslog("%s", b); }
+//#define PRINTPIDS(s) { char b[500]; char *q = b; q += sprintf(q, "%d %s ", DeviceNumber() + 1, s); for (int i = 0; i < numPidHandles; i++) q += sprintf(q, " %s%4d %d", i == ptOther ? "* " : "", pidHandles[i].pid, pidHandles[i].used); dsyslog("%s", b); }
 #define PRINTPIDS(s)
 
 bool cDevice::HasPid(int Pid) const
 {
   cMutexLock MutexLock(&mutexPids);
-  for (int i = 0; i < MAXPIDHANDLES; i++) {
+  for (int i = 0; i < numPidHandles; i++) {
       if (pidHandles[i].pid == Pid)
          return true;
       }
@@ -550,7 +556,7 @@ bool cDevice::AddPid(int Pid, ePidType PidType, int StreamType)
      int n = -1;
      int a = -1;
      if (PidType != ptPcr) { // PPID always has to be explicit
-        for (int i = 0; i < MAXPIDHANDLES; i++) {
+        for (int i = 0; i < numPidHandles; i++) {
             if (i != ptPcr) {
                if (pidHandles[i].pid == Pid)
                   n = i;
@@ -586,8 +592,15 @@ bool cDevice::AddPid(int Pid, ePidType PidType, int StreamType)
         n = a;
         }
      else {
-        esyslog("ERROR: no free slot for PID %d on device %d", Pid, DeviceNumber() + 1);
-        return false;
+        // The Pid is not yet in use and all slots are taken
+        n = numPidHandles;
+        cPidHandle *NewPidHandles = new cPidHandle[numPidHandles * 2];
+        for (int i = 0; i < numPidHandles; i++)
+            NewPidHandles[i] = pidHandles[i];
+        delete[] pidHandles;
+        pidHandles = NewPidHandles;
+        numPidHandles *= 2;
+        dsyslog("device %d now has %d PID handles", DeviceNumber() + 1, numPidHandles);
         }
      if (n >= 0) {
         pidHandles[n].pid = Pid;
@@ -616,7 +629,7 @@ void cDevice::DelPid(int Pid, ePidType PidType)
      if (PidType == ptPcr)
         n = PidType; // PPID always has to be explicit
      else {
-        for (int i = 0; i < MAXPIDHANDLES; i++) {
+        for (int i = 0; i < numPidHandles; i++) {
             if (pidHandles[i].pid == Pid) {
                n = i;
                break;
@@ -795,7 +808,11 @@ bool cDevice::IsTunedToTransponder(const cChannel *Channel) const
 
 bool cDevice::MaySwitchTransponder(const cChannel *Channel) const
 {
-  return time(NULL) > occupiedTimeout && !Receiving() && !(pidHandles[ptAudio].pid || pidHandles[ptVideo].pid || pidHandles[ptDolby].pid);
+  if (time(NULL) > occupiedTimeout && !Receiving()) {
+     cMutexLock MutexLock(&mutexPids); // AddPid() may reallocate pidHandles
+     return !(pidHandles[ptAudio].pid || pidHandles[ptVideo].pid || pidHandles[ptDolby].pid);
+     }
+  return false;
 }
 
 bool cDevice::SwitchChannel(const cChannel *Channel, bool LiveView)
@@ -855,6 +872,7 @@ bool cDevice::SwitchChannel(int Direction)
 eSetChannelResult cDevice::SetChannel(const cChannel *Channel, bool LiveView)
 {
   cMutexLock MutexLock(&mutexChannel); // to avoid a race between SVDRP CHAN and HasProgramme()
+  cTimeMs ZapTime;
   cStatus::MsgChannelSwitch(this, 0, LiveView);
 
   if (LiveView) {
@@ -899,7 +917,7 @@ eSetChannelResult cDevice::SetChannel(const cChannel *Channel, bool LiveView)
         // Start section handling:
         if (sectionHandler) {
            if (patFilter)
-              patFilter->Trigger(Channel->Sid());
+              patFilter->Trigger(Channel->Sid(), LiveView);
            sectionHandler->SetChannel(Channel);
            sectionHandler->SetStatus(true);
            }
@@ -931,9 +949,32 @@ eSetChannelResult cDevice::SetChannel(const cChannel *Channel, bool LiveView)
      cStatus::MsgChannelSwitch(this, Channel->Number(), LiveView); // only report status if channel switch successful
      }
 
+  if (LiveView) {
+     uint64_t t = ZapTime.Elapsed();
+     cMutexLock MutexLock(&zapStatsMutex);
+     zapCount++;
+     if (Result != scrOk)
+        zapFailed++;
+     zapTime += t;
+     maxZapTime = max(maxZapTime, t);
+     }
+
   return Result;
 }
 
+void cDevice::ZapStatistics(cStringList &Lines, bool Reset)
+{
+  {
+    cMutexLock MutexLock(&zapStatsMutex);
+    Lines.Append(strdup(cString::sprintf("switch: %d channel switches (%d failed), average %d ms, max %d ms", zapCount, zapFailed, zapCount ? int(zapTime / zapCount) : 0, int(maxZapTime))));
+    if (Reset) {
+       zapCount = zapFailed = 0;
+       zapTime = maxZapTime = 0;
+       }
+  }
+  cPatFilter::Statistics(Lines, Reset);
+}
+
 void cDevice::ForceTransferMode(void)
 {
   if (!cTransferControl::ReceiverDevice()) {
@@ -968,7 +1009,10 @@ bool cDevice::HasLock(int TimeoutMs) const
 bool cDevice::HasProgramme(void) const
 {
   cMutexLock MutexLock(&mutexChannel); // to avoid a race between SVDRP CHAN and HasProgramme()
-  return Replaying() || pidHandles[ptAudio].pid || pidHandles[ptVideo].pid;
+  if (Replaying())
+     return true;
+  cMutexLock MutexLockPids(&mutexPids); // AddPid() may reallocate pidHandles
+  return pidHandles[ptAudio].pid || pidHandles[ptVideo].pid;
 }
 
 int cDevice::GetAudioChannelDevice(void)
@@ -1651,10 +1695,8 @@ int cDevice::Priority(void) const
   if (IsPrimaryDevice() && !Replaying() && HasProgramme())
      priority = TRANSFERPRIORITY; // we use the same value here, no matter whether it's actual Transfer Mode or real live viewing
   cMutexLock MutexLock(&mutexReceiver);
-  for (int i = 0; i < MAXRECEIVERS; i++) {
-      if (receiver[i])
-         priority = max(receiver[i]->priority, priority);
-      }
+  for (int i = 0; i < receivers.Size(); i++)
+      priority = max(receivers[i]->priority, priority);
   return priority;
 }
 
@@ -1666,11 +1708,7 @@ bool cDevice::Ready(void)
 bool cDevice::Receiving(bool Dummy) const
 {
   cMutexLock MutexLock(&mutexReceiver);
-  for (int i = 0; i < MAXRECEIVERS; i++) {
-      if (receiver[i])
-         return true;
-      }
-  return false;
+  return receivers.Size() > 0;
 }
 
 #define TS_SCRAMBLING_TIMEOUT     3 // seconds to wait until a TS becomes unscrambled
@@ -1680,6 +1718,7 @@ bool cDevice::Receiving(bool Dummy) const
 void cDevice::Action(void)
 {
   if (Running() && OpenDvr()) {
+     streamStats.Start("device", cString::sprintf("%d %s", DeviceNumber() + 1, *DeviceName()));
      while (Running()) {
            // Read data from the DVR device:
            uchar *b = NULL;
@@ -1690,12 +1729,15 @@ void cDevice::Action(void)
                  cCamSlot *cs = CamSlot();
                  if (cs)
                     cs->TsPostProcess(b);
+                 streamStats.Packet(b);
                  int Pid = TsPid(b);
                  bool IsScrambled = TsIsScrambled(b);
-                 for (int i = 0; i < MAXRECEIVERS; i++) {
-                     cMutexLock MutexLock(&mutexReceiver);
-                     cReceiver *Receiver = receiver[i];
-                     if (Receiver && Receiver->WantsPid(Pid)) {
+                 mutexReceiver.Lock();
+                 for (int i = receivers.Size(); i-- > 0; ) { // backwards, because a receiver may get detached
+                     if (i >= receivers.Size())
+                        continue;
+                     cReceiver *Receiver = receivers[i];
+                     if (Receiver->WantsPid(Pid)) {
                         Receiver->Receive(b, TS_SIZE);
                         // Check whether the TS packet is scrambled:
                         if (Receiver->startScrambleDetection) {
@@ -1739,12 +1781,14 @@ void cDevice::Action(void)
                            }
                         }
                      }
+                 mutexReceiver.Unlock();
                  Unlock();
                  }
               }
            else
               break;
            }
+     streamStats.Stop();
      CloseDvr();
      }
 }
@@ -1779,58 +1823,47 @@ bool cDevice::AttachReceiver(cReceiver *Receiver)
      }
 #endif
   cMutexLock MutexLock(&mutexReceiver);
-  for (int i = 0; i < MAXRECEIVERS; i++) {
-      if (!receiver[i]) {
-         for (int n = 0; n < Receiver->numPids; n++) {
-             if (!AddPid(Receiver->pids[n])) {
-                for ( ; n-- > 0; )
-                    DelPid(Receiver->pids[n]);
-                return false;
-                }
-             }
-         Receiver->Activate(true);
-         Receiver->device = this;
-         receiver[i] = Receiver;
-         if (camSlot && Receiver->priority > MINPRIORITY) { // priority check to avoid an infinite loop with the CAM slot's caPidReceiver
-            camSlot->StartDecrypting();
-            if (camSlot->WantsTsData()) {
-               Receiver->lastEitInjection = 0;
-               Receiver->startEitInjection = time(NULL);
-               }
-            if (CamSlots.NumReadyMasterSlots() > 1) { // don't try different CAMs if there is only one
-               Receiver->startScrambleDetection = time(NULL);
-               Receiver->scramblingTimeout = TS_SCRAMBLING_TIMEOUT;
-               bool KnownToDecrypt = ChannelCamRelations.CamDecrypt(Receiver->ChannelID(), camSlot->MasterSlotNumber());
-               if (KnownToDecrypt)
-                  Receiver->scramblingTimeout *= 10; // give it time to receive ECM/EMM
-               if (Receiver->ChannelID().Valid())
-                  dsyslog("CAM %d: %sknown to decrypt channel %s (scramblingTimeout = %ds)", camSlot->MasterSlotNumber(), KnownToDecrypt ? "" : "not ", *Receiver->ChannelID().ToString(), Receiver->scramblingTimeout);
-               }
-            }
-         Start();
-         return true;
+  for (int n = 0; n < Receiver->pids.Size(); n++) {
+      if (!AddPid(Receiver->pids[n])) {
+         for ( ; n-- > 0; )
+             DelPid(Receiver->pids[n]);
+         return false;
          }
       }
-  esyslog("ERROR: no free receiver slot!");
-  return false;
+  Receiver->Activate(true);
+  Receiver->device = this;
+  receivers.Append(Receiver);
+  if (camSlot && Receiver->priority > MINPRIORITY) { // priority check to avoid an infinite loop with the CAM slot's caPidReceiver
+     camSlot->StartDecrypting();
+     if (camSlot->WantsTsData()) {
+        Receiver->lastEitInjection = 0;
+        Receiver->startEitInjection = time(NULL);
+        }
+     if (CamSlots.NumReadyMasterSlots() > 1) { // don't try different CAMs if there is only one
+        Receiver->startScrambleDetection = time(NULL);
+        Receiver->scramblingTimeout = TS_SCRAMBLING_TIMEOUT;
+        bool KnownToDecrypt = ChannelCamRelations.CamDecrypt(Receiver->ChannelID(), camSlot->MasterSlotNumber());
+        if (KnownToDecrypt)
+           Receiver->scramblingTimeout *= 10; // give it time to receive ECM/EMM
+        if (Receiver->ChannelID().Valid())
+           dsyslog("CAM %d: %sknown to decrypt channel %s (scramblingTimeout = %ds)", camSlot->MasterSlotNumber(), KnownToDecrypt ? "" : "not ", *Receiver->ChannelID().ToString(), Receiver->scramblingTimeout);
+        }
+     }
+  Start();
+  return true;
 }
 
 void cDevice::Detach(cReceiver *Receiver)
 {
   if (!Receiver || Receiver->device != this)
      return;
-  bool receiversLeft = false;
   mutexReceiver.Lock();
-  for (int i = 0; i < MAXRECEIVERS; i++) {
-      if (receiver[i] == Receiver)
-         receiver[i] = NULL;
-      else if (receiver[i])
-         receiversLeft = true;
-      }
+  receivers.RemoveElement(Receiver);
+  bool receiversLeft = receivers.Size() > 0;
   mutexReceiver.Unlock();
   Receiver->device = NULL;
   Receiver->Activate(false);
-  for (int n = 0; n < Receiver->numPids; n++)
+  for (int n = 0; n < Receiver->pids.Size(); n++)
       DelPid(Receiver->pids[n]);
   if (camSlot) {
      if (Receiver->priority > MINPRIORITY) { // priority check to avoid an infinite loop with the CAM slot's caPidReceiver
@@ -1847,10 +1880,9 @@ void cDevice::DetachAll(int Pid)
 {
   if (Pid) {
      cMutexLock MutexLock(&mutexReceiver);
-     for (int i = 0; i < MAXRECEIVERS; i++) {
-         cReceiver *Receiver = receiver[i];
-         if (Receiver && Receiver->WantsPid(Pid))
-            Detach(Receiver);
+     for (int i = receivers.Size(); i-- > 0; ) {
+         if (i < receivers.Size() && receivers[i]->WantsPid(Pid))
+            Detach(receivers[i]);
          }
      }
 }
@@ -1858,8 +1890,8 @@ void cDevice::DetachAll(int Pid)
 void cDevice::DetachAllReceivers(void)
 {
   cMutexLock MutexLock(&mutexReceiver);
-  for (int i = 0; i < MAXRECEIVERS; i++)
-      Detach(receiver[i]);
+  while (receivers.Size())
+        Detach(receivers[receivers.Size() - 1]);
 }
 
 // --- cTSBuffer -------------------------------------------------------------
@@ -1870,7 +1902,7 @@ cTSBuffer::cTSBuffer(int File, int Size, int DeviceNumber)
   f = File;
   deviceNumber = DeviceNumber;
   delivered = 0;
-  ringBuffer = new cRingBufferLinear(Size, TS_SIZE, true, "TS");
+  ringBuffer = new cRingBufferMirrored(Size, TS_SIZE, TS_SIZE, true, "TS");
   ringBuffer->SetTimeouts(100, 100);
   ringBuffer->SetIoThrottle();
   Start();
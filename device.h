@@ -23,12 +23,13 @@
 #include "sdt.h"
 #include "sections.h"
 #include "spu.h"
+#include "streamstats.h"
 #include "thread.h"
 #include "tools.h"
 
 #define MAXDEVICES         16 // the maximum number of devices in the system
-#define MAXPIDHANDLES      64 // the maximum number of different PIDs per device
-#define MAXRECEIVERS       16 // the maximum number of receivers per device
+#define MAXPIDHANDLES      64 // the initial number of PID handles per device (more are allocated as needed)
+#define MAXRECEIVERS       16 // the number of record controls per device (the number of receivers is not limited)
 #define MAXVOLUME         255
 #define VOLUMEDELTA       (MAXVOLUME / Setup.VolumeSteps) // used to increase/decrease the volume
 #define MAXOCCUPIEDTIMEOUT 99 // max. time (in seconds) a device may be occupied
@@ -260,6 +261,11 @@ public:
 private:
   mutable cMutex mutexChannel;
   time_t occupiedTimeout;
+  static cMutex zapStatsMutex;
+  static int zapCount;
+  static int zapFailed;
+  static uint64_t zapTime;
+  static uint64_t maxZapTime;
 protected:
   static int currentChannel;
 public:
@@ -369,6 +375,11 @@ public:
          ///< channel number while replaying.
   void ForceTransferMode(void);
          ///< Forces the device into transfermode for the current channel.
+  static void ZapStatistics(cStringList &Lines, bool Reset = false);
+         ///< Adds statistics about the channel switches in live view (the time the
+         ///< actual switch took, and the time until the PMT of the new channel was
+         ///< received) to the given list of Lines.
+         ///< If Reset is true, the statistics are cleared afterwards.
   int Occupied(void) const;
          ///< Returns the number of seconds this device is still occupied for.
   void SetOccupied(int Seconds);
@@ -392,9 +403,9 @@ public:
 // PID handle facilities
 
 private:
-  mutable cMutex mutexPids;
   virtual void Action(void);
 protected:
+  mutable cMutex mutexPids;
   enum ePidType { ptAudio, ptVideo, ptPcr, ptTeletext, ptDolby, ptOther };
   class cPidHandle {
   public:
@@ -404,7 +415,13 @@ protected:
     int used;
     cPidHandle(void) { pid = streamType = used = 0; handle = -1; }
     };
-  cPidHandle pidHandles[MAXPIDHANDLES];
+  cPidHandle *pidHandles;
+  int numPidHandles;
+         ///< The PID handles of this device. The first ptOther handles are reserved
+         ///< for the respective PID types, the rest is used for any other PIDs.
+         ///< The array grows as needed, so a pointer to a cPidHandle must not be
+         ///< kept beyond the call it has been given to, and the array must only be
+         ///< accessed while holding mutexPids.
   bool HasPid(int Pid) const;
          ///< Returns true if this device is currently receiving the given PID.
   bool AddPid(int Pid, ePidType PidType = ptOther, int StreamType = 0);
@@ -459,6 +476,7 @@ public:
   void Detach(cFilter *Filter);
        ///< Detaches the given filter from this device.
   const cSdtFilter *SdtFilter(void) const { return sdtFilter; }
+  const cEitFilter *EitFilter(void) const { return eitFilter; }
   cSectionHandler *SectionHandler(void) const { return sectionHandler; }
 
 // Common Interface facilities:
@@ -829,7 +847,7 @@ public:
 
 private:
   mutable cMutex mutexReceiver;
-  cReceiver *receiver[MAXRECEIVERS];
+  cVector<cReceiver *> receivers; // only the receivers that are actually attached
 public:
   int Priority(void) const;
       ///< Returns the priority of the current receiving session (-MAXPRIORITY..MAXPRIORITY),
@@ -847,6 +865,10 @@ protected:
       ///< new data available, Data will be set to NULL. The function returns
       ///< false in case of a non recoverable error, otherwise it returns true,
       ///< even if Data is NULL.
+  cStreamStats streamStats;
+      ///< Collects the health data of the Transport Stream delivered by this
+      ///< device while its DVR is open. A derived device that stores the data
+      ///< in a ring buffer can make it known through streamStats.SetRingBuffer().
 public:
   bool Receiving(bool Dummy = false) const;
        ///< Returns true if we are currently receiving. The parameter has no meaning (for backwards compatibility only).
@@ -873,11 +895,13 @@ private:
   int f;
   int deviceNumber;
   int delivered;
-  cRingBufferLinear *ringBuffer;
+  cRingBufferMirrored *ringBuffer;
   virtual void Action(void);
 public:
   cTSBuffer(int File, int Size, int DeviceNumber);
   virtual ~cTSBuffer();
+  cRingBuffer *RingBuffer(void) { return ringBuffer; }
+     ///< Returns the ring buffer the TS packets are stored in.
   uchar *Get(int *Available = NULL, bool CheckAvailable = false);
      ///< Returns a pointer to the first TS packet in the buffer. If Available is given,
      ///< it will return the total number of consecutive bytes pointed to in the buffer.
@@ -2321,14 +2321,17 @@ bool cDvbDevice::OpenDvr(void)
 {
   CloseDvr();
   fd_dvr = DvbOpen(DEV_DVB_DVR, adapter, frontend, O_RDONLY | O_NONBLOCK, true);
-  if (fd_dvr >= 0)
+  if (fd_dvr >= 0) {
      tsBuffer = new cTSBuffer(fd_dvr, TSBUFFERSIZE, DeviceNumber() + 1);
+     streamStats.SetRingBuffer(tsBuffer->RingBuffer());
+     }
   return fd_dvr >= 0;
 }
 
 void cDvbDevice::CloseDvr(void)
 {
   if (fd_dvr >= 0) {
+     streamStats.SetRingBuffer(NULL);
      delete tsBuffer;
      tsBuffer = NULL;
      close(fd_dvr);
@@ -122,33 +122,117 @@ int cPtsIndex::FindFrameNumber(uint32_t Pts)
 
 // --- cNonBlockingFileReader ------------------------------------------------
 
+// The reader reads large contiguous extents of the recording and delivers the
+// requested frames as slices of these extents. While the player consumes one
+// extent, the next one is read ahead, and the size of the extents is adapted
+// to the time the storage needs to deliver them.
+
+#define READAHEADMIN  (4 * MAXFRAMESIZE)  // min. size of a read ahead extent
+#define READAHEADMAX  (16 * MAXFRAMESIZE) // max. size of a read ahead extent
+#define READCHUNKSIZE (MAXFRAMESIZE / 4)  // number of bytes read at once
+
+class cReadExtent {
+public:
+  uchar *data;
+  int capacity;
+  uint16_t fileNumber; // 0 means the file given in the request
+  off_t offset;
+  int size;
+  int length;
+  bool eof;
+  int error;
+  int readMs;
+  int serial; // changes whenever the extent is set up for a different range
+  bool filling; // the reader thread is reading into data without holding the lock
+  uchar *stale; // the previous data, if the extent was enlarged while being filled
+  cTimeMs used;
+  cReadExtent(void) { data = NULL; capacity = 0; serial = 0; filling = false; stale = NULL; Reset(); }
+  ~cReadExtent() { free(data); free(stale); }
+  void Reset(void) { fileNumber = 0; offset = 0; size = length = 0; eof = false; error = 0; readMs = 0; serial++; }
+  bool Setup(uint16_t FileNumber, off_t Offset, int Size);
+  bool Contains(uint16_t FileNumber, off_t Offset, int Length) { return size > 0 && fileNumber == FileNumber && offset <= Offset && Offset + Length <= offset + size; }
+  bool Pending(void) { return size > 0 && length < size && !eof && !error; }
+  };
+
+bool cReadExtent::Setup(uint16_t FileNumber, off_t Offset, int Size)
+{
+  Reset();
+  if (Size > capacity) {
+     if (uchar *NewData = MALLOC(uchar, Size)) {
+        if (filling && !stale)
+           stale = data; // will be freed by the reader thread once it is done with it
+        else
+           free(data);
+        data = NewData;
+        capacity = Size;
+        }
+     else {
+        esyslog("ERROR: can't allocate %d bytes for read ahead", Size);
+        return false;
+        }
+     }
+  fileNumber = FileNumber;
+  offset = Offset;
+  size = Size;
+  used.Set();
+  return true;
+}
+
 class cNonBlockingFileReader : public cThread {
 private:
+  cFileName *fileName;
   cUnbufferedFile *f;
-  uchar *buffer;
-  int wanted;
-  int length;
+  cReadExtent extents[2];
+  cReadExtent *current;
+  cReadExtent *ahead;
+  int readAhead;
+  bool streaming;
+  bool requested;
+  uint16_t requestFileNumber;
+  off_t requestOffset;
+  int requestLength;
   cCondWait newSet;
   cCondVar newDataCond;
   cMutex newDataMutex;
+  cMutex readMutex; // held while reading from f without the thread lock
+  bool Ready(void);
+  void Adapt(void);
 protected:
   void Action(void);
 public:
-  cNonBlockingFileReader(void);
+  cNonBlockingFileReader(const char *FileName, bool IsPesRecording);
   ~cNonBlockingFileReader();
   void Clear(void);
   void Request(cUnbufferedFile *File, int Length);
+       ///< Requests Length bytes from the current position of File.
+  void Request(uint16_t FileNumber, off_t FileOffset, int Length);
+       ///< Requests Length bytes at FileOffset of the recording file with the
+       ///< given FileNumber. If this is not the continuation of the previous
+       ///< request, only the requested data is read. Otherwise the data is read
+       ///< in large extents, and the next extent is read ahead.
   int Result(uchar **Buffer);
-  bool Reading(void) { return buffer; }
+       ///< Returns the number of bytes delivered for the most recent request
+       ///< (0 at the end of the file) and sets Buffer to point to them.
+       ///< The data remains valid until the next call to Request() or Clear().
+       ///< If the data is not yet available, -1 is returned and errno is set
+       ///< to EAGAIN.
+  bool Reading(void) { return requested; }
   bool WaitForDataMs(int msToWait);
   };
 
-cNonBlockingFileReader::cNonBlockingFileReader(void)
+cNonBlockingFileReader::cNonBlockingFileReader(const char *FileName, bool IsPesRecording)
 :cThread("non blocking file reader")
 {
+  fileName = new cFileName(FileName, false, false, IsPesRecording);
   f = NULL;
-  buffer = NULL;
-  wanted = length = 0;
+  current = &extents[0];
+  ahead = &extents[1];
+  readAhead = READAHEADMIN;
+  streaming = false;
+  requested = false;
+  requestFileNumber = 0;
+  requestOffset = 0;
+  requestLength = 0;
   Start();
 }
 
@@ -156,37 +240,89 @@ cNonBlockingFileReader::~cNonBlockingFileReader()
 {
   newSet.Signal();
   Cancel(3);
-  free(buffer);
+  delete fileName;
 }
 
 void cNonBlockingFileReader::Clear(void)
 {
   Lock();
   f = NULL;
-  free(buffer);
-  buffer = NULL;
-  wanted = length = 0;
+  current->Reset();
+  ahead->Reset();
+  streaming = false;
+  requested = false;
+  requestFileNumber = 0;
+  requestOffset = 0;
+  requestLength = 0;
   Unlock();
+  // The caller may close the file after this, so we wait until it is no longer being read:
+  cMutexLock ReadLock(&readMutex);
 }
 
 void cNonBlockingFileReader::Request(cUnbufferedFile *File, int Length)
 {
-  Lock();
   Clear();
-  wanted = Length;
-  buffer = MALLOC(uchar, wanted);
+  Lock();
+  requestLength = Length;
+  requested = current->Setup(0, 0, Length);
   f = File;
   Unlock();
   newSet.Signal();
 }
 
+void cNonBlockingFileReader::Adapt(void)
+{
+  // Called when the player moves on to the extent that has been read ahead:
+  int UsedMs = current->used.Elapsed();
+  if (ahead->Pending() || ahead->readMs * 2 > UsedMs)
+     readAhead = min(readAhead * 2, READAHEADMAX); // the storage barely kept up
+  else if (ahead->readMs * 8 < UsedMs)
+     readAhead = max(readAhead / 2, READAHEADMIN); // the storage is much faster than needed
+}
+
+void cNonBlockingFileReader::Request(uint16_t FileNumber, off_t FileOffset, int Length)
+{
+  Lock();
+  streaming = FileNumber == requestFileNumber && FileOffset == requestOffset + requestLength;
+  requestFileNumber = FileNumber;
+  requestOffset = FileOffset;
+  requestLength = Length;
+  requested = true;
+  if (!current->Contains(FileNumber, FileOffset, Length) && ahead->Contains(FileNumber, FileOffset, Length)) {
+     Adapt();
+     cReadExtent *e = current;
+     current = ahead;
+     ahead = e;
+     ahead->Reset();
+     current->used.Set();
+     }
+  if (!current->Contains(FileNumber, FileOffset, Length) || ((current->eof || current->error) && current->offset + current->length < FileOffset + Length)) {
+     // a jump, or the data wasn't there when it was read (maybe it is now):
+     ahead->Reset();
+     requested = current->Setup(FileNumber, FileOffset, streaming ? readAhead : Length);
+     }
+  Unlock();
+  newSet.Signal();
+}
+
+bool cNonBlockingFileReader::Ready(void)
+{
+  return requested && current->Contains(requestFileNumber, requestOffset, requestLength) && (current->offset + current->length >= requestOffset + requestLength || !current->Pending());
+}
+
 int cNonBlockingFileReader::Result(uchar **Buffer)
 {
   LOCK_THREAD;
-  if (buffer && length == wanted) {
-     *Buffer = buffer;
-     buffer = NULL;
-     return wanted;
+  if (Ready()) {
+     requested = false;
+     int Offset = int(requestOffset - current->offset);
+     int Length = min(requestLength, max(current->length - Offset, 0)); // at the end of the file there may be less data than requested
+     if (Length == 0 && current->error) {
+        errno = current->error;
+        return -1;
+        }
+     *Buffer = current->data + Offset;
+     return Length;
      }
   errno = EAGAIN;
   return -1;
@@ -196,41 +332,80 @@ void cNonBlockingFileReader::Action(void)
 {
   while (Running()) {
         Lock();
-        if (f && buffer && length < wanted) {
-           int r = f->Read(buffer + length, wanted - length);
-           if (r > 0)
-              length += r;
-           else if (r == 0) { // r == 0 means EOF
-              if (length > 0)
-                 wanted = length; // already read something, so return the rest
-              else
-                 length = wanted = 0; // report EOF
-              }
-           else if (FATALERRNO) {
+        cReadExtent *e = NULL;
+        if (requested && current->Pending())
+           e = current;
+        else if (streaming && current->fileNumber && current->size > 0 && !current->Pending() && !current->eof && !current->error) {
+           if (!ahead->size)
+              ahead->Setup(current->fileNumber, current->offset + current->size, readAhead);
+           if (ahead->Pending())
+              e = ahead;
+           }
+        if (e) {
+           // The data is read directly into the free space of the extent, without
+           // holding the lock, so that the player isn't blocked by slow storage.
+           // The player only accesses the data up to the extent's length, which is
+           // only increased if the extent hasn't been set up for a different range
+           // in the meantime:
+           int Serial = e->serial;
+           uint16_t FileNumber = e->fileNumber;
+           off_t Offset = e->offset + e->length;
+           int Size = min(READCHUNKSIZE, e->size - e->length);
+           uchar *Buffer = e->data + e->length;
+           e->filling = true;
+           cUnbufferedFile *File = f;
+           if (!FileNumber)
+              readMutex.Lock();
+           Unlock();
+           if (FileNumber)
+              File = fileName->SetOffset(FileNumber, Offset); // fileName is only used by this thread
+           cTimeMs Time;
+           int r = File ? File->Read(Buffer, Size) : 0; // no file means it doesn't exist (yet)
+           int Error = 0;
+           if (r < 0 && FATALERRNO) {
               LOG_ERROR;
-              length = wanted = r; // this will forward the error status to the caller
+              Error = errno;
+              }
+           if (!FileNumber)
+              readMutex.Unlock();
+           Lock();
+           e->filling = false;
+           if (e->stale) {
+              free(e->stale);
+              e->stale = NULL;
               }
-           if (length == wanted) {
-              cMutexLock NewDataLock(&newDataMutex);
-              newDataCond.Broadcast();
+           if (e->serial == Serial) {
+              e->readMs += Time.Elapsed();
+              if (r > 0)
+                 e->length += r;
+              else if (r == 0) // r == 0 means EOF
+                 e->eof = true;
+              else if (Error)
+                 e->error = Error; // this will forward the error status to the caller
+              if (e == current && Ready()) {
+                 cMutexLock NewDataLock(&newDataMutex);
+                 newDataCond.Broadcast();
+                 }
               }
            }
         Unlock();
-        newSet.Wait(1000);
+        if (!e)
+           newSet.Wait(1000);
         }
 }
 
 bool cNonBlockingFileReader::WaitForDataMs(int msToWait)
 {
   cMutexLock NewDataLock(&newDataMutex);
-  if (buffer && length == wanted)
+  if (Ready())
      return true;
   return newDataCond.TimedWait(newDataMutex, msToWait);
 }
 
 // --- cDvbPlayer ------------------------------------------------------------
 
-#define PLAYERBUFSIZE  (MAXFRAMESIZE * 5)
+#define PLAYERBUFSIZE   (MAXFRAMESIZE * 5)
+#define PLAYERBUFFRAMES 1000 // max. number of frames in the player's ring buffer
 
 #define RESUMEBACKUP 10 // number of seconds to back up when resuming an interrupted replay session
 #define MAXSTUCKATEOF 3 // max. number of seconds to wait in case the device doesn't play the last frame
@@ -241,7 +416,7 @@ private:
   enum ePlayDirs { pdForward, pdBackward };
   static int Speeds[];
   cNonBlockingFileReader *nonBlockingFileReader;
-  cRingBufferFrame *ringBuffer;
+  cRingBufferFramePool *ringBuffer;
   cPtsIndex ptsIndex;
   const cMarks *marks;
   cFileName *fileName;
@@ -257,7 +432,8 @@ private:
   int trickSpeed;
   int readIndex;
   bool readIndependent;
-  cFrame *readFrame;
+  uchar *readBuffer; // points into the nonBlockingFileReader's buffer
+  int readCount;
   cFrame *playFrame;
   cFrame *dropFrame;
   bool resyncAfterPause;
@@ -312,16 +488,18 @@ cDvbPlayer::cDvbPlayer(const char *FileName, bool PauseLive)
   trickSpeed = NORMAL_SPEED;
   readIndex = -1;
   readIndependent = false;
-  readFrame = NULL;
+  readBuffer = NULL;
+  readCount = 0;
   playFrame = NULL;
   dropFrame = NULL;
   resyncAfterPause = false;
   isyslog("replay %s", FileName);
   fileName = new cFileName(FileName, false, false, isPesRecording);
   replayFile = fileName->Open();
+  nonBlockingFileReader = new cNonBlockingFileReader(FileName, isPesRecording);
   if (!replayFile)
      return;
-  ringBuffer = new cRingBufferFrame(PLAYERBUFSIZE);
+  ringBuffer = new cRingBufferFramePool(PLAYERBUFSIZE, PLAYERBUFFRAMES);
   // Create the index file:
   index = new cIndexFile(FileName, false, isPesRecording, pauseLive);
   if (!index)
@@ -338,7 +516,7 @@ cDvbPlayer::~cDvbPlayer()
 {
   Save();
   Detach();
-  delete readFrame; // might not have been stored in the buffer in Action()
+  delete nonBlockingFileReader;
   delete index;
   delete fileName;
   delete ringBuffer;
@@ -377,8 +555,8 @@ void cDvbPlayer::Empty(void)
      nonBlockingFileReader->Clear();
   if (!firstPacket) // don't set the readIndex twice if Empty() is called more than once
      readIndex = ptsIndex.FindIndex(DeviceGetSTC()) - 1;  // Action() will first increment it!
-  delete readFrame; // might not have been stored in the buffer in Action()
-  readFrame = NULL;
+  readBuffer = NULL; // might not have been stored in the buffer in Action()
+  readCount = 0;
   playFrame = NULL;
   dropFrame = NULL;
   ringBuffer->Clear();
@@ -470,7 +648,6 @@ void cDvbPlayer::Action(void)
   if (readIndex > 0) // will first be incremented in the loop!
      --readIndex;
 
-  nonBlockingFileReader = new cNonBlockingFileReader;
   int Length = 0;
   bool Sleep = false;
   bool WaitingForData = false;
@@ -499,11 +676,11 @@ void cDvbPlayer::Action(void)
           // Read the next frame from the file:
 
           if (playMode != pmStill && playMode != pmPause) {
-             if (!readFrame && (replayFile || readIndex >= 0)) {
+             if (!readBuffer && (replayFile || readIndex >= 0)) {
                 if (!nonBlockingFileReader->Reading() && !AtLastMark) {
+                   uint16_t FileNumber = 0;
+                   off_t FileOffset = -1;
                    if (!SwitchToPlayFrame && (playMode == pmFast || (playMode == pmSlow && playDir == pdBackward))) {
-                      uint16_t FileNumber;
-                      off_t FileOffset;
                       bool TimeShiftMode = index->IsStillRecording();
                       int Index = -1;
                       readIndependent = false;
@@ -529,12 +706,13 @@ void cDvbPlayer::Action(void)
                          if (!NextFile(FileNumber, FileOffset))
                             continue;
                          }
-                      else if (!(TimeShiftMode && playDir == pdForward))
-                         eof = true;
+                      else {
+                         FileNumber = 0; // continue reading where we are
+                         if (!(TimeShiftMode && playDir == pdForward))
+                            eof = true;
+                         }
                       }
                    else if (index) {
-                      uint16_t FileNumber;
-                      off_t FileOffset;
                       if (index->Get(readIndex + 1, &FileNumber, &FileOffset, &readIndependent, &Length) && NextFile(FileNumber, FileOffset)) {
                          readIndex++;
                          if ((Setup.SkipEdited || Setup.PauseAtLastMark) && marks) {
@@ -572,8 +750,12 @@ void cDvbPlayer::Action(void)
                       esyslog("ERROR: frame larger than buffer (%d > %d)", Length, MAXFRAMESIZE);
                       Length = MAXFRAMESIZE;
                       }
-                   if (!eof)
-                      nonBlockingFileReader->Request(replayFile, Length);
+                   if (!eof) {
+                      if (FileNumber && FileOffset >= 0)
+                         nonBlockingFileReader->Request(FileNumber, FileOffset, Length);
+                      else
+                         nonBlockingFileReader->Request(replayFile, Length);
+                      }
                    }
                 if (!eof) {
                    uchar *b = NULL;
@@ -581,8 +763,8 @@ void cDvbPlayer::Action(void)
                    if (r > 0) {
                       WaitingForData = false;
                       LastReadFrame = readIndex;
-                      uint32_t Pts = isPesRecording ? (PesHasPts(b) ? PesGetPts(b) : -1) : TsGetPts(b, r);
-                      readFrame = new cFrame(b, -r, ftUnknown, readIndex, Pts, readIndependent); // hands over b to the ringBuffer
+                      readBuffer = b; // will be copied into the ringBuffer
+                      readCount = r;
                       }
                    else if (r < 0) {
                       if (errno == EAGAIN)
@@ -599,14 +781,17 @@ void cDvbPlayer::Action(void)
 
              // Store the frame in the buffer:
 
-             if (readFrame) {
+             if (readBuffer) {
                 if (CutIn) {
                    if (isPesRecording)
-                      cRemux::SetBrokenLink(readFrame->Data(), readFrame->Count());
+                      cRemux::SetBrokenLink(readBuffer, readCount);
                    CutIn = false;
                    }
-                if (ringBuffer->Put(readFrame))
-                   readFrame = NULL;
+                uint32_t Pts = isPesRecording ? (PesHasPts(readBuffer) ? PesGetPts(readBuffer) : -1) : TsGetPts(readBuffer, readCount);
+                if (ringBuffer->Put(readBuffer, readCount, ftUnknown, readIndex, Pts, readIndependent)) {
+                   readBuffer = NULL;
+                   readCount = 0;
+                   }
                 else
                    Sleep = true;
                 }
@@ -717,9 +902,7 @@ void cDvbPlayer::Action(void)
         }
         }
 
-  cNonBlockingFileReader *nbfr = nonBlockingFileReader;
-  nonBlockingFileReader = NULL;
-  delete nbfr;
+  nonBlockingFileReader->Clear();
 }
 
 void cDvbPlayer::Pause(void)
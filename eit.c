@@ -168,43 +168,51 @@ cEIT::cEIT(cSectionSyncerHash &SectionSyncerHash, int Source, u_char Tid, const
       int LanguagePreferenceShort = -1;
       int LanguagePreferenceExt = -1;
       bool UseExtendedEventDescriptor = false;
-      SI::Descriptor *d;
+      SI::DescriptorTag Tag;
       SI::ExtendedEventDescriptors *ExtendedEventDescriptors = NULL;
+      SI::ShortEventDescriptor ShortEventDescriptorData;
       SI::ShortEventDescriptor *ShortEventDescriptor = NULL;
       cLinkChannels *LinkChannels = NULL;
       cComponents *Components = NULL;
-      for (SI::Loop::Iterator it2; (d = SiEitEvent.eventDescriptors.getNext(it2)); ) {
-          switch (d->getDescriptorTag()) {
+      // The descriptors are decoded in place, to avoid allocating an object for each of them:
+      for (SI::Loop::Iterator it2; SiEitEvent.eventDescriptors.getNextTag(it2, Tag); ) {
+          switch (Tag) {
             case SI::ExtendedEventDescriptorTag: {
-                 SI::ExtendedEventDescriptor *eed = (SI::ExtendedEventDescriptor *)d;
-                 if (I18nIsPreferredLanguage(Setup.EPGLanguages, eed->languageCode, LanguagePreferenceExt) || !ExtendedEventDescriptors) {
+                 SI::ExtendedEventDescriptor eed;
+                 if (!SiEitEvent.eventDescriptors.decode(eed, it2))
+                    break;
+                 if (I18nIsPreferredLanguage(Setup.EPGLanguages, eed.languageCode, LanguagePreferenceExt) || !ExtendedEventDescriptors) {
                     delete ExtendedEventDescriptors;
                     ExtendedEventDescriptors = new SI::ExtendedEventDescriptors;
                     UseExtendedEventDescriptor = true;
                     }
                  if (UseExtendedEventDescriptor) {
-                    if (ExtendedEventDescriptors->Add(eed))
-                       d = NULL; // so that it is not deleted
+                    SI::ExtendedEventDescriptor *d = new SI::ExtendedEventDescriptor(eed);
+                    if (!ExtendedEventDescriptors->Add(d))
+                       delete d;
                     }
-                 if (eed->getDescriptorNumber() == eed->getLastDescriptorNumber())
+                 if (eed.getDescriptorNumber() == eed.getLastDescriptorNumber())
                     UseExtendedEventDescriptor = false;
                  }
                  break;
             case SI::ShortEventDescriptorTag: {
-                 SI::ShortEventDescriptor *sed = (SI::ShortEventDescriptor *)d;
-                 if (I18nIsPreferredLanguage(Setup.EPGLanguages, sed->languageCode, LanguagePreferenceShort) || !ShortEventDescriptor) {
-                    delete ShortEventDescriptor;
-                    ShortEventDescriptor = sed;
-                    d = NULL; // so that it is not deleted
+                 SI::ShortEventDescriptor sed;
+                 if (!SiEitEvent.eventDescriptors.decode(sed, it2))
+                    break;
+                 if (I18nIsPreferredLanguage(Setup.EPGLanguages, sed.languageCode, LanguagePreferenceShort) || !ShortEventDescriptor) {
+                    ShortEventDescriptorData = sed;
+                    ShortEventDescriptor = &ShortEventDescriptorData;
                     }
                  }
                  break;
             case SI::ContentDescriptorTag: {
-                 SI::ContentDescriptor *cd = (SI::ContentDescriptor *)d;
+                 SI::ContentDescriptor cd;
+                 if (!SiEitEvent.eventDescriptors.decode(cd, it2))
+                    break;
                  SI::ContentDescriptor::Nibble Nibble;
                  int NumContents = 0;
                  uchar Contents[MaxEventContents] = { 0 };
-                 for (SI::Loop::Iterator it3; cd->nibbleLoop.getNext(Nibble, it3); ) {
+                 for (SI::Loop::Iterator it3; cd.nibbleLoop.getNext(Nibble, it3); ) {
                      if (NumContents < MaxEventContents) {
                         Contents[NumContents] = ((Nibble.getContentNibbleLevel1() & 0xF) << 4) | (Nibble.getContentNibbleLevel2() & 0xF);
                         NumContents++;
@@ -215,9 +223,11 @@ cEIT::cEIT(cSectionSyncerHash &SectionSyncerHash, int Source, u_char Tid, const
                  break;
             case SI::ParentalRatingDescriptorTag: {
                  int LanguagePreferenceRating = -1;
-                 SI::ParentalRatingDescriptor *prd = (SI::ParentalRatingDescriptor *)d;
+                 SI::ParentalRatingDescriptor prd;
+                 if (!SiEitEvent.eventDescriptors.decode(prd, it2))
+                    break;
                  SI::ParentalRatingDescriptor::Rating Rating;
-                 for (SI::Loop::Iterator it3; prd->ratingLoop.getNext(Rating, it3); ) {
+                 for (SI::Loop::Iterator it3; prd.ratingLoop.getNext(Rating, it3); ) {
                      if (I18nIsPreferredLanguage(Setup.EPGLanguages, Rating.languageCode, LanguagePreferenceRating)) {
                         int ParentalRating = (Rating.getRating() & 0xFF);
                         switch (ParentalRating) {
@@ -235,13 +245,15 @@ cEIT::cEIT(cSectionSyncerHash &SectionSyncerHash, int Source, u_char Tid, const
                  }
                  break;
             case SI::PDCDescriptorTag: {
-                 SI::PDCDescriptor *pd = (SI::PDCDescriptor *)d;
+                 SI::PDCDescriptor pd;
+                 if (!SiEitEvent.eventDescriptors.decode(pd, it2))
+                    break;
                  t.tm_isdst = -1; // makes sure mktime() will determine the correct DST setting
                  int month = t.tm_mon;
-                 t.tm_mon = pd->getMonth() - 1;
-                 t.tm_mday = pd->getDay();
-                 t.tm_hour = pd->getHour();
-                 t.tm_min = pd->getMinute();
+                 t.tm_mon = pd.getMonth() - 1;
+                 t.tm_mday = pd.getDay();
+                 t.tm_hour = pd.getHour();
+                 t.tm_min = pd.getMinute();
                  t.tm_sec = 0;
                  if (month == 11 && t.tm_mon == 0) // current month is dec, but event is in jan
                     t.tm_year++;
@@ -252,11 +264,13 @@ cEIT::cEIT(cSectionSyncerHash &SectionSyncerHash, int Source, u_char Tid, const
                  }
                  break;
             case SI::TimeShiftedEventDescriptorTag: {
-                 SI::TimeShiftedEventDescriptor *tsed = (SI::TimeShiftedEventDescriptor *)d;
-                 cSchedule *rSchedule = (cSchedule *)Schedules->GetSchedule(tChannelID(Source, Channel->Nid(), Channel->Tid(), tsed->getReferenceServiceId()));
+                 SI::TimeShiftedEventDescriptor tsed;
+                 if (!SiEitEvent.eventDescriptors.decode(tsed, it2))
+                    break;
+                 cSchedule *rSchedule = (cSchedule *)Schedules->GetSchedule(tChannelID(Source, Channel->Nid(), Channel->Tid(), tsed.getReferenceServiceId()));
                  if (!rSchedule)
                     break;
-                 rEvent = (cEvent *)rSchedule->GetEvent(tsed->getReferenceEventId());
+                 rEvent = (cEvent *)rSchedule->GetEvent(tsed.getReferenceEventId());
                  if (!rEvent)
                     break;
                  EpgHandlers.SetTitle(pEvent, rEvent->Title());
@@ -265,13 +279,15 @@ cEIT::cEIT(cSectionSyncerHash &SectionSyncerHash, int Source, u_char Tid, const
                  }
                  break;
             case SI::LinkageDescriptorTag: {
-                 SI::LinkageDescriptor *ld = (SI::LinkageDescriptor *)d;
-                 tChannelID linkID(Source, ld->getOriginalNetworkId(), ld->getTransportStreamId(), ld->getServiceId());
-                 if (ld->getLinkageType() == SI::LinkageTypePremiere) { // Premiere World
+                 SI::LinkageDescriptor ld;
+                 if (!SiEitEvent.eventDescriptors.decode(ld, it2))
+                    break;
+                 tChannelID linkID(Source, ld.getOriginalNetworkId(), ld.getTransportStreamId(), ld.getServiceId());
+                 if (ld.getLinkageType() == SI::LinkageTypePremiere) { // Premiere World
                     bool hit = StartTime <= Now && Now < StartTime + Duration;
                     if (hit) {
-                       char linkName[ld->privateData.getLength() + 1];
-                       strn0cpy(linkName, (const char *)ld->privateData.getData(), sizeof(linkName));
+                       char linkName[ld.privateData.getLength() + 1];
+                       strn0cpy(linkName, (const char *)ld.privateData.getData(), sizeof(linkName));
                        // TODO is there a standard way to determine the character set of this string?
                        cChannel *link = Channels->GetByChannelID(linkID);
                        if (link != Channel) { // only link to other channels, not the same one
@@ -281,9 +297,9 @@ cEIT::cEIT(cSectionSyncerHash &SectionSyncerHash, int Source, u_char Tid, const
                              }
                           else if (Setup.UpdateChannels >= 4) {
                              cChannel *Transponder = Channel;
-                             if (Channel->Tid() != ld->getTransportStreamId())
+                             if (Channel->Tid() != ld.getTransportStreamId())
                                 Transponder = Channels->GetByTransponderID(linkID);
-                             link = Channels->NewChannel(Transponder, linkName, "", "", ld->getOriginalNetworkId(), ld->getTransportStreamId(), ld->getServiceId());
+                             link = Channels->NewChannel(Transponder, linkName, "", "", ld.getOriginalNetworkId(), ld.getTransportStreamId(), ld.getServiceId());
                              ChannelsModified = true;
                              //XXX patFilter->Trigger();
                              }
@@ -300,10 +316,12 @@ cEIT::cEIT(cSectionSyncerHash &SectionSyncerHash, int Source, u_char Tid, const
                  }
                  break;
             case SI::ComponentDescriptorTag: {
-                 SI::ComponentDescriptor *cd = (SI::ComponentDescriptor *)d;
-                 uchar Stream = cd->getStreamContent();
-                 uchar Ext = cd->getStreamContentExt();
-                 uchar Type = cd->getComponentType();
+                 SI::ComponentDescriptor cd;
+                 if (!SiEitEvent.eventDescriptors.decode(cd, it2))
+                    break;
+                 uchar Stream = cd.getStreamContent();
+                 uchar Ext = cd.getStreamContentExt();
+                 uchar Type = cd.getComponentType();
                  if ((1 <= Stream && Stream <= 6 && Type != 0) // 1=MPEG2-video, 2=MPEG1-audio, 3=subtitles, 4=AC3-audio, 5=H.264-video, 6=HEAAC-audio
                     || (Stream == 9 && Ext < 2)) {             // 0x09=HEVC-video, 0x19=AC-4-audio
                     if (!Components)
@@ -311,13 +329,12 @@ cEIT::cEIT(cSectionSyncerHash &SectionSyncerHash, int Source, u_char Tid, const
                     char buffer[Utf8BufSize(256)];
                     if (Stream == 9)
                        Stream |= Ext << 4;
-                    Components->SetComponent(Components->NumComponents(), Stream, Type, I18nNormalizeLanguageCode(cd->languageCode), cd->description.getText(buffer, sizeof(buffer)));
+                    Components->SetComponent(Components->NumComponents(), Stream, Type, I18nNormalizeLanguageCode(cd.languageCode), cd.description.getText(buffer, sizeof(buffer)));
                     }
                  }
                  break;
             default: ;
             }
-          delete d;
           }
 
       if (!rEvent) {
@@ -338,7 +355,6 @@ cEIT::cEIT(cSectionSyncerHash &SectionSyncerHash, int Source, u_char Tid, const
             EpgHandlers.SetDescription(pEvent, NULL);
          }
       delete ExtendedEventDescriptors;
-      delete ShortEventDescriptor;
 
       EpgHandlers.SetComponents(pEvent, Components);
 
@@ -416,6 +432,20 @@ cTDT::cTDT(const u_char *Data)
      }
 }
 
+// --- cSectionSyncerHash ----------------------------------------------------
+
+int cSectionSyncerHash::Coverage(void) const
+{
+  if (!entries.Size())
+     return -1;
+  int Complete = 0;
+  for (int i = 0; i < entries.Size(); i++) {
+      if (entries[i]->Complete())
+         Complete++;
+      }
+  return Complete * 100 / entries.Size();
+}
+
 // --- cEitFilter ------------------------------------------------------------
 
 time_t cEitFilter::disableUntil = 0;
@@ -438,6 +468,12 @@ void cEitFilter::SetDisableUntil(time_t Time)
   disableUntil = Time;
 }
 
+int cEitFilter::Coverage(void) const
+{
+  cMutexLock MutexLock(&mutex);
+  return sectionSyncerHash.Coverage();
+}
+
 void cEitFilter::Process(u_short Pid, u_char Tid, const u_char *Data, int Length)
 {
   cMutexLock MutexLock(&mutex);
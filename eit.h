@@ -16,13 +16,20 @@
 class cSectionSyncerEntry : public cListObject, public cSectionSyncer {};
 
 class cSectionSyncerHash : public cHash<cSectionSyncerEntry> {
+private:
+  cVector<cSectionSyncerEntry *> entries;
 public:
   cSectionSyncerHash(void) : cHash(HASHSIZE, true) {};
+  void Add(cSectionSyncerEntry *Entry, unsigned int Id) { cHash::Add(Entry, Id); entries.Append(Entry); }
+  void Clear(void) { entries.Clear(); cHash::Clear(); }
+  int Coverage(void) const;
+      ///< Returns the percentage of tables that have been received completely,
+      ///< or -1 if no table has been seen at all.
   };
 
 class cEitFilter : public cFilter {
 private:
-  cMutex mutex;
+  mutable cMutex mutex;
   cSectionSyncerHash sectionSyncerHash;
   static time_t disableUntil;
 protected:
@@ -31,6 +38,10 @@ public:
   cEitFilter(void);
   virtual void SetStatus(bool On);
   static void SetDisableUntil(time_t Time);
+  int Coverage(void) const;
+      ///< Returns the percentage of EIT tables on the current transponder that
+      ///< have been received completely since the filter has been switched on,
+      ///< or -1 if no EIT data has been received, yet.
   };
 
 #endif //__EIT_H
@@ -11,25 +11,41 @@
 #include <stdlib.h>
 #include "channels.h"
 #include "dvbdevice.h"
+#include "eit.h"
 #include "skins.h"
+#include "timers.h"
 #include "transfer.h"
 
 // --- cScanData -------------------------------------------------------------
 
 class cScanData : public cListObject {
+  friend class cEITScanner;
 private:
   cChannel channel;
+  time_t lastScan; // when the EIT data of this transponder has last been collected
+  int coverage;    // the percentage of complete EIT tables at that time
+  int dwell;       // the number of seconds it took to collect them
+  int timers;      // the number of upcoming timers on this transponder
 public:
   cScanData(const cChannel *Channel);
   virtual int Compare(const cListObject &ListObject) const;
   int Source(void) const { return channel.Source(); }
   int Transponder(void) const { return channel.Transponder(); }
   const cChannel *GetChannel(void) const { return &channel; }
+  bool Is(const cChannel *Channel) const { return Source() == Channel->Source() && ISTRANSPONDER(Transponder(), Channel->Transponder()); }
+  int Urgency(time_t Now, int FreshTime) const;
+      ///< Returns the number of seconds since the last scan of this transponder,
+      ///< weighted by the completeness of the data collected at that time and the
+      ///< number of timers that depend on it.
   };
 
 cScanData::cScanData(const cChannel *Channel)
 {
   channel = *Channel;
+  lastScan = 0;
+  coverage = 0;
+  dwell = 0;
+  timers = 0;
 }
 
 int cScanData::Compare(const cListObject &ListObject) const
@@ -41,12 +57,19 @@ int cScanData::Compare(const cListObject &ListObject) const
   return r;
 }
 
+int cScanData::Urgency(time_t Now, int FreshTime) const
+{
+  int Age = lastScan ? min(int(Now - lastScan), 10 * FreshTime) : 10 * FreshTime;
+  return Age * (200 - coverage) / 100 * (1 + min(timers, 10));
+}
+
 // --- cScanList -------------------------------------------------------------
 
 class cScanList : public cList<cScanData> {
 public:
   void AddTransponders(const cList<cChannel> *Channels);
   void AddTransponder(const cChannel *Channel);
+  cScanData *Get(const cChannel *Channel);
   };
 
 void cScanList::AddTransponders(const cList<cChannel> *Channels)
@@ -60,13 +83,24 @@ void cScanList::AddTransponder(const cChannel *Channel)
 {
   if (Channel->Source() && Channel->Transponder()) {
      for (cScanData *sd = First(); sd; sd = Next(sd)) {
-         if (sd->Source() == Channel->Source() && ISTRANSPONDER(sd->Transponder(), Channel->Transponder()))
+         if (sd->Is(Channel))
             return;
          }
      Add(new cScanData(Channel));
      }
 }
 
+cScanData *cScanList::Get(const cChannel *Channel)
+{
+  if (Channel) {
+     for (cScanData *sd = First(); sd; sd = Next(sd)) {
+         if (sd->Is(Channel))
+            return sd;
+         }
+     }
+  return NULL;
+}
+
 // --- cTransponderList ------------------------------------------------------
 
 class cTransponderList : public cList<cChannel> {
@@ -92,9 +126,15 @@ cEITScanner EITScanner;
 cEITScanner::cEITScanner(void)
 {
   lastScan = lastActivity = time(NULL);
+  forcedScan = 0;
   currentChannel = 0;
   scanList = NULL;
   transponderList = NULL;
+  for (int i = 0; i < MAXDEVICES; i++) {
+      scanning[i] = NULL;
+      scanStart[i] = 0;
+      scanCoverage[i] = -1;
+      }
 }
 
 cEITScanner::~cEITScanner()
@@ -105,6 +145,7 @@ cEITScanner::~cEITScanner()
 
 void cEITScanner::AddTransponder(cChannel *Channel)
 {
+  cMutexLock MutexLock(&mutex);
   if (!transponderList)
      transponderList = new cTransponderList;
   transponderList->AddTransponder(Channel);
@@ -112,6 +153,7 @@ void cEITScanner::AddTransponder(cChannel *Channel)
 
 void cEITScanner::ForceScan(void)
 {
+  forcedScan = time(NULL);
   lastActivity = 0;
 }
 
@@ -125,67 +167,209 @@ void cEITScanner::Activity(void)
   lastActivity = time(NULL);
 }
 
+void cEITScanner::UpdateScanList(void)
+{
+  if (const cChannels *Channels = cChannels::GetChannelsRead(channelsStateKey, 10)) {
+     // The channels have been modified, so let's rebuild the list, keeping what we know about each transponder:
+     cScanList *NewList = new cScanList;
+     NewList->AddTransponders(Channels);
+     channelsStateKey.Remove();
+     if (scanList) {
+        for (cScanData *sd = NewList->First(); sd; sd = NewList->Next(sd)) {
+            if (cScanData *Old = scanList->Get(sd->GetChannel())) {
+               sd->lastScan = Old->lastScan;
+               sd->coverage = Old->coverage;
+               sd->dwell = Old->dwell;
+               for (int i = 0; i < MAXDEVICES; i++) {
+                   if (scanning[i] == Old)
+                      scanning[i] = sd;
+                   }
+               }
+            }
+        for (int i = 0; i < MAXDEVICES; i++) {
+            if (scanning[i] && !NewList->Contains(scanning[i]))
+               scanning[i] = NULL;
+            }
+        delete scanList;
+        }
+     scanList = NewList;
+     }
+  if (scanList && transponderList) {
+     scanList->AddTransponders(transponderList);
+     DELETENULL(transponderList);
+     }
+}
+
+void cEITScanner::UpdateTimers(time_t Now)
+{
+  cStateKey StateKey;
+  if (const cTimers *Timers = cTimers::GetTimersRead(StateKey, 10)) {
+     for (cScanData *sd = scanList->First(); sd; sd = scanList->Next(sd))
+         sd->timers = 0;
+     for (const cTimer *Timer = Timers->First(); Timer; Timer = Timers->Next(Timer)) {
+         if (Timer->Local() && Timer->HasFlags(tfActive) && Timer->StopTime() > Now && Timer->StartTime() < Now + TimerLookAhead) {
+            if (cScanData *sd = scanList->Get(Timer->Channel()))
+               sd->timers++;
+            }
+         }
+     StateKey.Remove();
+     }
+}
+
+bool cEITScanner::CheckDevice(cDevice *Device, time_t Now)
+{
+  int n = Device->DeviceNumber();
+  const cEitFilter *EitFilter = Device->EitFilter();
+  int Coverage = EitFilter ? EitFilter->Coverage() : -1;
+  if (cScanData *sd = scanning[n]) {
+     if (Device->IsTunedToTransponder(sd->GetChannel())) {
+        int Dwell = int(Now - scanStart[n]);
+        if (Coverage < 100 && Coverage > scanCoverage[n] && Dwell < MaxDwellTime) {
+           scanCoverage[n] = Coverage; // still collecting data
+           return true;
+           }
+        sd->lastScan = Now;
+        sd->coverage = max(Coverage, 0);
+        sd->dwell = Dwell;
+        //dsyslog("EIT scan: device %d  source  %-8s tp %5d  coverage %d%%  dwell %d", n + 1, *cSource::ToString(sd->Source()), sd->Transponder(), sd->coverage, Dwell);
+        }
+     scanning[n] = NULL; // done, or the device has been switched to a different transponder
+     }
+  else if (Coverage == 100) {
+     // the device is tuned to this transponder for some other reason, and has collected its EIT data:
+     for (cScanData *sd = scanList->First(); sd; sd = scanList->Next(sd)) {
+         if (Device->IsTunedToTransponder(sd->GetChannel())) {
+            sd->lastScan = Now;
+            sd->coverage = Coverage;
+            break;
+            }
+         }
+     }
+  return false;
+}
+
+cScanData *cEITScanner::BestTransponder(cDevice *Device, time_t Now)
+{
+  cScanData *Best = NULL;
+  int BestScore = 0;
+  for (cScanData *ScanData = scanList->First(); ScanData; ScanData = scanList->Next(ScanData)) {
+      if (lastActivity == 0) { // this is a triggered scan
+         if (ScanData->lastScan >= forcedScan)
+            continue;
+         }
+      else if (ScanData->Urgency(Now, FreshTime) < FreshTime)
+         continue;
+      bool Scanning = false;
+      for (int i = 0; i < MAXDEVICES; i++) {
+          if (scanning[i] == ScanData)
+             Scanning = true;
+          }
+      if (Scanning)
+         continue;
+      const cChannel *Channel = ScanData->GetChannel();
+      if (!Channel->Ca() || Channel->Ca() == Device->DeviceNumber() + 1 || Channel->Ca() >= CA_ENCRYPTED_MIN) {
+         if (Device->ProvidesTransponder(Channel)) {
+            if (const cPositioner *Positioner = Device->Positioner()) {
+               if (Positioner->LastLongitude() != cSource::Position(Channel->Source()))
+                  continue;
+               }
+            if (Device->MaySwitchTransponder(Channel) || Device->ProvidesTransponderExclusively(Channel) && Now - lastActivity > Setup.EPGScanTimeout * 3600) {
+               // Prefer the transponders that need fresh data most, per second of scan time:
+               int Score = ScanData->Urgency(Now, FreshTime) / max(ScanData->dwell, int(ScanTimeout)) + 1;
+               if (Score > BestScore) {
+                  Best = ScanData;
+                  BestScore = Score;
+                  }
+               }
+            }
+         }
+      }
+  return Best;
+}
+
 void cEITScanner::Process(void)
 {
   if (Setup.EPGScanTimeout || !lastActivity) { // !lastActivity means a scan was forced
      time_t now = time(NULL);
      if (now - lastScan > ScanTimeout && now - lastActivity > ActivityTimeout) {
-        cStateKey StateKey;
-        if (const cChannels *Channels = cChannels::GetChannelsRead(StateKey, 10)) {
-           if (!scanList) {
-              scanList = new cScanList;
-              if (transponderList) {
-                 scanList->AddTransponders(transponderList);
-                 delete transponderList;
-                 transponderList = NULL;
-                 }
-              scanList->AddTransponders(Channels);
-              }
-           bool AnyDeviceSwitched = false;
-           for (int i = 0; i < cDevice::NumDevices(); i++) {
-               cDevice *Device = cDevice::GetDevice(i);
-               if (Device && Device->ProvidesEIT()) {
-                  for (cScanData *ScanData = scanList->First(); ScanData; ScanData = scanList->Next(ScanData)) {
-                      const cChannel *Channel = ScanData->GetChannel();
-                      if (Channel) {
-                         if (!Channel->Ca() || Channel->Ca() == Device->DeviceNumber() + 1 || Channel->Ca() >= CA_ENCRYPTED_MIN) {
-                            if (Device->ProvidesTransponder(Channel)) {
-                               if (Device->Priority() < 0) {
-                                  if (const cPositioner *Positioner = Device->Positioner()) {
-                                     if (Positioner->LastLongitude() != cSource::Position(Channel->Source()))
-                                        continue;
-                                     }
-                                  bool MaySwitchTransponder = Device->MaySwitchTransponder(Channel);
-                                  if (MaySwitchTransponder || Device->ProvidesTransponderExclusively(Channel) && now - lastActivity > Setup.EPGScanTimeout * 3600) {
-                                     if (!MaySwitchTransponder) {
-                                        if (Device == cDevice::ActualDevice() && !currentChannel) {
-                                           cDevice::PrimaryDevice()->StopReplay(); // stop transfer mode
-                                           currentChannel = Device->CurrentChannel();
-                                           Skins.Message(mtInfo, tr("Starting EPG scan"));
-                                           }
-                                        }
-                                     //dsyslog("EIT scan: device %d  source  %-8s tp %5d", Device->DeviceNumber() + 1, *cSource::ToString(Channel->Source()), Channel->Transponder());
-                                     Device->SwitchChannel(Channel, false);
-                                     scanList->Del(ScanData);
-                                     AnyDeviceSwitched = true;
-                                     break;
-                                     }
-                                  }
-                               }
-                            }
-                         }
-                      }
+        cMutexLock MutexLock(&mutex);
+        UpdateScanList();
+        if (scanList) {
+           UpdateTimers(now);
+           cStateKey StateKey;
+           if (cChannels::GetChannelsRead(StateKey, 10)) {
+              bool AnyDeviceScanning = false;
+              for (int i = 0; i < cDevice::NumDevices(); i++) {
+                  cDevice *Device = cDevice::GetDevice(i);
+                  if (Device && Device->ProvidesEIT()) {
+                     if (CheckDevice(Device, now)) {
+                        AnyDeviceScanning = true;
+                        continue;
+                        }
+                     if (Device->Priority() < 0) {
+                        if (cScanData *ScanData = BestTransponder(Device, now)) {
+                           const cChannel *Channel = ScanData->GetChannel();
+                           if (!Device->MaySwitchTransponder(Channel)) {
+                              if (Device == cDevice::ActualDevice() && !currentChannel) {
+                                 cDevice::PrimaryDevice()->StopReplay(); // stop transfer mode
+                                 currentChannel = Device->CurrentChannel();
+                                 Skins.Message(mtInfo, tr("Starting EPG scan"));
+                                 }
+                              }
+                           //dsyslog("EIT scan: device %d  source  %-8s tp %5d", Device->DeviceNumber() + 1, *cSource::ToString(Channel->Source()), Channel->Transponder());
+                           Device->SwitchChannel(Channel, false);
+                           scanning[Device->DeviceNumber()] = ScanData;
+                           scanStart[Device->DeviceNumber()] = now;
+                           scanCoverage[Device->DeviceNumber()] = -1;
+                           AnyDeviceScanning = true;
+                           }
+                        }
+                     }
                   }
-               }
-           if (!AnyDeviceSwitched) {
-              delete scanList;
-              scanList = NULL;
-              if (lastActivity == 0) // this was a triggered scan
-                 Activity();
+              if (!AnyDeviceScanning) {
+                 if (lastActivity == 0) // this was a triggered scan
+                    Activity();
+                 }
+              StateKey.Remove();
               }
-           StateKey.Remove();
            }
         lastScan = time(NULL);
         }
      }
 }
+
+void cEITScanner::Statistics(cStringList &Lines)
+{
+  cMutexLock MutexLock(&mutex);
+  time_t Now = time(NULL);
+  int Transponders = 0;
+  int Fresh = 0;
+  int Never = 0;
+  int Coverage = 0;
+  int Oldest = 0;
+  if (scanList) {
+     for (cScanData *sd = scanList->First(); sd; sd = scanList->Next(sd)) {
+         Transponders++;
+         if (!sd->lastScan)
+            Never++;
+         else {
+            if (Now - sd->lastScan < FreshTime)
+               Fresh++;
+            Oldest = max(Oldest, int(Now - sd->lastScan));
+            }
+         Coverage += sd->coverage;
+         }
+     }
+  Lines.Append(strdup(cString::sprintf("%d transponders, %d scanned within %d minutes, %d never scanned, oldest scan %d minutes ago, average coverage %d%%", Transponders, Fresh, FreshTime / 60, Never, Oldest / 60, Transponders ? Coverage / Transponders : 0)));
+  if (scanList) {
+     for (cScanData *sd = scanList->First(); sd; sd = scanList->Next(sd)) {
+         cString Device = "";
+         for (int i = 0; i < MAXDEVICES; i++) {
+             if (scanning[i] == sd)
+                Device = cString::sprintf(", scanning on device %d", i + 1);
+             }
+         cString Scanned = sd->lastScan ? cString::sprintf("scanned %d minutes ago", int(Now - sd->lastScan) / 60) : cString("never scanned");
+         Lines.Append(strdup(cString::sprintf("%s %d: %s, coverage %d%%, dwell %d s, %d timers%s", *cSource::ToString(sd->Source()), sd->Transponder(), *Scanned, sd->coverage, sd->dwell, sd->timers, *Device)));
+         }
+     }
+}
@@ -15,18 +15,31 @@
 #include "config.h"
 #include "device.h"
 
+class cScanData;
 class cScanList;
 class cTransponderList;
 
 class cEITScanner {
 private:
   enum { ActivityTimeout = 60,
-         ScanTimeout = 20
+         ScanTimeout = 20,
+         MaxDwellTime = 90,      // max. number of seconds a device stays on a transponder
+         FreshTime = 3600,       // a transponder is rescanned after this many seconds
+         TimerLookAhead = 86400  // timers starting within this many seconds make their transponder more important
        };
-  time_t lastScan, lastActivity;
+  cMutex mutex;
+  time_t lastScan, lastActivity, forcedScan;
   int currentChannel;
+  cStateKey channelsStateKey;
   cScanList *scanList;
   cTransponderList *transponderList;
+  cScanData *scanning[MAXDEVICES];
+  time_t scanStart[MAXDEVICES];
+  int scanCoverage[MAXDEVICES];
+  void UpdateScanList(void);
+  void UpdateTimers(time_t Now);
+  bool CheckDevice(cDevice *Device, time_t Now);
+  cScanData *BestTransponder(cDevice *Device, time_t Now);
 public:
   cEITScanner(void);
   ~cEITScanner();
@@ -35,6 +48,9 @@ public:
   void ForceScan(void);
   void Activity(void);
   void Process(void);
+  void Statistics(cStringList &Lines);
+       ///< Adds a summary of the EPG scan coverage to Lines, followed by one
+       ///< line for each transponder.
   };
 
 extern cEITScanner EITScanner;
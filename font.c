@@ -107,6 +107,7 @@ private:
   FT_Face face; ///< Handle to face object
   mutable cList<cGlyph> glyphCacheMonochrome;
   mutable cList<cGlyph> glyphCacheAntiAliased;
+  mutable cMutex mutex; // protects the glyph and kerning caches, since text may be drawn by several threads
   int Bottom(void) const { return bottom; }
   int Kerning(cGlyph *Glyph, uint PrevSym) const;
   cGlyph* Glyph(uint CharCode, bool AntiAliased = false) const;
@@ -176,6 +177,7 @@ cFreetypeFont::cFreetypeFont(const char *Name, int CharHeight, int CharWidth)
 
 cFreetypeFont::~cFreetypeFont()
 {
+  cOsd::ExecuteAllDeferred(); // pending DrawText() operations might use this font
   FT_Done_Face(face);
   FT_Done_FreeType(library);
 }
@@ -184,6 +186,7 @@ int cFreetypeFont::Kerning(cGlyph *Glyph, uint PrevSym) const
 {
   int kerning = 0;
   if (Glyph && PrevSym) {
+     cMutexLock MutexLock(&mutex);
      kerning = Glyph->GetKerningCache(PrevSym);
      if (kerning == KERNING_UNKNOWN) {
         FT_Vector delta;
@@ -204,6 +207,7 @@ cGlyph* cFreetypeFont::Glyph(uint CharCode, bool AntiAliased) const
      CharCode = 0x20;
 
   // Lookup in cache:
+  cMutexLock MutexLock(&mutex);
   cList<cGlyph> *glyphCache = AntiAliased ? &glyphCacheAntiAliased : &glyphCacheMonochrome;
   for (cGlyph *g = glyphCache->First(); g; g = glyphCache->Next(g)) {
       if (g->CharCode() == CharCode)
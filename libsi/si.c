@@ -14,6 +14,7 @@
 #include <errno.h>
 #include <iconv.h>
 #include <malloc.h>
+#include <pthread.h>
 #include <stdlib.h> // for broadcaster stupidity workaround
 #include <string.h>
 #include "descriptor.h"
@@ -167,6 +168,26 @@ Descriptor *DescriptorLoop::createDescriptor(int &i, bool returnUnimplemetedDesc
    return d;
 }
 
+bool DescriptorLoop::getNextTag(Iterator &it, DescriptorTag &tag) {
+   if (isValid() && it.i<getLength()) {
+      const unsigned char *p=data.getData(it.i);
+      if (!checkSize(Descriptor::getLength(p)))
+         return false;
+      tag=Descriptor::getDescriptorTag(p);
+      it.current=it.i;
+      it.i+=Descriptor::getLength(p);
+      return true;
+   }
+   return false;
+}
+
+bool DescriptorLoop::decode(Descriptor &d, const Iterator &it) {
+   CharArray da=data+it.current;
+   d.setData(da);
+   d.CheckParse();
+   return d.isValid();
+}
+
 int DescriptorLoop::getNumberOfDescriptors() {
    const unsigned char *p=data.getData();
    const unsigned char *end=p+getLength();
@@ -314,6 +335,201 @@ static const char *CharacterTables2[] = {
 static char *SystemCharacterTable = NULL;
 bool SystemCharacterTableIsSingleByte = true;
 
+// --- Character conversion caches ---
+//
+// Opening an iconv converter is expensive compared to converting a short string,
+// so converters are kept for reuse. Since a converter can only be used by one
+// thread at a time, a thread takes it out of the cache while using it.
+// For the single byte character tables and ISO6937 the result of converting every
+// character is stored in a lookup table, which is used instead of iconv.
+
+static pthread_mutex_t ConverterMutex = PTHREAD_MUTEX_INITIALIZER;
+
+class ConverterLock {
+public:
+   ConverterLock() { pthread_mutex_lock(&ConverterMutex); }
+   ~ConverterLock() { pthread_mutex_unlock(&ConverterMutex); }
+};
+
+#define MaxIdleConverters 16
+
+struct Converter {
+   char *fromCode; // NULL if this slot is unused
+   iconv_t cd;
+};
+
+static Converter IdleConverters[MaxIdleConverters] = { { NULL, 0 } };
+
+static void closeConverter(Converter &c) {
+   if (c.fromCode) {
+      iconv_close(c.cd);
+      free(c.fromCode);
+      c.fromCode = NULL;
+   }
+}
+
+// Returns a converter from fromCode to the system character table, which the caller
+// has to hand back with releaseConverter(). Returns (iconv_t)-1 in case of an error.
+static iconv_t getConverter(const char *fromCode) {
+   {
+      ConverterLock Lock;
+      for (int i = 0; i < MaxIdleConverters; i++) {
+         if (IdleConverters[i].fromCode && strcmp(IdleConverters[i].fromCode, fromCode) == 0) {
+            free(IdleConverters[i].fromCode);
+            IdleConverters[i].fromCode = NULL;
+            return IdleConverters[i].cd;
+         }
+      }
+   }
+   return iconv_open(SystemCharacterTable, fromCode);
+}
+
+static void releaseConverter(const char *fromCode, iconv_t cd) {
+   iconv(cd, NULL, NULL, NULL, NULL); // resets the conversion state
+   ConverterLock Lock;
+   static int Next = 0;
+   int Slot = -1;
+   for (int i = 0; i < MaxIdleConverters; i++) {
+      if (!IdleConverters[i].fromCode) {
+         Slot = i;
+         break;
+      }
+   }
+   if (Slot < 0) { // all slots are used, so replace one of them
+      Slot = Next;
+      Next = (Next + 1) % MaxIdleConverters;
+      closeConverter(IdleConverters[Slot]);
+   }
+   IdleConverters[Slot].fromCode = strdup(fromCode);
+   IdleConverters[Slot].cd = cd;
+}
+
+#define MaxCharacterLength 4 // the longest encoding of a character in the system character table
+#define CombiningPrefix    0xFF // marks the first byte of a two byte character
+
+struct CharacterEncoding {
+   unsigned char length; // 0 if the character can't be converted
+   char data[MaxCharacterLength];
+};
+
+struct CharacterMap {
+   char *fromCode;
+   CharacterEncoding single[256];
+   CharacterEncoding (*combined)[256]; // ISO6937 characters with diacritical marks, indexed by first byte & 0x0F and second byte
+};
+
+#define MaxCharacterMaps 32
+
+static CharacterMap *CharacterMaps[MaxCharacterMaps] = { NULL };
+static int NumCharacterMaps = 0;
+static bool SystemCharacterTableHasMaps = false;
+
+static void freeCharacterMaps(void) {
+   ConverterLock Lock;
+   for (int i = 0; i < NumCharacterMaps; i++) {
+      free(CharacterMaps[i]->fromCode);
+      delete[] CharacterMaps[i]->combined;
+      delete CharacterMaps[i];
+      CharacterMaps[i] = NULL;
+   }
+   NumCharacterMaps = 0;
+   for (int i = 0; i < MaxIdleConverters; i++)
+      closeConverter(IdleConverters[i]);
+}
+
+// Converts the Length bytes at From into Encoding. Returns 1 if this was successful,
+// 0 if From is an invalid or unconvertible sequence, and -1 if it is incomplete.
+static int encodeCharacter(iconv_t cd, const unsigned char *From, size_t Length, CharacterEncoding &Encoding) {
+   char *from = (char *)From;
+   char *to = Encoding.data;
+   size_t toLength = sizeof(Encoding.data);
+   Encoding.length = 0;
+   iconv(cd, NULL, NULL, NULL, NULL);
+   if (iconv(cd, &from, &Length, &to, &toLength) == size_t(-1))
+      return errno == EINVAL ? -1 : 0;
+   if (Length)
+      return 0;
+   Encoding.length = to - Encoding.data;
+   return Encoding.length > 0;
+}
+
+static CharacterMap *buildCharacterMap(const char *fromCode) {
+   iconv_t cd = iconv_open(SystemCharacterTable, fromCode);
+   if (cd == (iconv_t)-1)
+      return NULL;
+   CharacterMap *Map = new CharacterMap;
+   Map->fromCode = strdup(fromCode);
+   Map->combined = NULL;
+   for (int c = 0; c < 256; c++) {
+      unsigned char b = c;
+      if (encodeCharacter(cd, &b, 1, Map->single[c]) < 0) {
+         if ((c & 0xF0) == 0xC0) { // ISO6937 diacritical mark
+            if (!Map->combined)
+               Map->combined = new CharacterEncoding[16][256];
+            unsigned char s[2] = { b, 0 };
+            for (int d = 0; d < 256; d++) {
+               s[1] = d;
+               encodeCharacter(cd, s, 2, Map->combined[c & 0x0F][d]);
+            }
+            Map->single[c].length = CombiningPrefix;
+         }
+         else { // not a character table this can be done for
+            free(Map->fromCode);
+            delete[] Map->combined;
+            delete Map;
+            Map = NULL;
+            break;
+         }
+      }
+   }
+   iconv_close(cd);
+   return Map;
+}
+
+static const CharacterMap *getCharacterMap(const char *fromCode) {
+   if (!SystemCharacterTableHasMaps || strncmp(fromCode, "ISO-8859-", 9) != 0 && strcmp(fromCode, "ISO6937") != 0)
+      return NULL;
+   ConverterLock Lock;
+   for (int i = 0; i < NumCharacterMaps; i++) {
+      if (strcmp(CharacterMaps[i]->fromCode, fromCode) == 0)
+         return CharacterMaps[i];
+   }
+   if (NumCharacterMaps < MaxCharacterMaps) {
+      if (CharacterMap *Map = buildCharacterMap(fromCode)) {
+         CharacterMaps[NumCharacterMaps++] = Map;
+         return Map;
+      }
+   }
+   return NULL;
+}
+
+static void convertByCharacterMap(const CharacterMap *Map, const unsigned char *from, size_t fromLength, char *to, size_t toLength) {
+   static const CharacterEncoding Unknown = { 1, { '?' } };
+   while (fromLength > 0) {
+      const CharacterEncoding *e = &Map->single[*from];
+      size_t n = 1;
+      if (e->length == CombiningPrefix) {
+         if (fromLength < 2)
+            break; // incomplete character
+         e = &Map->combined[*from & 0x0F][from[1]];
+         n = 2;
+      }
+      if (!e->length) {
+         // A character can't be converted, so mark it with '?' and proceed:
+         e = &Unknown;
+         n = 1;
+      }
+      if (e->length >= toLength)
+         break;
+      memcpy(to, e->data, e->length);
+      to += e->length;
+      toLength -= e->length;
+      from += n;
+      fromLength -= n;
+   }
+   *to = 0;
+}
+
 bool systemCharacterTableIsSingleByte(void)
 {
   return SystemCharacterTableIsSingleByte;
@@ -337,9 +553,11 @@ bool SetOverrideCharacterTable(const char *CharacterTable)
 }
 
 bool SetSystemCharacterTable(const char *CharacterTable) {
+   freeCharacterMaps();
    free(SystemCharacterTable);
    SystemCharacterTable = CharacterTable ? strdup(CharacterTable) : NULL;
    SystemCharacterTableIsSingleByte = true;
+   SystemCharacterTableHasMaps = false;
    if (SystemCharacterTable) {
       // Check whether the character table is known and "single byte":
       char a[] = "";
@@ -355,6 +573,8 @@ bool SetSystemCharacterTable(const char *CharacterTable) {
             SystemCharacterTableIsSingleByte = strlen(b) == 1;
          }
          iconv_close(cd);
+         // Lookup tables only work with stateless character tables:
+         SystemCharacterTableHasMaps = SystemCharacterTableIsSingleByte || strcasecmp(SystemCharacterTable, "UTF-8") == 0 || strcasecmp(SystemCharacterTable, "UTF8") == 0;
          return true;
       }
    }
@@ -415,8 +635,14 @@ size_t convertCharacterTable(const char *from, size_t fromLength, char *to, size
 {
   bool converted = false;
   char *result = to;
-  if (SystemCharacterTable && fromCode) {
-     iconv_t cd = iconv_open(SystemCharacterTable, fromCode);
+  if (SystemCharacterTable && fromCode && toLength > 0) {
+     if (const CharacterMap *Map = getCharacterMap(fromCode)) {
+        convertByCharacterMap(Map, (const unsigned char *)from, fromLength, to, toLength);
+        converted = true;
+     }
+  }
+  if (SystemCharacterTable && fromCode && !converted) {
+     iconv_t cd = getConverter(fromCode);
      if (cd != (iconv_t)-1) {
         char *fromPtr = (char *)from;
         while (fromLength > 0 && toLength > 1) {
@@ -433,7 +659,7 @@ size_t convertCharacterTable(const char *from, size_t fromLength, char *to, size
            }
         }
         *to = 0;
-        iconv_close(cd);
+        releaseConverter(fromCode, cd);
         converted = true;
      }
   }
@@ -322,14 +322,15 @@ class Loop : public VariableLengthPart {
 public:
    class Iterator {
    public:
-      Iterator() { i=0; }
-      void reset() { i=0; }
+      Iterator() { i=0; current=0; }
+      void reset() { i=0; current=0; }
    private:
       template <class T> friend class StructureLoop;
       friend class DescriptorLoop;
       template <class T> friend class TypeLoop;
       friend class ExtendedEventDescriptors;
       int i;
+      int current; //offset of the descriptor most recently returned by DescriptorLoop::getNextTag()
    };
 protected:
    virtual void Parse() {}
@@ -403,6 +404,22 @@ public:
    //In either case, a return value of 0 indicates that no further calls to this method
    //with the iterator shall be made.
    Descriptor *getNext(Iterator &it, DescriptorTag *tags, int arrayLength, bool returnUnimplemetedDescriptor=false);
+   //Allocation free alternative to getNext():
+   //stores the tag of the next descriptor in tag and advances the iterator,
+   //or returns false if no more descriptors are available.
+   //The descriptor can then be decoded in place with decode(), e.g. into an
+   //object on the stack:
+   //   DescriptorTag tag;
+   //   for (Loop::Iterator it; loop.getNextTag(it, tag); ) {
+   //      if (tag == ShortEventDescriptorTag) {
+   //         ShortEventDescriptor sed;
+   //         if (loop.decode(sed, it))
+   //            ...
+   bool getNextTag(Iterator &it, DescriptorTag &tag);
+   //decodes the descriptor most recently returned by getNextTag() into d,
+   //which must be of the class that implements that descriptor's tag.
+   //Returns false if the descriptor's data is invalid.
+   bool decode(Descriptor &d, const Iterator &it);
    //returns the number of descriptors in this loop
    int getNumberOfDescriptors();
    //writes the tags of the descriptors in this loop in the array,
@@ -12,6 +12,10 @@
 
 #include <string.h>
 #include "util.h"
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define CRC32_CLMUL
+#endif
 
 namespace SI {
 
@@ -264,17 +268,91 @@ u_int32_t CRC32::crc_table[256] = {
    0x933eb0bb, 0x97ffad0c, 0xafb010b1, 0xab710d06, 0xa6322bdf, 0xa2f33668,
    0xbcb4666d, 0xb8757bda, 0xb5365d03, 0xb1f740b4};
 
-u_int32_t CRC32::crc32 (const char *d, int len, u_int32_t crc)
+u_int32_t CRC32::crc_tables[8][256];
+
+#define CRC32_POLYNOMIAL 0x04c11db7
+#define CRC32_CLMUL_MIN  64 // shorter data isn't worth setting up the carry-less multiplication
+
+static pthread_once_t crcTablesInitialized = PTHREAD_ONCE_INIT;
+static bool crcClmul = false;
+#ifdef CRC32_CLMUL
+static u_int32_t crcFold1, crcFold2; // x^192 mod P, x^128 mod P
+#endif
+
+// Returns x^n mod P:
+static u_int32_t crcPowerOfX(int n)
 {
-   register int i;
-   const unsigned char *u=(unsigned char*)d; // Saves '& 0xff'
+   u_int32_t r = 1;
+   while (n-- > 0)
+      r = (r & 0x80000000) ? (r << 1) ^ CRC32_POLYNOMIAL : r << 1;
+   return r;
+}
 
-   for (i=0; i<len; i++)
-      crc = (crc << 8) ^ crc_table[((crc >> 24) ^ *u++)];
+void CRC32::initTables()
+{
+   memcpy(crc_tables[0], crc_table, sizeof(crc_table));
+   for (int k = 1; k < 8; k++) {
+      for (int i = 0; i < 256; i++)
+         crc_tables[k][i] = (crc_tables[k - 1][i] << 8) ^ crc_table[crc_tables[k - 1][i] >> 24];
+   }
+#ifdef CRC32_CLMUL
+   crcFold1 = crcPowerOfX(192);
+   crcFold2 = crcPowerOfX(128);
+   __builtin_cpu_init();
+   crcClmul = __builtin_cpu_supports("pclmul") && __builtin_cpu_supports("ssse3");
+#endif
+}
 
+// "Slice-by-8": processes eight bytes at a time with eight lookup tables.
+u_int32_t CRC32::crc32Bytes(const unsigned char *u, int len, u_int32_t crc)
+{
+   for (; len >= 8; len -= 8, u += 8) {
+      crc ^= (u[0] << 24) | (u[1] << 16) | (u[2] << 8) | u[3];
+      crc = crc_tables[7][crc >> 24] ^ crc_tables[6][(crc >> 16) & 0xFF] ^ crc_tables[5][(crc >> 8) & 0xFF] ^ crc_tables[4][crc & 0xFF]
+          ^ crc_tables[3][u[4]] ^ crc_tables[2][u[5]] ^ crc_tables[1][u[6]] ^ crc_tables[0][u[7]];
+   }
+   while (len-- > 0)
+      crc = (crc << 8) ^ crc_table[((crc >> 24) ^ *u++)];
    return crc;
 }
 
+#ifdef CRC32_CLMUL
+// Folds the data 16 bytes at a time by carry-less multiplication (PCLMULQDQ), and
+// calculates the CRC of the remaining 128 bits with the lookup tables.
+// len must be at least 16.
+__attribute__((target("pclmul,ssse3")))
+u_int32_t CRC32::crc32Clmul(const unsigned char *u, int len, u_int32_t crc)
+{
+   const __m128i Swap = _mm_setr_epi8(15, 14, 13, 12, 11, 10, 9, 8, 7, 6, 5, 4, 3, 2, 1, 0);
+   const __m128i Fold = _mm_set_epi64x(crcFold1, crcFold2);
+   __m128i x = _mm_shuffle_epi8(_mm_loadu_si128((const __m128i *)u), Swap);
+   x = _mm_xor_si128(x, _mm_set_epi32(crc, 0, 0, 0));
+   for (u += 16, len -= 16; len >= 16; u += 16, len -= 16) {
+      // x * x^128 == high * x^192 + low * x^128:
+      __m128i h = _mm_clmulepi64_si128(x, Fold, 0x11);
+      __m128i l = _mm_clmulepi64_si128(x, Fold, 0x00);
+      x = _mm_xor_si128(_mm_xor_si128(h, l), _mm_shuffle_epi8(_mm_loadu_si128((const __m128i *)u), Swap));
+   }
+   unsigned char b[16];
+   _mm_storeu_si128((__m128i *)b, _mm_shuffle_epi8(x, Swap));
+   return crc32Bytes(u, len, crc32Bytes(b, sizeof(b), 0));
+}
+#else
+u_int32_t CRC32::crc32Clmul(const unsigned char *u, int len, u_int32_t crc)
+{
+   return crc32Bytes(u, len, crc);
+}
+#endif
+
+u_int32_t CRC32::crc32 (const char *d, int len, u_int32_t crc)
+{
+   pthread_once(&crcTablesInitialized, initTables);
+   const unsigned char *u=(unsigned char*)d; // Saves '& 0xff'
+   if (crcClmul && len >= CRC32_CLMUL_MIN)
+      return crc32Clmul(u, len, crc);
+   return crc32Bytes(u, len, crc);
+}
+
 CRC32::CRC32(const char *d, int len, u_int32_t CRCvalue) {
    data=d;
    length=len;
@@ -152,6 +152,11 @@ public:
    static u_int32_t crc32(const char *d, int len, u_int32_t CRCvalue);
 protected:
    static u_int32_t crc_table[256];
+   // crc_tables[k][b] is the CRC of byte b followed by k zero bytes, with crc_tables[0] == crc_table:
+   static u_int32_t crc_tables[8][256];
+   static void initTables();
+   static u_int32_t crc32Bytes(const unsigned char *u, int len, u_int32_t crc);
+   static u_int32_t crc32Clmul(const unsigned char *u, int len, u_int32_t crc);
 
    const char *data;
    int length;
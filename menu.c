@@ -30,6 +30,7 @@
 #include "svdrp.h"
 #include "themes.h"
 #include "timers.h"
+#include "timeshift.h"
 #include "transfer.h"
 #include "videodir.h"
 
@@ -3522,6 +3523,7 @@ void cMenuSetupOSD::Set(void)
   Add(new cMenuEditIntItem( tr("Setup.OSD$Message time (s)"),       &data.OSDMessageTime, 1, 60));
   Add(new cMenuEditStraItem(tr("Setup.OSD$Use small font"),         &data.UseSmallFont, 3, useSmallFontTexts));
   Add(new cMenuEditBoolItem(tr("Setup.OSD$Anti-alias"),             &data.AntiAlias));
+  Add(new cMenuEditIntItem( tr("Setup.OSD$Render threads"),         &data.OSDRenderThreads, 0, MAXOSDRENDERTHREADS, tr("off")));
   Add(new cMenuEditStraItem(tr("Setup.OSD$Default font"),           &fontOsdIndex, fontOsdNames.Size(), &fontOsdNames[0]));
   Add(new cMenuEditStraItem(tr("Setup.OSD$Small font"),             &fontSmlIndex, fontSmlNames.Size(), &fontSmlNames[0]));
   Add(new cMenuEditStraItem(tr("Setup.OSD$Fixed font"),             &fontFixIndex, fontFixNames.Size(), &fontFixNames[0]));
@@ -4165,6 +4167,7 @@ cMenuSetupRecord::cMenuSetupRecord(void)
   Add(new cMenuEditStraItem(tr("Setup.Recording$Pause key handling"),        &data.PauseKeyHandling, 3, pauseKeyHandlingTexts));
   Add(new cMenuEditIntItem( tr("Setup.Recording$Pause priority"),            &data.PausePriority, 0, MAXPRIORITY));
   Add(new cMenuEditIntItem( tr("Setup.Recording$Pause lifetime (d)"),        &data.PauseLifetime, 0, MAXLIFETIME));
+  Add(new cMenuEditIntItem( tr("Setup.Recording$Timeshift buffer (MB)"),     &data.TimeshiftSize, 0, MAXTIMESHIFTSIZE, tr("off")));
   Add(new cMenuEditBoolItem(tr("Setup.Recording$Use episode name"),          &data.UseSubtitle));
   Add(new cMenuEditBoolItem(tr("Setup.Recording$Use VPS"),                   &data.UseVps));
   Add(new cMenuEditIntItem( tr("Setup.Recording$VPS margin (s)"),            &data.VpsMargin, 0));
@@ -4173,7 +4176,10 @@ cMenuSetupRecord::cMenuSetupRecord(void)
   Add(new cMenuEditIntItem( tr("Setup.Recording$Instant rec. time (min)"),   &data.InstantRecordTime, 0, MAXINSTANTRECTIME, tr("Setup.Recording$present event")));
   Add(new cMenuEditIntItem( tr("Setup.Recording$Max. video file size (MB)"), &data.MaxVideoFileSize, MINVIDEOFILESIZE, MAXVIDEOFILESIZETS));
   Add(new cMenuEditBoolItem(tr("Setup.Recording$Split edited files"),        &data.SplitEditedFiles));
+  Add(new cMenuEditBoolItem(tr("Setup.Recording$Record whole transponder"),  &data.MuxRecording));
   Add(new cMenuEditStraItem(tr("Setup.Recording$Delete timeshift recording"),&data.DelTimeshiftRec, 3, delTimeshiftRecTexts));
+  Add(new cMenuEditIntItem( tr("Setup.Recording$Remove in steps of (MB)"),   &data.RemoveStepSize, 0, INT_MAX, tr("off")));
+  Add(new cMenuEditIntItem( tr("Setup.Recording$Pause between steps (ms)"),  &data.RemoveStepDelay, 0, 10000));
 }
 
 // --- cMenuSetupReplay ------------------------------------------------------
@@ -5309,6 +5315,7 @@ cRecordControl::cRecordControl(cDevice *Device, cTimers *Timers, cTimer *Timer,
   event = NULL;
   fileName = NULL;
   recorder = NULL;
+  muxRecording = NULL;
   device = Device;
   if (!device) device = cDevice::PrimaryDevice();//XXX
   timer = Timer;
@@ -5350,8 +5357,18 @@ cRecordControl::cRecordControl(cDevice *Device, cTimers *Timers, cTimer *Timer,
   if (MakeDirs(fileName, true)) {
      Recording.WriteInfo(); // we write this *before* attaching the recorder to the device, to make sure the info file is present when the recorder needs to update the fps value!
      const cChannel *ch = timer->Channel();
-     recorder = new cRecorder(fileName, ch, timer->Priority());
-     if (device->AttachReceiver(recorder)) {
+     bool Attached;
+     if (Setup.MuxRecording && Timer && cMuxRecording::Supports(ch)) {
+        muxRecording = new cMuxRecording(device, fileName, ch, timer->Priority());
+        muxRecording->SetStopTime(timer->StopTime());
+        Attached = muxRecording->IsAttached();
+        }
+     else {
+        recorder = new cRecorder(fileName, ch, timer->Priority());
+        recorder->SetStopTime(timer->StopTime());
+        Attached = device->AttachReceiver(recorder);
+        }
+     if (Attached) {
         cStatus::MsgRecording(device, Recording.Name(), Recording.FileName(), true);
         if (!Timer && !LastReplayed) // an instant recording, maybe from cRecordControls::PauseLiveVideo()
            cReplayControl::SetRecording(fileName);
@@ -5361,8 +5378,10 @@ cRecordControl::cRecordControl(cDevice *Device, cTimers *Timers, cTimer *Timer,
         Recordings->AddByName(fileName);
         return;
         }
-     else
+     else {
         DELETENULL(recorder);
+        DELETENULL(muxRecording);
+        }
      }
   else
      timer->SetDeferred(DEFERTIMER);
@@ -5409,6 +5428,7 @@ void cRecordControl::Stop(bool ExecuteUserCommand)
 {
   if (timer) {
      DELETENULL(recorder);
+     DELETENULL(muxRecording);
      timer->SetRecording(false);
      timer = NULL;
      SetRecordingTimerId(fileName, NULL);
@@ -5420,7 +5440,7 @@ void cRecordControl::Stop(bool ExecuteUserCommand)
 
 bool cRecordControl::Process(time_t t)
 {
-  if (!recorder || !recorder->IsAttached() || !timer || !timer->Matches(t)) {
+  if (!(recorder ? recorder->IsAttached() : muxRecording && muxRecording->IsAttached()) || !timer || !timer->Matches(t)) {
      if (timer) {
         timer->SetPending(false);
         if (timer->HasFlags(tfAvoid)) {
@@ -5430,6 +5450,10 @@ bool cRecordControl::Process(time_t t)
         }
      return false;
      }
+  if (recorder)
+     recorder->SetStopTime(timer->StopTime()); // the timer may have been modified
+  else
+     muxRecording->SetStopTime(timer->StopTime());
   return true;
 }
 
@@ -5536,6 +5560,11 @@ void cRecordControls::Stop(cTimer *Timer)
 bool cRecordControls::PauseLiveVideo(void)
 {
   Skins.Message(mtStatus, tr("Pausing live video..."));
+  if (Setup.TimeshiftSize) {
+     bool Result = cTimeshiftControl::PauseLiveVideo();
+     Skins.Message(mtStatus, NULL);
+     return Result;
+     }
   cReplayControl::SetRecording(NULL); // make sure the new cRecordControl will set cReplayControl::LastReplayed()
   if (Start(true)) {
      cReplayControl *rc = new cReplayControl(true);
@@ -240,6 +240,7 @@ private:
   cDevice *device;
   cTimer *timer;
   cRecorder *recorder;
+  cMuxRecording *muxRecording;
   const cEvent *event;
   cString instantId;
   char *fileName;
@@ -1139,12 +1139,355 @@ void cImage::Fill(tColor Color)
       data[i] = Color;
 }
 
+#define SCALESHIFT 14
+#define SCALEONE   (1 << SCALESHIFT)
+#define SCALEROUND (1 << (SCALESHIFT - 1))
+
+class cScaleWeights {
+private:
+  int taps;
+  int *first;
+  int *weights;
+public:
+  cScaleWeights(int SrcLength, int DstLength);
+  ~cScaleWeights();
+  int Taps(void) const { return taps; }
+  int First(int Index) const { return first[Index]; }
+       ///< Returns the first source pixel that contributes to the destination pixel
+       ///< with the given Index.
+  const int *Weights(int Index) const { return weights + Index * taps; }
+       ///< Returns the weights of the source pixels that contribute to the destination
+       ///< pixel with the given Index. The weights add up to SCALEONE.
+  };
+
+cScaleWeights::cScaleWeights(int SrcLength, int DstLength)
+{
+  double Scale = double(SrcLength) / DstLength;
+  taps = Scale > 1 ? int(ceil(Scale)) + 1 : 2;
+  first = MALLOC(int, DstLength);
+  weights = MALLOC(int, DstLength * taps);
+  memset(weights, 0, DstLength * taps * sizeof(int));
+  for (int d = 0; d < DstLength; d++) {
+      int *w = weights + d * taps;
+      if (Scale > 1) { // area average
+         double x0 = d * Scale;
+         double x1 = x0 + Scale;
+         int i0 = int(x0);
+         int Sum = 0;
+         for (int t = 0; t < taps && i0 + t < SrcLength; t++) {
+             double Overlap = min(x1, i0 + t + 1.0) - max(x0, double(i0 + t));
+             if (Overlap > 0) {
+                w[t] = int(Overlap / Scale * SCALEONE + 0.5);
+                Sum += w[t];
+                }
+             }
+         w[0] += SCALEONE - Sum;
+         first[d] = i0;
+         }
+      else { // linear interpolation
+         double c = (d + 0.5) * Scale - 0.5;
+         int i0 = int(floor(c));
+         double f = c - i0;
+         if (i0 < 0) {
+            i0 = 0;
+            f = 0;
+            }
+         else if (i0 >= SrcLength - 1) {
+            i0 = SrcLength - 1;
+            f = 0;
+            }
+         w[1] = int(f * SCALEONE + 0.5);
+         w[0] = SCALEONE - w[1];
+         first[d] = i0;
+         }
+      }
+}
+
+cScaleWeights::~cScaleWeights()
+{
+  free(first);
+  free(weights);
+}
+
+cImage *cImage::Scaled(const cSize &Size, uint8_t AlphaLayer) const
+{
+  int ws = Width();
+  int hs = Height();
+  int wd = Size.Width();
+  int hd = Size.Height();
+  cImage *Image = new cImage(Size);
+  if (ws <= 0 || hs <= 0 || wd <= 0 || hd <= 0) {
+     Image->Clear();
+     return Image;
+     }
+  cScaleWeights wx(ws, wd);
+  cScaleWeights wy(hs, hd);
+  // Scale horizontally, using premultiplied alpha (each color component is
+  // multiplied with the alpha value, so the results are in 0..255 * 255):
+  uint32_t *Tmp = MALLOC(uint32_t, wd * hs * 4);
+  uint32_t *t = Tmp;
+  for (int y = 0; y < hs; y++) {
+      const tColor *s = data + y * ws;
+      for (int x = 0; x < wd; x++) {
+          uint32_t a = 0, r = 0, g = 0, b = 0;
+          int f = wx.First(x);
+          const int *w = wx.Weights(x);
+          for (int i = 0; i < wx.Taps() && f + i < ws; i++) {
+              if (w[i]) {
+                 tColor c = s[f + i];
+                 uint32_t ca = (c >> 24) & 0xFF;
+                 a += ca * 255 * w[i];
+                 r += ((c >> 16) & 0xFF) * ca * w[i];
+                 g += ((c >>  8) & 0xFF) * ca * w[i];
+                 b += ( c        & 0xFF) * ca * w[i];
+                 }
+              }
+          *t++ = (a + SCALEROUND) >> SCALESHIFT;
+          *t++ = (r + SCALEROUND) >> SCALESHIFT;
+          *t++ = (g + SCALEROUND) >> SCALESHIFT;
+          *t++ = (b + SCALEROUND) >> SCALESHIFT;
+          }
+      }
+  // Scale vertically and convert back:
+  tColor *d = Image->data;
+  for (int y = 0; y < hd; y++) {
+      int f = wy.First(y);
+      const int *w = wy.Weights(y);
+      for (int x = 0; x < wd; x++) {
+          uint32_t a = 0, r = 0, g = 0, b = 0;
+          for (int i = 0; i < wy.Taps() && f + i < hs; i++) {
+              if (w[i]) {
+                 const uint32_t *p = Tmp + ((f + i) * wd + x) * 4;
+                 a += p[0] * w[i];
+                 r += p[1] * w[i];
+                 g += p[2] * w[i];
+                 b += p[3] * w[i];
+                 }
+              }
+          a = (a + SCALEROUND) >> SCALESHIFT;
+          r = (r + SCALEROUND) >> SCALESHIFT;
+          g = (g + SCALEROUND) >> SCALESHIFT;
+          b = (b + SCALEROUND) >> SCALESHIFT;
+          if (a) {
+             r = min(uint32_t(255), (r * 255 + a / 2) / a);
+             g = min(uint32_t(255), (g * 255 + a / 2) / a);
+             b = min(uint32_t(255), (b * 255 + a / 2) / a);
+             }
+          a = (a + 127) / 255;
+          if (AlphaLayer != ALPHA_OPAQUE)
+             a = (a * AlphaLayer + 127) / 255;
+          *d++ = (a << 24) | (r << 16) | (g << 8) | b;
+          }
+      }
+  free(Tmp);
+  return Image;
+}
+
+// --- cPixmapCommand --------------------------------------------------------
+
+class cPixmapCommand : public cListObject {
+public:
+  virtual void Execute(cPixmapMemory *Pixmap) = 0;
+  };
+
+class cPixmapClear : public cPixmapCommand {
+public:
+  virtual void Execute(cPixmapMemory *Pixmap) { Pixmap->Clear(); }
+  };
+
+class cPixmapFill : public cPixmapCommand {
+private:
+  tColor color;
+public:
+  cPixmapFill(tColor Color) { color = Color; }
+  virtual void Execute(cPixmapMemory *Pixmap) { Pixmap->Fill(color); }
+  };
+
+class cPixmapDrawText : public cPixmapCommand {
+private:
+  cPoint point;
+  cString s;
+  tColor colorFg, colorBg;
+  const cFont *font;
+  int width, height, alignment;
+public:
+  cPixmapDrawText(const cPoint &Point, const char *S, tColor ColorFg, tColor ColorBg, const cFont *Font, int Width, int Height, int Alignment)
+  :point(Point), s(S)
+  {
+    colorFg = ColorFg;
+    colorBg = ColorBg;
+    font = Font;
+    width = Width;
+    height = Height;
+    alignment = Alignment;
+  }
+  virtual void Execute(cPixmapMemory *Pixmap) { Pixmap->DrawText(point, s, colorFg, colorBg, font, width, height, alignment); }
+  };
+
+class cPixmapDrawRectangle : public cPixmapCommand {
+private:
+  cRect rect;
+  tColor color;
+public:
+  cPixmapDrawRectangle(const cRect &Rect, tColor Color): rect(Rect) { color = Color; }
+  virtual void Execute(cPixmapMemory *Pixmap) { Pixmap->DrawRectangle(rect, color); }
+  };
+
+class cPixmapDrawEllipse : public cPixmapCommand {
+private:
+  cRect rect;
+  tColor color;
+  int quadrants;
+public:
+  cPixmapDrawEllipse(const cRect &Rect, tColor Color, int Quadrants): rect(Rect) { color = Color; quadrants = Quadrants; }
+  virtual void Execute(cPixmapMemory *Pixmap) { Pixmap->DrawEllipse(rect, color, quadrants); }
+  };
+
+class cPixmapDrawSlope : public cPixmapCommand {
+private:
+  cRect rect;
+  tColor color;
+  int type;
+public:
+  cPixmapDrawSlope(const cRect &Rect, tColor Color, int Type): rect(Rect) { color = Color; type = Type; }
+  virtual void Execute(cPixmapMemory *Pixmap) { Pixmap->DrawSlope(rect, color, type); }
+  };
+
+// --- cPixmapWorkers --------------------------------------------------------
+
+#define PIXMAPWORKERIDLETIMEOUT 10000 // ms after which an idle worker thread ends (it is restarted when needed)
+
+class cPixmapWorker;
+
+class cPixmapWorkers {
+  friend class cPixmapWorker;
+private:
+  cMutex mutex;
+  cCondVar newJobs;
+  cCondVar jobsDone;
+  cVector<cPixmapMemory *> *jobs;
+  int nextJob;
+  int busy;
+  cVector<cPixmapWorker *> workers;
+  bool Work(void);
+       ///< Executes the next job, if any. Must be called with mutex locked.
+public:
+  cPixmapWorkers(void);
+  ~cPixmapWorkers();
+  void SetNumWorkers(int NumWorkers);
+  void Execute(cVector<cPixmapMemory *> &Jobs);
+       ///< Executes the deferred drawing operations of the given pixmaps, using
+       ///< the worker threads as well as the calling thread. Returns when all
+       ///< pixmaps are done. The caller must hold the cPixmap mutex.
+  };
+
+class cPixmapWorker : public cThread {
+private:
+  cPixmapWorkers *workers;
+protected:
+  virtual void Action(void);
+public:
+  cPixmapWorker(cPixmapWorkers *Workers);
+  virtual ~cPixmapWorker();
+  };
+
+cPixmapWorker::cPixmapWorker(cPixmapWorkers *Workers)
+:cThread("pixmap worker")
+{
+  workers = Workers;
+}
+
+cPixmapWorker::~cPixmapWorker()
+{
+  Cancel(-1);
+  {
+    cMutexLock MutexLock(&workers->mutex);
+    workers->newJobs.Broadcast();
+  }
+  Cancel(3);
+}
+
+void cPixmapWorker::Action(void)
+{
+  cMutexLock MutexLock(&workers->mutex);
+  while (Running()) {
+        if (workers->Work())
+           continue;
+        if (!workers->newJobs.TimedWait(workers->mutex, PIXMAPWORKERIDLETIMEOUT) && !workers->Work()) {
+           // This worker has been idle for too long. It ends while holding the
+           // mutex, so that Execute() will start it again when it is needed:
+           Cancel(-1);
+           break;
+           }
+        }
+}
+
+static cPixmapWorkers PixmapWorkers;
+
+cPixmapWorkers::cPixmapWorkers(void)
+{
+  jobs = NULL;
+  nextJob = 0;
+  busy = 0;
+}
+
+cPixmapWorkers::~cPixmapWorkers()
+{
+  SetNumWorkers(0);
+}
+
+void cPixmapWorkers::SetNumWorkers(int NumWorkers)
+{
+  while (workers.Size() < NumWorkers)
+        workers.Append(new cPixmapWorker(this));
+  while (workers.Size() > NumWorkers) {
+        delete workers[workers.Size() - 1];
+        workers.Remove(workers.Size() - 1);
+        }
+}
+
+bool cPixmapWorkers::Work(void)
+{
+  if (jobs && nextJob < jobs->Size()) {
+     cPixmapMemory *Pixmap = jobs->At(nextJob++);
+     busy++;
+     mutex.Unlock();
+     Pixmap->ExecuteCommands();
+     mutex.Lock();
+     if (!--busy && nextJob >= jobs->Size())
+        jobsDone.Broadcast();
+     return true;
+     }
+  return false;
+}
+
+void cPixmapWorkers::Execute(cVector<cPixmapMemory *> &Jobs)
+{
+  if (Jobs.Size() > 1)
+     SetNumWorkers(Setup.OSDRenderThreads);
+  cMutexLock MutexLock(&mutex);
+  jobs = &Jobs;
+  nextJob = 0;
+  if (workers.Size() && Jobs.Size() > 1) {
+     for (int i = 0; i < workers.Size(); i++)
+         workers[i]->Start(); // does nothing if the worker is already running
+     newJobs.Broadcast();
+     }
+  while (Work())
+        ;
+  while (busy)
+        jobsDone.Wait(mutex);
+  jobs = NULL;
+}
+
 // --- cPixmapMemory ---------------------------------------------------------
 
 cPixmapMemory::cPixmapMemory(void)
 {
   data = NULL;
   panning = false;
+  deferred = false;
+  executing = false;
 }
 
 cPixmapMemory::cPixmapMemory(int Layer, const cRect &ViewPort, const cRect &DrawPort)
@@ -1152,6 +1495,8 @@ cPixmapMemory::cPixmapMemory(int Layer, const cRect &ViewPort, const cRect &Draw
 {
   data = MALLOC(tColor, this->DrawPort().Width() * this->DrawPort().Height());
   panning = false;
+  deferred = false;
+  executing = false;
 }
 
 cPixmapMemory::~cPixmapMemory()
@@ -1159,21 +1504,105 @@ cPixmapMemory::~cPixmapMemory()
   free(data);
 }
 
-void cPixmapMemory::Clear(void)
+void cPixmapMemory::SetDeferred(bool On)
+{
+  Lock();
+  if (!On)
+     Execute();
+  deferred = On;
+  Unlock();
+}
+
+void cPixmapMemory::Defer(cPixmapCommand *Command)
+{
+  Lock();
+  commands.Add(Command);
+  Unlock();
+}
+
+void cPixmapMemory::ExecuteCommands(void)
+{
+  executor = pthread_self();
+  executing = true;
+  while (cPixmapCommand *Command = commands.First()) {
+        Command->Execute(this);
+        commands.Del(Command);
+        }
+  executing = false;
+}
+
+void cPixmapMemory::Execute(void)
+{
+  if (HasCommands() && !Executing()) {
+     Lock();
+     ExecuteCommands();
+     Unlock();
+     }
+}
+
+void cPixmapMemory::SetLayer(int Layer)
+{
+  Lock();
+  Execute();
+  cPixmap::SetLayer(Layer);
+  Unlock();
+}
+
+void cPixmapMemory::SetAlpha(int Alpha)
+{
+  Lock();
+  Execute();
+  cPixmap::SetAlpha(Alpha);
+  Unlock();
+}
+
+void cPixmapMemory::SetTile(bool Tile)
 {
   Lock();
+  Execute();
+  cPixmap::SetTile(Tile);
+  Unlock();
+}
+
+void cPixmapMemory::SetViewPort(const cRect &Rect)
+{
+  Lock();
+  Execute();
+  cPixmap::SetViewPort(Rect);
+  Unlock();
+}
+
+void cPixmapMemory::SetDrawPortPoint(const cPoint &Point, bool Dirty)
+{
+  Lock();
+  Execute();
+  cPixmap::SetDrawPortPoint(Point, Dirty);
+  Unlock();
+}
+
+void cPixmapMemory::Clear(void)
+{
+  if (Deferring()) {
+     Defer(new cPixmapClear);
+     return;
+     }
+  LockDrawing();
   memset(data, 0x00, DrawPort().Width() * DrawPort().Height() * sizeof(tColor));
   MarkDrawPortDirty(DrawPort());
-  Unlock();
+  UnlockDrawing();
 }
 
 void cPixmapMemory::Fill(tColor Color)
 {
-  Lock();
+  if (Deferring()) {
+     Defer(new cPixmapFill(Color));
+     return;
+     }
+  LockDrawing();
   for (int i = DrawPort().Width() * DrawPort().Height() - 1; i >= 0; i--)
       data[i] = Color;
   MarkDrawPortDirty(DrawPort());
-  Unlock();
+  UnlockDrawing();
 }
 
 void cPixmap::DrawPixmap(const cPixmap *Pixmap, const cRect &Dirty)
@@ -1229,7 +1658,8 @@ void cPixmap::DrawPixmap(const cPixmap *Pixmap, const cRect &Dirty)
 
 void cPixmapMemory::DrawImage(const cPoint &Point, const cImage &Image)
 {
-  Lock();
+  LockDrawing();
+  Execute();
   cRect r = cRect(Point, Image.Size()).Intersected(DrawPort().Size());
   if (!r.IsEmpty()) {
      int ws = Image.Size().Width();
@@ -1248,20 +1678,22 @@ void cPixmapMemory::DrawImage(const cPoint &Point, const cImage &Image)
          }
      MarkDrawPortDirty(r);
      }
-  Unlock();
+  UnlockDrawing();
 }
 
 void cPixmapMemory::DrawImage(const cPoint &Point, int ImageHandle)
 {
-  Lock();
+  LockDrawing();
+  Execute();
   if (const cImage *Image = cOsdProvider::GetImageData(ImageHandle))
      DrawImage(Point, *Image);
-  Unlock();
+  UnlockDrawing();
 }
 
 void cPixmapMemory::DrawPixel(const cPoint &Point, tColor Color)
 {
-  Lock();
+  LockDrawing();
+  Execute();
   if (DrawPort().Size().Contains(Point)) {
      int p = Point.Y() * DrawPort().Width() + Point.X();
      if (Layer() == 0 && !IS_OPAQUE(Color))
@@ -1270,12 +1702,13 @@ void cPixmapMemory::DrawPixel(const cPoint &Point, tColor Color)
         data[p] = Color;
      MarkDrawPortDirty(Point);
      }
-  Unlock();
+  UnlockDrawing();
 }
 
 void cPixmapMemory::DrawBlendedPixel(const cPoint &Point, tColor Color, uint8_t Alpha)
 {
-  Lock();
+  LockDrawing();
+  Execute();
   if (DrawPort().Size().Contains(Point)) {
      int p = Point.Y() * DrawPort().Width() + Point.X();
      if (Alpha != ALPHA_OPAQUE) {
@@ -1288,12 +1721,13 @@ void cPixmapMemory::DrawBlendedPixel(const cPoint &Point, tColor Color, uint8_t
         data[p] = Color;
      MarkDrawPortDirty(Point);
      }
-  Unlock();
+  UnlockDrawing();
 }
 
 void cPixmapMemory::DrawBitmap(const cPoint &Point, const cBitmap &Bitmap, tColor ColorFg, tColor ColorBg, bool Overlay)
 {
-  Lock();
+  LockDrawing();
+  Execute();
   cRect r = cRect(Point, cSize(Bitmap.Width(), Bitmap.Height())).Intersected(DrawPort().Size());
   if (!r.IsEmpty()) {
      bool UseColors = ColorFg || ColorBg;
@@ -1315,12 +1749,16 @@ void cPixmapMemory::DrawBitmap(const cPoint &Point, const cBitmap &Bitmap, tColo
          }
      MarkDrawPortDirty(r);
      }
-  Unlock();
+  UnlockDrawing();
 }
 
 void cPixmapMemory::DrawText(const cPoint &Point, const char *s, tColor ColorFg, tColor ColorBg, const cFont *Font, int Width, int Height, int Alignment)
 {
-  Lock();
+  if (Deferring()) {
+     Defer(new cPixmapDrawText(Point, s, ColorFg, ColorBg, Font, Width, Height, Alignment));
+     return;
+     }
+  LockDrawing();
   int x = Point.X();
   int y = Point.Y();
   int w = Font->Width(s);
@@ -1364,12 +1802,16 @@ void cPixmapMemory::DrawText(const cPoint &Point, const char *s, tColor ColorFg,
      }
   Font->DrawText(this, x, y, s, ColorFg, ColorBg, limit);
   MarkDrawPortDirty(r);
-  Unlock();
+  UnlockDrawing();
 }
 
 void cPixmapMemory::DrawRectangle(const cRect &Rect, tColor Color)
 {
-  Lock();
+  if (Deferring()) {
+     Defer(new cPixmapDrawRectangle(Rect, Color));
+     return;
+     }
+  LockDrawing();
   cRect r = Rect.Intersected(DrawPort().Size());
   if (!r.IsEmpty()) {
      int wd = DrawPort().Width();
@@ -1391,12 +1833,16 @@ void cPixmapMemory::DrawRectangle(const cRect &Rect, tColor Color)
          }
      MarkDrawPortDirty(r);
      }
-  Unlock();
+  UnlockDrawing();
 }
 
 void cPixmapMemory::DrawEllipse(const cRect &Rect, tColor Color, int Quadrants)
 {
-  Lock();
+  if (Deferring()) {
+     Defer(new cPixmapDrawEllipse(Rect, Color, Quadrants));
+     return;
+     }
+  LockDrawing();
   // Algorithm based on https://dai.fmph.uniba.sk/upload/0/01/Ellipse.pdf
   int x1 = Rect.Left();
   int y1 = Rect.Top();
@@ -1615,13 +2061,17 @@ void cPixmapMemory::DrawEllipse(const cRect &Rect, tColor Color, int Quadrants)
         }
      }
   MarkDrawPortDirty(Rect);
-  Unlock();
+  UnlockDrawing();
 }
 
 void cPixmapMemory::DrawSlope(const cRect &Rect, tColor Color, int Type)
 {
+  if (Deferring()) {
+     Defer(new cPixmapDrawSlope(Rect, Color, Type));
+     return;
+     }
   //TODO also simplify cBitmap::DrawSlope()
-  Lock();
+  LockDrawing();
   bool upper    = Type & 0x01;
   bool falling  = Type & 0x02;
   bool vertical = Type & 0x04;
@@ -1715,14 +2165,16 @@ void cPixmapMemory::DrawSlope(const cRect &Rect, tColor Color, int Type)
          }
      }
   MarkDrawPortDirty(Rect);
-  Unlock();
+  UnlockDrawing();
 }
 
 void cPixmapMemory::Render(const cPixmap *Pixmap, const cRect &Source, const cPoint &Dest)
 {
-  Lock();
+  LockDrawing();
+  Execute();
   if (Pixmap->Alpha() != ALPHA_TRANSPARENT) {
      if (const cPixmapMemory *pm = dynamic_cast<const cPixmapMemory *>(Pixmap)) {
+        const_cast<cPixmapMemory *>(pm)->Execute();
         cRect s = Source.Intersected(Pixmap->DrawPort().Size());
         if (!s.IsEmpty()) {
            cPoint v = Dest - Source.Point();
@@ -1750,13 +2202,15 @@ void cPixmapMemory::Render(const cPixmap *Pixmap, const cRect &Source, const cPo
            }
         }
      }
-  Unlock();
+  UnlockDrawing();
 }
 
 void cPixmapMemory::Copy(const cPixmap *Pixmap, const cRect &Source, const cPoint &Dest)
 {
-  Lock();
+  LockDrawing();
+  Execute();
   if (const cPixmapMemory *pm = dynamic_cast<const cPixmapMemory *>(Pixmap)) {
+     const_cast<cPixmapMemory *>(pm)->Execute();
      cRect s = Source.Intersected(pm->DrawPort().Size());
      if (!s.IsEmpty()) {
         cPoint v = Dest - Source.Point();
@@ -1777,12 +2231,13 @@ void cPixmapMemory::Copy(const cPixmap *Pixmap, const cRect &Source, const cPoin
            }
         }
      }
-  Unlock();
+  UnlockDrawing();
 }
 
 void cPixmapMemory::Scroll(const cPoint &Dest, const cRect &Source)
 {
-  Lock();
+  LockDrawing();
+  Execute();
   cRect s;
   if (&Source == &cRect::Null)
      s = DrawPort().Shifted(-DrawPort().Point());
@@ -1811,16 +2266,148 @@ void cPixmapMemory::Scroll(const cPoint &Dest, const cRect &Source)
            }
         }
      }
-  Unlock();
+  UnlockDrawing();
 }
 
 void cPixmapMemory::Pan(const cPoint &Dest, const cRect &Source)
 {
-  Lock();
+  LockDrawing();
+  Execute();
   panning = true;
   Scroll(Dest, Source);
   panning = false;
-  Unlock();
+  UnlockDrawing();
+}
+
+bool cPixmapMemory::IsOpaque(const cRect &Rect) const
+{
+  if (Rect.IsEmpty() || !cRect(DrawPort().Size()).Contains(Rect))
+     return false;
+  int w = DrawPort().Width();
+  const tColor *p = data + w * Rect.Top() + Rect.Left();
+  for (int y = Rect.Height(); y-- > 0; ) {
+      for (int x = 0; x < Rect.Width(); x++) {
+          if (!IS_OPAQUE(p[x]))
+             return false;
+          }
+      p += w;
+      }
+  return true;
+}
+
+// --- cOsdDirtyMap ---------------------------------------------------------
+
+class cOsdDirtyMap {
+private:
+  cRect area;
+  int columns;
+  int rows;
+  cRect *tiles; // the dirty part of each tile, in absolute OSD coordinates
+  int *keys; // tiles with different keys are never combined
+  cRect *rects; // the combined rectangles (there can't be more of them than tiles)
+  int numRects;
+  int nextRect;
+public:
+  cOsdDirtyMap(const cRect &Area);
+  ~cOsdDirtyMap();
+  void Mark(const cRect &Rect);
+       ///< Marks the given Rect (in absolute OSD coordinates) as dirty.
+  int Tiles(void) const { return columns * rows; }
+  const cRect &Tile(int Index) const { return tiles[Index]; }
+       ///< Returns the dirty part of the tile with the given Index (which is empty
+       ///< if this tile is clean).
+  void SetKey(int Index, int Key) { keys[Index] = Key; }
+  void Combine(void);
+       ///< Combines adjacent dirty tiles with the same key into rectangles and
+       ///< marks all tiles as clean.
+  bool GetRect(cRect &Rect);
+       ///< Returns the next rectangle that has been created by Combine() in Rect.
+       ///< Returns false if there are no (more) rectangles.
+  };
+
+cOsdDirtyMap::cOsdDirtyMap(const cRect &Area)
+{
+  area = Area;
+  columns = (area.Width() + OSDTILESIZE - 1) / OSDTILESIZE;
+  rows = (area.Height() + OSDTILESIZE - 1) / OSDTILESIZE;
+  tiles = new cRect[Tiles()];
+  keys = MALLOC(int, Tiles());
+  rects = new cRect[Tiles()];
+  numRects = nextRect = 0;
+}
+
+cOsdDirtyMap::~cOsdDirtyMap()
+{
+  delete[] tiles;
+  free(keys);
+  delete[] rects;
+}
+
+void cOsdDirtyMap::Mark(const cRect &Rect)
+{
+  cRect r = Rect.Intersected(area);
+  if (r.IsEmpty())
+     return;
+  int c1 = (r.Left() - area.Left()) / OSDTILESIZE;
+  int c2 = (r.Right() - area.Left()) / OSDTILESIZE;
+  int r1 = (r.Top() - area.Top()) / OSDTILESIZE;
+  int r2 = (r.Bottom() - area.Top()) / OSDTILESIZE;
+  for (int y = r1; y <= r2; y++) {
+      for (int x = c1; x <= c2; x++) {
+          cRect t(area.Left() + x * OSDTILESIZE, area.Top() + y * OSDTILESIZE, OSDTILESIZE, OSDTILESIZE);
+          tiles[y * columns + x].Combine(r.Intersected(t));
+          }
+      }
+}
+
+void cOsdDirtyMap::Combine(void)
+{
+  numRects = nextRect = 0;
+  for (int y = 0; y < rows; y++) {
+      for (int x = 0; x < columns; x++) {
+          int i = y * columns + x;
+          if (tiles[i].IsEmpty())
+             continue;
+          int Key = keys[i];
+          // Extend to the right as far as possible:
+          int x2 = x;
+          while (x2 + 1 < columns && !tiles[i + x2 + 1 - x].IsEmpty() && keys[i + x2 + 1 - x] == Key)
+                x2++;
+          // Extend downwards as long as the entire row span is dirty:
+          int y2 = y;
+          while (y2 + 1 < rows) {
+                int j = (y2 + 1) * columns;
+                bool Ok = true;
+                for (int k = x; k <= x2; k++) {
+                    if (tiles[j + k].IsEmpty() || keys[j + k] != Key) {
+                       Ok = false;
+                       break;
+                       }
+                    }
+                if (!Ok)
+                   break;
+                y2++;
+                }
+          cRect r;
+          for (int v = y; v <= y2; v++) {
+              for (int h = x; h <= x2; h++) {
+                  r.Combine(tiles[v * columns + h]);
+                  tiles[v * columns + h] = cRect::Null;
+                  }
+              }
+          rects[numRects++] = r;
+          x = x2;
+          }
+      }
+}
+
+bool cOsdDirtyMap::GetRect(cRect &Rect)
+{
+  if (nextRect < numRects) {
+     Rect = rects[nextRect++];
+     return true;
+     }
+  return false;
 }
 
 // --- cOsd ------------------------------------------------------------------
@@ -1852,6 +2439,7 @@ cOsd::cOsd(int Left, int Top, uint Level)
   savedBitmap = NULL;
   numBitmaps = 0;
   savedPixmap = NULL;
+  dirtyMap = NULL;
   left = Left;
   top = Top;
   width = height = 0;
@@ -1873,6 +2461,7 @@ cOsd::~cOsd()
       delete bitmaps[i];
   delete savedBitmap;
   delete savedPixmap;
+  delete dirtyMap;
   for (int i = 0; i < pixmaps.Size(); i++)
       delete pixmaps[i];
   for (int i = 0; i < Osds.Size(); i++) {
@@ -1915,7 +2504,8 @@ cPixmap *cOsd::CreatePixmap(int Layer, const cRect &ViewPort, const cRect &DrawP
 {
   if (isTrueColor) {
      LOCK_PIXMAPS;
-     cPixmap *Pixmap = new cPixmapMemory(Layer, ViewPort, DrawPort);
+     cPixmapMemory *Pixmap = new cPixmapMemory(Layer, ViewPort, DrawPort);
+     Pixmap->SetDeferred(Setup.OSDRenderThreads > 0);
      if (AddPixmap(Pixmap))
         return Pixmap;
      delete Pixmap;
@@ -1953,23 +2543,75 @@ cPixmap *cOsd::AddPixmap(cPixmap *Pixmap)
   return Pixmap;
 }
 
+void cOsd::ExecuteDeferred(void)
+{
+  cVector<cPixmapMemory *> Jobs;
+  for (int i = 0; i < pixmaps.Size(); i++) {
+      if (cPixmapMemory *pm = dynamic_cast<cPixmapMemory *>(pixmaps[i])) {
+         if (pm->HasCommands())
+            Jobs.Append(pm);
+         }
+      }
+  if (Jobs.Size())
+     PixmapWorkers.Execute(Jobs);
+}
+
+void cOsd::ExecuteAllDeferred(void)
+{
+  cMutexLock MutexLock(&mutex);
+  LOCK_PIXMAPS;
+  for (int i = 0; i < Osds.Size(); i++)
+      Osds[i]->ExecuteDeferred();
+}
+
+int cOsd::Occluder(const cRect &Rect)
+{
+  for (int Layer = MAXPIXMAPLAYERS - 1; Layer >= 0; Layer--) {
+      for (int i = pixmaps.Size() - 1; i >= 0; i--) {
+          if (cPixmap *pm = pixmaps[i]) {
+             if (pm->Layer() == Layer && pm->Alpha() == ALPHA_OPAQUE && pm->ViewPort().Contains(Rect)) {
+                if (pm->Tile() && (pm->DrawPort().Point() != cPoint(0, 0) || pm->DrawPort().Size() < pm->ViewPort().Size()))
+                   continue; // tiled pixmaps are never used as occluders
+                if (const cPixmapMemory *pmm = dynamic_cast<const cPixmapMemory *>(pm)) {
+                   if (pmm->IsOpaque(Rect.Shifted(-pm->ViewPort().Point()).Shifted(-pm->DrawPort().Point())))
+                      return i;
+                   }
+                }
+             }
+          }
+      }
+  return -1;
+}
+
 cPixmap *cOsd::RenderPixmaps(void)
 {
   cPixmap *Pixmap = NULL;
-  if (isTrueColor) {
+  if (isTrueColor && dirtyMap) {
      LOCK_PIXMAPS;
-     // Collect overlapping dirty rectangles:
+     ExecuteDeferred();
      cRect d;
-     for (int i = 0; i < pixmaps.Size(); i++) {
-         if (cPixmap *pm = pixmaps[i]) {
-            if (!pm->DirtyViewPort().IsEmpty()) {
-               if (d.IsEmpty() || d.Intersects(pm->DirtyViewPort())) {
-                  d.Combine(pm->DirtyViewPort());
+     if (!dirtyMap->GetRect(d)) {
+        // Collect the dirty areas of all pixmaps:
+        bool Dirty = false;
+        for (int i = 0; i < pixmaps.Size(); i++) {
+            if (cPixmap *pm = pixmaps[i]) {
+               if (!pm->DirtyViewPort().IsEmpty()) {
+                  dirtyMap->Mark(pm->DirtyViewPort());
                   pm->SetClean();
+                  Dirty = true;
                   }
                }
             }
-         }
+        if (Dirty) {
+           // Only tiles that are covered by the same opaque pixmap are combined:
+           for (int i = 0; i < dirtyMap->Tiles(); i++) {
+               if (!dirtyMap->Tile(i).IsEmpty())
+                  dirtyMap->SetKey(i, Occluder(dirtyMap->Tile(i)));
+               }
+           dirtyMap->Combine();
+           dirtyMap->GetRect(d);
+           }
+        }
      if (!d.IsEmpty()) {
 //#define DebugDirty
 #ifdef DebugDirty
@@ -1981,12 +2623,21 @@ cPixmap *cOsd::RenderPixmaps(void)
         Pixmap = CreatePixmap(-1, d);
         if (Pixmap) {
            Pixmap->Clear();
-           // Render the individual pixmaps into the resulting pixmap:
+           // Render the individual pixmaps into the resulting pixmap, skipping
+           // the ones that are completely covered by an opaque pixmap:
+           int Occluding = Occluder(d);
+           bool Visible = Occluding < 0;
            for (int Layer = 0; Layer < MAXPIXMAPLAYERS; Layer++) {
                for (int i = 0; i < pixmaps.Size(); i++) {
                    if (cPixmap *pm = pixmaps[i]) {
-                      if (pm->Layer() == Layer)
-                         Pixmap->DrawPixmap(pm, d);
+                      if (pm->Layer() == Layer) {
+                         if (i == Occluding) {
+                            Pixmap->Copy(pm, d.Shifted(-pm->ViewPort().Point()).Shifted(-pm->DrawPort().Point()), cPoint(0, 0));
+                            Visible = true;
+                            }
+                         else if (Visible)
+                            Pixmap->DrawPixmap(pm, d);
+                         }
                       }
                    }
                }
@@ -2037,10 +2688,12 @@ eOsdError cOsd::SetAreas(const tArea *Areas, int NumAreas)
          pixmaps[i] = NULL;
          }
      width = height = 0;
+     DELETENULL(dirtyMap);
      isTrueColor = NumAreas == 1 && Areas[0].bpp == 32;
      if (isTrueColor) {
         width = Areas[0].x2 - Areas[0].x1 + 1;
         height = Areas[0].y2 - Areas[0].y1 + 1;
+        dirtyMap = new cOsdDirtyMap(cRect(Areas[0].x1, Areas[0].y1, width, height));
         cPixmap *Pixmap = CreatePixmap(0, cRect(Areas[0].x1, Areas[0].y1, width, height));
         if (Pixmap)
            Pixmap->Clear();
@@ -2192,6 +2845,238 @@ void cOsd::Flush(void)
 {
 }
 
+// --- cOsdImageCache --------------------------------------------------------
+
+class cOsdImageCacheEntry : public cListObject {
+public:
+  int source; // 0 if the source image has been dropped while scaling
+  cSize size;
+  uint8_t alpha;
+  cImage *image; // the scaled image, as long as it hasn't been stored
+  int handle; // the handle of the stored scaled image
+  bool scaling; // the image is currently being scaled in the background
+  cOsdImageCacheEntry(int Source, const cSize &Size, uint8_t Alpha);
+  virtual ~cOsdImageCacheEntry();
+  bool Matches(int Source, const cSize &Size, uint8_t Alpha) const { return source == Source && size == Size && alpha == Alpha; }
+  int Bytes(void) const { return (image || handle) ? size.Width() * size.Height() * sizeof(tColor) : 0; }
+  };
+
+cOsdImageCacheEntry::cOsdImageCacheEntry(int Source, const cSize &Size, uint8_t Alpha)
+{
+  source = Source;
+  size = Size;
+  alpha = Alpha;
+  image = NULL;
+  handle = 0;
+  scaling = false;
+}
+
+cOsdImageCacheEntry::~cOsdImageCacheEntry()
+{
+  delete image;
+}
+
+class cOsdImageCache : public cThread {
+private:
+  cMutex mutex;
+  cCondVar newRequest;
+  cList<cOsdImageCacheEntry> entries; // the least recently used entry comes first
+  int64_t bytes; // the memory used by all scaled images
+  void Drop(cOsdImageCacheEntry *Entry);
+  enum { dropStored = 1, dropUnstored = 2, dropAny = dropStored | dropUnstored };
+  bool DropLeastRecentlyUsed(const cOsdImageCacheEntry *Keep, int What);
+       ///< Drops the least recently used entry other than Keep that is of the
+       ///< given kind. Stored entries must only be dropped by the thread that
+       ///< calls ScaledImage(), since their handles may still be in use.
+protected:
+  virtual void Action(void);
+public:
+  cOsdImageCache(void);
+  virtual ~cOsdImageCache();
+  int ScaledImage(int Source, const cSize &Size, uint8_t AlphaLayer, bool Wait);
+  bool MakeRoom(void);
+       ///< Drops the least recently used scaled image that has been stored by the
+       ///< OSD provider, to make room for a new image. Returns false if there was
+       ///< no such image.
+  void DropSource(int Source);
+       ///< Drops all scaled versions of the image with the given Source handle.
+  void Clear(void);
+  };
+
+static cOsdImageCache OsdImageCache;
+
+cOsdImageCache::cOsdImageCache(void)
+:cThread("osd image cache", true)
+{
+  bytes = 0;
+}
+
+cOsdImageCache::~cOsdImageCache()
+{
+  Cancel(3);
+}
+
+void cOsdImageCache::Drop(cOsdImageCacheEntry *Entry)
+{
+  if (Entry->scaling) {
+     Entry->source = 0; // the background thread will delete it
+     return;
+     }
+  bytes -= Entry->Bytes();
+  if (Entry->handle && cOsdProvider::osdProvider)
+     cOsdProvider::osdProvider->DropImageData(Entry->handle);
+  entries.Del(Entry);
+}
+
+bool cOsdImageCache::DropLeastRecentlyUsed(const cOsdImageCacheEntry *Keep, int What)
+{
+  for (cOsdImageCacheEntry *e = entries.First(); e; e = entries.Next(e)) {
+      if (e != Keep && !e->scaling && (e->handle && (What & dropStored) || e->image && (What & dropUnstored))) {
+         Drop(e);
+         return true;
+         }
+      }
+  return false;
+}
+
+int cOsdImageCache::ScaledImage(int Source, const cSize &Size, uint8_t AlphaLayer, bool Wait)
+{
+  LOCK_PIXMAPS; // must be locked before the cache, because the background thread and StoreImageData() need it
+  cMutexLock MutexLock(&mutex);
+  cOsdImageCacheEntry *Entry = NULL;
+  for (cOsdImageCacheEntry *e = entries.First(); e; e = entries.Next(e)) {
+      if (e->Matches(Source, Size, AlphaLayer)) {
+         Entry = e;
+         break;
+         }
+      }
+  if (Entry) {
+     if (Entry->handle) {
+        if (Entry != entries.Last()) {
+           entries.Del(Entry, false);
+           entries.Add(Entry);
+           }
+        return Entry->handle;
+        }
+     }
+  else if (Size.Width() > 0 && Size.Height() > 0 && cOsdProvider::GetImageData(Source)) {
+     Entry = new cOsdImageCacheEntry(Source, Size, AlphaLayer);
+     entries.Add(Entry);
+     }
+  else
+     return 0;
+  if (!Entry->image) {
+     if (!Wait) {
+        if (!Active())
+           Start();
+        newRequest.Broadcast();
+        return 0;
+        }
+     // The background thread may be working on this one, too, but waiting for it
+     // could deadlock, since we're holding the pixmap mutex:
+     Entry->image = cOsdProvider::GetImageData(Source)->Scaled(Size, AlphaLayer);
+     bytes += Entry->Bytes();
+     }
+  while (bytes > OSDIMAGECACHESIZE && DropLeastRecentlyUsed(Entry, dropAny))
+        ;
+  int Handle;
+  while (!(Handle = cOsdProvider::osdProvider->StoreImageData(*Entry->image)) && DropLeastRecentlyUsed(Entry, dropStored))
+        ;
+  if (Handle) {
+     DELETENULL(Entry->image);
+     Entry->handle = Handle;
+     }
+  return Handle;
+}
+
+bool cOsdImageCache::MakeRoom(void)
+{
+  LOCK_PIXMAPS;
+  cMutexLock MutexLock(&mutex);
+  return DropLeastRecentlyUsed(NULL, dropStored);
+}
+
+void cOsdImageCache::DropSource(int Source)
+{
+  LOCK_PIXMAPS;
+  cMutexLock MutexLock(&mutex);
+  cOsdImageCacheEntry *e = entries.First();
+  while (e) {
+        cOsdImageCacheEntry *Next = entries.Next(e);
+        if (e->source == Source)
+           Drop(e);
+        e = Next;
+        }
+}
+
+void cOsdImageCache::Clear(void)
+{
+  LOCK_PIXMAPS;
+  cMutexLock MutexLock(&mutex);
+  cOsdImageCacheEntry *e = entries.First();
+  while (e) {
+        cOsdImageCacheEntry *Next = entries.Next(e);
+        Drop(e);
+        e = Next;
+        }
+}
+
+void cOsdImageCache::Action(void)
+{
+  while (Running()) {
+        cOsdImageCacheEntry *Entry = NULL;
+        mutex.Lock();
+        for (cOsdImageCacheEntry *e = entries.First(); e; e = entries.Next(e)) {
+            if (!e->image && !e->handle && !e->scaling) {
+               Entry = e;
+               Entry->scaling = true;
+               break;
+               }
+            }
+        if (!Entry)
+           newRequest.TimedWait(mutex, 1000);
+        mutex.Unlock();
+        if (Entry) {
+           // The entry can't be deleted while 'scaling' is set, and its key doesn't change
+           // (except for 'source', which is only set to 0 under the lock):
+           cImage *Source = NULL;
+           cImage *Scaled = NULL;
+           {
+             LOCK_PIXMAPS;
+             mutex.Lock();
+             if (Entry->source) {
+                if (const cImage *Image = cOsdProvider::GetImageData(Entry->source))
+                   Source = new cImage(*Image);
+                }
+             mutex.Unlock();
+           }
+           if (Source)
+              Scaled = Source->Scaled(Entry->size, Entry->alpha);
+           delete Source;
+           LOCK_PIXMAPS;
+           cMutexLock MutexLock(&mutex);
+           Entry->scaling = false;
+           if (!Entry->source) { // the source image has been dropped in the meantime
+              delete Scaled;
+              Drop(Entry);
+              }
+           else if (!Scaled || Entry->image || Entry->handle) {
+              delete Scaled;
+              if (!Entry->image && !Entry->handle)
+                 entries.Del(Entry);
+              }
+           else {
+              Entry->image = Scaled;
+              bytes += Entry->Bytes();
+              // The handle returned by the latest call to ScaledImage() must remain valid,
+              // so only images that haven't been stored yet are dropped here:
+              while (bytes > OSDIMAGECACHESIZE && DropLeastRecentlyUsed(Entry, dropUnstored))
+                    ;
+              }
+           }
+        }
+}
+
 // --- cOsdProvider ----------------------------------------------------------
 
 cOsdProvider *cOsdProvider::osdProvider = NULL;
@@ -2308,19 +3193,33 @@ const cImage *cOsdProvider::GetImageData(int ImageHandle)
 
 int cOsdProvider::StoreImage(const cImage &Image)
 {
-  if (osdProvider)
-     return osdProvider->StoreImageData(Image);
+  if (osdProvider) {
+     int Handle;
+     while (!(Handle = osdProvider->StoreImageData(Image)) && OsdImageCache.MakeRoom()) // scaled images are less important
+           ;
+     return Handle;
+     }
   return 0;
 }
 
 void cOsdProvider::DropImage(int ImageHandle)
 {
-  if (osdProvider)
+  if (osdProvider) {
+     OsdImageCache.DropSource(ImageHandle);
      osdProvider->DropImageData(ImageHandle);
+     }
+}
+
+int cOsdProvider::ScaledImage(int ImageHandle, const cSize &Size, uint8_t AlphaLayer, bool Wait)
+{
+  if (osdProvider)
+     return OsdImageCache.ScaledImage(ImageHandle, Size, AlphaLayer, Wait);
+  return 0;
 }
 
 void cOsdProvider::Shutdown(void)
 {
+  OsdImageCache.Clear();
   delete osdProvider;
   osdProvider = NULL;
 }
@@ -447,6 +447,12 @@ public:
        ///< Clears the image data by setting all pixels to be fully transparent.
   void Fill(tColor Color);
        ///< Fills the image data with the given Color.
+  cImage *Scaled(const cSize &Size, uint8_t AlphaLayer = ALPHA_OPAQUE) const;
+       ///< Creates a copy of this image, scaled to the given Size. When scaling
+       ///< down, each resulting pixel is the weighted average of the area it covers
+       ///< in the original image, when scaling up, the pixels are interpolated
+       ///< linearly. The alpha values of the resulting pixels are multiplied with
+       ///< AlphaLayer. The caller must delete the returned image.
   };
 
 #define MAXPIXMAPLAYERS    8
@@ -687,15 +693,51 @@ public:
 // cPixmapMemory is an implementation of cPixmap that uses an array of tColor
 // values to store the pixmap.
 
+class cPixmapCommand;
+
 class cPixmapMemory : public cPixmap {
+  friend class cPixmapWorkers;
 private:
   tColor *data;
   bool panning;
+  bool deferred;
+  cList<cPixmapCommand> commands;
+  bool executing;
+  pthread_t executor;
+  bool Executing(void) const { return executing && pthread_equal(executor, pthread_self()); }
+       ///< Returns true if the calling thread is currently executing the deferred
+       ///< drawing operations of this pixmap. In that case the cPixmap mutex is
+       ///< already held on its behalf by the thread that initiated the execution.
+  bool Deferring(void) const { return deferred && !Executing(); }
+  void LockDrawing(void) { if (!Executing()) Lock(); }
+  void UnlockDrawing(void) { if (!Executing()) Unlock(); }
+  void Defer(cPixmapCommand *Command);
+  void ExecuteCommands(void);
 public:
   cPixmapMemory(void);
   cPixmapMemory(int Layer, const cRect &ViewPort, const cRect &DrawPort = cRect::Null);
   virtual ~cPixmapMemory();
-  const uint8_t *Data(void) { return (uint8_t *)data; }
+  void SetDeferred(bool On);
+       ///< Turns deferred drawing on or off. In deferred mode the operations Clear(),
+       ///< Fill(), DrawText(), DrawRectangle(), DrawEllipse() and DrawSlope() are
+       ///< only recorded, and are executed later by a call to Execute(). This allows
+       ///< cOsd to render several pixmaps in parallel when the OSD is flushed.
+       ///< All other operations, as well as accessing the pixmap's data, first
+       ///< execute any pending operations, so the result is always the same as in
+       ///< immediate mode. A font used in a deferred DrawText() call must remain
+       ///< valid until the operation has been executed (deleting a FreeType font
+       ///< takes care of this automatically).
+  bool HasCommands(void) const { return commands.Count() > 0; }
+       ///< Returns true if there are deferred drawing operations that have not
+       ///< yet been executed.
+  void Execute(void);
+       ///< Executes all pending deferred drawing operations.
+  const uint8_t *Data(void) { Execute(); return (uint8_t *)data; }
+  virtual void SetLayer(int Layer);
+  virtual void SetAlpha(int Alpha);
+  virtual void SetTile(bool Tile);
+  virtual void SetViewPort(const cRect &Rect);
+  virtual void SetDrawPortPoint(const cPoint &Point, bool Dirty = true);
   virtual void Clear(void);
   virtual void Fill(tColor Color);
   virtual void DrawImage(const cPoint &Point, const cImage &Image);
@@ -711,9 +753,18 @@ public:
   virtual void Copy(const cPixmap *Pixmap, const cRect &Source, const cPoint &Dest);
   virtual void Scroll(const cPoint &Dest, const cRect &Source = cRect::Null);
   virtual void Pan(const cPoint &Dest, const cRect &Source = cRect::Null);
+  bool IsOpaque(const cRect &Rect) const;
+       ///< Returns true if all pixels within Rect are fully opaque. Rect is relative
+       ///< to this pixmap's draw port and must be completely inside it, otherwise
+       ///< false is returned. The pixmap's own alpha value is not taken into account.
+       ///< Any deferred drawing operations must have been executed before calling
+       ///< this function.
   };
 
 #define MAXOSDAREAS 16
+#define OSDTILESIZE 32 // the size of the tiles used for keeping track of "dirty" areas
+
+class cOsdDirtyMap;
 
 /// The cOsd class is the interface to the "On Screen Display".
 /// An actual output device needs to derive from this class and implement
@@ -739,9 +790,18 @@ private:
   int numBitmaps;
   cPixmapMemory *savedPixmap;
   cVector<cPixmap *> pixmaps;
+  cOsdDirtyMap *dirtyMap;
   int left, top, width, height;
   uint level;
   bool active;
+  void ExecuteDeferred(void);
+       ///< Executes the deferred drawing operations of all pixmaps of this OSD,
+       ///< distributing the pixmaps over the pixmap worker threads.
+  int Occluder(const cRect &Rect);
+       ///< Returns the index of the pixmap that is rendered last among those that
+       ///< completely cover Rect with fully opaque pixels, or -1 if there is no such
+       ///< pixmap. Pixmaps that are rendered before the occluder can't contribute
+       ///< anything to Rect and therefore need not be rendered there.
 protected:
   cOsd(int Left, int Top, uint Level);
        ///< Initializes the OSD with the given coordinates.
@@ -780,9 +840,12 @@ protected:
        ///< refreshed; its draw port's origin is at (0, 0), and it has the same
        ///< size as the view port.
        ///< Only pixmaps with a non-negative layer value are rendered.
-       ///< If there are several non-overlapping dirty rectangles from different pixmaps,
-       ///< they are returned separately in order to avoid re-rendering large parts
-       ///< of the OSD that haven't changed at all. The caller must therefore call
+       ///< The dirty areas are collected in tiles of OSDTILESIZE x OSDTILESIZE pixels,
+       ///< and adjacent dirty tiles are combined into as few rectangles as possible,
+       ///< which are returned separately in order to avoid re-rendering large parts
+       ///< of the OSD that haven't changed at all. Within each rectangle, pixmaps that
+       ///< are completely covered by fully opaque pixmaps in higher layers are not
+       ///< rendered at all. The caller must therefore call
        ///< RenderPixmaps() repeatedly until it returns NULL, and display the returned
        ///< parts of the OSD at their appropriate locations. During this entire
        ///< operation the caller must hold a lock on the cPixmap mutex (for instance
@@ -818,6 +881,10 @@ public:
        ///< screen.
   static int IsOpen(void) { return Osds.Size() && Osds[0]->level == OSD_LEVEL_DEFAULT; }
        ///< Returns true if there is currently a level 0 OSD open.
+  static void ExecuteAllDeferred(void);
+       ///< Executes the deferred drawing operations of all pixmaps of all OSDs.
+       ///< This needs to be done before deleting anything a deferred operation
+       ///< might refer to, like a font.
   bool IsTrueColor(void) const { return isTrueColor; }
        ///< Returns 'true' if this is a true color OSD (providing full 32 bit color
        ///< depth).
@@ -966,9 +1033,11 @@ public:
   };
 
 #define MAXOSDIMAGES 64
+#define OSDIMAGECACHESIZE MEGABYTE(16) // maximum memory used by scaled images
 
 class cOsdProvider {
   friend class cPixmapMemory;
+  friend class cOsdImageCache;
 private:
   static cOsdProvider *osdProvider;
   static int oldWidth;
@@ -1033,6 +1102,24 @@ public:
   static void DropImage(int ImageHandle);
       ///< Drops the image referenced by the given ImageHandle. If ImageHandle
       ///< has an invalid value, nothing happens.
+      ///< Any scaled versions of this image are dropped, too.
+  static int ScaledImage(int ImageHandle, const cSize &Size, uint8_t AlphaLayer = ALPHA_OPAQUE, bool Wait = true);
+      ///< Returns a handle to a version of the image referenced by ImageHandle that
+      ///< has been scaled to the given Size, with its alpha values multiplied with
+      ///< AlphaLayer (see cImage::Scaled()). The returned handle can be used in calls
+      ///< to DrawImage(), but must not be dropped by the caller.
+      ///< Scaled images are kept in a cache that is shared by all OSDs and limited
+      ///< to OSDIMAGECACHESIZE bytes, so asking for the same image again doesn't
+      ///< cause any scaling work. If the cache is full, the least recently used
+      ///< images are dropped, so the returned handle is only guaranteed to be valid
+      ///< until the next call to ScaledImage() or StoreImage().
+      ///< If Wait is false and the requested image is not yet available, it is
+      ///< scaled in a background thread and 0 is returned. This can be used to
+      ///< prepare images that will soon be needed, like the logos of the next page
+      ///< of a channel list.
+      ///< If ImageHandle doesn't refer to an image stored by the default
+      ///< implementation of StoreImageData(), or if the scaled image can't be
+      ///< stored, 0 is returned.
   static void Shutdown(void);
       ///< Shuts down the OSD provider facility by deleting the current OSD provider.
   };
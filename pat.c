@@ -337,8 +337,18 @@ cPmtSidEntry::cPmtSidEntry(int Sid, int Pid, cPmtPidEntry *PidEntry)
 #define DBGLOG(a...) void()
 #endif
 
+cMutex cPatFilter::statsMutex;
+int cPatFilter::pmtCount = 0;
+int cPatFilter::pmtFast = 0;
+uint64_t cPatFilter::pmtTime = 0;
+uint64_t cPatFilter::maxPmtTime = 0;
+
 cPatFilter::cPatFilter(void)
 {
+  fastPmtPid = 0;
+  fastPmtVersion = -1;
+  triggerTime = 0;
+  pmtSeen = true;
   Trigger(0);
   Set(0x00, 0x00);  // PAT
 }
@@ -349,9 +359,19 @@ void cPatFilter::SetStatus(bool On)
   DBGLOG("PAT filter set status %d", On);
   cFilter::SetStatus(On);
   Trigger();
+  if (On && sid > 0) {
+     // If the PMT Pid of this channel is already known from an earlier visit
+     // of this transponder, the PMT is requested right away, without waiting
+     // for the PAT. This makes any changed PIDs known as early as possible.
+     if ((fastPmtPid = GetPmtPid(Source(), Transponder(), sid)) != 0) {
+        DBGLOG("PAT filter fast PMT pid %d for SID %d", fastPmtPid, sid);
+        fastPmtVersion = -1;
+        Add(fastPmtPid, SI::TableIdPMT);
+        }
+     }
 }
 
-void cPatFilter::Trigger(int Sid)
+void cPatFilter::Trigger(int Sid, bool LiveView)
 {
   cMutexLock MutexLock(&mutex);
   patVersion = -1;
@@ -359,12 +379,40 @@ void cPatFilter::Trigger(int Sid)
   if (Sid != 0 && activePmt)
      Del(activePmt->Pid(), SI::TableIdPMT);
   activePmt = NULL;
+  if (fastPmtPid) {
+     Del(fastPmtPid, SI::TableIdPMT);
+     fastPmtPid = 0;
+     }
   if (Sid >= 0) {
      sid = Sid;
+     triggerTime = cTimeMs::Now();
+     pmtSeen = Sid == 0 || !LiveView; // the zap statistics only cover live view
      DBGLOG("PAT filter trigger SID %d", Sid);
      }
 }
 
+void cPatFilter::PmtReceived(bool Fast)
+{
+  pmtSeen = true;
+  uint64_t t = cTimeMs::Now() - triggerTime;
+  cMutexLock MutexLock(&statsMutex);
+  pmtCount++;
+  if (Fast)
+     pmtFast++;
+  pmtTime += t;
+  maxPmtTime = max(maxPmtTime, t);
+}
+
+void cPatFilter::Statistics(cStringList &Lines, bool Reset)
+{
+  cMutexLock MutexLock(&statsMutex);
+  Lines.Append(strdup(cString::sprintf("PMT: %d channel switches (%d received before the PAT), average %d ms, max %d ms", pmtCount, pmtFast, pmtCount ? int(pmtTime / pmtCount) : 0, int(maxPmtTime))));
+  if (Reset) {
+     pmtCount = pmtFast = 0;
+     pmtTime = maxPmtTime = 0;
+     }
+}
+
 bool cPatFilter::PmtPidComplete(int PmtPid)
 {
   for (cPmtSidEntry *se = pmtSidList.First(); se; se = pmtSidList.Next(se)) {
@@ -462,6 +510,10 @@ void cPatFilter::Process(u_short Pid, u_char Tid, const u_char *Data, int Length
                  DBGLOG("  PAT %d: shared PMT PIDs", Transponder());
               if (pmtSidList.Count() && !activePmt)
                  activePmt = pmtPidList.First();
+              if (fastPmtPid) {
+                 Del(fastPmtPid, SI::TableIdPMT); // from now on the PMTs are handled as listed in the PAT
+                 fastPmtPid = 0;
+                 }
               if (activePmt)
                  Add(activePmt->Pid(), SI::TableIdPMT);
               timer.Set(PMT_SCAN_TIMEOUT);
@@ -474,7 +526,14 @@ void cPatFilter::Process(u_short Pid, u_char Tid, const u_char *Data, int Length
      SI::PMT pmt(Data, false);
      if (!pmt.CheckCRCAndParse())
         return;
-     if (!PmtVersionChanged(Pid, pmt.getTableIdExtension(), pmt.getVersionNumber(), false)) {
+     bool Fast = Pid == fastPmtPid && pmt.getServiceId() == sid; // the PMT of the current channel, received before the PAT
+     if (!pmtSeen && pmt.getServiceId() == sid)
+        PmtReceived(Fast);
+     if (Fast) {
+        if (pmt.getVersionNumber() == fastPmtVersion)
+           return;
+        }
+     else if (!PmtVersionChanged(Pid, pmt.getTableIdExtension(), pmt.getVersionNumber(), false)) {
         if (activePmt && activePmt->Complete())
            SwitchToNextPmtPid();
         return;
@@ -483,18 +542,25 @@ void cPatFilter::Process(u_short Pid, u_char Tid, const u_char *Data, int Length
      cChannels *Channels = cChannels::GetChannelsWrite(StateKey, 10);
      if (!Channels)
         return;
-     PmtVersionChanged(Pid, pmt.getTableIdExtension(), pmt.getVersionNumber(), true);
+     if (Fast)
+        fastPmtVersion = pmt.getVersionNumber();
+     else
+        PmtVersionChanged(Pid, pmt.getTableIdExtension(), pmt.getVersionNumber(), true);
      bool ChannelsModified = false;
      if (activePmt && activePmt->Complete())
         SwitchToNextPmtPid();
      cChannel *Channel = Channels->GetByServiceID(Source(), Transponder(), pmt.getServiceId());
      if (Channel) {
-        SI::CaDescriptor *d;
+        // The descriptors are decoded in place, to avoid allocating an object for each of them:
+        SI::DescriptorTag Tag;
         cCaDescriptors *CaDescriptors = new cCaDescriptors(Channel->Source(), Channel->Transponder(), Channel->Sid(), Pid);
         // Scan the common loop:
-        for (SI::Loop::Iterator it; (d = (SI::CaDescriptor*)pmt.commonDescriptors.getNext(it, SI::CaDescriptorTag)); ) {
-            CaDescriptors->AddCaDescriptor(d, 0);
-            delete d;
+        for (SI::Loop::Iterator it; pmt.commonDescriptors.getNextTag(it, Tag); ) {
+            if (Tag == SI::CaDescriptorTag) {
+               SI::CaDescriptor d;
+               if (pmt.commonDescriptors.decode(d, it))
+                  CaDescriptors->AddCaDescriptor(&d, 0);
+               }
             }
         // Scan the stream-specific loop:
         SI::PMT::Stream stream;
@@ -537,16 +603,17 @@ void cPatFilter::Process(u_short Pid, u_char Tid, const u_char *Data, int Length
                       if (NumApids < MAXAPIDS) {
                          Apids[NumApids] = esPid;
                          Atypes[NumApids] = stream.getStreamType();
-                         SI::Descriptor *d;
-                         for (SI::Loop::Iterator it; (d = stream.streamDescriptors.getNext(it)); ) {
-                             switch (d->getDescriptorTag()) {
+                         for (SI::Loop::Iterator it; stream.streamDescriptors.getNextTag(it, Tag); ) {
+                             switch (Tag) {
                                case SI::ISO639LanguageDescriptorTag: {
-                                    SI::ISO639LanguageDescriptor *ld = (SI::ISO639LanguageDescriptor *)d;
+                                    SI::ISO639LanguageDescriptor ld;
+                                    if (!stream.streamDescriptors.decode(ld, it))
+                                       break;
                                     SI::ISO639LanguageDescriptor::Language l;
                                     char *s = ALangs[NumApids];
                                     int n = 0;
-                                    for (SI::Loop::Iterator it; ld->languageLoop.getNext(l, it); ) {
-                                        if (*ld->languageCode != '-') { // some use "---" to indicate "none"
+                                    for (SI::Loop::Iterator it; ld.languageLoop.getNext(l, it); ) {
+                                        if (*ld.languageCode != '-') { // some use "---" to indicate "none"
                                            if (n > 0)
                                               *s++ = '+';
                                            strn0cpy(s, I18nNormalizeLanguageCode(l.languageCode), MAXLANGCODE1);
@@ -559,7 +626,6 @@ void cPatFilter::Process(u_short Pid, u_char Tid, const u_char *Data, int Length
                                     break;
                                default: ;
                                }
-                             delete d;
                              }
                          NumApids++;
                          }
@@ -573,23 +639,24 @@ void cPatFilter::Process(u_short Pid, u_char Tid, const u_char *Data, int Length
                       int dpid = 0;
                       int dtype = 0;
                       char lang[MAXLANGCODE1] = { 0 };
-                      SI::Descriptor *d;
-                      for (SI::Loop::Iterator it; (d = stream.streamDescriptors.getNext(it)); ) {
-                          switch (d->getDescriptorTag()) {
+                      for (SI::Loop::Iterator it; stream.streamDescriptors.getNextTag(it, Tag); ) {
+                          switch (Tag) {
                             case SI::AC3DescriptorTag:
                             case SI::EnhancedAC3DescriptorTag:
                                  dpid = esPid;
-                                 dtype = d->getDescriptorTag();
+                                 dtype = Tag;
                                  ProcessCaDescriptors = true;
                                  break;
                             case SI::SubtitlingDescriptorTag:
                                  if (NumSpids < MAXSPIDS) {
+                                    SI::SubtitlingDescriptor sd;
+                                    if (!stream.streamDescriptors.decode(sd, it))
+                                       break;
                                     Spids[NumSpids] = esPid;
-                                    SI::SubtitlingDescriptor *sd = (SI::SubtitlingDescriptor *)d;
                                     SI::SubtitlingDescriptor::Subtitling sub;
                                     char *s = SLangs[NumSpids];
                                     int n = 0;
-                                    for (SI::Loop::Iterator it; sd->subtitlingLoop.getNext(sub, it); ) {
+                                    for (SI::Loop::Iterator it; sd.subtitlingLoop.getNext(sub, it); ) {
                                         if (sub.languageCode[0]) {
                                            SubtitlingTypes[NumSpids] = sub.getSubtitlingType();
                                            CompositionPageIds[NumSpids] = sub.getCompositionPageId();
@@ -609,13 +676,13 @@ void cPatFilter::Process(u_short Pid, u_char Tid, const u_char *Data, int Length
                                  Tpid = esPid;
                                  break;
                             case SI::ISO639LanguageDescriptorTag: {
-                                 SI::ISO639LanguageDescriptor *ld = (SI::ISO639LanguageDescriptor *)d;
-                                 strn0cpy(lang, I18nNormalizeLanguageCode(ld->languageCode), MAXLANGCODE1);
+                                 SI::ISO639LanguageDescriptor ld;
+                                 if (stream.streamDescriptors.decode(ld, it))
+                                    strn0cpy(lang, I18nNormalizeLanguageCode(ld.languageCode), MAXLANGCODE1);
                                  }
                                  break;
                             default: ;
                             }
-                          delete d;
                           }
                       if (dpid) {
                          if (NumDpids < MAXDPIDS) {
@@ -640,17 +707,16 @@ void cPatFilter::Process(u_short Pid, u_char Tid, const u_char *Data, int Length
               case 0x87: // eac3
                       if (Setup.StandardCompliance == STANDARD_ANSISCTE) { // ATSC A/53 AUDIO (ANSI/SCTE 57)
                          char lang[MAXLANGCODE1] = { 0 };
-                         SI::Descriptor *d;
-                         for (SI::Loop::Iterator it; (d = stream.streamDescriptors.getNext(it)); ) {
-                             switch (d->getDescriptorTag()) {
+                         for (SI::Loop::Iterator it; stream.streamDescriptors.getNextTag(it, Tag); ) {
+                             switch (Tag) {
                                case SI::ISO639LanguageDescriptorTag: {
-                                    SI::ISO639LanguageDescriptor *ld = (SI::ISO639LanguageDescriptor *)d;
-                                    strn0cpy(lang, I18nNormalizeLanguageCode(ld->languageCode), MAXLANGCODE1);
+                                    SI::ISO639LanguageDescriptor ld;
+                                    if (stream.streamDescriptors.decode(ld, it))
+                                       strn0cpy(lang, I18nNormalizeLanguageCode(ld.languageCode), MAXLANGCODE1);
                                     }
                                     break;
                                default: ;
                                }
-                            delete d;
                             }
                          if (NumDpids < MAXDPIDS) {
                             Dpids[NumDpids] = esPid;
@@ -673,13 +739,14 @@ void cPatFilter::Process(u_short Pid, u_char Tid, const u_char *Data, int Length
                       {
                       char lang[MAXLANGCODE1] = { 0 };
                       bool IsAc3 = false;
-                      SI::Descriptor *d;
-                      for (SI::Loop::Iterator it; (d = stream.streamDescriptors.getNext(it)); ) {
-                          switch (d->getDescriptorTag()) {
+                      for (SI::Loop::Iterator it; stream.streamDescriptors.getNextTag(it, Tag); ) {
+                          switch (Tag) {
                             case SI::RegistrationDescriptorTag: {
-                                 SI::RegistrationDescriptor *rd = (SI::RegistrationDescriptor *)d;
+                                 SI::RegistrationDescriptor rd;
+                                 if (!stream.streamDescriptors.decode(rd, it))
+                                    break;
                                  // http://www.smpte-ra.org/mpegreg/mpegreg.html
-                                 switch (rd->getFormatIdentifier()) {
+                                 switch (rd.getFormatIdentifier()) {
                                    case 0x41432D33: // 'AC-3'
                                         IsAc3 = true;
                                         break;
@@ -690,13 +757,13 @@ void cPatFilter::Process(u_short Pid, u_char Tid, const u_char *Data, int Length
                                  }
                                  break;
                             case SI::ISO639LanguageDescriptorTag: {
-                                 SI::ISO639LanguageDescriptor *ld = (SI::ISO639LanguageDescriptor *)d;
-                                 strn0cpy(lang, I18nNormalizeLanguageCode(ld->languageCode), MAXLANGCODE1);
+                                 SI::ISO639LanguageDescriptor ld;
+                                 if (stream.streamDescriptors.decode(ld, it))
+                                    strn0cpy(lang, I18nNormalizeLanguageCode(ld.languageCode), MAXLANGCODE1);
                                  }
                                  break;
                             default: ;
                             }
-                         delete d;
                          }
                       if (IsAc3) {
                          if (NumDpids < MAXDPIDS) {
@@ -712,9 +779,12 @@ void cPatFilter::Process(u_short Pid, u_char Tid, const u_char *Data, int Length
               default: ;//printf("PID: %5d %5d %2d %3d %3d\n", pmt.getServiceId(), stream.getPid(), stream.getStreamType(), pmt.getVersionNumber(), Channel->Number());
               }
             if (ProcessCaDescriptors) {
-               for (SI::Loop::Iterator it; (d = (SI::CaDescriptor*)stream.streamDescriptors.getNext(it, SI::CaDescriptorTag)); ) {
-                   CaDescriptors->AddCaDescriptor(d, esPid);
-                   delete d;
+               for (SI::Loop::Iterator it; stream.streamDescriptors.getNextTag(it, Tag); ) {
+                   if (Tag == SI::CaDescriptorTag) {
+                      SI::CaDescriptor d;
+                      if (stream.streamDescriptors.decode(d, it))
+                         CaDescriptors->AddCaDescriptor(&d, esPid);
+                      }
                    }
                }
             }
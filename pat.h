@@ -27,6 +27,16 @@ private:
   cList<cPmtPidEntry> pmtPidList;
   cList<cPmtSidEntry> pmtSidList;
   cSectionSyncer sectionSyncer;
+  int fastPmtPid;
+  int fastPmtVersion;
+  uint64_t triggerTime;
+  bool pmtSeen;
+  static cMutex statsMutex;
+  static int pmtCount;
+  static int pmtFast;
+  static uint64_t pmtTime;
+  static uint64_t maxPmtTime;
+  void PmtReceived(bool Fast);
   bool PmtPidComplete(int PmtPid);
   void PmtPidReset(int PmtPid);
   bool PmtVersionChanged(int PmtPid, int Sid, int Version, bool SetNewVersion = false);
@@ -36,7 +46,15 @@ protected:
 public:
   cPatFilter(void);
   virtual void SetStatus(bool On);
-  void Trigger(int Sid = -1);
+  void Trigger(int Sid = -1, bool LiveView = false);
+       ///< Restarts the PAT/PMT scan. If Sid is given, it becomes the current
+       ///< channel's service id. If LiveView is true, the time until the PMT of
+       ///< that channel is received is recorded in the statistics.
+  static void Statistics(cStringList &Lines, bool Reset = false);
+       ///< Adds statistics about the time it took after switching to a channel
+       ///< in live view until the PMT of that channel was received to the given
+       ///< list of Lines.
+       ///< If Reset is true, the statistics are cleared afterwards.
   };
 
 void GetCaDescriptors(int Source, int Transponder, int ServiceId, const int *CaSystemIds, cDynamicBuffer &Buffer, int EsPid);
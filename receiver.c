@@ -15,7 +15,7 @@ cReceiver::cReceiver(const cChannel *Channel, int Priority)
 {
   device = NULL;
   SetPriority(Priority);
-  numPids = 0;
+  memset(pidMask, 0, sizeof(pidMask));
   lastScrambledPacket = 0;
   startScrambleDetection = 0;
   scramblingTimeout = 0;
@@ -42,17 +42,16 @@ void cReceiver::SetPriority(int Priority)
 bool cReceiver::AddPid(int Pid)
 {
   if (Pid) {
-     if (numPids < MAXRECEIVEPIDS) {
-        if (!WantsPid(Pid)) {
-           pids[numPids++] = Pid;
-           if (device)
-              device->AddPid(Pid);
-           }
-        }
-     else {
-        dsyslog("too many PIDs in cReceiver (Pid = %d)", Pid);
+     if (Pid < 0 || Pid >= MAXPID) {
+        dsyslog("invalid PID in cReceiver (Pid = %d)", Pid);
         return false;
         }
+     if (!WantsPid(Pid)) {
+        pids.Append(Pid);
+        pidMask[Pid / 32] |= 1U << (Pid % 32);
+        if (device)
+           device->AddPid(Pid);
+        }
      }
   return true;
 }
@@ -75,7 +74,8 @@ bool cReceiver::AddPids(int Pid1, int Pid2, int Pid3, int Pid4, int Pid5, int Pi
 
 bool cReceiver::SetPids(const cChannel *Channel)
 {
-  numPids = 0;
+  pids.Clear();
+  memset(pidMask, 0, sizeof(pidMask));
   if (Channel) {
      channelID = Channel->GetChannelID();
      return AddPid(Channel->Vpid()) &&
@@ -89,17 +89,11 @@ bool cReceiver::SetPids(const cChannel *Channel)
 
 void cReceiver::DelPid(int Pid)
 {
-  if (Pid) {
-     for (int i = 0; i < numPids; i++) {
-         if (pids[i] == Pid) {
-            for ( ; i < numPids; i++) // we also copy the terminating 0!
-                pids[i] = pids[i + 1];
-            numPids--;
-            if (device)
-               device->DelPid(Pid);
-            return;
-            }
-         }
+  if (WantsPid(Pid)) {
+     pids.RemoveElement(Pid);
+     pidMask[Pid / 32] &= ~(1U << (Pid % 32));
+     if (device)
+        device->DelPid(Pid);
      }
 }
 
@@ -111,17 +105,6 @@ void cReceiver::DelPids(const int *Pids)
      }
 }
 
-bool cReceiver::WantsPid(int Pid)
-{
-  if (Pid) {
-     for (int i = 0; i < numPids; i++) {
-         if (pids[i] == Pid)
-            return true;
-         }
-     }
-  return false;
-}
-
 void cReceiver::Detach(void)
 {
   if (device)
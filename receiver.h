@@ -12,7 +12,7 @@
 
 #include "device.h"
 
-#define MAXRECEIVEPIDS  64 // the maximum number of PIDs per receiver
+#define MAXRECEIVEPIDS  64 // the maximum number of CA PIDs per program (the number of PIDs per receiver is not limited)
 
 class cReceiver {
   friend class cDevice;
@@ -20,14 +20,14 @@ private:
   cDevice *device;
   tChannelID channelID;
   int priority;
-  int pids[MAXRECEIVEPIDS];
-  int numPids;
+  cVector<int> pids;
+  uint32_t pidMask[MAXPID / 32]; // one bit for each PID in pids
   time_t lastScrambledPacket;
   time_t startScrambleDetection;
   int scramblingTimeout;
   time_t startEitInjection;
   time_t lastEitInjection;
-  bool WantsPid(int Pid);
+  bool WantsPid(int Pid) { return Pid > 0 && Pid < MAXPID && (pidMask[Pid / 32] & (1U << (Pid % 32))); }
 protected:
   cDevice *Device(void) { return device; }
   void Detach(void);
@@ -49,7 +49,6 @@ public:
                ///< If Channel is not NULL, its pids are set by a call to SetPids().
                ///< Otherwise pids can be added to the receiver by separate calls to the AddPid[s]
                ///< functions.
-               ///< The total number of PIDs added to a receiver must not exceed MAXRECEIVEPIDS.
                ///< Priority may be any value in the range MINPRIORITY...MAXPRIORITY. Negative values indicate
                ///< that this cReceiver may be detached at any time in favor of a timer recording
                ///< or live viewing (without blocking the cDevice it is attached to).
@@ -78,7 +77,7 @@ public:
                ///< Deletes the given zero terminated list of Pids from the list of PIDs of this
                ///< receiver.
   tChannelID ChannelID(void) { return channelID; }
-  int NumPids(void) const { return numPids; }
+  int NumPids(void) const { return pids.Size(); }
   bool IsAttached(void) { return device != NULL; }
                ///< Returns true if this receiver is (still) attached to a device.
                ///< A receiver may be automatically detached from its device in
@@ -8,7 +8,9 @@
  */
 
 #include "recorder.h"
+#include "device.h"
 #include "shutdown.h"
+#include "videodir.h"
 
 #define RECORDERBUFSIZE  (MEGABYTE(20) / TS_SIZE * TS_SIZE) // multiple of TS_SIZE
 
@@ -19,8 +21,73 @@
 #define MINFREEDISKSPACE    (512) // MB
 #define DISKCHECKINTERVAL   100 // seconds
 
+#define MINRATETIME          60 // seconds before the data rate of a recorder is considered known
+
+#define MUXRECORDERBUFSIZE  (MEGABYTE(40) / TS_SIZE * TS_SIZE) // multiple of TS_SIZE
+#define MUXREADSIZE         (KILOBYTE(256) / TS_SIZE * TS_SIZE) // multiple of TS_SIZE
+#define MUXEXTRACTBUFSIZE   MEGABYTE(2)
+#define MUXEXTRACTDELAY     10 // seconds to wait before checking again whether an extraction can proceed
+#define MUXFLUSHTIMEOUT     30 // seconds to wait for the ring buffer to be written when a mux recorder stops
+#define MUXRETRYINTERVAL   600 // seconds between attempts to extract the muxes that had to be kept
+
+static bool IsFillerPacket(const uchar *Data)
+{
+  static const uchar aff[TS_SIZE - 4] = { 0xB7, 0x00,
+    0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
+    0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
+    0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
+    0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
+    0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
+    0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
+    0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
+    0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
+    0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
+    0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
+    0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
+    0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
+    0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
+    0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
+    0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
+    0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
+    0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
+    0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
+    0xFF, 0xFF}; // Length is always TS_SIZE!
+  return (Data[3] & 0b00110000) == 0b00100000 && !memcmp(Data + 4, aff, sizeof(aff));
+}
+
+cFrameDetector *NewFrameDetector(const cChannel *Channel)
+{
+  int Pid = Channel->Vpid();
+  int Type = Channel->Vtype();
+  if (!Pid && Channel->Apid(0)) {
+     Pid = Channel->Apid(0);
+     Type = 0x04;
+     }
+  if (!Pid && Channel->Dpid(0)) {
+     Pid = Channel->Dpid(0);
+     Type = 0x06;
+     }
+  return new cFrameDetector(Pid, Type);
+}
+
+static void UpdateFramesPerSecond(const char *RecordingName, double FramesPerSecond)
+{
+  cRecordingInfo RecordingInfo(RecordingName);
+  if (RecordingInfo.Read()) {
+     if (FramesPerSecond > 0 && DoubleEqual(RecordingInfo.FramesPerSecond(), DEFAULTFRAMESPERSECOND) && !DoubleEqual(RecordingInfo.FramesPerSecond(), FramesPerSecond)) {
+        RecordingInfo.SetFramesPerSecond(FramesPerSecond);
+        RecordingInfo.Write();
+        LOCK_RECORDINGS_WRITE;
+        Recordings->UpdateByName(RecordingName);
+        }
+     }
+}
+
 // --- cRecorder -------------------------------------------------------------
 
+cMutex cRecorder::recordersMutex;
+cVector<cRecorder *> cRecorder::recorders;
+
 cRecorder::cRecorder(const char *FileName, const cChannel *Channel, int Priority)
 :cReceiver(Channel, Priority)
 ,cThread("recording")
@@ -31,23 +98,16 @@ cRecorder::cRecorder(const char *FileName, const cChannel *Channel, int Priority
 
   SpinUpDisk(FileName);
 
-  ringBuffer = new cRingBufferLinear(RECORDERBUFSIZE, MIN_TS_PACKETS_FOR_FRAME_DETECTOR * TS_SIZE, true, "Recorder");
+  ringBuffer = new cRingBufferMirrored(RECORDERBUFSIZE, MIN_TS_PACKETS_FOR_FRAME_DETECTOR * TS_SIZE, 0, true, "Recorder");
   ringBuffer->SetTimeouts(0, 100);
   ringBuffer->SetIoThrottle();
 
-  int Pid = Channel->Vpid();
-  int Type = Channel->Vtype();
-  if (!Pid && Channel->Apid(0)) {
-     Pid = Channel->Apid(0);
-     Type = 0x04;
-     }
-  if (!Pid && Channel->Dpid(0)) {
-     Pid = Channel->Dpid(0);
-     Type = 0x06;
-     }
-  frameDetector = new cFrameDetector(Pid, Type);
+  frameDetector = NewFrameDetector(Channel);
   index = NULL;
   fileSize = 0;
+  bytesWritten = 0;
+  startTime = time(NULL);
+  stopTime = 0;
   lastDiskSpaceCheck = time(NULL);
   fileName = new cFileName(FileName, true);
   int PatVersion, PmtVersion;
@@ -57,6 +117,11 @@ cRecorder::cRecorder(const char *FileName, const cChannel *Channel, int Priority
   recordFile = fileName->Open();
   if (!recordFile)
      return;
+  recordersMutex.Lock();
+  recorders.Append(this);
+  recordersMutex.Unlock();
+  streamStats.Start("recorder", recordingName);
+  streamStats.SetRingBuffer(ringBuffer);
   // Create the index file:
   index = new cIndexFile(FileName, true);
   if (!index)
@@ -66,6 +131,10 @@ cRecorder::cRecorder(const char *FileName, const cChannel *Channel, int Priority
 
 cRecorder::~cRecorder()
 {
+  streamStats.Stop();
+  recordersMutex.Lock();
+  recorders.RemoveElement(this);
+  recordersMutex.Unlock();
   Detach();
   delete index;
   delete fileName;
@@ -74,6 +143,30 @@ cRecorder::~cRecorder()
   free(recordingName);
 }
 
+double cRecorder::MBperMinute(void) const
+{
+  int Seconds = time(NULL) - startTime;
+  if (Seconds >= MINRATETIME)
+     return double(__atomic_load_n(&bytesWritten, __ATOMIC_RELAXED)) * 60 / MEGABYTE(1) / Seconds;
+  return -1;
+}
+
+int cRecorder::ForecastMB(int Seconds, double MBperMinute)
+{
+  time_t Now = time(NULL);
+  double MB = 0;
+  cMutexLock MutexLock(&recordersMutex);
+  for (int i = 0; i < recorders.Size(); i++) {
+      const cRecorder *Recorder = recorders[i];
+      int Remaining = Recorder->stopTime ? min(int(Recorder->stopTime - Now), Seconds) : Seconds;
+      if (Remaining > 0) {
+         double Rate = Recorder->MBperMinute();
+         MB += (Rate > 0 ? Rate : MBperMinute) * Remaining / 60;
+         }
+      }
+  return int(ceil(MB)) + cMuxRecorder::ForecastMB(Seconds, MBperMinute);
+}
+
 bool cRecorder::RunningLowOnDiskSpace(void)
 {
   if (time(NULL) > lastDiskSpaceCheck + DISKCHECKINTERVAL) {
@@ -109,31 +202,14 @@ void cRecorder::Activate(bool On)
 void cRecorder::Receive(const uchar *Data, int Length)
 {
   if (Running()) {
-     static const uchar aff[TS_SIZE - 4] = { 0xB7, 0x00,
-       0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
-       0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
-       0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
-       0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
-       0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
-       0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
-       0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
-       0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
-       0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
-       0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
-       0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
-       0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
-       0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
-       0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
-       0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
-       0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
-       0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
-       0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
-       0xFF, 0xFF}; // Length is always TS_SIZE!
-     if ((Data[3] & 0b00110000) == 0b00100000 && !memcmp(Data + 4, aff, sizeof(aff)))
+     if (IsFillerPacket(Data))
         return; // Adaptation Field Filler found, skipping
      int p = ringBuffer->Put(Data, Length);
-     if (p != Length && Running())
+     streamStats.Packet(Data);
+     if (p != Length && Running()) {
         ringBuffer->ReportOverflow(Length - p);
+        streamStats.Lost();
+        }
      }
 }
 
@@ -152,15 +228,7 @@ void cRecorder::Action(void)
                  break;
               if (frameDetector->Synced()) {
                  if (!InfoWritten) {
-                    cRecordingInfo RecordingInfo(recordingName);
-                    if (RecordingInfo.Read()) {
-                       if (frameDetector->FramesPerSecond() > 0 && DoubleEqual(RecordingInfo.FramesPerSecond(), DEFAULTFRAMESPERSECOND) && !DoubleEqual(RecordingInfo.FramesPerSecond(), frameDetector->FramesPerSecond())) {
-                          RecordingInfo.SetFramesPerSecond(frameDetector->FramesPerSecond());
-                          RecordingInfo.Write();
-                          LOCK_RECORDINGS_WRITE;
-                          Recordings->UpdateByName(recordingName);
-                          }
-                       }
+                    UpdateFramesPerSecond(recordingName, frameDetector->FramesPerSecond());
                     InfoWritten = true;
                     cRecordingUserCommand::InvokeCommand(RUC_STARTRECORDING, recordingName);
                     }
@@ -168,8 +236,10 @@ void cRecorder::Action(void)
                     FirstIframeSeen = true; // start recording with the first I-frame
                     if (!NextFile())
                        break;
-                    if (index && frameDetector->NewFrame())
+                    if (index && frameDetector->NewFrame()) {
                        index->Write(frameDetector->IndependentFrame(), fileName->Number(), fileSize);
+                       streamStats.IndexWritten();
+                       }
                     if (frameDetector->IndependentFrame()) {
                        recordFile->Write(patPmtGenerator.GetPat(), TS_SIZE);
                        fileSize += TS_SIZE;
@@ -180,11 +250,14 @@ void cRecorder::Action(void)
                              }
                        t.Set(MAXBROKENTIMEOUT);
                        }
+                    uint64_t WriteStart = cStreamStats::Now();
                     if (recordFile->Write(b, Count) < 0) {
                        LOG_ERROR_STR(fileName->Name());
                        break;
                        }
+                    streamStats.Written(cStreamStats::Now() - WriteStart);
                     fileSize += Count;
+                    __atomic_add_fetch(&bytesWritten, Count, __ATOMIC_RELAXED);
                     }
                  }
               ringBuffer->Del(Count);
@@ -197,3 +270,762 @@ void cRecorder::Action(void)
            }
         }
 }
+
+// --- cMuxExtractor ---------------------------------------------------------
+
+class cMuxExtractor : public cThread {
+private:
+  cMutex mutex;
+  cCondWait condWait;
+  cStringList muxes;
+  cString current; // the mux that is currently being extracted
+  bool Wait(void);
+  bool ExtractRecording(const char *Directory, const char *FileName, int StartNumber, off_t StartOffset, int StopNumber, off_t StopOffset);
+  bool ExtractMux(const char *Directory);
+protected:
+  virtual void Action(void);
+public:
+  cMuxExtractor(void);
+  void Add(const char *Directory);
+  void Stop(void);
+  };
+
+static cMuxExtractor MuxExtractor;
+
+cMuxExtractor::cMuxExtractor(void)
+:cThread("mux extraction", true)
+{
+}
+
+void cMuxExtractor::Add(const char *Directory)
+{
+  mutex.Lock();
+  if (muxes.Find(Directory) < 0 && !(*current && strcmp(current, Directory) == 0)) {
+     muxes.Append(strdup(Directory));
+     isyslog("queued mux %s for extraction", Directory);
+     }
+  mutex.Unlock();
+  Start();
+  condWait.Signal();
+}
+
+void cMuxExtractor::Stop(void)
+{
+  if (Active()) {
+     Cancel(-1);
+     condWait.Signal();
+     Cancel(3);
+     }
+}
+
+bool cMuxExtractor::Wait(void)
+{
+  // Extraction only takes place while no mux is being recorded:
+  while (Running() && (cMuxRecorder::AnyActive() || cIoThrottle::Engaged()))
+        cCondWait::SleepMs(100);
+  return Running();
+}
+
+static void GetChannelPids(const cChannel *Channel, cVector<int> &Pids)
+{
+  Pids.AppendUnique(Channel->Vpid());
+  Pids.AppendUnique(Channel->Ppid());
+  for (const int *Apid = Channel->Apids(); *Apid; Apid++)
+      Pids.AppendUnique(*Apid);
+  for (const int *Dpid = Channel->Dpids(); *Dpid; Dpid++)
+      Pids.AppendUnique(*Dpid);
+  for (const int *Spid = Channel->Spids(); *Spid; Spid++)
+      Pids.AppendUnique(*Spid);
+  Pids.RemoveElement(0);
+}
+
+static bool MuxFileRefers(const char *FileName, const char *Directory)
+{
+  bool Refers = false;
+  if (FILE *f = fopen(AddDirectory(FileName, MUXFILE), "r")) {
+     cReadLine ReadLine;
+     char *s;
+     while (!Refers && (s = ReadLine.Read(f)) != NULL) {
+           if ((*s == 'M' || *s == 'D') && s[1] == ' ' && strcmp(s + 2, Directory) == 0)
+              Refers = true;
+           }
+     fclose(f);
+     }
+  return Refers;
+}
+
+static cString FindMuxRecording(const char *Path, const char *BaseName, const char *Directory)
+{
+  // Renaming or moving a recording keeps the last component of its file name
+  // ("YYYY-MM-DD.hh.mm.c-r.rec"), and deleting it only changes the extension:
+  const char *Ext = strrchr(BaseName, '.');
+  int StemLength = Ext ? Ext - BaseName : strlen(BaseName);
+  cReadDir d(Path);
+  struct dirent *e;
+  while ((e = d.Next()) != NULL) {
+        cString Name = AddDirectory(Path, e->d_name);
+        struct stat st;
+        if (stat(Name, &st) != 0 || !S_ISDIR(st.st_mode))
+           continue;
+        if (endswith(e->d_name, ".rec") || endswith(e->d_name, ".del")) {
+           if (int(strlen(e->d_name)) == StemLength + 4 && strncmp(e->d_name, BaseName, StemLength) == 0 && MuxFileRefers(Name, Directory))
+              return Name;
+           }
+        else if (*e->d_name != '.' && strcmp(e->d_name, MUXDIRECTORY) != 0) {
+           cString Found = FindMuxRecording(Name, BaseName, Directory);
+           if (*Found)
+              return Found;
+           }
+        }
+  return NULL;
+}
+
+bool cMuxExtractor::ExtractRecording(const char *Directory, const char *FileName, int StartNumber, off_t StartOffset, int StopNumber, off_t StopOffset)
+{
+  // Locate the recording, which may have been renamed, moved or deleted since it was recorded:
+  cString RecordingName = FileName;
+  if (access(FileName, F_OK) != 0) {
+     const char *BaseName = strrchr(FileName, '/');
+     RecordingName = FindMuxRecording(cVideoDirectory::Name(), BaseName ? BaseName + 1 : FileName, Directory);
+     if (!*RecordingName) {
+        isyslog("recording %s no longer exists", FileName);
+        return true;
+        }
+     if (endswith(RecordingName, ".del")) {
+        isyslog("keeping mux %s for deleted recording %s", Directory, *RecordingName);
+        return false; // it might still be undeleted
+        }
+     isyslog("recording %s has been moved to %s", FileName, *RecordingName);
+     FileName = RecordingName;
+     }
+  // Check whether this recording still needs data from this mux:
+  cString MuxFileName = AddDirectory(FileName, MUXFILE);
+  FILE *f = fopen(MuxFileName, "r");
+  if (!f) {
+     if (errno == ENOENT)
+        return true; // already extracted
+     LOG_ERROR_STR(*MuxFileName);
+     return false;
+     }
+  cChannel Channel;
+  cStringList Lines;
+  bool ChannelOk = false;
+  bool Extracted = false;
+  int ExtractedNumber = 0; // the state of the recording after the last mux has been extracted
+  int64_t ExtractedSize = 0;
+  int64_t ExtractedIndexSize = 0;
+  const char *FirstMux = NULL;
+  cReadLine ReadLine;
+  char *s;
+  while ((s = ReadLine.Read(f)) != NULL) {
+        if (*s == 'C' && s[1] == ' ')
+           ChannelOk = Channel.Parse(s + 2);
+        else if (*s == 'D' && s[1] == ' ')
+           Extracted = true;
+        else if (*s == 'S' && s[1] == ' ') {
+           if (sscanf(s + 2, "%d %" SCNd64 " %" SCNd64, &ExtractedNumber, &ExtractedSize, &ExtractedIndexSize) != 3)
+              ExtractedNumber = 0;
+           continue; // is written anew below
+           }
+        Lines.Append(strdup(s));
+        if (!FirstMux && *s == 'M' && s[1] == ' ')
+           FirstMux = Lines[Lines.Size() - 1] + 2;
+        }
+  fclose(f);
+  if (!ChannelOk) {
+     esyslog("ERROR: invalid channel data in %s", *MuxFileName);
+     return false;
+     }
+  if (!FirstMux || strcmp(FirstMux, Directory) != 0) {
+     // This recording's data from an earlier mux must be extracted first:
+     bool Pending = false;
+     for (int i = 0; i < Lines.Size(); i++) {
+         if (Lines[i][0] == 'M' && strcmp(Lines[i] + 2, Directory) == 0)
+            Pending = true;
+         }
+     return !Pending;
+     }
+  if (RecordingsHandler.GetUsage(FileName) & (ruSrc | ruDst)) {
+     isyslog("keeping mux %s for recording %s, which is being edited", Directory, FileName);
+     return false;
+     }
+  isyslog("extracting %s", FileName);
+  // Remove any leftovers from an interrupted extraction, i.e. everything that has
+  // been written after the data of the muxes that have already been extracted:
+  cString IndexFileName = cIndexFile::IndexFileName(FileName, false);
+  if (!Extracted)
+     unlink(IndexFileName);
+  else if (ExtractedNumber && truncate(IndexFileName, ExtractedIndexSize) < 0)
+     LOG_ERROR_STR(*IndexFileName);
+  if (!Extracted || ExtractedNumber) {
+     cReadDir d(FileName);
+     struct dirent *e;
+     while ((e = d.Next()) != NULL) {
+           if (endswith(e->d_name, ".ts")) {
+              cString TsFileName = AddDirectory(FileName, e->d_name);
+              int Number = atoi(e->d_name);
+              if (!Extracted || Number > ExtractedNumber)
+                 unlink(TsFileName);
+              else if (Number == ExtractedNumber && truncate(TsFileName, ExtractedSize) < 0)
+                 LOG_ERROR_STR(*TsFileName);
+              }
+           }
+     }
+  cVector<int> Pids;
+  GetChannelPids(&Channel, Pids);
+  uint32_t PidMask[MAXPID / 32] = { 0 };
+  for (int i = 0; i < Pids.Size(); i++)
+      PidMask[Pids[i] / 32] |= 1U << (Pids[i] % 32);
+  cFrameDetector *FrameDetector = NewFrameDetector(&Channel);
+  cPatPmtGenerator PatPmtGenerator;
+  cFileName FromFileName(Directory, false, true);
+  cFileName ToFileName(FileName, true);
+  int PatVersion, PmtVersion;
+  if (ToFileName.GetLastPatPmtVersions(PatVersion, PmtVersion))
+     PatPmtGenerator.SetVersions(PatVersion + 1, PmtVersion + 1);
+  PatPmtGenerator.SetChannel(&Channel);
+  cIndexFile Index(FileName, true);
+  cUnbufferedFile *FromFile = FromFileName.SetOffset(StartNumber, StartOffset);
+  cUnbufferedFile *ToFile = ToFileName.Open();
+  uchar *ReadBuffer = MALLOC(uchar, MUXREADSIZE);
+  uchar *Buffer = MALLOC(uchar, MUXEXTRACTBUFSIZE);
+  off_t Offset = StartOffset;
+  off_t FileSize = 0;
+  int Length = 0;
+  bool InfoWritten = false;
+  bool FirstIframeSeen = false;
+  bool Ok = FromFile && ToFile && ReadBuffer && Buffer;
+  while (Ok && Wait()) {
+        int Size = MUXREADSIZE;
+        if (StopNumber) {
+           if (FromFileName.Number() > StopNumber)
+              break;
+           if (FromFileName.Number() == StopNumber)
+              Size = int(min(off_t(Size), StopOffset - Offset));
+           if (Size <= 0)
+              break;
+           }
+        ssize_t r = FromFile->Read(ReadBuffer, Size);
+        if (r < 0) {
+           LOG_ERROR_STR(FromFileName.Name());
+           Ok = false;
+           break;
+           }
+        if (r == 0) {
+           if (FromFileName.Number() == StopNumber || !(FromFile = FromFileName.NextFile()))
+              break; // end of mux
+           Offset = 0;
+           continue;
+           }
+        Offset += r;
+        // Select the TS packets of this recording:
+        for (const uchar *p = ReadBuffer; p + TS_SIZE <= ReadBuffer + r; p += TS_SIZE) {
+            int Pid = TsPid(p);
+            if (p[0] == TS_SYNC_BYTE && (PidMask[Pid / 32] & (1U << (Pid % 32)))) {
+               memcpy(Buffer + Length, p, TS_SIZE);
+               Length += TS_SIZE;
+               }
+            }
+        // Write them to the recording, the same way cRecorder does:
+        int Done = 0;
+        while (Ok && Length - Done >= MIN_TS_PACKETS_FOR_FRAME_DETECTOR * TS_SIZE) {
+              uchar *b = Buffer + Done;
+              int Count = FrameDetector->Analyze(b, Length - Done);
+              if (!Count)
+                 break;
+              if (FrameDetector->Synced()) {
+                 if (!InfoWritten) {
+                    UpdateFramesPerSecond(FileName, FrameDetector->FramesPerSecond());
+                    InfoWritten = true;
+                    }
+                 if (FirstIframeSeen || FrameDetector->IndependentFrame()) {
+                    FirstIframeSeen = true;
+                    if (FrameDetector->IndependentFrame() && FileSize > MEGABYTE(off_t(Setup.MaxVideoFileSize))) {
+                       if (!(ToFile = ToFileName.NextFile())) {
+                          Ok = false;
+                          break;
+                          }
+                       FileSize = 0;
+                       }
+                    if (FrameDetector->NewFrame())
+                       Index.Write(FrameDetector->IndependentFrame(), ToFileName.Number(), FileSize);
+                    if (FrameDetector->IndependentFrame()) {
+                       ToFile->Write(PatPmtGenerator.GetPat(), TS_SIZE);
+                       FileSize += TS_SIZE;
+                       int i = 0;
+                       while (uchar *pmt = PatPmtGenerator.GetPmt(i)) {
+                             ToFile->Write(pmt, TS_SIZE);
+                             FileSize += TS_SIZE;
+                             }
+                       }
+                    if (ToFile->Write(b, Count) < 0) {
+                       LOG_ERROR_STR(ToFileName.Name());
+                       Ok = false;
+                       break;
+                       }
+                    FileSize += Count;
+                    }
+                 }
+              Done += Count;
+              }
+        Length -= Done;
+        memmove(Buffer, Buffer + Done, Length);
+        if (Length > MUXEXTRACTBUFSIZE - MUXREADSIZE) {
+           esyslog("ERROR: can't detect frames in %s", FileName);
+           Ok = false;
+           }
+        }
+  free(ReadBuffer);
+  free(Buffer);
+  delete FrameDetector;
+  if (!Ok || !Running()) {
+     if (Ok)
+        isyslog("interrupted extracting %s", FileName);
+     return false;
+     }
+  // Record that this mux has been extracted, and the size of the recording's
+  // last file and index at this point, in case the extraction of the next mux
+  // is interrupted:
+  struct stat st;
+  int64_t IndexSize = stat(IndexFileName, &st) == 0 ? int64_t(st.st_size) : 0;
+  int Muxes = 0;
+  cSafeFile SafeFile(MuxFileName);
+  if (SafeFile.Open()) {
+     for (int i = 0; i < Lines.Size(); i++) {
+         if (Lines[i][0] == 'M') {
+            if (Lines[i] + 2 == FirstMux) {
+               fprintf(SafeFile, "D %s\n", Directory);
+               continue;
+               }
+            Muxes++;
+            }
+         fprintf(SafeFile, "%s\n", Lines[i]);
+         }
+     fprintf(SafeFile, "S %d %" PRId64 " %" PRId64 "\n", ToFileName.Number(), int64_t(FileSize), IndexSize);
+     if (!SafeFile.Close())
+        return false;
+     }
+  else
+     return false;
+  if (!Muxes)
+     unlink(MuxFileName);
+  cRecordings::TouchUpdate();
+  isyslog("extracted %s", FileName);
+  return true;
+}
+
+class cMuxIndexEntry : public cListObject {
+public:
+  cString fileName;
+  int startNumber, stopNumber;
+  off_t startOffset, stopOffset;
+  cMuxIndexEntry(const char *FileName, int StartNumber, off_t StartOffset) { fileName = FileName; startNumber = StartNumber; startOffset = StartOffset; stopNumber = 0; stopOffset = 0; }
+  };
+
+bool cMuxExtractor::ExtractMux(const char *Directory)
+{
+  cList<cMuxIndexEntry> Entries;
+  cString IndexFileName = AddDirectory(Directory, MUXINDEXFILE);
+  if (FILE *f = fopen(IndexFileName, "r")) {
+     cReadLine ReadLine;
+     char *s;
+     while ((s = ReadLine.Read(f)) != NULL) {
+           char Type;
+           long Time;
+           int Number;
+           int64_t Offset;
+           int n = 0;
+           if (sscanf(s, "%c %ld %d %" SCNd64 " %n", &Type, &Time, &Number, &Offset, &n) == 4 && n > 0) {
+              const char *FileName = s + n;
+              if (Type == '+')
+                 Entries.Add(new cMuxIndexEntry(FileName, Number, Offset));
+              else if (Type == '-') {
+                 for (cMuxIndexEntry *e = Entries.Last(); e; e = Entries.Prev(e)) {
+                     if (!e->stopNumber && strcmp(e->fileName, FileName) == 0) {
+                        e->stopNumber = Number;
+                        e->stopOffset = Offset;
+                        break;
+                        }
+                     }
+                 }
+              }
+           else
+              esyslog("ERROR: invalid line in %s: %s", *IndexFileName, s);
+           }
+     fclose(f);
+     }
+  else {
+     LOG_ERROR_STR(*IndexFileName);
+     return false;
+     }
+  bool Ok = true;
+  for (cMuxIndexEntry *e = Entries.First(); e && Running(); e = Entries.Next(e)) {
+      if (!ExtractRecording(Directory, e->fileName, e->startNumber, e->startOffset, e->stopNumber, e->stopOffset))
+         Ok = false;
+      }
+  if (Ok && Running()) {
+     isyslog("removing mux %s", Directory);
+     return RemoveFileOrDir(Directory);
+     }
+  return false;
+}
+
+void cMuxExtractor::Action(void)
+{
+  while (Running()) {
+        char *Directory = NULL;
+        mutex.Lock();
+        if (muxes.Size()) {
+           Directory = muxes[0];
+           muxes.Remove(0);
+           current = Directory;
+           }
+        mutex.Unlock();
+        if (Directory) {
+           if (Wait() && !ExtractMux(Directory) && Running())
+              esyslog("ERROR: mux %s has not been completely extracted", Directory);
+           mutex.Lock();
+           current = NULL;
+           mutex.Unlock();
+           free(Directory);
+           }
+        else
+           condWait.Wait(MUXEXTRACTDELAY * 1000);
+        }
+}
+
+// --- cMuxRecorder ----------------------------------------------------------
+
+cMutex cMuxRecorder::muxRecordersMutex;
+cVector<cMuxRecorder *> cMuxRecorder::muxRecorders;
+
+cMuxRecorder::cMuxRecorder(cDevice *Device, const cChannel *Channel)
+:cReceiver(NULL, MINPRIORITY)
+,cThread("mux recording")
+{
+  device = Device;
+  source = Channel->Source();
+  transponder = Channel->Transponder();
+  fileName = NULL;
+  recordFile = NULL;
+  indexFile = NULL;
+  fileSize = 0;
+  bytesWritten = 0;
+  bytesReceived = 0;
+  startTime = time(NULL);
+  char DateTime[32];
+  struct tm tm_r;
+  strftime(DateTime, sizeof(DateTime), "%Y-%m-%d.%H.%M.%S", localtime_r(&startTime, &tm_r));
+  directory = strdup(cString::sprintf("%s/%s/%s.%d.mux", cVideoDirectory::Name(), MUXDIRECTORY, DateTime, device->DeviceNumber() + 1));
+  ringBuffer = new cRingBufferLinear(MUXRECORDERBUFSIZE, TS_SIZE, true, "Mux recorder");
+  ringBuffer->SetTimeouts(0, 100);
+  ringBuffer->SetIoThrottle();
+  if (!MakeDirs(directory, true))
+     return;
+  SpinUpDisk(directory);
+  cString IndexFileName = AddDirectory(directory, MUXINDEXFILE);
+  indexFile = fopen(IndexFileName, "a");
+  if (!indexFile) {
+     LOG_ERROR_STR(*IndexFileName);
+     return;
+     }
+  fileName = new cFileName(directory, true);
+  recordFile = fileName->Open();
+  if (!recordFile)
+     return;
+  isyslog("recording mux %s", directory);
+  muxRecordersMutex.Lock();
+  muxRecorders.Append(this);
+  muxRecordersMutex.Unlock();
+  streamStats.Start("mux", directory);
+  streamStats.SetRingBuffer(ringBuffer);
+}
+
+cMuxRecorder::~cMuxRecorder()
+{
+  streamStats.Stop();
+  muxRecordersMutex.Lock();
+  muxRecorders.RemoveElement(this);
+  muxRecordersMutex.Unlock();
+  Detach();
+  if (indexFile)
+     fclose(indexFile);
+  delete fileName;
+  delete ringBuffer;
+  free(directory);
+}
+
+cMuxRecorder *cMuxRecorder::Get(cDevice *Device, const cChannel *Channel)
+{
+  cMutexLock MutexLock(&muxRecordersMutex);
+  for (int i = 0; i < muxRecorders.Size(); i++) {
+      cMuxRecorder *MuxRecorder = muxRecorders[i];
+      if (MuxRecorder->device == Device && MuxRecorder->IsAttached() && MuxRecorder->source == Channel->Source() && ISTRANSPONDER(MuxRecorder->transponder, Channel->Transponder()))
+         return MuxRecorder;
+      }
+  return NULL;
+}
+
+void cMuxRecorder::WriteIndex(char Type, const char *FileName, off_t Offset)
+{
+  cMutexLock MutexLock(&mutex);
+  fprintf(indexFile, "%c %ld %d %" PRId64 " %s\n", Type, long(time(NULL)), fileName->Number(), int64_t(Offset), FileName);
+  fflush(indexFile);
+}
+
+void cMuxRecorder::WriteLeaves(bool All)
+{
+  cMutexLock MutexLock(&mutex);
+  int64_t Written = __atomic_load_n(&bytesWritten, __ATOMIC_RELAXED);
+  for (int i = 0; i < leavingViews.Size(); ) {
+      if (All || leavePositions[i] <= Written) {
+         // This is checked after every write, so the position is always within the current file:
+         WriteIndex('-', leavingViews[i], max(fileSize - off_t(Written - leavePositions[i]), off_t(0)));
+         free(leavingViews[i]);
+         leavingViews.Remove(i);
+         leavePositions.Remove(i);
+         }
+      else
+         i++;
+      }
+}
+
+void cMuxRecorder::Join(cMuxRecording *View)
+{
+  cMutexLock MutexLock(&mutex);
+  views.Append(View);
+  for (int i = 0; i < View->pids.Size(); i++)
+      AddPid(View->pids[i]);
+  if (View->priority > Priority())
+     cReceiver::SetPriority(View->priority);
+  WriteIndex('+', View->fileName, fileSize);
+}
+
+bool cMuxRecorder::Leave(cMuxRecording *View)
+{
+  cMutexLock MutexLock(&mutex);
+  views.RemoveElement(View);
+  for (int i = 0; i < View->pids.Size(); i++) {
+      int Pid = View->pids[i];
+      bool Used = false;
+      for (int j = 0; j < views.Size() && !Used; j++)
+          Used = views[j]->pids.IndexOf(Pid) >= 0;
+      if (!Used)
+         DelPid(Pid);
+      }
+  int NewPriority = MINPRIORITY;
+  for (int i = 0; i < views.Size(); i++)
+      NewPriority = max(NewPriority, views[i]->priority);
+  cReceiver::SetPriority(NewPriority);
+  // The last data of this view may still be in the ring buffer, so its end is
+  // recorded once everything received so far has been written:
+  leavingViews.Append(strdup(View->fileName));
+  leavePositions.Append(__atomic_load_n(&bytesReceived, __ATOMIC_RELAXED));
+  WriteLeaves(!cThread::Active()); // nothing will be written any more once the thread has ended
+  return views.Size() > 0;
+}
+
+double cMuxRecorder::MBperMinute(void) const
+{
+  int Seconds = time(NULL) - startTime;
+  if (Seconds >= MINRATETIME)
+     return double(__atomic_load_n(&bytesWritten, __ATOMIC_RELAXED)) * 60 / MEGABYTE(1) / Seconds;
+  return -1;
+}
+
+bool cMuxRecorder::AnyActive(void)
+{
+  cMutexLock MutexLock(&muxRecordersMutex);
+  return muxRecorders.Size() > 0;
+}
+
+int cMuxRecorder::ForecastMB(int Seconds, double MBperMinute)
+{
+  time_t Now = time(NULL);
+  double MB = 0;
+  cMutexLock MutexLock(&muxRecordersMutex);
+  for (int i = 0; i < muxRecorders.Size(); i++) {
+      cMuxRecorder *MuxRecorder = muxRecorders[i];
+      cMutexLock MutexLock(&MuxRecorder->mutex);
+      int Remaining = 0;
+      for (int j = 0; j < MuxRecorder->views.Size(); j++) {
+          const cMuxRecording *View = MuxRecorder->views[j];
+          Remaining = max(Remaining, View->stopTime ? min(int(View->stopTime - Now), Seconds) : Seconds);
+          }
+      if (Remaining > 0) {
+         double Rate = MuxRecorder->MBperMinute();
+         MB += (Rate > 0 ? Rate : MBperMinute * MuxRecorder->views.Size()) * Remaining / 60;
+         }
+      }
+  return int(ceil(MB));
+}
+
+void cMuxRecorder::Extract(void)
+{
+  cString MuxDirectory = AddDirectory(cVideoDirectory::Name(), MUXDIRECTORY);
+  cStringList Directories;
+  cReadDir d(MuxDirectory);
+  struct dirent *e;
+  while ((e = d.Next()) != NULL) {
+        if (endswith(e->d_name, ".mux"))
+           Directories.Append(strdup(AddDirectory(MuxDirectory, e->d_name)));
+        }
+  Directories.Sort(); // the names start with the date and time, so this extracts them in the order they were recorded
+  for (int i = 0; i < Directories.Size(); i++) {
+      bool Recording = false;
+      muxRecordersMutex.Lock();
+      for (int j = 0; j < muxRecorders.Size(); j++) {
+          if (strcmp(muxRecorders[j]->directory, Directories[i]) == 0)
+             Recording = true;
+          }
+      muxRecordersMutex.Unlock();
+      if (!Recording)
+         MuxExtractor.Add(Directories[i]);
+      }
+}
+
+void cMuxRecorder::Housekeeping(void)
+{
+  static time_t LastExtract = time(NULL); // Extract() is called at startup
+  if (time(NULL) - LastExtract > MUXRETRYINTERVAL) {
+     Extract();
+     LastExtract = time(NULL);
+     }
+}
+
+void cMuxRecorder::Shutdown(void)
+{
+  MuxExtractor.Stop();
+}
+
+bool cMuxRecorder::NextFile(void)
+{
+  if (recordFile && fileSize > MEGABYTE(off_t(Setup.MaxVideoFileSize))) {
+     // The mux is always read packet by packet, so there is no need to start a new file with an independent frame.
+     cMutexLock MutexLock(&mutex);
+     recordFile = fileName->NextFile();
+     fileSize = 0;
+     }
+  return recordFile != NULL;
+}
+
+void cMuxRecorder::Activate(bool On)
+{
+  if (On)
+     Start();
+  else
+     Cancel(MUXFLUSHTIMEOUT);
+}
+
+void cMuxRecorder::Receive(const uchar *Data, int Length)
+{
+  if (Running()) {
+     if (IsFillerPacket(Data))
+        return; // Adaptation Field Filler found, skipping
+     int p = ringBuffer->Put(Data, Length);
+     __atomic_add_fetch(&bytesReceived, p, __ATOMIC_RELAXED);
+     streamStats.Packet(Data);
+     if (p != Length && Running()) {
+        ringBuffer->ReportOverflow(Length - p);
+        streamStats.Lost();
+        }
+     }
+}
+
+void cMuxRecorder::Action(void)
+{
+  cTimeMs t(MAXBROKENTIMEOUT);
+  for (;;) {
+        bool Stopping = !Running(); // checked before Get(), so that no data received before stopping is lost
+        int r;
+        uchar *b = ringBuffer->Get(r);
+        if (b) {
+           int Count = r - r % TS_SIZE;
+           if (!NextFile())
+              break;
+           uint64_t WriteStart = cStreamStats::Now();
+           if (recordFile->Write(b, Count) < 0) {
+              LOG_ERROR_STR(fileName->Name());
+              break;
+              }
+           streamStats.Written(cStreamStats::Now() - WriteStart);
+           mutex.Lock();
+           fileSize += Count;
+           __atomic_add_fetch(&bytesWritten, Count, __ATOMIC_RELAXED);
+           WriteLeaves(false);
+           mutex.Unlock();
+           ringBuffer->Del(Count);
+           t.Set(MAXBROKENTIMEOUT);
+           }
+        else if (Stopping)
+           break; // everything that has been received is written
+        if (t.TimedOut()) {
+           esyslog("ERROR: video data stream broken");
+           ShutdownHandler.RequestEmergencyExit();
+           t.Set(MAXBROKENTIMEOUT);
+           }
+        }
+  WriteLeaves(true);
+}
+
+// --- cMuxRecording ---------------------------------------------------------
+
+cMuxRecording::cMuxRecording(cDevice *Device, const char *FileName, const cChannel *Channel, int Priority)
+{
+  muxRecorder = NULL;
+  fileName = strdup(FileName);
+  priority = Priority;
+  stopTime = 0;
+  GetChannelPids(Channel, pids);
+  bool New = false;
+  cMuxRecorder *MuxRecorder = cMuxRecorder::Get(Device, Channel);
+  if (!MuxRecorder) {
+     MuxRecorder = new cMuxRecorder(Device, Channel);
+     if (!MuxRecorder->recordFile) {
+        delete MuxRecorder;
+        return;
+        }
+     New = true;
+     }
+  MuxRecorder->Join(this);
+  if (New && !Device->AttachReceiver(MuxRecorder)) {
+     MuxRecorder->Leave(this);
+     RemoveFileOrDir(MuxRecorder->Directory());
+     delete MuxRecorder;
+     return;
+     }
+  // A recording that is continued (e.g. after a device has been taken away from it)
+  // may consist of data from several muxes:
+  cString MuxFileName = AddDirectory(fileName, MUXFILE);
+  bool Exists = access(MuxFileName, F_OK) == 0;
+  if (FILE *f = fopen(MuxFileName, "a")) {
+     if (!Exists)
+        fprintf(f, "C %s\n", *Channel->ToText());
+     fprintf(f, "M %s\n", MuxRecorder->Directory());
+     fclose(f);
+     muxRecorder = MuxRecorder;
+     }
+  else {
+     LOG_ERROR_STR(*MuxFileName);
+     if (!MuxRecorder->Leave(this)) {
+        cString Directory = MuxRecorder->Directory();
+        delete MuxRecorder;
+        RemoveFileOrDir(Directory);
+        }
+     }
+}
+
+cMuxRecording::~cMuxRecording()
+{
+  if (muxRecorder && !muxRecorder->Leave(this)) {
+     cString Directory = muxRecorder->Directory();
+     delete muxRecorder;
+     MuxExtractor.Add(Directory);
+     }
+  free(fileName);
+}
+
+bool cMuxRecording::Supports(const cChannel *Channel)
+{
+  return !Channel->Ca(); // encrypted channels need a CAM, which is assigned per receiver
+}
@@ -14,11 +14,16 @@
 #include "recording.h"
 #include "remux.h"
 #include "ringbuffer.h"
+#include "streamstats.h"
 #include "thread.h"
 
+cFrameDetector *NewFrameDetector(const cChannel *Channel);
+     ///< Returns a new frame detector for the video PID of the given Channel,
+     ///< or for its first audio or Dolby PID if it has no video.
+
 class cRecorder : public cReceiver, cThread {
 private:
-  cRingBufferLinear *ringBuffer;
+  cRingBufferMirrored *ringBuffer;
   cFrameDetector *frameDetector;
   cPatPmtGenerator patPmtGenerator;
   cFileName *fileName;
@@ -26,7 +31,13 @@ private:
   cUnbufferedFile *recordFile;
   char *recordingName;
   off_t fileSize;
+  int64_t bytesWritten;
+  time_t startTime;
+  time_t stopTime;
   time_t lastDiskSpaceCheck;
+  cStreamStats streamStats;
+  static cMutex recordersMutex;
+  static cVector<cRecorder *> recorders;
   bool RunningLowOnDiskSpace(void);
   bool NextFile(void);
 protected:
@@ -42,6 +53,125 @@ public:
        ///< Creates a new recorder for the given Channel and
        ///< the given Priority that will record into the file FileName.
   virtual ~cRecorder();
+  void SetStopTime(time_t StopTime) { stopTime = StopTime; }
+       ///< Sets the time at which this recording is expected to end. This is
+       ///< used to forecast the disk space the recording will still need.
+  double MBperMinute(void) const;
+       ///< Returns the data rate (in MB/min) this recorder has been writing with
+       ///< so far, or -1 if this value is not yet known.
+  static int ForecastMB(int Seconds, double MBperMinute);
+       ///< Returns the amount of disk space (in MB) all active recorders (including
+       ///< mux recorders) are expected to write within the next Seconds. The data rate of a recorder
+       ///< that has only just started is assumed to be the given MBperMinute.
+  };
+
+// Mux recording:
+//
+// In "mux" mode all timers that record services of the same transponder on the
+// same device share one cMuxRecorder, which writes the combined TS data of all
+// these services into a single stream below the MUXDIRECTORY of the video
+// directory. Each individual recording is a cMuxRecording, which only has the
+// usual info file in its recording directory, plus a MUXFILE that identifies
+// the channel. The combined index of the mux (file MUXINDEXFILE in the mux
+// directory) records where each recording starts and stops within the mux.
+// Once all recordings of a mux have ended (and no other mux is being recorded),
+// the recordings are extracted into normal recordings in the background, and
+// the mux is deleted. A recording that has been renamed or moved in the meantime
+// is found through its MUXFILE. The mux is kept as long as any of its recordings
+// has not been extracted, has only been marked as deleted (and could thus still
+// be undeleted), or is being edited. Such muxes are tried again periodically.
+// After each extracted mux, the MUXFILE records the size of the recording's last
+// file and index, so that an interrupted extraction of the next mux can be undone.
+
+#define MUXDIRECTORY "@mux"
+#define MUXINDEXFILE "index"
+#define MUXFILE      "mux"
+
+class cMuxRecording;
+
+class cMuxRecorder : public cReceiver, cThread {
+  friend class cMuxRecording;
+private:
+  cMutex mutex;
+  cRingBufferLinear *ringBuffer;
+  cFileName *fileName;
+  cUnbufferedFile *recordFile;
+  char *directory;
+  FILE *indexFile;
+  cDevice *device;
+  int source;
+  int transponder;
+  off_t fileSize;
+  int64_t bytesWritten;
+  int64_t bytesReceived;
+  time_t startTime;
+  time_t lastIndexEntry;
+  cStreamStats streamStats;
+  cVector<cMuxRecording *> views;
+  cStringList leavingViews;
+  cVector<int64_t> leavePositions;
+  static cMutex muxRecordersMutex;
+  static cVector<cMuxRecorder *> muxRecorders;
+  cMuxRecorder(cDevice *Device, const cChannel *Channel);
+  static cMuxRecorder *Get(cDevice *Device, const cChannel *Channel);
+  void WriteIndex(char Type, const char *FileName, off_t Offset);
+  void WriteLeaves(bool All);
+       ///< Writes the '-' entries of the views that have left, as soon as all the
+       ///< data they have received has been written (or right away if All is true).
+  void Join(cMuxRecording *View);
+  bool Leave(cMuxRecording *View);
+  bool NextFile(void);
+protected:
+  virtual void Activate(bool On);
+  virtual void Receive(const uchar *Data, int Length);
+  virtual void Action(void);
+public:
+  virtual ~cMuxRecorder();
+  const char *Directory(void) { return directory; }
+  double MBperMinute(void) const;
+       ///< Returns the data rate (in MB/min) this mux recorder has been writing with
+       ///< so far, or -1 if this value is not yet known.
+  static bool AnyActive(void);
+       ///< Returns true if any mux is currently being recorded.
+  static int ForecastMB(int Seconds, double MBperMinute);
+       ///< Same as cRecorder::ForecastMB(), for all active mux recorders.
+  static void Extract(void);
+       ///< Starts extracting the recordings of all muxes in the video directory
+       ///< that are no longer being recorded (e.g. because VDR was stopped before
+       ///< the extraction could finish).
+  static void Housekeeping(void);
+       ///< Calls Extract() every MUXRETRYINTERVAL seconds, so that muxes that had to
+       ///< be kept because one of their recordings has been deleted (but could still
+       ///< be undeleted) or was being edited are eventually extracted or removed.
+  static void Shutdown(void);
+       ///< Stops any ongoing extraction. It will be resumed by the next call to
+       ///< Extract().
+  };
+
+class cMuxRecording {
+  friend class cMuxRecorder;
+private:
+  cMuxRecorder *muxRecorder;
+  char *fileName;
+  cVector<int> pids;
+  int priority;
+  time_t stopTime;
+public:
+  cMuxRecording(cDevice *Device, const char *FileName, const cChannel *Channel, int Priority);
+       ///< Creates a new recording of the given Channel with the given Priority,
+       ///< with FileName being the (already existing) recording directory.
+       ///< The data is actually recorded by the cMuxRecorder that records the
+       ///< transponder of Channel on the given Device, which is created and attached
+       ///< to Device if necessary. Check IsAttached() to see whether this was
+       ///< successful.
+  ~cMuxRecording();
+  bool IsAttached(void) { return muxRecorder && muxRecorder->IsAttached(); }
+       ///< Returns true if the mux this recording is part of is (still) being
+       ///< recorded.
+  void SetStopTime(time_t StopTime) { stopTime = StopTime; }
+       ///< Sets the time at which this recording is expected to end.
+  static bool Supports(const cChannel *Channel);
+       ///< Returns true if the given Channel can be recorded as part of a mux.
   };
 
 #endif //__RECORDER_H
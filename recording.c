@@ -24,6 +24,7 @@
 #include "i18n.h"
 #include "interface.h"
 #include "menu.h"
+#include "recorder.h"
 #include "remux.h"
 #include "ringbuffer.h"
 #include "skins.h"
@@ -64,10 +65,14 @@
 #define REMOVECHECKDELTA   60 // seconds between checks for removing deleted files
 #define DELETEDLIFETIME   300 // seconds after which a deleted recording will be actually removed
 #define DISKCHECKDELTA    100 // seconds between checks for free disk space
+#define DISKFORECASTTIME 3600 // seconds for which to forecast the disk space needed by recordings
 #define REMOVELATENCY      10 // seconds to wait until next check after removing a file
 #define MARKSUPDATEDELTA   10 // seconds between checks for updating editing marks
+#define TOTALSUPDATEDELTA  60 // seconds between recalculations of the total size of the recordings
 #define MININDEXAGE      3600 // seconds before an index file is considered no longer to be written
 #define MAXREMOVETIME      10 // seconds after which to return from removing deleted recordings
+#define REMOVEPROGRESSDELTA 10 // seconds between progress reports when removing a recording
+#define REMOVETHROTTLEWAIT 1000 // ms to wait while the I/O throttle is engaged
 
 #define MAX_LINK_LEVEL  6
 
@@ -78,6 +83,176 @@ int DirectoryNameMax = NAME_MAX;
 bool DirectoryEncoding = false;
 int InstanceId = 0;
 
+// --- cRecordingRemover -----------------------------------------------------
+
+// Unlinking a file of several GB in one go can cause a long burst of file system
+// metadata I/O, during which concurrent recordings may overflow their buffers.
+// Therefore the actual removal of recordings is done in a background thread,
+// which first truncates the large files in small steps (with a pause after each
+// step), and then removes the (now small) recording directory.
+
+class cRecordingRemover : public cThread {
+private:
+  cMutex mutex;
+  cStringList fileNames;
+  cVector<int> sizesMB;
+  int64_t bytesTotal;
+  int64_t bytesDone;
+  time_t lastProgress;
+  void Shrink(const char *FileName);
+  void Truncate(const char *FileName);
+protected:
+  virtual void Action(void);
+public:
+  cRecordingRemover(void);
+  virtual ~cRecordingRemover();
+  void Add(const char *FileName, int SizeMB);
+       ///< Adds the recording with the given FileName (and the given size in MB)
+       ///< to the list of recordings that shall be removed.
+  bool Busy(void);
+       ///< Returns true if there are recordings that are about to be removed.
+       ///< Also restarts the thread in case it has ended just as a new recording
+       ///< was added.
+  int PendingMB(void);
+       ///< Returns the amount of disk space (in MB) that is about to be freed
+       ///< by removing the recordings in the list.
+  };
+
+cRecordingRemover::cRecordingRemover(void)
+:cThread("remove recordings", true)
+{
+  bytesTotal = bytesDone = 0;
+  lastProgress = 0;
+}
+
+cRecordingRemover::~cRecordingRemover()
+{
+  Cancel(3);
+}
+
+void cRecordingRemover::Add(const char *FileName, int SizeMB)
+{
+  cMutexLock MutexLock(&mutex);
+  if (fileNames.Find(FileName) < 0) {
+     fileNames.Append(strdup(FileName));
+     sizesMB.Append(max(SizeMB, 0));
+     }
+  Start();
+}
+
+bool cRecordingRemover::Busy(void)
+{
+  cMutexLock MutexLock(&mutex);
+  if (fileNames.Size()) {
+     if (!Active())
+        Start();
+     return true;
+     }
+  return false;
+}
+
+int cRecordingRemover::PendingMB(void)
+{
+  cMutexLock MutexLock(&mutex);
+  int64_t MB = 0;
+  for (int i = 0; i < sizesMB.Size(); i++)
+      MB += sizesMB[i];
+  if (sizesMB.Size())
+     MB -= bytesDone / MEGABYTE(1); // the first one is currently being removed
+  return max(int(MB), 0);
+}
+
+void cRecordingRemover::Truncate(const char *FileName)
+{
+  int f = open(FileName, O_WRONLY | O_NOFOLLOW);
+  if (f < 0) {
+     LOG_ERROR_STR(FileName);
+     return;
+     }
+  struct stat st;
+  if (fstat(f, &st) == 0) {
+     off_t Step = MEGABYTE(off_t(Setup.RemoveStepSize));
+     for (off_t Size = st.st_size; Size > Step && Running(); ) {
+         while (cIoThrottle::Engaged() && Running())
+               cCondWait::SleepMs(REMOVETHROTTLEWAIT);
+         Size -= Step;
+         if (ftruncate(f, Size) < 0) {
+            LOG_ERROR_STR(FileName);
+            break;
+            }
+         mutex.Lock();
+         bytesDone += Step;
+         mutex.Unlock();
+         if (time(NULL) - lastProgress >= REMOVEPROGRESSDELTA) {
+            lastProgress = time(NULL);
+            dsyslog("removing %s: %d%%", FileName, bytesTotal ? int(bytesDone * 100 / bytesTotal) : 100);
+            }
+         cCondWait::SleepMs(Setup.RemoveStepDelay);
+         }
+     }
+  else
+     LOG_ERROR_STR(FileName);
+  close(f);
+}
+
+void cRecordingRemover::Shrink(const char *FileName)
+{
+  cReadDir d(FileName);
+  if (d.Ok()) {
+     // Determine the total size first, to be able to report the progress:
+     cStringList LargeFiles;
+     mutex.Lock();
+     bytesTotal = bytesDone = 0;
+     mutex.Unlock();
+     struct dirent *e;
+     while ((e = d.Next()) != NULL) {
+           cString Name = AddDirectory(FileName, e->d_name);
+           struct stat st;
+           if (lstat(Name, &st) == 0 && S_ISREG(st.st_mode) && st.st_size > MEGABYTE(off_t(Setup.RemoveStepSize))) {
+              LargeFiles.Append(strdup(Name));
+              bytesTotal += st.st_size - MEGABYTE(off_t(Setup.RemoveStepSize));
+              }
+           }
+     if (LargeFiles.Size()) {
+        isyslog("removing recording %s in steps of %d MB (%d MB)", FileName, Setup.RemoveStepSize, int(bytesTotal / MEGABYTE(1)));
+        lastProgress = time(NULL);
+        for (int i = 0; i < LargeFiles.Size() && Running(); i++)
+            Truncate(LargeFiles[i]);
+        }
+     }
+}
+
+void cRecordingRemover::Action(void)
+{
+  bool Removed = false;
+  while (Running()) {
+        cString FileName;
+        {
+          cMutexLock MutexLock(&mutex);
+          if (!fileNames.Size())
+             break;
+          FileName = fileNames[0];
+        }
+        if (Setup.RemoveStepSize > 0)
+           Shrink(FileName);
+        if (!Running())
+           break; // the rest will be removed the next time VDR runs
+        cVideoDirectory::RemoveVideoFile(FileName);
+        Removed = true;
+        cMutexLock MutexLock(&mutex);
+        free(fileNames[0]);
+        fileNames.Remove(0);
+        sizesMB.Remove(0);
+        bytesDone = 0;
+        }
+  if (Removed && Running()) {
+     const char *IgnoreFiles[] = { SORTMODEFILE, TIMERRECFILE, NULL };
+     cVideoDirectory::RemoveEmptyVideoDirectories(IgnoreFiles);
+     }
+}
+
+static cRecordingRemover RecordingRemover;
+
 // --- cRemoveDeletedRecordingsThread ----------------------------------------
 
 class cRemoveDeletedRecordingsThread : public cThread {
@@ -138,7 +313,7 @@ void RemoveDeletedRecordings(void)
 {
   static time_t LastRemoveCheck = 0;
   if (time(NULL) - LastRemoveCheck > REMOVECHECKDELTA) {
-     if (!RemoveDeletedRecordingsThread.Active()) {
+     if (!RemoveDeletedRecordingsThread.Active() && !RecordingRemover.Busy()) {
         LOCK_DELETEDRECORDINGS_READ;
         for (const cRecording *r = DeletedRecordings->First(); r; r = DeletedRecordings->Next(r)) {
             if (r->Deleted() && time(NULL) - r->Deleted() > DELETEDLIFETIME) {
@@ -151,94 +326,170 @@ void RemoveDeletedRecordings(void)
      }
 }
 
-void AssertFreeDiskSpace(int Priority, bool Force)
+static int DiskSpaceForecastMB(void)
+{
+  // Estimates the disk space (in MB) the ongoing and upcoming recordings
+  // will need within the next DISKFORECASTTIME seconds:
+  double MBperMinute;
+  {
+    LOCK_RECORDINGS_READ;
+    MBperMinute = Recordings->MBperMinute();
+  }
+  if (MBperMinute <= 0)
+     MBperMinute = MB_PER_MINUTE;
+  int MB = cRecorder::ForecastMB(DISKFORECASTTIME, MBperMinute);
+  time_t Now = time(NULL);
+  LOCK_TIMERS_READ;
+  for (const cTimer *Timer = Timers->First(); Timer; Timer = Timers->Next(Timer)) {
+      if (Timer->Local() && Timer->HasFlags(tfActive) && !Timer->Recording()) { // ongoing recordings are handled by their recorders
+         time_t Start = max(Timer->StartTime(), Now);
+         time_t Stop = min(Timer->StopTime(), Now + DISKFORECASTTIME);
+         if (Stop > Start)
+            MB += int(ceil(MBperMinute * (Stop - Start) / 60));
+         }
+      }
+  return MB;
+}
+
+static bool DiskSpaceAvailable(int SizeMB)
+{
+  // Disk space that is currently being freed counts as available:
+  return cVideoDirectory::VideoFileSpaceAvailable(SizeMB - RecordingRemover.PendingMB());
+}
+
+static void CheckFreeDiskSpace(int Priority, bool Force, bool Recording)
 {
   static cMutex Mutex;
-  cMutexLock MutexLock(&Mutex);
-  // With every call to this function we try to actually remove
-  // a file, or mark a file for removal ("delete" it), so that
-  // it will get removed during the next call.
   static time_t LastFreeDiskCheck = 0;
+  static bool ShortForUpcoming = false; // the predictive check has already been logged
   int Factor = (Priority == -1) ? 10 : 1;
+  if (!Force && time(NULL) - LastFreeDiskCheck <= DISKCHECKDELTA / Factor)
+     return;
+  // This locks the timers, so it must be done before locking the mutex:
+  int ForecastMB = DiskSpaceForecastMB();
+  cMutexLock MutexLock(&Mutex);
+  // With every call to this function we try to actually remove
+  // files, or mark files for removal ("delete" them), so that
+  // they will get removed during the next call. Besides the
+  // minimum free disk space we also keep ahead of the disk space
+  // the ongoing and upcoming recordings are expected to need,
+  // but only "deleted" recordings and recordings with an expired
+  // lifetime are removed for that purpose.
   if (Force || time(NULL) - LastFreeDiskCheck > DISKCHECKDELTA / Factor) {
-     if (!cVideoDirectory::VideoFileSpaceAvailable(MINDISKSPACE)) {
+     int RequiredMB = MINDISKSPACE + ForecastMB;
+     if ((Recording || ForecastMB > 0) && !DiskSpaceAvailable(RequiredMB)) {
+        bool LowDiskSpace = Recording && !DiskSpaceAvailable(MINDISKSPACE);
         // Make sure only one instance of VDR does this:
         cLockFile LockFile(cVideoDirectory::Name());
         if (!LockFile.Lock())
            return;
-        // Remove the oldest file that has been "deleted":
-        isyslog("low disk space while recording, trying to remove a deleted recording...");
+        // Running short of space for upcoming recordings is only logged once, until the situation changes:
+        bool Log = LowDiskSpace || !ShortForUpcoming;
+        ShortForUpcoming = !LowDiskSpace;
+        if (LowDiskSpace)
+           isyslog("low disk space while recording, trying to remove deleted recordings...");
+        else if (Log)
+           isyslog("upcoming recordings will need %d MB, trying to remove deleted recordings in advance...", ForecastMB);
+        // Remove the oldest files that have been "deleted":
         int NumDeletedRecordings = 0;
         {
           LOCK_DELETEDRECORDINGS_WRITE;
           NumDeletedRecordings = DeletedRecordings->Count();
-          if (NumDeletedRecordings) {
-             cRecording *r = DeletedRecordings->First();
-             cRecording *r0 = NULL;
-             while (r) {
-                   if (r->IsOnVideoDirectoryFileSystem()) { // only remove recordings that will actually increase the free video disk space
-                      if (!r0 || r->Start() < r0->Start())
-                         r0 = r;
+          bool Removed = false;
+          while (!DiskSpaceAvailable(RequiredMB)) {
+                cRecording *r = DeletedRecordings->First();
+                cRecording *r0 = NULL;
+                while (r) {
+                      if (r->IsOnVideoDirectoryFileSystem()) { // only remove recordings that will actually increase the free video disk space
+                         if (!r0 || r->Start() < r0->Start())
+                            r0 = r;
+                         }
+                      r = DeletedRecordings->Next(r);
                       }
-                   r = DeletedRecordings->Next(r);
-                   }
-             if (r0) {
+                if (!r0)
+                   break;
                 if (r0->Remove())
-                   LastFreeDiskCheck += REMOVELATENCY / Factor;
+                   Removed = true;
                 DeletedRecordings->Del(r0);
-                return;
                 }
+          if (Removed) {
+             LastFreeDiskCheck += REMOVELATENCY / Factor;
+             return;
              }
         }
-        if (NumDeletedRecordings == 0) {
+        if (NumDeletedRecordings == 0 && LowDiskSpace) {
            // DeletedRecordings was empty, so to be absolutely sure there are no
-           // deleted recordings we need to double check:
+           // deleted recordings we need to double check (which takes a while, so
+           // we only do this if we really need the space right now):
            cRecordings::Update(true);
            LOCK_DELETEDRECORDINGS_READ;
            if (DeletedRecordings->Count())
               return; // the next call will actually remove it
            }
-        // No "deleted" files to remove, so let's see if we can delete a recording:
-        if (Priority > 0) {
-           isyslog("...no deleted recording found, trying to delete an old recording...");
+        // No "deleted" files to remove, so let's see if we can delete recordings:
+        if (Priority > 0 || !LowDiskSpace) {
+           if (Log)
+              isyslog("...no deleted recording found, trying to delete old recordings...");
            LOCK_RECORDINGS_WRITE;
            Recordings->SetExplicitModify();
-           if (Recordings->Count()) {
-              cRecording *r = Recordings->First();
-              cRecording *r0 = NULL;
-              while (r) {
-                    if (r->IsOnVideoDirectoryFileSystem()) { // only delete recordings that will actually increase the free video disk space
-                       if (!r->IsEdited() && r->Lifetime() < MAXLIFETIME) { // edited recordings and recordings with MAXLIFETIME live forever
-                          if ((r->Lifetime() == 0 && Priority > r->Priority()) || // the recording has no guaranteed lifetime and the new recording has higher priority
-                              (r->Lifetime() > 0 && (time(NULL) - r->Start()) / SECSINDAY >= r->Lifetime())) { // the recording's guaranteed lifetime has expired
-                             if (r0) {
-                                if (r->Priority() < r0->Priority() || (r->Priority() == r0->Priority() && r->Start() < r0->Start()))
-                                   r0 = r; // in any case we delete the one with the lowest priority (or the older one in case of equal priorities)
+           bool Deleted = false;
+           int DeletedMB = 0;
+           while (!DiskSpaceAvailable(RequiredMB - DeletedMB)) {
+                 cRecording *r = Recordings->First();
+                 cRecording *r0 = NULL;
+                 while (r) {
+                       if (r->IsOnVideoDirectoryFileSystem()) { // only delete recordings that will actually increase the free video disk space
+                          if (!r->IsEdited() && r->Lifetime() < MAXLIFETIME) { // edited recordings and recordings with MAXLIFETIME live forever
+                             if ((LowDiskSpace && r->Lifetime() == 0 && Priority > r->Priority()) || // the recording has no guaranteed lifetime and the new recording has higher priority
+                                 (r->Lifetime() > 0 && (time(NULL) - r->Start()) / SECSINDAY >= r->Lifetime())) { // the recording's guaranteed lifetime has expired
+                                if (r0) {
+                                   if (r->Priority() < r0->Priority() || (r->Priority() == r0->Priority() && r->Start() < r0->Start()))
+                                      r0 = r; // in any case we delete the one with the lowest priority (or the older one in case of equal priorities)
+                                   }
+                                else
+                                   r0 = r;
                                 }
-                             else
-                                r0 = r;
                              }
                           }
+                       r = Recordings->Next(r);
                        }
-                    r = Recordings->Next(r);
-                    }
-              if (r0 && r0->Delete()) {
+                 if (!r0)
+                    break;
+                 int SizeMB = r0->FileSizeMB();
+                 if (!r0->Delete())
+                    break;
+                 Deleted = true;
+                 DeletedMB += max(SizeMB, 0);
                  Recordings->Del(r0);
                  Recordings->SetModified();
-                 return;
                  }
-              }
+           if (Deleted)
+              return;
            // Unable to free disk space, but there's nothing we can do about that...
-           isyslog("...no old recording found, giving up");
+           if (Log)
+              isyslog("...no old recording found, giving up");
            }
         else
            isyslog("...no deleted recording found, priority %d too low to trigger deleting an old recording", Priority);
-        Skins.QueueMessage(mtWarning, tr("Low disk space!"), 5, -1);
+        if (LowDiskSpace)
+           Skins.QueueMessage(mtWarning, tr("Low disk space!"), 5, -1);
         }
+     else
+        ShortForUpcoming = false;
      LastFreeDiskCheck = time(NULL);
      }
 }
 
+void AssertFreeDiskSpace(int Priority, bool Force)
+{
+  CheckFreeDiskSpace(Priority, Force, true);
+}
+
+void PrepareFreeDiskSpace(void)
+{
+  CheckFreeDiskSpace(0, false, false);
+}
+
 // --- cResumeFile -----------------------------------------------------------
 
 cResumeFile::cResumeFile(const char *FileName, bool IsPesRecording)
@@ -775,6 +1026,10 @@ cRecording::cRecording(cTimer *Timer, const cEvent *Event)
   framesPerSecond = DEFAULTFRAMESPERSECOND;
   numFrames = -1;
   deleted = 0;
+  dirModified = 0;
+  dirInode = 0;
+  resumeModified = 0;
+  indexModified = 0;
   // set up the actual name:
   const char *Title = Event ? Event->Title() : NULL;
   const char *Subtitle = Event ? Event->ShortText() : NULL;
@@ -815,7 +1070,7 @@ cRecording::cRecording(cTimer *Timer, const cEvent *Event)
   info->lifetime = lifetime;
 }
 
-cRecording::cRecording(const char *FileName)
+bool cRecording::ParseFileName(const char *FileName)
 {
   id = 0;
   resume = RESUME_NOT_INITIALIZED;
@@ -829,6 +1084,10 @@ cRecording::cRecording(const char *FileName)
   framesPerSecond = DEFAULTFRAMESPERSECOND;
   numFrames = -1;
   deleted = 0;
+  dirModified = 0;
+  dirInode = 0;
+  resumeModified = 0;
+  indexModified = 0;
   titleBuffer = NULL;
   sortBufferName = sortBufferTime = NULL;
   FileName = fileName = strdup(FileName);
@@ -856,9 +1115,28 @@ cRecording::cRecording(const char *FileName)
         name[p - FileName] = 0;
         name = ExchangeChars(name, false);
         isPesRecording = instanceId < 0;
+        return true;
         }
-     else
-        return;
+     }
+  return false;
+}
+
+cRecording::cRecording(const char *FileName, FILE *InfoFile)
+{
+  if (ParseFileName(FileName)) {
+     if (!info->Read(InfoFile))
+        esyslog("ERROR: EPG data problem in recordings cache for %s", fileName);
+     else if (!isPesRecording) {
+        priority = info->priority;
+        lifetime = info->lifetime;
+        framesPerSecond = info->framesPerSecond;
+        }
+     }
+}
+
+cRecording::cRecording(const char *FileName)
+{
+  if (ParseFileName(FileName)) {
      GetResume();
      // read an optional info file:
      cString InfoFileName = cString::sprintf("%s%s", fileName, isPesRecording ? INFOFILESUFFIX ".vdr" : INFOFILESUFFIX);
@@ -1294,7 +1572,8 @@ bool cRecording::Remove(void)
      return false;
      }
   isyslog("removing recording %s", FileName());
-  return cVideoDirectory::RemoveVideoFile(FileName());
+  RecordingRemover.Add(FileName(), FileSizeMB());
+  return true;
 }
 
 bool cRecording::Undelete(void)
@@ -1369,6 +1648,269 @@ int cRecording::FileSizeMB(void) const
   return fileSizeMB;
 }
 
+// --- cRecordingsCache ------------------------------------------------------
+
+// Creating the list of recordings requires reading several files of each
+// recording, which can take quite a while with a large number of recordings
+// (especially on a network file system). Therefore the relevant data of all
+// recordings is stored in a cache file in the video directory, from which the
+// list can be created at startup without accessing the individual recordings.
+// Each entry is validated against the modification time and inode of the
+// recording's directory, and the modification times of its resume and index
+// file, when the video directory is scanned in the background.
+
+static time_t ResumeModifiedTime(const char *FileName, bool IsPesRecording)
+{
+  cResumeFile ResumeFile(FileName, IsPesRecording);
+  return ResumeFile.FileName() ? LastModifiedTime(ResumeFile.FileName()) : 0;
+}
+
+static time_t IndexModifiedTime(const char *FileName, bool IsPesRecording)
+{
+  return LastModifiedTime(cIndexFile::IndexFileName(FileName, IsPesRecording));
+}
+
+#define RECORDINGSCACHEFILE     ".recordings"
+#define RECORDINGSCACHEVERSION  2
+
+class cRecordingsCache {
+private:
+  static cMutex mutex;
+  static int state;
+  static cString FileName(void);
+public:
+  static bool Load(void);
+       ///< Adds the recordings stored in the cache file to the list of recordings.
+       ///< Returns true if the cache file could be read.
+  static void Save(void);
+       ///< Writes all recordings that are completely known to the cache file,
+       ///< if the list has been modified since it was last loaded or saved.
+  static void SetModified(void) { state = -1; }
+       ///< Makes the next call to Save() actually write the cache file, even if
+       ///< the list itself hasn't been modified (e.g. if a resume file has changed).
+  };
+
+cMutex cRecordingsCache::mutex;
+int cRecordingsCache::state = -1;
+
+cString cRecordingsCache::FileName(void)
+{
+  return AddDirectory(cVideoDirectory::Name(), RECORDINGSCACHEFILE);
+}
+
+bool cRecordingsCache::Load(void)
+{
+  cString CacheFileName = FileName();
+  FILE *f = fopen(CacheFileName, "r");
+  if (!f) {
+     if (errno != ENOENT)
+        LOG_ERROR_STR(*CacheFileName);
+     return false;
+     }
+  cTimeMs Time;
+  cVector<cRecording *> Loaded(1000);
+  cReadLine ReadLine;
+  cDynamicBuffer Info;
+  cString RecordingName;
+  int Version = 0;
+  long long Modified = 0;
+  unsigned long long Inode = 0;
+  long long ResumeModified = 0;
+  long long IndexModified = 0;
+  int NumFrames = -1;
+  int FileSizeMB = -1;
+  int Resume = 0;
+  int OnVideoDirectoryFileSystem = -1;
+  int Line = 0;
+  bool Ok = true;
+  char *s;
+  while (Ok && (s = ReadLine.Read(f)) != NULL) {
+        Line++;
+        if (Line == 1) {
+           if (sscanf(s, "V %d", &Version) != 1 || Version != RECORDINGSCACHEVERSION) {
+              isyslog("ignoring recordings cache %s (version %d)", *CacheFileName, Version);
+              break;
+              }
+           continue;
+           }
+        switch (*s) {
+          case 'R': {
+                    int n = 0;
+                    if (sscanf(s + 1, "%lld %llu %lld %lld %d %d %d %d %n", &Modified, &Inode, &ResumeModified, &IndexModified, &NumFrames, &FileSizeMB, &Resume, &OnVideoDirectoryFileSystem, &n) == 8 && n > 0 && s[n + 1]) {
+                       RecordingName = AddDirectory(cVideoDirectory::Name(), s + n + 1);
+                       Info.Clear();
+                       }
+                    else
+                       Ok = false;
+                    }
+                    break;
+          case 'I': if (*RecordingName && s[1] == ' ') {
+                       Info.Append((const uchar *)s + 2, strlen(s + 2));
+                       Info.Append('\n');
+                       }
+                    else
+                       Ok = false;
+                    break;
+          case 'r': if (*RecordingName) {
+                       Info.Append(0);
+                       if (FILE *InfoFile = fmemopen(Info.Data(), Info.Length() - 1, "r")) {
+                          cRecording *r = new cRecording(RecordingName, InfoFile);
+                          fclose(InfoFile);
+                          if (r->Name()) {
+                             r->numFrames = NumFrames;
+                             r->fileSizeMB = FileSizeMB;
+                             r->resume = Resume;
+                             r->isOnVideoDirectoryFileSystem = OnVideoDirectoryFileSystem;
+                             r->dirModified = Modified;
+                             r->dirInode = Inode;
+                             r->resumeModified = ResumeModified;
+                             r->indexModified = IndexModified;
+                             Loaded.Append(r);
+                             }
+                          else
+                             delete r;
+                          }
+                       RecordingName = NULL;
+                       }
+                    else
+                       Ok = false;
+                    break;
+          default: Ok = false;
+          }
+        }
+  fclose(f);
+  if (!Ok)
+     esyslog("ERROR: recordings cache %s corrupted in line %d", *CacheFileName, Line);
+  if (Loaded.Size()) {
+     {
+       LOCK_RECORDINGS_WRITE;
+       for (int i = 0; i < Loaded.Size(); i++)
+           Recordings->Add(Loaded[i]);
+     }
+     LOCK_RECORDINGS_READ;
+     state = Recordings->State();
+     }
+  dsyslog("read %d recordings from %s in %d ms", Loaded.Size(), *CacheFileName, int(Time.Elapsed()));
+  return Ok && Version == RECORDINGSCACHEVERSION;
+}
+
+void cRecordingsCache::Save(void)
+{
+  cMutexLock MutexLock(&mutex);
+  // The data is collected in memory, so that the list doesn't have to be
+  // locked while the file is being written:
+  char *Buffer = NULL;
+  size_t Size = 0;
+  int n = 0;
+  {
+    LOCK_RECORDINGS_READ;
+    if (Recordings->State() == state)
+       return;
+    state = Recordings->State();
+    FILE *f = open_memstream(&Buffer, &Size);
+    if (!f) {
+       LOG_ERROR;
+       return;
+       }
+    int l = strlen(cVideoDirectory::Name());
+    fprintf(f, "V %d\n", RECORDINGSCACHEVERSION);
+    for (const cRecording *r = Recordings->First(); r; r = Recordings->Next(r)) {
+        if (r->numFrames < 0 || r->fileSizeMB < 0)
+           continue; // not yet completely known (or still being recorded)
+        if (strncmp(r->FileName(), cVideoDirectory::Name(), l) != 0 || r->FileName()[l] != '/')
+           continue;
+        time_t DirModified = r->dirModified;
+        ino_t DirInode = r->dirInode;
+        time_t ResumeModified = r->resumeModified;
+        time_t IndexModified = r->indexModified;
+        if (!DirInode) {
+           // The stamp is only stored in the recording by the video directory scanner,
+           // which holds a write lock:
+           struct stat st;
+           if (stat(r->FileName(), &st) != 0)
+              continue;
+           DirModified = st.st_mtime;
+           DirInode = st.st_ino;
+           ResumeModified = ResumeModifiedTime(r->FileName(), r->IsPesRecording());
+           IndexModified = IndexModifiedTime(r->FileName(), r->IsPesRecording());
+           }
+        fprintf(f, "R %lld %llu %lld %lld %d %d %d %d %s\n", (long long)DirModified, (unsigned long long)DirInode, (long long)ResumeModified, (long long)IndexModified, r->numFrames, r->fileSizeMB, r->GetResume(), r->IsOnVideoDirectoryFileSystem(), r->FileName() + l + 1);
+        r->Info()->Write(f, "I ");
+        fprintf(f, "r\n");
+        n++;
+        }
+    fclose(f);
+  }
+  cString CacheFileName = FileName();
+  cSafeFile CacheFile(CacheFileName);
+  if (CacheFile.Open()) {
+     if (fwrite(Buffer, Size, 1, CacheFile) != 1)
+        LOG_ERROR_STR(*CacheFileName);
+     CacheFile.Close();
+     dsyslog("wrote %d recordings to %s", n, *CacheFileName);
+     }
+  free(Buffer);
+}
+
+// --- cRecordingStamp -------------------------------------------------------
+
+void cRecording::SetStamp(const struct stat &st)
+{
+  dirModified = st.st_mtime;
+  dirInode = st.st_ino;
+  resumeModified = ResumeModifiedTime(FileName(), IsPesRecording());
+  indexModified = IndexModifiedTime(FileName(), IsPesRecording());
+}
+
+class cRecordingStamp : public cListObject {
+private:
+  char *fileName;
+  bool isPesRecording;
+  time_t modified;
+  ino_t inode;
+  time_t resumeModified;
+  time_t indexModified;
+public:
+  cRecordingStamp(const cRecording *Recording);
+  ~cRecordingStamp();
+  const char *FileName(void) const { return fileName; }
+  bool Matches(const struct stat &st) const;
+       ///< Returns true if the recording's directory still has the modification
+       ///< time and inode it had when the recording was read, and its resume and
+       ///< index file haven't been modified since then.
+  static unsigned int Hash(const char *FileName);
+  };
+
+cRecordingStamp::cRecordingStamp(const cRecording *Recording)
+{
+  fileName = strdup(Recording->FileName());
+  isPesRecording = Recording->IsPesRecording();
+  modified = Recording->dirModified;
+  inode = Recording->dirInode;
+  resumeModified = Recording->resumeModified;
+  indexModified = Recording->indexModified;
+}
+
+bool cRecordingStamp::Matches(const struct stat &st) const
+{
+  return st.st_mtime == modified && st.st_ino == inode
+      && ResumeModifiedTime(fileName, isPesRecording) == resumeModified
+      && IndexModifiedTime(fileName, isPesRecording) == indexModified;
+}
+
+cRecordingStamp::~cRecordingStamp()
+{
+  free(fileName);
+}
+
+unsigned int cRecordingStamp::Hash(const char *FileName)
+{
+  unsigned int h = 2166136261u; // FNV-1a
+  while (*FileName)
+        h = (h ^ uchar(*FileName++)) * 16777619u;
+  return h;
+}
+
 // --- cVideoDirectoryScannerThread ------------------------------------------
 
 class cVideoDirectoryScannerThread : public cThread {
@@ -1377,6 +1919,10 @@ private:
   cRecordings *deletedRecordings;
   int count;
   bool initial;
+  bool cacheLoaded;
+  cHash<cRecordingStamp> stamps;
+  const cRecordingStamp *GetStamp(const char *FileName);
+  void RefreshRecording(const char *FileName, const struct stat &st);
   void ScanVideoDir(const char *DirName, int LinkLevel = 0, int DirLevel = 0);
 protected:
   virtual void Action(void);
@@ -1387,11 +1933,13 @@ public:
 
 cVideoDirectoryScannerThread::cVideoDirectoryScannerThread(cRecordings *Recordings, cRecordings *DeletedRecordings)
 :cThread("video directory scanner", true)
+,stamps(HASHSIZE, true)
 {
   recordings = Recordings;
   deletedRecordings = DeletedRecordings;
   count = 0;
   initial = true;
+  cacheLoaded = false;
 }
 
 cVideoDirectoryScannerThread::~cVideoDirectoryScannerThread()
@@ -1399,17 +1947,65 @@ cVideoDirectoryScannerThread::~cVideoDirectoryScannerThread()
   Cancel(3);
 }
 
+const cRecordingStamp *cVideoDirectoryScannerThread::GetStamp(const char *FileName)
+{
+  unsigned int Hash = cRecordingStamp::Hash(FileName);
+  int Index;
+  for (const cRecordingStamp *Stamp = stamps.First(Hash, Index); Stamp; Stamp = stamps.Next(Hash, Index)) {
+      if (strcmp(Stamp->FileName(), FileName) == 0)
+         return Stamp;
+      }
+  return NULL;
+}
+
+void cVideoDirectoryScannerThread::RefreshRecording(const char *FileName, const struct stat &st)
+{
+  cStateKey StateKey;
+  recordings->Lock(StateKey, true);
+  if (cRecording *r = recordings->GetByName(FileName)) {
+     dsyslog("refreshing recording %s", FileName);
+     r->ReadInfo();
+     r->ResetResume();
+     r->numFrames = -1;
+     r->fileSizeMB = -1;
+     r->NumFrames();
+     r->FileSizeMB();
+     r->SetStamp(st);
+     }
+  StateKey.Remove();
+}
+
 void cVideoDirectoryScannerThread::Action(void)
 {
+  if (!cacheLoaded) {
+     cacheLoaded = true;
+     cRecordingsCache::Load();
+     }
   cStateKey StateKey;
-  recordings->Lock(StateKey);
+  recordings->Lock(StateKey, true);
   count = recordings->Count();
   initial = count == 0; // no name checking if the list is initially empty
-  StateKey.Remove();
+  if (!initial) {
+     // Remember the known recordings, to quickly check whether they are still valid:
+     for (cRecording *r = recordings->First(); r; r = recordings->Next(r)) {
+         if (!r->dirInode && r->numFrames >= 0 && r->fileSizeMB >= 0) {
+            // a recording that was added after the last scan (and is no longer being recorded):
+            struct stat st;
+            if (stat(r->FileName(), &st) == 0)
+               r->SetStamp(st);
+            }
+         if (r->dirInode)
+            stamps.Add(new cRecordingStamp(r), cRecordingStamp::Hash(r->FileName()));
+         }
+     }
+  StateKey.Remove(false); // setting the stamps doesn't count as a real modification
   deletedRecordings->Lock(StateKey, true);
   deletedRecordings->Clear();
   StateKey.Remove();
   ScanVideoDir(cVideoDirectory::Name());
+  stamps.Clear();
+  if (Running())
+     cRecordingsCache::Save();
 }
 
 void cVideoDirectoryScannerThread::ScanVideoDir(const char *DirName, int LinkLevel, int DirLevel)
@@ -1439,7 +2035,12 @@ void cVideoDirectoryScannerThread::ScanVideoDir(const char *DirName, int LinkLev
                  Recordings = recordings;
               else if (endswith(buffer, DELEXT))
                  Recordings = deletedRecordings;
-              if (Recordings) {
+              const cRecordingStamp *Stamp = (Recordings == recordings && !initial) ? GetStamp(buffer) : NULL;
+              if (Stamp) {
+                 if (!Stamp->Matches(st))
+                    RefreshRecording(buffer, st);
+                 }
+              else if (Recordings) {
                  cStateKey StateKey;
                  Recordings->Lock(StateKey, true);
                  if (initial && count != recordings->Count()) {
@@ -1452,6 +2053,7 @@ void cVideoDirectoryScannerThread::ScanVideoDir(const char *DirName, int LinkLev
                        r->NumFrames(); // initializes the numFrames member
                        r->FileSizeMB(); // initializes the fileSizeMB member
                        r->IsOnVideoDirectoryFileSystem(); // initializes the isOnVideoDirectoryFileSystem member
+                       r->SetStamp(st);
                        if (Recordings == deletedRecordings)
                           r->SetDeleted();
                        Recordings->Add(r);
@@ -1471,13 +2073,16 @@ void cVideoDirectoryScannerThread::ScanVideoDir(const char *DirName, int LinkLev
   if (!initial && DirLevel == 0) {
      cStateKey StateKey;
      recordings->Lock(StateKey, true);
+     bool Vanished = false;
      for (cRecording *Recording = recordings->First(); Recording; ) {
          cRecording *r = Recording;
          Recording = recordings->Next(Recording);
-         if (access(r->FileName(), F_OK) != 0)
+         if (access(r->FileName(), F_OK) != 0) {
             recordings->Del(r);
+            Vanished = true;
+            }
          }
-     StateKey.Remove();
+     StateKey.Remove(Vanished);
      }
 }
 
@@ -1493,6 +2098,10 @@ time_t cRecordings::lastUpdate = 0;
 cRecordings::cRecordings(bool Deleted)
 :cList<cRecording>(Deleted ? "4 DelRecs" : "3 Recordings")
 {
+  totalsState = -1;
+  totalsTime = 0;
+  totalFileSizeMB = 0;
+  mbPerMinute = -1;
 }
 
 cRecordings::~cRecordings()
@@ -1525,6 +2134,11 @@ bool cRecordings::NeedsUpdate(void)
   return lastUpdate < lastModified;
 }
 
+void cRecordings::SaveCache(void)
+{
+  cRecordingsCache::Save();
+}
+
 void cRecordings::Update(bool Wait)
 {
   if (!videoDirectoryScannerThread)
@@ -1600,25 +2214,18 @@ void cRecordings::UpdateByName(const char *FileName)
      Recording->ReadInfo();
 }
 
-int cRecordings::TotalFileSizeMB(void) const
-{
-  int size = 0;
-  for (const cRecording *Recording = First(); Recording; Recording = Next(Recording)) {
-      int FileSizeMB = Recording->FileSizeMB();
-      if (FileSizeMB > 0 && Recording->IsOnVideoDirectoryFileSystem())
-         size += FileSizeMB;
-      }
-  return size;
-}
-
-double cRecordings::MBperMinute(void) const
+void cRecordings::UpdateTotals(void) const
 {
+  if (totalsState == State() && time(NULL) - totalsTime <= TOTALSUPDATEDELTA)
+     return;
+  int total = 0;
   int size = 0;
   int length = 0;
   for (const cRecording *Recording = First(); Recording; Recording = Next(Recording)) {
       if (Recording->IsOnVideoDirectoryFileSystem()) {
          int FileSizeMB = Recording->FileSizeMB();
          if (FileSizeMB > 0) {
+            total += FileSizeMB;
             int LengthInSeconds = Recording->LengthInSeconds();
             if (LengthInSeconds > 0) {
                if (LengthInSeconds / FileSizeMB < LIMIT_SECS_PER_MB_RADIO) { // don't count radio recordings
@@ -1629,7 +2236,24 @@ double cRecordings::MBperMinute(void) const
             }
          }
       }
-  return (size && length) ? double(size) * 60 / length : -1;
+  totalFileSizeMB = total;
+  mbPerMinute = (size && length) ? double(size) * 60 / length : -1;
+  totalsState = State();
+  totalsTime = time(NULL);
+}
+
+int cRecordings::TotalFileSizeMB(void) const
+{
+  cMutexLock MutexLock(&totalsMutex);
+  UpdateTotals();
+  return totalFileSizeMB;
+}
+
+double cRecordings::MBperMinute(void) const
+{
+  cMutexLock MutexLock(&totalsMutex);
+  UpdateTotals();
+  return mbPerMinute;
 }
 
 int cRecordings::PathIsInUse(const char *Path) const
@@ -1674,6 +2298,8 @@ bool cRecordings::MoveRecordings(const char *OldPath, const char *NewPath)
 
 void cRecordings::ResetResume(const char *ResumeFileName)
 {
+  if (this == &recordings)
+     cRecordingsCache::SetModified();
   for (cRecording *Recording = First(); Recording; Recording = Next(Recording)) {
       if (!ResumeFileName || strncmp(ResumeFileName, Recording->FileName(), strlen(Recording->FileName())) == 0)
          Recording->ResetResume();
@@ -47,6 +47,15 @@ void AssertFreeDiskSpace(int Priority = 0, bool Force = false);
      ///< deleted recordings faster than normal (because we're cutting).
      ///< If Force is true, the check will be done even if the timeout
      ///< hasn't expired yet.
+     ///< Besides keeping a minimum amount of free disk space, this also tries to
+     ///< stay ahead of the disk space the ongoing and upcoming recordings are
+     ///< expected to need (based on the data rates of the active recorders and
+     ///< the timer schedule), by removing "deleted" recordings and recordings with
+     ///< an expired lifetime in advance.
+void PrepareFreeDiskSpace(void);
+     ///< Same as AssertFreeDiskSpace(), but for the time when no recording is
+     ///< going on. Only frees disk space for upcoming recordings, and only by
+     ///< removing "deleted" recordings and recordings with an expired lifetime.
 
 class cResumeFile {
 private:
@@ -58,6 +67,7 @@ public:
   int Read(void);
   bool Save(int Index);
   void Delete(void);
+  const char *FileName(void) const { return fileName; }
   };
 
 class cRecordingInfo {
@@ -97,6 +107,9 @@ public:
 
 class cRecording : public cListObject {
   friend class cRecordings;
+  friend class cRecordingsCache;
+  friend class cVideoDirectoryScannerThread;
+  friend class cRecordingStamp;
 private:
   int id;
   mutable int resume;
@@ -111,10 +124,22 @@ private:
   int instanceId;
   bool isPesRecording;
   mutable int isOnVideoDirectoryFileSystem; // -1 = unknown, 0 = no, 1 = yes
+  time_t dirModified; // modification time and inode of the recording's directory,
+  ino_t dirInode;     // used to validate the entry in the recordings cache (0 = unknown)
+  time_t resumeModified; // modification times of the resume and index file (0 = none), which
+  time_t indexModified;  // can change without changing the directory's modification time
+  void SetStamp(const struct stat &st);
+       ///< Stores the modification time and inode of the recording's directory
+       ///< (as given in st), as well as the current modification times of its
+       ///< resume and index file.
   double framesPerSecond;
   cRecordingInfo *info;
   cRecording(const cRecording&); // can't copy cRecording
   cRecording &operator=(const cRecording &); // can't assign cRecording
+  cRecording(const char *FileName, FILE *InfoFile);
+       ///< Creates a recording from an entry in the recordings cache. The info data
+       ///< is read from InfoFile, and no other files of the recording are accessed.
+  bool ParseFileName(const char *FileName);
   static char *StripEpisodeName(char *s, bool Strip);
   char *SortName(void) const;
   void ClearSortName(void);
@@ -231,6 +256,15 @@ private:
   static time_t lastUpdate;
   static cVideoDirectoryScannerThread *videoDirectoryScannerThread;
   static const char *UpdateFileName(void);
+  mutable cMutex totalsMutex;
+  mutable int totalsState;
+  mutable time_t totalsTime;
+  mutable int totalFileSizeMB;
+  mutable double mbPerMinute;
+  void UpdateTotals(void) const;
+       ///< Recalculates the values returned by TotalFileSizeMB() and MBperMinute()
+       ///< if the list has been modified, or the values are older than
+       ///< TOTALSUPDATEDELTA (the sizes of ongoing recordings keep growing).
 public:
   cRecordings(bool Deleted = false);
   virtual ~cRecordings();
@@ -255,6 +289,11 @@ public:
        ///< instances of VDR that access the same video directory can be triggered
        ///< to update their recordings list.
   static bool NeedsUpdate(void);
+  static void SaveCache(void);
+       ///< Writes the data of all recordings to a cache file in the video directory
+       ///< (if it has changed), from which the list of recordings will be read at
+       ///< the next startup. The cache is also written whenever a scan of the video
+       ///< directory has been completed.
   void ResetResume(const char *ResumeFileName = NULL);
   void ClearSortNames(void);
   const cRecording *GetById(int Id) const;
@@ -266,6 +305,8 @@ public:
   void DelByName(const char *FileName);
   void UpdateByName(const char *FileName);
   int TotalFileSizeMB(void) const;
+       ///< Returns the total size (in MB) of all recordings on the video directory
+       ///< file system.
   double MBperMinute(void) const;
        ///< Returns the average data rate (in MB/min) of all recordings, or -1 if
        ///< this value is unknown.
@@ -12,6 +12,7 @@
 
 #include "ringbuffer.h"
 #include <stdlib.h>
+#include <sys/mman.h>
 #include <unistd.h>
 #include "tools.h"
 
@@ -28,6 +29,7 @@ cRingBuffer::cRingBuffer(int Size, bool Statistics)
   size = Size;
   statistics = Statistics;
   getThreadTid = 0;
+  getThreshold = Size / 10;
   maxFill = 0;
   lastPercent = 0;
   putTimeout = getTimeout = 0;
@@ -82,7 +84,7 @@ void cRingBuffer::EnablePut(void)
 
 void cRingBuffer::EnableGet(void)
 {
-  if (getTimeout && Available() > Size() / 10)
+  if (getTimeout && Available() > getThreshold)
      readyForGet.Signal();
 }
 
@@ -389,6 +391,224 @@ void cRingBufferLinear::Del(int Count)
 #endif
 }
 
+// --- cRingBufferMirrored ---------------------------------------------------
+
+cRingBufferMirrored::cRingBufferMirrored(int Size, int Margin, int GetThreshold, bool Statistics, const char *Description)
+:cRingBuffer(PageAligned(Size), Statistics)
+{
+  description = Description ? strdup(Description) : NULL;
+  margin = max(Margin, 1);
+  if (GetThreshold > 0)
+     getThreshold = GetThreshold;
+  head = tail = 0;
+  gotten = 0;
+  buffer = NULL;
+  mirrored = false;
+  lastDecile = 0;
+  memset(histogram, 0, sizeof(histogram));
+  Size = this->Size();
+  // Map the same memory twice in a row, so that data which wraps around the end
+  // of the buffer is also accessible as one consecutive block:
+  int fd = memfd_create(Description ? Description : "ring buffer", 0);
+  if (fd >= 0) {
+     if (ftruncate(fd, Size) == 0) {
+        void *p = mmap(NULL, 2 * Size, PROT_NONE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+        if (p != MAP_FAILED) {
+           if (mmap(p, Size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_FIXED, fd, 0) != MAP_FAILED && mmap((uchar *)p + Size, Size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_FIXED, fd, 0) != MAP_FAILED) {
+              buffer = (uchar *)p;
+              mirrored = true;
+              }
+           else
+              munmap(p, 2 * Size);
+           }
+        }
+     close(fd);
+     }
+  if (!buffer) {
+     // Fall back to copying the data into both halves of a plain buffer:
+     dsyslog("can't map ring buffer twice (%s) - using copies", Description ? Description : "");
+     buffer = MALLOC(uchar, 2 * Size);
+     if (!buffer)
+        esyslog("ERROR: can't allocate ring buffer (size=%d)", Size);
+     }
+}
+
+cRingBufferMirrored::~cRingBufferMirrored()
+{
+  if (statistics) {
+     uint Total = 0;
+     for (int i = 0; i < RINGBUFFERHISTOGRAMSIZE; i++)
+         Total += histogram[i];
+     if (Total) {
+        cString s = "";
+        for (int i = 0; i < RINGBUFFERHISTOGRAMSIZE; i++)
+            s = cString::sprintf("%s %d%%", *s, int(uint64_t(histogram[i]) * 100 / Total));
+        dsyslog("buffer fill histogram (%s):%s", description ? description : "", *s);
+        }
+     }
+  if (mirrored)
+     munmap(buffer, 2 * Size());
+  else
+     free(buffer);
+  free(description);
+}
+
+int cRingBufferMirrored::PageAligned(int Size)
+{
+  int PageSize = getpagesize();
+  return max((Size + PageSize - 1) / PageSize * PageSize, PageSize);
+}
+
+void cRingBufferMirrored::Mirror(int Offset, int Count)
+{
+  if (!mirrored) {
+     int n = min(Count, Size() - Offset);
+     memcpy(buffer + Size() + Offset, buffer + Offset, n);
+     if (Count > n)
+        memcpy(buffer, buffer + Size(), Count - n);
+     }
+}
+
+void cRingBufferMirrored::Stored(int Count, int Tail)
+{
+  int Head = head + Count;
+  if (Head >= Size())
+     Head -= Size();
+  __atomic_store_n(&head, Head, __ATOMIC_RELEASE);
+  int Fill = Head - Tail;
+  if (Fill < 0)
+     Fill += Size();
+  if (statistics) {
+     histogram[min(Fill * RINGBUFFERHISTOGRAMSIZE / Size(), RINGBUFFERHISTOGRAMSIZE - 1)]++;
+     if (Fill > maxFill)
+        maxFill = Fill;
+     int Decile = Fill * 10 / Size();
+     if (Decile != lastDecile) { // avoids unnecessary locking in cIoThrottle
+        UpdatePercentage(Fill);
+        lastDecile = Decile;
+        }
+     }
+  if (Fill > getThreshold && Fill - Count <= getThreshold)
+     EnableGet(); // wake up the reader only once per batch
+}
+
+int cRingBufferMirrored::DataReady(const uchar *Data, int Count)
+{
+  return Count >= margin ? Count : 0;
+}
+
+int cRingBufferMirrored::Available(void)
+{
+  int diff = __atomic_load_n(&head, __ATOMIC_ACQUIRE) - __atomic_load_n(&tail, __ATOMIC_ACQUIRE);
+  return (diff >= 0) ? diff : Size() + diff;
+}
+
+void cRingBufferMirrored::Clear(void)
+{
+  __atomic_store_n(&tail, __atomic_load_n(&head, __ATOMIC_ACQUIRE), __ATOMIC_RELEASE);
+  maxFill = 0;
+  EnablePut();
+}
+
+int cRingBufferMirrored::Read(int FileHandle, int Max)
+{
+  int Tail = __atomic_load_n(&tail, __ATOMIC_ACQUIRE);
+  int free = Tail - head - 1;
+  if (free < 0)
+     free += Size();
+  int Count = -1;
+  errno = EAGAIN;
+  if (buffer && free > 0) {
+     if (0 < Max && Max < free)
+        free = Max;
+     Count = safe_read(FileHandle, buffer + head, free);
+     if (Count > 0) {
+        Mirror(head, Count);
+        Stored(Count, Tail);
+        }
+     }
+  if (free == 0)
+     WaitForPut();
+  return Count;
+}
+
+int cRingBufferMirrored::Read(cUnbufferedFile *File, int Max)
+{
+  int Tail = __atomic_load_n(&tail, __ATOMIC_ACQUIRE);
+  int free = Tail - head - 1;
+  if (free < 0)
+     free += Size();
+  int Count = -1;
+  errno = EAGAIN;
+  if (buffer && free > 0) {
+     if (0 < Max && Max < free)
+        free = Max;
+     Count = File->Read(buffer + head, free);
+     if (Count > 0) {
+        Mirror(head, Count);
+        Stored(Count, Tail);
+        }
+     }
+  if (free == 0)
+     WaitForPut();
+  return Count;
+}
+
+int cRingBufferMirrored::Put(const uchar *Data, int Count)
+{
+  if (Count > 0) {
+     int Tail = __atomic_load_n(&tail, __ATOMIC_ACQUIRE);
+     int free = Tail - head - 1;
+     if (free < 0)
+        free += Size();
+     if (free > 0 && buffer) {
+        if (free < Count)
+           Count = free;
+        memcpy(buffer + head, Data, Count);
+        Mirror(head, Count);
+        Stored(Count, Tail);
+        }
+     else
+        Count = 0;
+     if (Count == 0)
+        WaitForPut();
+     }
+  return Count;
+}
+
+uchar *cRingBufferMirrored::Get(int &Count)
+{
+  if (getThreadTid <= 0)
+     getThreadTid = cThread::ThreadId();
+  int diff = __atomic_load_n(&head, __ATOMIC_ACQUIRE) - tail;
+  int cont = (diff >= 0) ? diff : Size() + diff;
+  uchar *p = buffer + tail;
+  if (buffer && (cont = DataReady(p, cont)) > 0) {
+     Count = gotten = cont;
+     return p;
+     }
+  WaitForGet();
+  return NULL;
+}
+
+void cRingBufferMirrored::Del(int Count)
+{
+  if (Count > gotten) {
+     esyslog("ERROR: invalid Count in cRingBufferMirrored::Del: %d (limited to %d)", Count, gotten);
+     Count = gotten;
+     }
+  if (Count > 0) {
+     int Tail = tail + Count;
+     gotten -= Count;
+     if (Tail >= Size())
+        Tail -= Size();
+     __atomic_store_n(&tail, Tail, __ATOMIC_RELEASE);
+     int Free = Size() - Available() - 1;
+     if (Free > Size() / 10 && Free - Count <= Size() / 10)
+        EnablePut(); // wake up the writer only once per batch
+     }
+}
+
 // --- cFrame ----------------------------------------------------------------
 
 cFrame::cFrame(const uchar *Data, int Count, eFrameType Type, int Index, uint32_t Pts, bool Independent)
@@ -502,3 +722,97 @@ int cRingBufferFrame::Available(void)
   Unlock();
   return av;
 }
+
+// --- cRingBufferFramePool --------------------------------------------------
+
+cRingBufferFramePool::cRingBufferFramePool(int Size, int MaxFrames, bool Statistics)
+:cRingBuffer(Size, Statistics)
+{
+  numFrames = MaxFrames + 1; // one frame slot always remains empty
+  frames = new cFrame[numFrames];
+  buffer = MALLOC(uchar, Size);
+  if (!buffer)
+     esyslog("ERROR: can't allocate ring buffer (size=%d)", Size);
+  frameHead = frameTail = 0;
+  head = tail = 0;
+  putBytes = dropBytes = 0;
+}
+
+cRingBufferFramePool::~cRingBufferFramePool()
+{
+  for (int i = 0; i < numFrames; i++)
+      frames[i].data = NULL; // the data belongs to buffer
+  delete[] frames;
+  free(buffer);
+}
+
+void cRingBufferFramePool::Clear(void)
+{
+  frameHead = frameTail = 0;
+  head = tail = 0;
+  putBytes = dropBytes = 0;
+  EnablePut();
+  EnableGet();
+}
+
+bool cRingBufferFramePool::Put(const uchar *Data, int Count, eFrameType Type, int Index, uint32_t Pts, bool Independent)
+{
+  if (!buffer || Count <= 0)
+     return false;
+  int NextHead = (frameHead + 1) % numFrames;
+  if (NextHead == __atomic_load_n(&frameTail, __ATOMIC_ACQUIRE))
+     return false; // no free frame slot
+  int Tail = __atomic_load_n(&tail, __ATOMIC_ACQUIRE);
+  // The data of the stored frames lies in [Tail, head), or in [Tail, Size()) and [0, head) if
+  // head < Tail. Since a frame's data is never split, the end of the buffer may remain unused:
+  int Offset = -1;
+  if (head >= Tail) {
+     if (head + Count <= Size())
+        Offset = head;
+     else if (Count < Tail)
+        Offset = 0;
+     }
+  else if (head + Count < Tail)
+     Offset = head;
+  if (Offset < 0)
+     return false;
+  cFrame *Frame = &frames[frameHead];
+  Frame->data = buffer + Offset;
+  Frame->count = Count;
+  Frame->type = Type;
+  Frame->index = Index;
+  Frame->pts = Pts;
+  Frame->independent = Type == ftAudio ? true : Independent;
+  memcpy(Frame->data, Data, Count);
+  head = Offset + Count;
+  __atomic_store_n(&putBytes, putBytes + Count, __ATOMIC_RELAXED);
+  __atomic_store_n(&frameHead, NextHead, __ATOMIC_RELEASE);
+  if (statistics)
+     UpdatePercentage(Available());
+  EnableGet();
+  return true;
+}
+
+cFrame *cRingBufferFramePool::Get(void)
+{
+  if (frameTail != __atomic_load_n(&frameHead, __ATOMIC_ACQUIRE))
+     return &frames[frameTail];
+  return NULL;
+}
+
+void cRingBufferFramePool::Drop(cFrame *Frame)
+{
+  if (frameTail != __atomic_load_n(&frameHead, __ATOMIC_ACQUIRE) && Frame == &frames[frameTail]) {
+     __atomic_store_n(&dropBytes, dropBytes + Frame->count, __ATOMIC_RELAXED);
+     __atomic_store_n(&tail, int(Frame->data - buffer) + Frame->count, __ATOMIC_RELEASE);
+     __atomic_store_n(&frameTail, (frameTail + 1) % numFrames, __ATOMIC_RELEASE);
+     }
+  else
+     esyslog("ERROR: attempt to drop wrong frame from ring buffer!");
+  EnablePut();
+}
+
+int cRingBufferFramePool::Available(void)
+{
+  return __atomic_load_n(&putBytes, __ATOMIC_RELAXED) - __atomic_load_n(&dropBytes, __ATOMIC_RELAXED);
+}
@@ -25,6 +25,7 @@ private:
   cIoThrottle *ioThrottle;
 protected:
   tThreadId getThreadTid;
+  int getThreshold;
   int maxFill;//XXX
   int lastPercent;
   bool statistics;//XXX
@@ -34,12 +35,12 @@ protected:
   void EnablePut(void);
   void EnableGet(void);
   virtual void Clear(void) = 0;
-  virtual int Available(void) = 0;
   virtual int Free(void) { return Size() - Available() - 1; }
-  int Size(void) { return size; }
 public:
   cRingBuffer(int Size, bool Statistics = false);
   virtual ~cRingBuffer();
+  virtual int Available(void) = 0;
+  int Size(void) { return size; }
   void SetTimeouts(int PutTimeout, int GetTimeout);
   void SetIoThrottle(void);
   void ReportOverflow(int Bytes);
@@ -104,10 +105,72 @@ public:
     ///< call to Get().
   };
 
+#define RINGBUFFERHISTOGRAMSIZE 10
+
+class cRingBufferMirrored : public cRingBuffer {
+private:
+  int margin, head, tail;
+  int gotten;
+  uchar *buffer;
+  bool mirrored;
+  int lastDecile;
+  uint histogram[RINGBUFFERHISTOGRAMSIZE];
+  char *description;
+  static int PageAligned(int Size);
+  void Mirror(int Offset, int Count);
+  void Stored(int Count, int Tail);
+protected:
+  virtual int DataReady(const uchar *Data, int Count);
+    ///< See cRingBufferLinear::DataReady().
+public:
+  cRingBufferMirrored(int Size, int Margin = 0, int GetThreshold = 0, bool Statistics = false, const char *Description = NULL);
+    ///< Creates a ring buffer for one writing and one reading thread, the memory
+    ///< of which is mapped twice in a row, so that all available data can always
+    ///< be returned by Get() as one consecutive block, even if it wraps around
+    ///< the end of the buffer. Size is rounded up to a multiple of the page size.
+    ///< Put(), Read(), Get() and Del() don't lock any mutex. Get() returns data
+    ///< only if at least Margin bytes are available.
+    ///< A reading thread that waits in Get() is only woken up when the amount of
+    ///< available data exceeds GetThreshold (default is 10% of Size), otherwise
+    ///< it waits for the get timeout (see SetTimeouts()). This allows the reader
+    ///< to process the data in larger blocks.
+    ///< If Statistics is true, a histogram of the buffer's fill level is logged
+    ///< when the buffer is deleted. The optional Description is used for logging.
+  virtual ~cRingBufferMirrored();
+  virtual int Available(void);
+  virtual int Free(void) { return Size() - Available() - 1; }
+  virtual void Clear(void);
+    ///< Immediately clears the ring buffer.
+    ///< This function may safely be called from the reading thread without additional
+    ///< locking. If called from the writing thread, proper locking must be used.
+  int Read(int FileHandle, int Max = 0);
+    ///< See cRingBufferLinear::Read().
+  int Read(cUnbufferedFile *File, int Max = 0);
+    ///< See cRingBufferLinear::Read().
+  int Put(const uchar *Data, int Count);
+    ///< Puts at most Count bytes of Data into the ring buffer.
+    ///< Returns the number of bytes actually stored.
+  uchar *Get(int &Count);
+    ///< Gets all available data from the ring buffer.
+    ///< The data will remain in the buffer until a call to Del() deletes it.
+    ///< Returns a pointer to the data, and stores the number of bytes
+    ///< actually available in Count. If the returned pointer is NULL, Count has no meaning.
+  void Del(int Count);
+    ///< Deletes at most Count bytes from the ring buffer.
+    ///< Count must be less or equal to the number that was returned by a previous
+    ///< call to Get().
+  const uint *Histogram(void) const { return histogram; }
+    ///< Returns the fill level histogram of this buffer (only maintained if
+    ///< Statistics was given in the constructor). Element i holds the number
+    ///< of times data has been stored while the buffer was filled to between
+    ///< i and i + 1 tenths of its size.
+  };
+
 enum eFrameType { ftUnknown, ftVideo, ftAudio, ftDolby };
 
 class cFrame {
   friend class cRingBufferFrame;
+  friend class cRingBufferFramePool;
 private:
   cFrame *next;
   uchar *data;
@@ -116,6 +179,7 @@ private:
   int index;
   uint32_t pts;
   bool independent;
+  cFrame(void) { next = NULL; data = NULL; count = 0; type = ftUnknown; index = -1; pts = 0; independent = false; }
 public:
   cFrame(const uchar *Data, int Count, eFrameType = ftUnknown, int Index = -1, uint32_t Pts = 0, bool independent = false);
     ///< Creates a new cFrame object.
@@ -154,4 +218,41 @@ public:
     // Drops the Frame that has just been fetched with Get().
   };
 
+class cRingBufferFramePool : public cRingBuffer {
+private:
+  cFrame *frames;
+  int numFrames;
+  int frameHead, frameTail; // the next frame to Put(), the next frame to Get()
+  uchar *buffer;
+  int head, tail; // the end of the most recently stored/dropped frame data in buffer
+  uint32_t putBytes, dropBytes;
+public:
+  cRingBufferFramePool(int Size, int MaxFrames, bool Statistics = false);
+    ///< Creates a frame ring buffer for one writing and one reading thread.
+    ///< It can hold at most MaxFrames frames with a total of Size-1 bytes of data.
+    ///< The frame descriptors are kept in a fixed array and the frame data is
+    ///< copied into one contiguous buffer, so Put(), Get() and Drop() neither
+    ///< allocate memory nor lock a mutex. The data of each frame is stored in
+    ///< one consecutive block.
+  virtual ~cRingBufferFramePool();
+  virtual int Available(void);
+    ///< Returns the total number of data bytes of all frames in the buffer.
+  virtual void Clear(void);
+    ///< Immediately clears the ring buffer.
+    ///< This function must not be called while the writing or reading thread
+    ///< is in Put(), Get() or Drop(), so proper locking must be used if it is
+    ///< not called from the only thread that uses this buffer.
+  bool Put(const uchar *Data, int Count, eFrameType Type = ftUnknown, int Index = -1, uint32_t Pts = 0, bool Independent = false);
+    ///< Copies Count bytes of Data into the ring buffer as a new frame with the
+    ///< given properties (see cFrame).
+    ///< Returns true if this was possible. May only be called from the writing thread.
+  cFrame *Get(void);
+    ///< Gets the next frame from the ring buffer.
+    ///< The frame and its data remain valid until Drop() or Clear() is called.
+    ///< May only be called from the reading thread.
+  void Drop(cFrame *Frame);
+    ///< Drops the Frame that has just been fetched with Get().
+    ///< May only be called from the reading thread.
+  };
+
 #endif // __RINGBUFFER_H
@@ -8,19 +8,404 @@
  */
 
 #include "status.h"
+#include <cxxabi.h>
+#include <time.h>
+#include <typeinfo>
+
+// --- cStatusMessage --------------------------------------------------------
+
+enum eStatusMessage {
+  smChannelSwitch,
+  smRecording,
+  smSetVolume,
+  smSetAudioTrack,
+  smSetAudioChannel,
+  smSetSubtitleTrack,
+  smOsdClear,
+  smOsdTitle,
+  smOsdStatusMessage,
+  smOsdHelpKeys,
+  smOsdItem,
+  smOsdCurrentItem,
+  smOsdTextItem,
+  smOsdChannel,
+  smOsdProgramme,
+  };
+
+#define MAXSTATUSTEXTS 6
+
+static uint64_t NowUs(void)
+{
+  struct timespec tp;
+  clock_gettime(CLOCK_MONOTONIC, &tp);
+  return uint64_t(tp.tv_sec) * 1000000 + tp.tv_nsec / 1000;
+}
+
+class cStatusMessage {
+private:
+  eStatusMessage type;
+  const cDevice *device;
+  int number;
+  bool flag;
+  time_t time[2];
+  char *text[MAXSTATUSTEXTS];
+  char **tracks;
+public:
+  uint64_t queued;
+  cStatusMessage(eStatusMessage Type, const cDevice *Device = NULL, int Number = 0, bool Flag = false);
+  ~cStatusMessage();
+  cStatusMessage *SetText(int i, const char *Text) { text[i] = Text ? strdup(Text) : NULL; return this; }
+  cStatusMessage *SetTime(int i, time_t Time) { time[i] = Time; return this; }
+  cStatusMessage *SetTracks(const char * const *Tracks);
+  eStatusMessage Type(void) const { return type; }
+  int Number(void) const { return number; }
+  bool Supersedes(const cStatusMessage *Message) const;
+       ///< Returns true if this message makes the given earlier one obsolete.
+  void Deliver(cStatus *Monitor) const;
+  };
+
+cStatusMessage::cStatusMessage(eStatusMessage Type, const cDevice *Device, int Number, bool Flag)
+{
+  type = Type;
+  device = Device;
+  number = Number;
+  flag = Flag;
+  time[0] = time[1] = 0;
+  memset(text, 0, sizeof(text));
+  tracks = NULL;
+  queued = 0;
+}
+
+cStatusMessage::~cStatusMessage()
+{
+  for (int i = 0; i < MAXSTATUSTEXTS; i++)
+      free(text[i]);
+  if (tracks) {
+     for (char **t = tracks; *t; t++)
+         free(*t);
+     free(tracks);
+     }
+}
+
+cStatusMessage *cStatusMessage::SetTracks(const char * const *Tracks)
+{
+  if (Tracks) {
+     int n = 0;
+     while (Tracks[n])
+           n++;
+     tracks = MALLOC(char *, n + 1);
+     for (int i = 0; i < n; i++)
+         tracks[i] = strdup(Tracks[i]);
+     tracks[n] = NULL;
+     }
+  return this;
+}
+
+bool cStatusMessage::Supersedes(const cStatusMessage *Message) const
+{
+  if (Message->type != type)
+     return false;
+  switch (type) {
+    case smOsdTitle:
+    case smOsdStatusMessage:
+    case smOsdHelpKeys:
+    case smOsdCurrentItem:
+    case smOsdChannel:
+    case smOsdProgramme: return true;
+    case smOsdItem:      return Message->number == number;
+    default: ;
+    }
+  return false;
+}
+
+void cStatusMessage::Deliver(cStatus *Monitor) const
+{
+  switch (type) {
+    case smChannelSwitch:    Monitor->ChannelSwitch(device, number, flag); break;
+    case smRecording:        Monitor->Recording(device, text[0], text[1], flag); break;
+    case smSetVolume:        Monitor->SetVolume(number, flag); break;
+    case smSetAudioTrack:    Monitor->SetAudioTrack(number, tracks); break;
+    case smSetAudioChannel:  Monitor->SetAudioChannel(number); break;
+    case smSetSubtitleTrack: Monitor->SetSubtitleTrack(number, tracks); break;
+    case smOsdClear:         Monitor->OsdClear(); break;
+    case smOsdTitle:         Monitor->OsdTitle(text[0]); break;
+    case smOsdStatusMessage: Monitor->OsdStatusMessage(text[0]); break;
+    case smOsdHelpKeys:      Monitor->OsdHelpKeys(text[0], text[1], text[2], text[3]); break;
+    case smOsdItem:          Monitor->OsdItem(text[0], number); break;
+    case smOsdCurrentItem:   Monitor->OsdCurrentItem(text[0]); break;
+    case smOsdTextItem:      Monitor->OsdTextItem(text[0], flag); break;
+    case smOsdChannel:       Monitor->OsdChannel(text[0]); break;
+    case smOsdProgramme:     Monitor->OsdProgramme(time[0], text[0], text[1], time[1], text[2], text[3]); break;
+    }
+}
+
+// --- cStatusQueue ----------------------------------------------------------
+
+// A bounded queue for any number of writing threads and one reading thread,
+// which works without locking a mutex. Each slot carries a sequence number
+// that tells whether it is ready to be written or read in the current round.
+
+#define STATUSQUEUESIZE 1024 // must be a power of 2
+
+class cStatusQueue {
+private:
+  struct tSlot {
+    uint32_t sequence;
+    cStatusMessage *message;
+    };
+  tSlot slots[STATUSQUEUESIZE];
+  uint32_t head; // the next slot to read
+  uint32_t tail; // the next slot to write
+public:
+  cStatusQueue(void);
+  bool Put(cStatusMessage *Message);
+       ///< Puts the given Message into the queue and returns true, or returns
+       ///< false if the queue is full. May be called from any thread.
+  cStatusMessage *Get(void);
+       ///< Returns the next message from the queue, or NULL if it is empty.
+       ///< May only be called from the reading thread.
+  int Fill(void) { return int(__atomic_load_n(&tail, __ATOMIC_RELAXED) - __atomic_load_n(&head, __ATOMIC_RELAXED)); }
+  };
+
+cStatusQueue::cStatusQueue(void)
+{
+  for (uint32_t i = 0; i < STATUSQUEUESIZE; i++) {
+      slots[i].sequence = i;
+      slots[i].message = NULL;
+      }
+  head = tail = 0;
+}
+
+bool cStatusQueue::Put(cStatusMessage *Message)
+{
+  uint32_t Pos = __atomic_load_n(&tail, __ATOMIC_RELAXED);
+  for (;;) {
+      tSlot *Slot = &slots[Pos & (STATUSQUEUESIZE - 1)];
+      int32_t d = int32_t(__atomic_load_n(&Slot->sequence, __ATOMIC_ACQUIRE) - Pos);
+      if (d == 0) {
+         if (__atomic_compare_exchange_n(&tail, &Pos, Pos + 1, true, __ATOMIC_RELAXED, __ATOMIC_RELAXED)) {
+            Slot->message = Message;
+            __atomic_store_n(&Slot->sequence, Pos + 1, __ATOMIC_RELEASE);
+            return true;
+            }
+         // Pos has been updated by the failed exchange
+         }
+      else if (d < 0)
+         return false; // the queue is full
+      else
+         Pos = __atomic_load_n(&tail, __ATOMIC_RELAXED);
+      }
+}
+
+cStatusMessage *cStatusQueue::Get(void)
+{
+  tSlot *Slot = &slots[head & (STATUSQUEUESIZE - 1)];
+  if (__atomic_load_n(&Slot->sequence, __ATOMIC_ACQUIRE) != head + 1)
+     return NULL;
+  cStatusMessage *Message = Slot->message;
+  __atomic_store_n(&Slot->sequence, head + STATUSQUEUESIZE, __ATOMIC_RELEASE);
+  __atomic_store_n(&head, head + 1, __ATOMIC_RELAXED);
+  return Message;
+}
+
+// --- cStatusDispatcher -----------------------------------------------------
+
+#define STATUSBATCHSIZE 256 // max. number of messages coalesced and delivered at once
+#define STATUSSTOPWARN   10 // seconds after which a warning is logged if the dispatcher doesn't stop
+
+class cStatusDispatcher : public cThread {
+private:
+  cStatusQueue queue;
+  cCondWait newMessage;
+  bool dispatching;
+  bool stopped;
+  int queued;
+  int coalesced;
+  int waits;
+  int maxFill;
+  uint64_t maxLatency;
+  void Deliver(cStatusMessage **Messages, int Count);
+protected:
+  virtual void Action(void);
+public:
+  cStatusDispatcher(void);
+  bool Dispatching(void) { return __atomic_load_n(&dispatching, __ATOMIC_ACQUIRE); }
+  void Activate(void);
+  void Stop(void);
+  void Put(cStatusMessage *Message);
+  void Statistics(cStringList &Lines, bool Reset);
+  };
+
+static cStatusDispatcher StatusDispatcher;
+
+cStatusDispatcher::cStatusDispatcher(void)
+:cThread("status dispatcher")
+{
+  dispatching = stopped = false;
+  queued = coalesced = waits = maxFill = 0;
+  maxLatency = 0;
+}
+
+void cStatusDispatcher::Activate(void)
+{
+  if (!Dispatching() && !stopped) {
+     __atomic_store_n(&dispatching, true, __ATOMIC_RELEASE);
+     Start();
+     }
+}
+
+void cStatusDispatcher::Stop(void)
+{
+  stopped = true;
+  if (Dispatching()) {
+     __atomic_store_n(&dispatching, false, __ATOMIC_RELEASE);
+     Cancel(-1);
+     newMessage.Signal();
+     // The thread must not be canceled while it holds cStatus::asyncMutex, because
+     // then no asynchronous monitor could ever be destroyed, so we wait for it to
+     // deliver all pending messages and end by itself:
+     cTimeMs Timeout(STATUSSTOPWARN * 1000);
+     while (Active()) {
+           if (Timeout.TimedOut()) {
+              esyslog("ERROR: status dispatcher is still delivering messages after %d seconds", STATUSSTOPWARN);
+              Timeout.Set(STATUSSTOPWARN * 1000);
+              }
+           cCondWait::SleepMs(10);
+           }
+     }
+}
+
+void cStatusDispatcher::Put(cStatusMessage *Message)
+{
+  Message->queued = NowUs();
+  while (!queue.Put(Message)) {
+        // the monitors can't keep up, so we need to slow down the producers:
+        __atomic_add_fetch(&waits, 1, __ATOMIC_RELAXED);
+        newMessage.Signal();
+        cCondWait::SleepMs(1);
+        }
+  newMessage.Signal();
+}
+
+void cStatusDispatcher::Deliver(cStatusMessage **Messages, int Count)
+{
+  // Skip OSD messages that are superseded by later ones, unless the OSD is cleared in between:
+  for (int i = 0; i < Count; i++) {
+      for (int j = i + 1; j < Count && Messages[j]->Type() != smOsdClear; j++) {
+          if (Messages[j]->Supersedes(Messages[i])) {
+             DELETENULL(Messages[i]);
+             coalesced++;
+             break;
+             }
+          }
+      }
+  cMutexLock MutexLock(&cStatus::asyncMutex);
+  for (int i = 0; i < Count; i++) {
+      if (cStatusMessage *m = Messages[i]) {
+         uint64_t Now = NowUs();
+         maxLatency = max(maxLatency, Now - m->queued);
+         for (cStatus *sm = cStatus::statusMonitors.First(); sm; sm = cStatus::statusMonitors.Next(sm)) {
+             if (sm->asynchronous) {
+                m->Deliver(sm);
+                uint64_t t = NowUs();
+                sm->asyncMessages++;
+                sm->asyncTime += t - Now;
+                sm->asyncMaxTime = max(sm->asyncMaxTime, t - Now);
+                Now = t;
+                }
+             }
+         queued++;
+         delete m;
+         }
+      }
+}
+
+void cStatusDispatcher::Action(void)
+{
+  cStatusMessage *Messages[STATUSBATCHSIZE];
+  for (;;) {
+      int Count = 0;
+      maxFill = max(maxFill, queue.Fill());
+      while (Count < STATUSBATCHSIZE && (Messages[Count] = queue.Get()) != NULL)
+            Count++;
+      if (Count)
+         Deliver(Messages, Count);
+      else if (Running())
+         newMessage.Wait(100);
+      else
+         break; // all pending messages have been delivered
+      }
+}
+
+void cStatusDispatcher::Statistics(cStringList &Lines, bool Reset)
+{
+  cMutexLock MutexLock(&cStatus::asyncMutex);
+  Lines.Append(strdup(cString::sprintf("queue: %d messages delivered, %d coalesced, max. %d queued, %d waits for a full queue, max. latency %d ms", queued, coalesced, maxFill, waits, int(maxLatency / 1000))));
+  for (cStatus *sm = cStatus::statusMonitors.First(); sm; sm = cStatus::statusMonitors.Next(sm)) {
+      if (sm->asynchronous) {
+         char *Name = abi::__cxa_demangle(typeid(*sm).name(), NULL, NULL, NULL);
+         Lines.Append(strdup(cString::sprintf("%s: %d messages, average %d us, max %d us", Name ? Name : typeid(*sm).name(), sm->asyncMessages, sm->asyncMessages ? int(sm->asyncTime / sm->asyncMessages) : 0, int(sm->asyncMaxTime))));
+         free(Name);
+         if (Reset) {
+            sm->asyncMessages = 0;
+            sm->asyncTime = sm->asyncMaxTime = 0;
+            }
+         }
+      }
+  if (Reset) {
+     queued = coalesced = maxFill = 0;
+     __atomic_store_n(&waits, 0, __ATOMIC_RELAXED);
+     maxLatency = 0;
+     }
+}
 
 // --- cStatus ---------------------------------------------------------------
 
 cList<cStatus> cStatus::statusMonitors;
+cMutex cStatus::asyncMutex;
+int cStatus::asyncMonitors = 0;
 
-cStatus::cStatus(void)
+cStatus::cStatus(bool Asynchronous)
 {
+  asynchronous = Asynchronous;
+  registered = true;
+  asyncMessages = 0;
+  asyncTime = asyncMaxTime = 0;
+  cMutexLock MutexLock(&asyncMutex);
   statusMonitors.Add(this);
+  if (asynchronous && asyncMonitors++ == 0)
+     StatusDispatcher.Activate();
 }
 
 cStatus::~cStatus()
 {
-  statusMonitors.Del(this, false);
+  Unregister();
+}
+
+void cStatus::Unregister(void)
+{
+  cMutexLock MutexLock(&asyncMutex); // waits until any message currently being delivered asynchronously has been handled
+  if (registered) {
+     statusMonitors.Del(this, false);
+     if (asynchronous)
+        asyncMonitors--;
+     registered = false;
+     }
+}
+
+bool cStatus::Asynchronous(void)
+{
+  return asyncMonitors && StatusDispatcher.Dispatching();
+}
+
+void cStatus::Shutdown(void)
+{
+  StatusDispatcher.Stop();
+}
+
+void cStatus::Statistics(cStringList &Lines, bool Reset)
+{
+  StatusDispatcher.Statistics(Lines, Reset);
 }
 
 void cStatus::MsgChannelChange(const cChannel *Channel)
@@ -37,14 +422,24 @@ void cStatus::MsgTimerChange(const cTimer *Timer, eTimerChange Change)
 
 void cStatus::MsgChannelSwitch(const cDevice *Device, int ChannelNumber, bool LiveView)
 {
-  for (cStatus *sm = statusMonitors.First(); sm; sm = statusMonitors.Next(sm))
-      sm->ChannelSwitch(Device, ChannelNumber, LiveView);
+  bool Async = Asynchronous();
+  for (cStatus *sm = statusMonitors.First(); sm; sm = statusMonitors.Next(sm)) {
+      if (!(Async && sm->asynchronous))
+         sm->ChannelSwitch(Device, ChannelNumber, LiveView);
+      }
+  if (Async)
+     StatusDispatcher.Put(new cStatusMessage(smChannelSwitch, Device, ChannelNumber, LiveView));
 }
 
 void cStatus::MsgRecording(const cDevice *Device, const char *Name, const char *FileName, bool On)
 {
-  for (cStatus *sm = statusMonitors.First(); sm; sm = statusMonitors.Next(sm))
-      sm->Recording(Device, Name, FileName, On);
+  bool Async = Asynchronous();
+  for (cStatus *sm = statusMonitors.First(); sm; sm = statusMonitors.Next(sm)) {
+      if (!(Async && sm->asynchronous))
+         sm->Recording(Device, Name, FileName, On);
+      }
+  if (Async)
+     StatusDispatcher.Put((new cStatusMessage(smRecording, Device, 0, On))->SetText(0, Name)->SetText(1, FileName));
 }
 
 void cStatus::MsgReplaying(const cControl *Control, const char *Name, const char *FileName, bool On)
@@ -61,78 +456,143 @@ void cStatus::MsgMarksModified(const cMarks* Marks)
 
 void cStatus::MsgSetVolume(int Volume, bool Absolute)
 {
-  for (cStatus *sm = statusMonitors.First(); sm; sm = statusMonitors.Next(sm))
-      sm->SetVolume(Volume, Absolute);
+  bool Async = Asynchronous();
+  for (cStatus *sm = statusMonitors.First(); sm; sm = statusMonitors.Next(sm)) {
+      if (!(Async && sm->asynchronous))
+         sm->SetVolume(Volume, Absolute);
+      }
+  if (Async)
+     StatusDispatcher.Put(new cStatusMessage(smSetVolume, NULL, Volume, Absolute));
 }
 
 void cStatus::MsgSetAudioTrack(int Index, const char * const *Tracks)
 {
-  for (cStatus *sm = statusMonitors.First(); sm; sm = statusMonitors.Next(sm))
-      sm->SetAudioTrack(Index, Tracks);
+  bool Async = Asynchronous();
+  for (cStatus *sm = statusMonitors.First(); sm; sm = statusMonitors.Next(sm)) {
+      if (!(Async && sm->asynchronous))
+         sm->SetAudioTrack(Index, Tracks);
+      }
+  if (Async)
+     StatusDispatcher.Put((new cStatusMessage(smSetAudioTrack, NULL, Index))->SetTracks(Tracks));
 }
 
 void cStatus::MsgSetAudioChannel(int AudioChannel)
 {
-  for (cStatus *sm = statusMonitors.First(); sm; sm = statusMonitors.Next(sm))
-      sm->SetAudioChannel(AudioChannel);
+  bool Async = Asynchronous();
+  for (cStatus *sm = statusMonitors.First(); sm; sm = statusMonitors.Next(sm)) {
+      if (!(Async && sm->asynchronous))
+         sm->SetAudioChannel(AudioChannel);
+      }
+  if (Async)
+     StatusDispatcher.Put(new cStatusMessage(smSetAudioChannel, NULL, AudioChannel));
 }
 
 void cStatus::MsgSetSubtitleTrack(int Index, const char * const *Tracks)
 {
-  for (cStatus *sm = statusMonitors.First(); sm; sm = statusMonitors.Next(sm))
-      sm->SetSubtitleTrack(Index, Tracks);
+  bool Async = Asynchronous();
+  for (cStatus *sm = statusMonitors.First(); sm; sm = statusMonitors.Next(sm)) {
+      if (!(Async && sm->asynchronous))
+         sm->SetSubtitleTrack(Index, Tracks);
+      }
+  if (Async)
+     StatusDispatcher.Put((new cStatusMessage(smSetSubtitleTrack, NULL, Index))->SetTracks(Tracks));
 }
 
 void cStatus::MsgOsdClear(void)
 {
-  for (cStatus *sm = statusMonitors.First(); sm; sm = statusMonitors.Next(sm))
-      sm->OsdClear();
+  bool Async = Asynchronous();
+  for (cStatus *sm = statusMonitors.First(); sm; sm = statusMonitors.Next(sm)) {
+      if (!(Async && sm->asynchronous))
+         sm->OsdClear();
+      }
+  if (Async)
+     StatusDispatcher.Put(new cStatusMessage(smOsdClear));
 }
 
 void cStatus::MsgOsdTitle(const char *Title)
 {
-  for (cStatus *sm = statusMonitors.First(); sm; sm = statusMonitors.Next(sm))
-      sm->OsdTitle(Title);
+  bool Async = Asynchronous();
+  for (cStatus *sm = statusMonitors.First(); sm; sm = statusMonitors.Next(sm)) {
+      if (!(Async && sm->asynchronous))
+         sm->OsdTitle(Title);
+      }
+  if (Async)
+     StatusDispatcher.Put((new cStatusMessage(smOsdTitle))->SetText(0, Title));
 }
 
 void cStatus::MsgOsdStatusMessage(const char *Message)
 {
-  for (cStatus *sm = statusMonitors.First(); sm; sm = statusMonitors.Next(sm))
-      sm->OsdStatusMessage(Message);
+  bool Async = Asynchronous();
+  for (cStatus *sm = statusMonitors.First(); sm; sm = statusMonitors.Next(sm)) {
+      if (!(Async && sm->asynchronous))
+         sm->OsdStatusMessage(Message);
+      }
+  if (Async)
+     StatusDispatcher.Put((new cStatusMessage(smOsdStatusMessage))->SetText(0, Message));
 }
 
 void cStatus::MsgOsdHelpKeys(const char *Red, const char *Green, const char *Yellow, const char *Blue)
 {
-  for (cStatus *sm = statusMonitors.First(); sm; sm = statusMonitors.Next(sm))
-      sm->OsdHelpKeys(Red, Green, Yellow, Blue);
+  bool Async = Asynchronous();
+  for (cStatus *sm = statusMonitors.First(); sm; sm = statusMonitors.Next(sm)) {
+      if (!(Async && sm->asynchronous))
+         sm->OsdHelpKeys(Red, Green, Yellow, Blue);
+      }
+  if (Async)
+     StatusDispatcher.Put((new cStatusMessage(smOsdHelpKeys))->SetText(0, Red)->SetText(1, Green)->SetText(2, Yellow)->SetText(3, Blue));
 }
 
 void cStatus::MsgOsdItem(const char *Text, int Index)
 {
-  for (cStatus *sm = statusMonitors.First(); sm; sm = statusMonitors.Next(sm))
-      sm->OsdItem(Text, Index);
+  bool Async = Asynchronous();
+  for (cStatus *sm = statusMonitors.First(); sm; sm = statusMonitors.Next(sm)) {
+      if (!(Async && sm->asynchronous))
+         sm->OsdItem(Text, Index);
+      }
+  if (Async)
+     StatusDispatcher.Put((new cStatusMessage(smOsdItem, NULL, Index))->SetText(0, Text));
 }
 
 void cStatus::MsgOsdCurrentItem(const char *Text)
 {
-  for (cStatus *sm = statusMonitors.First(); sm; sm = statusMonitors.Next(sm))
-      sm->OsdCurrentItem(Text);
+  bool Async = Asynchronous();
+  for (cStatus *sm = statusMonitors.First(); sm; sm = statusMonitors.Next(sm)) {
+      if (!(Async && sm->asynchronous))
+         sm->OsdCurrentItem(Text);
+      }
+  if (Async)
+     StatusDispatcher.Put((new cStatusMessage(smOsdCurrentItem))->SetText(0, Text));
 }
 
 void cStatus::MsgOsdTextItem(const char *Text, bool Scroll)
 {
-  for (cStatus *sm = statusMonitors.First(); sm; sm = statusMonitors.Next(sm))
-      sm->OsdTextItem(Text, Scroll);
+  bool Async = Asynchronous();
+  for (cStatus *sm = statusMonitors.First(); sm; sm = statusMonitors.Next(sm)) {
+      if (!(Async && sm->asynchronous))
+         sm->OsdTextItem(Text, Scroll);
+      }
+  if (Async)
+     StatusDispatcher.Put((new cStatusMessage(smOsdTextItem, NULL, 0, Scroll))->SetText(0, Text));
 }
 
 void cStatus::MsgOsdChannel(const char *Text)
 {
-  for (cStatus *sm = statusMonitors.First(); sm; sm = statusMonitors.Next(sm))
-      sm->OsdChannel(Text);
+  bool Async = Asynchronous();
+  for (cStatus *sm = statusMonitors.First(); sm; sm = statusMonitors.Next(sm)) {
+      if (!(Async && sm->asynchronous))
+         sm->OsdChannel(Text);
+      }
+  if (Async)
+     StatusDispatcher.Put((new cStatusMessage(smOsdChannel))->SetText(0, Text));
 }
 
 void cStatus::MsgOsdProgramme(time_t PresentTime, const char *PresentTitle, const char *PresentSubtitle, time_t FollowingTime, const char *FollowingTitle, const char *FollowingSubtitle)
 {
-  for (cStatus *sm = statusMonitors.First(); sm; sm = statusMonitors.Next(sm))
-      sm->OsdProgramme(PresentTime, PresentTitle, PresentSubtitle, FollowingTime, FollowingTitle, FollowingSubtitle);
+  bool Async = Asynchronous();
+  for (cStatus *sm = statusMonitors.First(); sm; sm = statusMonitors.Next(sm)) {
+      if (!(Async && sm->asynchronous))
+         sm->OsdProgramme(PresentTime, PresentTitle, PresentSubtitle, FollowingTime, FollowingTitle, FollowingSubtitle);
+      }
+  if (Async)
+     StatusDispatcher.Put((new cStatusMessage(smOsdProgramme))->SetTime(0, PresentTime)->SetText(0, PresentTitle)->SetText(1, PresentSubtitle)->SetTime(1, FollowingTime)->SetText(2, FollowingTitle)->SetText(3, FollowingSubtitle));
 }
@@ -27,14 +27,37 @@
 // set locks of its own (on mutexes defined inside the plugin code), it shall do so
 // after setting any locks on VDR's global lists, and it shall always set these
 // locks in the same sequence, to avoid deadlocks.
+// A status monitor may be created as "asynchronous", in which case the messages that
+// don't refer to objects from the global lists (i.e. ChannelSwitch(), Recording(),
+// SetVolume(), SetAudioTrack(), SetAudioChannel(), SetSubtitleTrack() and all Osd...()
+// functions) are put into a queue and delivered to it by a separate thread, in the
+// order in which they have been issued. The pointer to a cDevice given to these
+// functions is valid until the end of the program, while all strings are only valid
+// during the function call. Consecutive OSD messages that are superseded by later
+// ones of the same kind (for instance the same menu item being redisplayed) may be
+// skipped. All other functions are called directly, as with a synchronous monitor.
+// Note that the functions of an asynchronous monitor are called from a different
+// thread than the one that issued the message, so any data they share with other
+// parts of the plugin needs to be protected accordingly. The destructor of an
+// asynchronous monitor must call Unregister() before destroying any of its data.
 
 enum eTimerChange { tcMod, tcAdd, tcDel }; // tcMod is obsolete and no longer used!
 
 class cTimer;
 
 class cStatus : public cListObject {
+  friend class cStatusMessage;
+  friend class cStatusDispatcher;
 private:
   static cList<cStatus> statusMonitors;
+  static cMutex asyncMutex;
+  static int asyncMonitors;
+  bool asynchronous;
+  bool registered;
+  int asyncMessages;
+  uint64_t asyncTime;
+  uint64_t asyncMaxTime;
+  static bool Asynchronous(void);
 protected:
   // These functions can be implemented by derived classes to receive status information:
   virtual void ChannelChange(const cChannel *Channel) {}
@@ -100,8 +123,28 @@ protected:
   virtual void OsdProgramme(time_t PresentTime, const char *PresentTitle, const char *PresentSubtitle, time_t FollowingTime, const char *FollowingTitle, const char *FollowingSubtitle) {}
                // The OSD displays the given programme information.
 public:
-  cStatus(void);
+  cStatus(bool Asynchronous = false);
+               // Creates a status monitor. If Asynchronous is true, the messages
+               // are delivered asynchronously (see above).
   virtual ~cStatus();
+  void Unregister(void);
+               // Removes this status monitor from the list of monitors, so that it
+               // receives no further messages. If a message is currently being
+               // delivered to an asynchronous monitor, this function waits until
+               // that delivery has finished. The destructor of cStatus calls this
+               // function, but at that point the destructor of the derived class has
+               // already been executed, while the dispatcher thread may still be
+               // calling one of its functions. Therefore the destructor of an
+               // asynchronous monitor must call Unregister() itself, before it
+               // destroys any of its data.
+  static void Shutdown(void);
+               // Delivers any pending asynchronous messages and stops the thread that
+               // delivers them. Any messages issued after this call are delivered
+               // synchronously to all monitors.
+  static void Statistics(cStringList &Lines, bool Reset = false);
+               // Adds statistics about the asynchronous delivery of messages to
+               // Lines, one line per asynchronous monitor. If Reset is true, the
+               // statistics are cleared.
   // These functions are called whenever the related status information changes:
   static void MsgChannelChange(const cChannel *Channel);
   static void MsgTimerChange(const cTimer *Timer, eTimerChange Change);
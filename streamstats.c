@@ -0,0 +1,282 @@
+/*
+ * streamstats.c: Stream health and throughput telemetry
+ *
+ * See the main source file 'vdr.c' for copyright information and
+ * how to reach the author.
+ *
+ * $Id$
+ */
+
+#include "streamstats.h"
+#include <inttypes.h>
+#include <time.h>
+
+#define RATEINTERVAL 1000 // ms over which the current rates are calculated
+
+// --- cStreamStats ----------------------------------------------------------
+
+cMutex cStreamStats::streamStatsMutex;
+cList<cStreamStats> cStreamStats::streamStats;
+char *cStreamStats::statsFile = NULL;
+
+cStreamStats::cStreamStats(void)
+{
+  active = false;
+  ringBuffer = NULL;
+  startTime = 0;
+  ResetCounters();
+}
+
+cStreamStats::~cStreamStats()
+{
+  Stop();
+}
+
+void cStreamStats::ResetCounters(void)
+{
+  bytes = packets = 0;
+  scrambled = lost = ccErrors = 0;
+  lastPacket = 0;
+  memset(continuityCounters, 0xFF, sizeof(continuityCounters));
+  errorPids.Clear();
+  errorCounts.Clear();
+  maxFill = 0;
+  writes = writeTime = 0;
+  maxWriteTime = 0;
+  indexWrites = 0;
+  rateTime = cTimeMs::Now();
+  rateBytes = ratePackets = rateIndexWrites = 0;
+  bytesPerSecond = packetsPerSecond = indexWritesPerSecond = 0;
+  __atomic_store_n(&pendingPackets, 0, __ATOMIC_RELAXED);
+  __atomic_store_n(&pendingScrambled, 0, __ATOMIC_RELAXED);
+}
+
+void cStreamStats::Start(const char *Type, const char *Name)
+{
+  cMutexLock MutexLock(&streamStatsMutex);
+  mutex.Lock();
+  type = Type;
+  name = Name;
+  startTime = time(NULL);
+  ResetCounters();
+  bool WasActive = __atomic_exchange_n(&active, true, __ATOMIC_RELEASE);
+  mutex.Unlock();
+  if (!WasActive)
+     streamStats.Add(this);
+}
+
+void cStreamStats::Stop(void)
+{
+  cMutexLock MutexLock(&streamStatsMutex);
+  mutex.Lock();
+  bool WasActive = __atomic_exchange_n(&active, false, __ATOMIC_RELAXED);
+  Flush();
+  mutex.Unlock();
+  if (WasActive)
+     streamStats.Del(this, false);
+}
+
+void cStreamStats::SetRingBuffer(cRingBuffer *RingBuffer)
+{
+  cMutexLock MutexLock(&mutex);
+  ringBuffer = RingBuffer;
+}
+
+void cStreamStats::UpdateRates(uint64_t Now)
+{
+  uint64_t Elapsed = Now - rateTime;
+  if (Elapsed >= RATEINTERVAL) {
+     bytesPerSecond = double(bytes - rateBytes) * 1000 / Elapsed;
+     packetsPerSecond = double(packets - ratePackets) * 1000 / Elapsed;
+     indexWritesPerSecond = double(indexWrites - rateIndexWrites) * 1000 / Elapsed;
+     rateTime = Now;
+     rateBytes = bytes;
+     ratePackets = packets;
+     rateIndexWrites = indexWrites;
+     }
+}
+
+void cStreamStats::CountError(int Pid)
+{
+  ccErrors++;
+  int i = errorPids.IndexOf(Pid);
+  if (i < 0) {
+     errorPids.Append(Pid);
+     errorCounts.Append(1);
+     }
+  else
+     errorCounts[i]++;
+}
+
+void cStreamStats::Flush(void)
+{
+  // mutex must be locked by caller!
+  int Pending = __atomic_exchange_n(&pendingPackets, 0, __ATOMIC_RELAXED);
+  if (!Pending)
+     return;
+  uint64_t Now = cTimeMs::Now();
+  bytes += uint64_t(Pending) * TS_SIZE;
+  packets += Pending;
+  scrambled += __atomic_exchange_n(&pendingScrambled, 0, __ATOMIC_RELAXED);
+  lastPacket = Now;
+  if (ringBuffer) {
+     int Fill = ringBuffer->Available();
+     if (Fill > maxFill)
+        maxFill = Fill;
+     }
+  UpdateRates(Now);
+}
+
+void cStreamStats::Packet(const uchar *Data)
+{
+  if (!__atomic_load_n(&active, __ATOMIC_ACQUIRE))
+     return;
+  // Stop() may flush the pending packets from a different thread at any time:
+  int Pending = __atomic_add_fetch(&pendingPackets, 1, __ATOMIC_RELAXED);
+  int Pid = TsPid(Data);
+  if (Pid != 0x1FFF && !TsError(Data)) { // null packets have no meaningful continuity counter
+     if (TsIsScrambled(Data))
+        __atomic_fetch_add(&pendingScrambled, 1, __ATOMIC_RELAXED);
+     if (TsHasPayload(Data)) {
+        uchar Counter = TsContinuityCounter(Data);
+        uchar &Last = continuityCounters[Pid];
+        bool Discontinuity = TsHasAdaptationField(Data) && Data[4] && (Data[5] & TS_ADAPT_DISCONT);
+        // A packet may be sent twice in a row, so an unchanged counter is no error:
+        if (Last != 0xFF && !Discontinuity && Counter != Last && Counter != ((Last + 1) & TS_CONT_CNT_MASK)) {
+           cMutexLock MutexLock(&mutex);
+           CountError(Pid);
+           }
+        Last = Counter;
+        }
+     }
+  if (Pending >= STREAMSTATSBLOCK) {
+     cMutexLock MutexLock(&mutex);
+     Flush();
+     }
+}
+
+void cStreamStats::Written(uint64_t MicroSeconds)
+{
+  cMutexLock MutexLock(&mutex);
+  writes++;
+  writeTime += MicroSeconds;
+  if (int(MicroSeconds) > maxWriteTime)
+     maxWriteTime = int(MicroSeconds);
+}
+
+uint64_t cStreamStats::Now(void)
+{
+  struct timespec tp;
+  clock_gettime(CLOCK_MONOTONIC, &tp);
+  return uint64_t(tp.tv_sec) * 1000000 + tp.tv_nsec / 1000;
+}
+
+cString cStreamStats::ToText(void)
+{
+  uint64_t Now = cTimeMs::Now();
+  UpdateRates(Now);
+  cString s = cString::sprintf("%s %s: %.2f Mbit/s, %d packets/s, %" PRIu64 " packets, %" PRIu64 " scrambled, %" PRIu64 " lost, %" PRIu64 " continuity errors",
+                               *type, *name, bytesPerSecond * 8 / 1000000, int(packetsPerSecond), packets, scrambled, lost, ccErrors);
+  if (errorPids.Size()) {
+     s = cString::sprintf("%s (", *s);
+     for (int i = 0; i < errorPids.Size(); i++)
+         s = cString::sprintf("%s%spid %d: %d", *s, i ? ", " : "", errorPids[i], errorCounts[i]);
+     s = cString::sprintf("%s)", *s);
+     }
+  if (ringBuffer)
+     s = cString::sprintf("%s, buffer %d%% (max %d%%)", *s, int(int64_t(ringBuffer->Available()) * 100 / ringBuffer->Size()), int(int64_t(maxFill) * 100 / ringBuffer->Size()));
+  if (writes)
+     s = cString::sprintf("%s, %" PRIu64 " writes, average %d us, max %d us", *s, writes, int(writeTime / writes), maxWriteTime);
+  if (indexWrites)
+     s = cString::sprintf("%s, %.1f index entries/s", *s, indexWritesPerSecond);
+  if (lastPacket)
+     s = cString::sprintf("%s, last packet %d ms ago", *s, int(Now - lastPacket));
+  else
+     s = cString::sprintf("%s, no packets yet", *s);
+  return s;
+}
+
+static cString JsonString(const char *s)
+{
+  cString Result = "\"";
+  const char *p = s;
+  while (*p) {
+        const char *q = p;
+        while (*q && *q != '"' && *q != '\\' && uchar(*q) >= 0x20)
+              q++;
+        Result = cString::sprintf("%s%.*s", *Result, int(q - p), p);
+        if (!*q)
+           break;
+        if (*q == '"' || *q == '\\')
+           Result = cString::sprintf("%s\\%c", *Result, *q);
+        else
+           Result = cString::sprintf("%s\\u%04x", *Result, uchar(*q));
+        p = q + 1;
+        }
+  return cString::sprintf("%s\"", *Result);
+}
+
+cString cStreamStats::ToJson(void)
+{
+  uint64_t Now = cTimeMs::Now();
+  UpdateRates(Now);
+  cString s = cString::sprintf("{\"type\":%s,\"name\":%s,\"start\":%ld,\"bytes\":%" PRIu64 ",\"packets\":%" PRIu64 ",\"bytes_per_sec\":%.0f,\"packets_per_sec\":%.0f,\"scrambled\":%" PRIu64 ",\"lost\":%" PRIu64 ",\"cc_errors\":%" PRIu64 ",\"cc_errors_per_pid\":{",
+                               *JsonString(type), *JsonString(name), long(startTime), bytes, packets, bytesPerSecond, packetsPerSecond, scrambled, lost, ccErrors);
+  for (int i = 0; i < errorPids.Size(); i++)
+      s = cString::sprintf("%s%s\"%d\":%d", *s, i ? "," : "", errorPids[i], errorCounts[i]);
+  s = cString::sprintf("%s}", *s);
+  if (ringBuffer)
+     s = cString::sprintf("%s,\"buffer_size\":%d,\"buffer_fill\":%d,\"buffer_max_fill\":%d", *s, ringBuffer->Size(), ringBuffer->Available(), maxFill);
+  s = cString::sprintf("%s,\"writes\":%" PRIu64 ",\"write_us_avg\":%d,\"write_us_max\":%d,\"index_writes\":%" PRIu64 ",\"index_writes_per_sec\":%.1f,\"idle_ms\":%d}",
+                       *s, writes, writes ? int(writeTime / writes) : 0, maxWriteTime, indexWrites, indexWritesPerSecond, lastPacket ? int(Now - lastPacket) : -1);
+  return s;
+}
+
+void cStreamStats::Statistics(cStringList &Lines, bool Reset)
+{
+  cMutexLock MutexLock(&streamStatsMutex);
+  for (cStreamStats *ss = streamStats.First(); ss; ss = streamStats.Next(ss)) {
+      cMutexLock MutexLock(&ss->mutex);
+      Lines.Append(strdup(ss->ToText()));
+      if (Reset) {
+         ss->scrambled = ss->lost = ss->ccErrors = 0;
+         ss->errorPids.Clear();
+         ss->errorCounts.Clear();
+         ss->maxFill = 0;
+         ss->writes = ss->writeTime = 0;
+         ss->maxWriteTime = 0;
+         }
+      }
+}
+
+void cStreamStats::SetStatsFile(const char *FileName)
+{
+  free(statsFile);
+  statsFile = FileName ? strdup(FileName) : NULL;
+}
+
+void cStreamStats::WriteStatsFile(bool Force)
+{
+  static time_t LastWrite = 0;
+  if (!statsFile)
+     return;
+  time_t Now = time(NULL);
+  if (Now - LastWrite < STREAMSTATSINTERVAL && !Force)
+     return;
+  LastWrite = Now;
+  cStringList Streams;
+  streamStatsMutex.Lock();
+  for (cStreamStats *ss = streamStats.First(); ss; ss = streamStats.Next(ss)) {
+      cMutexLock MutexLock(&ss->mutex);
+      Streams.Append(strdup(ss->ToJson()));
+      }
+  streamStatsMutex.Unlock();
+  cSafeFile f(statsFile);
+  if (f.Open()) {
+     fprintf(f, "{\"time\":%ld,\"streams\":[", long(Now));
+     for (int i = 0; i < Streams.Size(); i++)
+         fprintf(f, "%s\n%s", i ? "," : "", Streams[i]);
+     fprintf(f, "\n]}\n");
+     f.Close();
+     }
+}
@@ -0,0 +1,110 @@
+/*
+ * streamstats.h: Stream health and throughput telemetry
+ *
+ * See the main source file 'vdr.c' for copyright information and
+ * how to reach the author.
+ *
+ * $Id$
+ */
+
+#ifndef __STREAMSTATS_H
+#define __STREAMSTATS_H
+
+#include "remux.h"
+#include "ringbuffer.h"
+#include "thread.h"
+#include "tools.h"
+
+#define STREAMSTATSINTERVAL 10 // seconds between two updates of the stats file
+#define STREAMSTATSBLOCK   100 // number of packets that are counted before the shared data is updated
+
+/// A cStreamStats object collects health and throughput data of a stream of
+/// TS packets, as seen by a recorder, a transfer or a device: the number of
+/// bytes and packets and their current rate, continuity counter errors per
+/// PID, scrambled and lost packets, the fill level of the ring buffer the
+/// data is stored in, the time it takes to write the data, and the rate at
+/// which index entries are written. All active objects are listed by the
+/// SVDRP command "STAT streams", and are periodically written into a stats
+/// file (if one has been given with SetStatsFile()).
+
+class cStreamStats : public cListObject {
+private:
+  cMutex mutex;
+  bool active; // accessed atomically, because Packet() checks it without locking the mutex
+  cString type;
+  cString name;
+  time_t startTime;
+  cRingBuffer *ringBuffer;
+  uint64_t bytes;
+  uint64_t packets;
+  uint64_t scrambled;
+  uint64_t lost;
+  uint64_t ccErrors;
+  uint64_t lastPacket;
+  uchar continuityCounters[MAXPID]; // the last continuity counter of each PID (0xFF = none yet)
+  cVector<int> errorPids;
+  cVector<int> errorCounts;
+  int maxFill;
+  uint64_t writes;
+  uint64_t writeTime;
+  int maxWriteTime;
+  uint64_t indexWrites;
+  uint64_t rateTime;
+  uint64_t rateBytes;
+  uint64_t ratePackets;
+  uint64_t rateIndexWrites;
+  double bytesPerSecond;
+  double packetsPerSecond;
+  double indexWritesPerSecond;
+  int pendingPackets;   // these are incremented atomically by the thread that calls Packet(),
+  int pendingScrambled; // and taken over by Flush() (which may be called from a different thread)
+  static cMutex streamStatsMutex;
+  static cList<cStreamStats> streamStats;
+  static char *statsFile;
+  void UpdateRates(uint64_t Now);
+  void CountError(int Pid);
+  void ResetCounters(void);
+  void Flush(void);
+  cString ToText(void);
+  cString ToJson(void);
+public:
+  cStreamStats(void);
+  virtual ~cStreamStats();
+  void Start(const char *Type, const char *Name);
+       ///< Starts collecting data for the stream of the given Type ("recorder",
+       ///< "transfer", "device"...) with the given Name, and adds this object to
+       ///< the list of active streams. Any previously collected data is cleared.
+  void Stop(void);
+       ///< Stops collecting data and removes this object from the list of
+       ///< active streams.
+  void SetRingBuffer(cRingBuffer *RingBuffer);
+       ///< Sets the ring buffer this stream is stored in. Its fill level is
+       ///< checked whenever a packet has been counted. Must be called with NULL
+       ///< before the ring buffer is deleted.
+  void Packet(const uchar *Data);
+       ///< Counts the TS packet in Data and checks its continuity counter and
+       ///< scrambling control. To keep the overhead per packet low, the counted
+       ///< packets are added to the data reported by Statistics() in blocks of
+       ///< STREAMSTATSBLOCK packets, so Packet() must always be called from the
+       ///< same thread.
+  void Lost(int Packets = 1) { cMutexLock MutexLock(&mutex); lost += Packets; }
+       ///< Counts the given number of packets as lost (e.g. because a ring
+       ///< buffer was full).
+  void Written(uint64_t MicroSeconds);
+       ///< Records the time it took to write a block of data.
+  void IndexWritten(void) { cMutexLock MutexLock(&mutex); indexWrites++; }
+       ///< Counts an entry written to the index file.
+  static uint64_t Now(void);
+       ///< Returns the current time in microseconds (for use with Written()).
+  static void Statistics(cStringList &Lines, bool Reset = false);
+       ///< Adds one line per active stream to Lines. If Reset is true, the error
+       ///< counters and maximum values are cleared.
+  static void SetStatsFile(const char *FileName);
+       ///< Sets the name of the file the data of all active streams is written to.
+  static void WriteStatsFile(bool Force = false);
+       ///< Writes the data of all active streams into the stats file, if one has
+       ///< been set. This is done at most every STREAMSTATSINTERVAL seconds,
+       ///< unless Force is true.
+  };
+
+#endif //__STREAMSTATS_H
@@ -37,6 +37,8 @@
 #include "recording.h"
 #include "remote.h"
 #include "skins.h"
+#include "status.h"
+#include "streamstats.h"
 #include "timers.h"
 #include "videodir.h"
 
@@ -985,7 +987,39 @@ const char *HelpPages[] = {
   "    Forces an EPG scan. If this is a single DVB device system, the scan\n"
   "    will be done on the primary device unless it is currently recording.",
   "STAT disk\n"
-  "    Return information about disk usage (total, free, percent).",
+  "    Return information about disk usage (total, free, percent).\n"
+  "STAT locks [ reset ]\n"
+  "    Return statistics of the locks on the global lists (channels, timers,\n"
+  "    schedules, recordings): the number of read and write locks, read locks\n"
+  "    that were released right away because the state was unchanged, and\n"
+  "    timeouts, histograms of the times spent waiting for and holding each\n"
+  "    lock, and the threads currently holding it. If 'reset' is given, the\n"
+  "    statistics are cleared after they have been listed.\n"
+  "STAT scan\n"
+  "    Return statistics of the EPG scan: how many transponders have recently\n"
+  "    been scanned, and for each transponder when it has last been scanned,\n"
+  "    the percentage of its EIT tables that were complete at that time, the\n"
+  "    time the scan took and the number of upcoming timers that depend on it.\n"
+  "STAT status [ reset ]\n"
+  "    Return statistics of the asynchronous delivery of status messages to\n"
+  "    plugins: the number of messages delivered and coalesced, the fill level\n"
+  "    of the queue and the time each asynchronous status monitor took to\n"
+  "    process a message. If 'reset' is given, the statistics are cleared after\n"
+  "    they have been listed.\n"
+  "STAT streams [ reset ]\n"
+  "    Return the health and throughput data of all active recordings,\n"
+  "    transfers and devices: the current data rate, the number of packets,\n"
+  "    of scrambled and lost packets and of continuity counter errors (per PID),\n"
+  "    the fill level of the ring buffer (current and maximum), the time it\n"
+  "    took to write the data, the rate at which index entries are written and\n"
+  "    the time since the last packet has been received. If 'reset' is given,\n"
+  "    the error counters and maximum values are cleared after they have been\n"
+  "    listed.\n"
+  "STAT zap [ reset ]\n"
+  "    Return statistics of the channel switches in live view: the time the\n"
+  "    actual switch took, and the time until the PMT of the new channel was\n"
+  "    received. If 'reset' is given, the statistics are cleared after they\n"
+  "    have been listed.",
   "UPDT <settings>\n"
   "    Updates a timer. Settings must be in the same format as returned\n"
   "    by the LSTT command. If a timer with the same channel, day, start\n"
@@ -1729,7 +1763,12 @@ void cSVDRPServer::CmdHITK(const char *Option)
 
 void cSVDRPServer::CmdLSTC(const char *Option)
 {
-  LOCK_CHANNELS_READ;
+  // Replies may take a while, so this works on a snapshot instead of locking the channels:
+  cSnapshot<cChannels> Snapshot = cChannels::GetChannelsSnapshot();
+  const cChannels *Channels = Snapshot.List();
+  const cChannel *LastChannel = Channels->Last();
+  while (LastChannel && LastChannel->GroupSep())
+        LastChannel = Channels->Prev(LastChannel);
   bool WithChannelIds = startswith(Option, ":ids") && (Option[4] == ' ' || Option[4] == 0);
   if (WithChannelIds)
      Option = skipspace(Option + 4);
@@ -1763,12 +1802,12 @@ void cSVDRPServer::CmdLSTC(const char *Option)
            Reply(501, "Channel \"%s\" not defined", Option);
         }
      }
-  else if (cChannels::MaxNumber() >= 1) {
+  else if (LastChannel) {
      for (const cChannel *Channel = Channels->First(); Channel; Channel = Channels->Next(Channel)) {
          if (WithGroupSeps)
             Reply(Channel->Next() ? -250: 250, "%d%s%s %s", Channel->GroupSep() ? 0 : Channel->Number(), (WithChannelIds && !Channel->GroupSep()) ? " " : "", (WithChannelIds && !Channel->GroupSep()) ? *Channel->GetChannelID().ToString() : "", *Channel->ToText());
          else if (!Channel->GroupSep())
-            Reply(Channel->Number() < cChannels::MaxNumber() ? -250 : 250, "%d%s%s %s", Channel->Number(), WithChannelIds ? " " : "", WithChannelIds ? *Channel->GetChannelID().ToString() : "", *Channel->ToText());
+            Reply(Channel != LastChannel ? -250 : 250, "%d%s%s %s", Channel->Number(), WithChannelIds ? " " : "", WithChannelIds ? *Channel->GetChannelID().ToString() : "", *Channel->ToText());
          }
      }
   else
@@ -1947,7 +1986,9 @@ void cSVDRPServer::CmdLSTT(const char *Option)
            p = strtok_r(NULL, delim, &strtok_next);
            }
      }
-  LOCK_TIMERS_READ;
+  // Replies may take a while, so this works on a snapshot instead of locking the timers:
+  cSnapshot<cTimers> Snapshot = cTimers::GetTimersSnapshot();
+  const cTimers *Timers = Snapshot.List();
   if (Id) {
      for (const cTimer *Timer = Timers->First(); Timer; Timer = Timers->Next(Timer)) {
          if (!Timer->Remote()) {
@@ -2479,6 +2520,60 @@ void cSVDRPServer::CmdSTAT(const char *Option)
         int Percent = cVideoDirectory::VideoDiskSpace(&FreeMB, &UsedMB);
         Reply(250, "%dMB %dMB %d%%", FreeMB + UsedMB, FreeMB, Percent);
         }
+     else if (strncasecmp(Option, "LOCKS", 5) == 0 && (!Option[5] || isspace(Option[5]))) {
+        const char *Reset = skipspace(Option + 5);
+        if (!*Reset || strcasecmp(Reset, "RESET") == 0) {
+           cStringList Lines;
+           cStateLock::Statistics(Lines, *Reset);
+           for (int i = 0; i < Lines.Size(); i++)
+               Reply(i < Lines.Size() - 1 ? -250 : 250, "%s", Lines[i]);
+           if (!Lines.Size())
+              Reply(550, "No locks");
+           }
+        else
+           Reply(501, "Invalid Option \"%s\"", Option);
+        }
+     else if (strcasecmp(Option, "SCAN") == 0) {
+        cStringList Lines;
+        EITScanner.Statistics(Lines);
+        for (int i = 0; i < Lines.Size(); i++)
+            Reply(i < Lines.Size() - 1 ? -250 : 250, "%s", Lines[i]);
+        }
+     else if (strncasecmp(Option, "STATUS", 6) == 0 && (!Option[6] || isspace(Option[6]))) {
+        const char *Reset = skipspace(Option + 6);
+        if (!*Reset || strcasecmp(Reset, "RESET") == 0) {
+           cStringList Lines;
+           cStatus::Statistics(Lines, *Reset);
+           for (int i = 0; i < Lines.Size(); i++)
+               Reply(i < Lines.Size() - 1 ? -250 : 250, "%s", Lines[i]);
+           }
+        else
+           Reply(501, "Invalid Option \"%s\"", Option);
+        }
+     else if (strncasecmp(Option, "STREAMS", 7) == 0 && (!Option[7] || isspace(Option[7]))) {
+        const char *Reset = skipspace(Option + 7);
+        if (!*Reset || strcasecmp(Reset, "RESET") == 0) {
+           cStringList Lines;
+           cStreamStats::Statistics(Lines, *Reset);
+           for (int i = 0; i < Lines.Size(); i++)
+               Reply(i < Lines.Size() - 1 ? -250 : 250, "%s", Lines[i]);
+           if (!Lines.Size())
+              Reply(550, "No active streams");
+           }
+        else
+           Reply(501, "Invalid Option \"%s\"", Option);
+        }
+     else if (strncasecmp(Option, "ZAP", 3) == 0 && (!Option[3] || isspace(Option[3]))) {
+        const char *Reset = skipspace(Option + 3);
+        if (!*Reset || strcasecmp(Reset, "RESET") == 0) {
+           cStringList Lines;
+           cDevice::ZapStatistics(Lines, *Reset);
+           for (int i = 0; i < Lines.Size(); i++)
+               Reply(i < Lines.Size() - 1 ? -250 : 250, "%s", Lines[i]);
+           }
+        else
+           Reply(501, "Invalid Option \"%s\"", Option);
+        }
      else
         Reply(501, "Invalid Option \"%s\"", Option);
      }
@@ -29,6 +29,7 @@
 //#define DEBUG_LOCKING  // uncomment this line to activate debug output for locking
 #define DEBUG_LOCKSEQ  // uncomment this line to activate debug output for invalid locking sequence
 //#define DEBUG_LOCKCALL // uncomment this line to activate caller information with DEBUG_LOCKSEQ (WARNING: expensive operation, use only when actually debugging the locking sequence!)
+//#define DEBUG_LOCKCALLERS // uncomment this line to show the call sites of lock holders in the lock statistics (WARNING: expensive operation, takes a backtrace with every lock!)
 
 #ifdef DEBUG_LOCKING
 #define dbglocking(a...) fprintf(stderr, a)
@@ -710,6 +711,57 @@ static cStateLockLog StateLockLog;
 
 // --- cStateLock ------------------------------------------------------------
 
+#define SLS_LOGINTERVAL  3600 // seconds between lock statistics in the log file
+#define SLS_LONGHOLD    1000000 // microseconds after which a lock holder is reported in the log file
+
+pthread_mutex_t cStateLock::listMutex = PTHREAD_MUTEX_INITIALIZER;
+cStateLock *cStateLock::firstLock = NULL;
+
+static uint64_t MicroSeconds(void)
+{
+  struct timespec tp;
+  if (clock_gettime(CLOCK_MONOTONIC, &tp) == 0)
+     return uint64_t(tp.tv_sec) * 1000000 + tp.tv_nsec / 1000;
+  return 0;
+}
+
+static void AtomicMax(uint64_t *Max, uint64_t Value)
+{
+  uint64_t m = __atomic_load_n(Max, __ATOMIC_RELAXED);
+  while (Value > m && !__atomic_compare_exchange_n(Max, &m, Value, true, __ATOMIC_RELAXED, __ATOMIC_RELAXED))
+        ; // m has been reloaded
+}
+
+static int HistogramBucket(uint64_t MicroSeconds)
+{
+  // Bucket n counts the times in the range [2^(n-1), 2^n) microseconds, and the last one everything above:
+  int n = 0;
+  while (MicroSeconds && n < SLS_HISTOGRAM - 1) {
+        MicroSeconds >>= 1;
+        n++;
+        }
+  return n;
+}
+
+static cString TimeString(uint64_t MicroSeconds)
+{
+  if (MicroSeconds < 1000)
+     return cString::sprintf("%dus", int(MicroSeconds));
+  if (MicroSeconds < 1000000)
+     return cString::sprintf("%dms", int(MicroSeconds / 1000));
+  return cString::sprintf("%ds", int(MicroSeconds / 1000000));
+}
+
+static cString HistogramString(const int *Histogram)
+{
+  cString s;
+  for (int i = 0; i < SLS_HISTOGRAM; i++) {
+      if (int n = __atomic_load_n(&Histogram[i], __ATOMIC_RELAXED))
+         s = cString::sprintf("%s %s%s:%d", *s ? *s : "", i < SLS_HISTOGRAM - 1 ? "<" : ">=", *TimeString(uint64_t(1) << (i < SLS_HISTOGRAM - 1 ? i : i - 1)), n);
+      }
+  return *s ? s : cString(" -");
+}
+
 cStateLock::cStateLock(const char *Name)
 :rwLock(true)
 {
@@ -718,6 +770,45 @@ cStateLock::cStateLock(const char *Name)
   state = 0;
   explicitModify = emDisabled;
   syncStateKey = NULL;
+  memset(holders, 0, sizeof(holders));
+  ResetStatistics();
+  nextLock = NULL;
+  if (name) {
+     pthread_mutex_lock(&listMutex);
+     nextLock = firstLock;
+     firstLock = this;
+     pthread_mutex_unlock(&listMutex);
+     }
+}
+
+cStateLock::~cStateLock()
+{
+  if (name) {
+     pthread_mutex_lock(&listMutex);
+     for (cStateLock **sl = &firstLock; *sl; sl = &(*sl)->nextLock) {
+         if (*sl == this) {
+            *sl = nextLock;
+            break;
+            }
+         }
+     pthread_mutex_unlock(&listMutex);
+     }
+}
+
+void cStateLock::ResetStatistics(void)
+{
+  __atomic_store_n(&readLocks, 0, __ATOMIC_RELAXED);
+  __atomic_store_n(&writeLocks, 0, __ATOMIC_RELAXED);
+  __atomic_store_n(&unchanged, 0, __ATOMIC_RELAXED);
+  __atomic_store_n(&timeouts, 0, __ATOMIC_RELAXED);
+  __atomic_store_n(&waitTime, 0, __ATOMIC_RELAXED);
+  __atomic_store_n(&holdTime, 0, __ATOMIC_RELAXED);
+  __atomic_store_n(&maxWaitTime, 0, __ATOMIC_RELAXED);
+  __atomic_store_n(&maxHoldTime, 0, __ATOMIC_RELAXED);
+  for (int i = 0; i < SLS_HISTOGRAM; i++) {
+      __atomic_store_n(&waitHistogram[i], 0, __ATOMIC_RELAXED);
+      __atomic_store_n(&holdHistogram[i], 0, __ATOMIC_RELAXED);
+      }
 }
 
 bool cStateLock::Lock(cStateKey &StateKey, bool Write, int TimeoutMs)
@@ -729,7 +820,43 @@ bool cStateLock::Lock(cStateKey &StateKey, bool Write, int TimeoutMs)
      ABORT;
      return false;
      }
-  if (rwLock.Lock(Write, TimeoutMs)) {
+  uint64_t Start = MicroSeconds();
+  bool Locked = rwLock.Lock(Write, TimeoutMs);
+  uint64_t Now = MicroSeconds();
+  bool Keep = Locked && (Write || state != StateKey.state);
+  uint64_t Wait = Now - Start;
+  __atomic_fetch_add(&waitTime, Wait, __ATOMIC_RELAXED);
+  AtomicMax(&maxWaitTime, Wait);
+  __atomic_fetch_add(&waitHistogram[HistogramBucket(Wait)], 1, __ATOMIC_RELAXED);
+  __atomic_fetch_add(!Locked ? &timeouts : !Keep ? &unchanged : Write ? &writeLocks : &readLocks, 1, __ATOMIC_RELAXED);
+  if (Keep) {
+     StateKey.lockTime = Now;
+     StateKey.holder = -1;
+     for (int i = 0; i < SLS_HOLDERS; i++) {
+         tHolder *h = &holders[i];
+         cStateKey *Free = NULL;
+         if (__atomic_compare_exchange_n(&h->key, &Free, &StateKey, false, __ATOMIC_ACQUIRE, __ATOMIC_RELAXED)) {
+            // The slot now belongs to this key. GetStatistics() ignores data
+            // that has been read while the sequence number was odd or changed:
+            StateKey.holder = i;
+            int Seq = __atomic_load_n(&h->seq, __ATOMIC_RELAXED);
+            __atomic_store_n(&h->seq, Seq + 1, __ATOMIC_RELAXED);
+            __atomic_thread_fence(__ATOMIC_RELEASE);
+            __atomic_store_n(&h->threadId, cThread::ThreadId(), __ATOMIC_RELAXED);
+            __atomic_store_n(&h->write, Write, __ATOMIC_RELAXED);
+            __atomic_store_n(&h->lockTime, Now, __ATOMIC_RELAXED);
+#ifdef DEBUG_LOCKCALLERS
+            void *b[SLS_CALLERS + 1];
+            int n = backtrace(b, SLS_CALLERS + 1); // b[0] is this function
+            for (int j = 0; j < SLS_CALLERS; j++)
+                __atomic_store_n(&h->caller[j], j + 1 < n ? b[j + 1] : NULL, __ATOMIC_RELAXED);
+#endif
+            __atomic_store_n(&h->seq, Seq + 2, __ATOMIC_RELEASE);
+            break;
+            }
+         }
+     }
+  if (Locked) {
      dbglockseq(name, true, Write);
      StateKey.stateLock = this;
      if (Write) {
@@ -738,7 +865,7 @@ bool cStateLock::Lock(cStateKey &StateKey, bool Write, int TimeoutMs)
         StateKey.write = true;
         return true;
         }
-     else if (state != StateKey.state) {
+     else if (Keep) {
         dbglocking("%5d %-12s %10p   locked read\n", cThread::ThreadId(), name, &StateKey);
         return true;
         }
@@ -772,7 +899,15 @@ void cStateLock::Unlock(cStateKey &StateKey, bool IncState)
   if (StateKey.write && (IncState && explicitModify != emArmed || explicitModify == emEnabled)) {
      if (syncStateKey && syncStateKey->state == state)
         syncStateKey->state++;
-     state++;
+     __atomic_store_n(&state, state + 1, __ATOMIC_RELEASE); // see State()
+     }
+  uint64_t Hold = MicroSeconds() - StateKey.lockTime;
+  __atomic_fetch_add(&holdTime, Hold, __ATOMIC_RELAXED);
+  AtomicMax(&maxHoldTime, Hold);
+  __atomic_fetch_add(&holdHistogram[HistogramBucket(Hold)], 1, __ATOMIC_RELAXED);
+  if (StateKey.holder >= 0) {
+     __atomic_store_n(&holders[StateKey.holder].key, (cStateKey *)NULL, __ATOMIC_RELEASE);
+     StateKey.holder = -1;
      }
   StateKey.state = state;
   StateKey.stateLock = NULL;
@@ -832,6 +967,86 @@ void cStateLock::SetModified(void)
   explicitModify = emEnabled;
 }
 
+void cStateLock::GetStatistics(cStringList &Lines, uint64_t LongHoldTime)
+{
+  // Copy the holders' data first, because resolving their call sites takes a while:
+  tHolder Holders[SLS_HOLDERS];
+  int NumHolders = 0;
+  int ReadLocks = __atomic_load_n(&readLocks, __ATOMIC_RELAXED);
+  int WriteLocks = __atomic_load_n(&writeLocks, __ATOMIC_RELAXED);
+  int Unchanged = __atomic_load_n(&unchanged, __ATOMIC_RELAXED);
+  int Timeouts = __atomic_load_n(&timeouts, __ATOMIC_RELAXED);
+  int Locks = ReadLocks + WriteLocks;
+  int Attempts = Locks + Unchanged + Timeouts;
+  cString Summary = cString::sprintf("%s: %d read, %d write, %d unchanged, %d timeouts, wait avg %s max %s, hold avg %s max %s", name, ReadLocks, WriteLocks, Unchanged, Timeouts,
+    *TimeString(Attempts ? __atomic_load_n(&waitTime, __ATOMIC_RELAXED) / Attempts : 0), *TimeString(__atomic_load_n(&maxWaitTime, __ATOMIC_RELAXED)),
+    *TimeString(Locks ? __atomic_load_n(&holdTime, __ATOMIC_RELAXED) / Locks : 0), *TimeString(__atomic_load_n(&maxHoldTime, __ATOMIC_RELAXED)));
+  cString WaitHistogram = HistogramString(waitHistogram);
+  cString HoldHistogram = HistogramString(holdHistogram);
+  uint64_t Now = MicroSeconds();
+  for (int i = 0; i < SLS_HOLDERS; i++) {
+      tHolder *h = &holders[i];
+      tHolder *c = &Holders[NumHolders];
+      int Seq = __atomic_load_n(&h->seq, __ATOMIC_ACQUIRE);
+      if ((Seq & 1) || !__atomic_load_n(&h->key, __ATOMIC_ACQUIRE))
+         continue; // being filled or free
+      c->threadId = __atomic_load_n(&h->threadId, __ATOMIC_RELAXED);
+      c->write = __atomic_load_n(&h->write, __ATOMIC_RELAXED);
+      c->lockTime = __atomic_load_n(&h->lockTime, __ATOMIC_RELAXED);
+      for (int j = 0; j < SLS_CALLERS; j++)
+          c->caller[j] = __atomic_load_n(&h->caller[j], __ATOMIC_RELAXED);
+      __atomic_thread_fence(__ATOMIC_ACQUIRE);
+      if (__atomic_load_n(&h->seq, __ATOMIC_RELAXED) != Seq)
+         continue; // taken by a different key in the meantime
+      if (Now - c->lockTime >= LongHoldTime)
+         NumHolders++;
+      }
+  Lines.Append(strdup(Summary));
+  Lines.Append(strdup(cString::sprintf("  wait:%s", *WaitHistogram)));
+  Lines.Append(strdup(cString::sprintf("  hold:%s", *HoldHistogram)));
+  for (int i = 0; i < NumHolders; i++) {
+      tHolder *h = &Holders[i];
+      uint64_t HoldTime = Now - h->lockTime;
+      cString Caller;
+      int n = 0;
+      while (n < SLS_CALLERS && h->caller[n])
+            n++;
+      if (char **s = n ? backtrace_symbols(h->caller, n) : NULL) {
+         for (int j = 0; j < n; j++)
+             Caller = cString::sprintf("%s%s%s", *Caller ? *Caller : "", *Caller ? " < " : "", *cBackTrace::Demangle(s[j]));
+         free(s);
+         }
+      Lines.Append(strdup(cString::sprintf("  held by thread %d (%s) for %s%s%s", h->threadId, h->write ? "write" : "read", *TimeString(HoldTime), *Caller ? ": " : "", *Caller ? *Caller : "")));
+      }
+}
+
+void cStateLock::Statistics(cStringList &Lines, bool Reset)
+{
+  pthread_mutex_lock(&listMutex);
+  for (cStateLock *sl = firstLock; sl; sl = sl->nextLock) {
+      sl->GetStatistics(Lines);
+      if (Reset)
+         sl->ResetStatistics();
+      }
+  pthread_mutex_unlock(&listMutex);
+}
+
+void cStateLock::LogStatistics(bool Force)
+{
+  static time_t LastLog = time(NULL);
+  time_t Now = time(NULL);
+  if (Now - LastLog < SLS_LOGINTERVAL && !Force)
+     return;
+  LastLog = Now;
+  cStringList Lines;
+  pthread_mutex_lock(&listMutex);
+  for (cStateLock *sl = firstLock; sl; sl = sl->nextLock)
+      sl->GetStatistics(Lines, SLS_LONGHOLD);
+  pthread_mutex_unlock(&listMutex);
+  for (int i = 0; i < Lines.Size(); i++)
+      isyslog("lock statistics: %s", Lines[i]);
+}
+
 // --- cStateKey -------------------------------------------------------------
 
 cStateKey::cStateKey(bool IgnoreFirst)
@@ -839,6 +1054,8 @@ cStateKey::cStateKey(bool IgnoreFirst)
   stateLock = NULL;
   write = false;
   state = 0;
+  holder = -1;
+  lockTime = 0;
   if (!IgnoreFirst)
      Reset();
 }
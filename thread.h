@@ -11,6 +11,7 @@
 #define __THREAD_H
 
 #include <pthread.h>
+#include <stdint.h>
 #include <stdio.h>
 #include <sys/types.h>
 
@@ -167,6 +168,11 @@ public:
 #define LOCK_THREAD cThreadLock ThreadLock(this)
 
 class cStateKey;
+class cStringList;
+
+#define SLS_HISTOGRAM 24 // number of log2 buckets for wait and hold times (in microseconds)
+#define SLS_CALLERS    3 // number of stack frames recorded as the call site of a lock (only with DEBUG_LOCKCALLERS in thread.c)
+#define SLS_HOLDERS   16 // max. number of threads listed as currently holding a lock
 
 class cStateLock {
   friend class cStateKey;
@@ -178,6 +184,32 @@ private:
   int state;
   int explicitModify;
   cStateKey *syncStateKey;
+  // Statistics:
+  static pthread_mutex_t listMutex;
+  static cStateLock *firstLock;
+  // The statistics are updated with atomic operations, so that they don't add
+  // another lock to every Lock()/Unlock():
+  cStateLock *nextLock;
+  struct tHolder {
+    cStateKey *key; // the key holding the lock (NULL = slot is free)
+    int seq;        // incremented before and after the slot is filled
+    tThreadId threadId;
+    bool write;
+    uint64_t lockTime;
+    void *caller[SLS_CALLERS];
+    } holders[SLS_HOLDERS];
+  int readLocks;
+  int writeLocks;
+  int unchanged;
+  int timeouts;
+  uint64_t waitTime;
+  uint64_t holdTime;
+  uint64_t maxWaitTime;
+  uint64_t maxHoldTime;
+  int waitHistogram[SLS_HISTOGRAM];
+  int holdHistogram[SLS_HISTOGRAM];
+  void ResetStatistics(void);
+  void GetStatistics(cStringList &Lines, uint64_t LongHoldTime = 0);
   void Unlock(cStateKey &StateKey, bool IncState = true);
        ///< Releases a lock that has been obtained by a previous call to Lock()
        ///< with the given StateKey. If this was a write-lock, and IncState is true,
@@ -185,6 +217,7 @@ private:
        ///< of the lock will be copied to the StateKey's state.
 public:
   cStateLock(const char *Name = NULL);
+  ~cStateLock();
   bool Lock(cStateKey &StateKey, bool Write = false, int TimeoutMs = 0);
        ///< Tries to get a lock and returns true if successful.
        ///< If TimoutMs is not 0, it waits for the given number of milliseconds
@@ -228,6 +261,21 @@ public:
        ///< Sets this lock to have its state incremented when the current write lock
        ///< state key is removed. Must have called SetExplicitModify() before calling
        ///< this function.
+  int State(void) const { return __atomic_load_n(&state, __ATOMIC_ACQUIRE); }
+       ///< Returns the current state of this lock. This can be called without
+       ///< holding the lock, to find out whether the protected data has been
+       ///< modified since a previous call.
+  static void Statistics(cStringList &Lines, bool Reset = false);
+       ///< Appends the statistics of all named locks to Lines. For each lock
+       ///< this is the number of read and write locks, read locks that were
+       ///< released right away because the state was unchanged, and timeouts,
+       ///< histograms of the times spent waiting for and holding the lock, as well as the
+       ///< threads currently holding it (and their call sites, if thread.c has
+       ///< been compiled with DEBUG_LOCKCALLERS). If Reset is true, the counters
+       ///< and histograms are cleared afterwards.
+  static void LogStatistics(bool Force = false);
+       ///< Writes the lock statistics to the log file, at most once per hour
+       ///< (unless Force is true).
   };
 
 class cStateKey {
@@ -237,6 +285,9 @@ private:
   bool write;
   int state;
   bool timedOut;
+  // Statistics:
+  int holder; // this key's slot in the lock's holders (-1 = none)
+  uint64_t lockTime;
 public:
   cStateKey(bool IgnoreFirst = false);
        ///< Sets up a new state key. If IgnoreFirst is true, the first use
@@ -925,6 +925,7 @@ void cTimer::OnOff(void)
 // --- cTimers ---------------------------------------------------------------
 
 cTimers cTimers::timers;
+cSnapshots<cTimers> cTimers::snapshots;
 int cTimers::lastTimerId = 0;
 
 cTimers::cTimers(void)
@@ -933,6 +934,20 @@ cTimers::cTimers(void)
   lastDeleteExpired = 0;
 }
 
+cTimers::cTimers(const cTimers &Timers)
+{
+  lastDeleteExpired = Timers.lastDeleteExpired;
+  for (const cTimer *Timer = Timers.First(); Timer; Timer = Timers.Next(Timer)) {
+      cTimer *Copy = new cTimer(*Timer);
+      // The events may be deleted once the original timers let go of them:
+      if (Copy->event) {
+         Copy->event->DecNumTimers();
+         Copy->event = NULL;
+         }
+      cListBase::Add(Copy); // keeps the timer's id and doesn't notify any status monitors
+      }
+}
+
 bool cTimers::Load(const char *FileName)
 {
   LOCK_TIMERS_WRITE;
@@ -1051,6 +1066,11 @@ cTimers *cTimers::GetTimersWrite(cStateKey &StateKey, int TimeoutMs)
   return timers.Lock(StateKey, true, TimeoutMs) ? &timers : NULL;
 }
 
+cSnapshot<cTimers> cTimers::GetTimersSnapshot(void)
+{
+  return snapshots.Get(timers);
+}
+
 void cTimers::Add(cTimer *Timer, cTimer *After)
 {
   if (!Timer->Remote())
@@ -30,6 +30,7 @@ class cTimers;
 
 class cTimer : public cListObject {
   friend class cMenuEditTimer;
+  friend class cTimers;
 private:
   int id;
   mutable time_t startTime, stopTime;
@@ -127,10 +128,14 @@ public:
 class cTimers : public cConfig<cTimer> {
 private:
   static cTimers timers;
+  static cSnapshots<cTimers> snapshots;
   static int lastTimerId;
   time_t lastDeleteExpired;
 public:
   cTimers(void);
+  cTimers(const cTimers &Timers);
+      ///< Creates a full copy of the given Timers (which must be locked),
+      ///< which is not itself subject to locking. Used for snapshots.
   static const cTimers *GetTimersRead(cStateKey &StateKey, int TimeoutMs = 0);
       ///< Gets the list of timers for read access. If TimeoutMs is given,
       ///< it will wait that long to get a read lock before giving up.
@@ -177,6 +182,23 @@ public:
       ///<    // access the timers
       ///<    StateKey.Remove();
       ///<    }
+  static cSnapshot<cTimers> GetTimersSnapshot(void);
+      ///< Gets a read-only snapshot of the list of timers. The snapshot is a copy
+      ///< of the list as it was after the most recent modification, and can be
+      ///< accessed without any locking for as long as the returned cSnapshot
+      ///< exists. This is meant for code that only needs a consistent view of
+      ///< the timers and may take a while to process it (like sending them over
+      ///< a network connection), so that it doesn't block (and isn't blocked by)
+      ///< threads that modify the list. Taking a snapshot is cheap as long as the
+      ///< list hasn't been modified since the previous one. If a writer is busy
+      ///< with the list, the previous snapshot is returned instead of waiting.
+      ///< Note that the timers in a snapshot refer to the channels in the global
+      ///< list of channels, but are not linked to any EPG events (their Event()
+      ///< is always NULL).
+      ///< A typical code sequence would look like this:
+      ///< cSnapshot<cTimers> Snapshot = cTimers::GetTimersSnapshot();
+      ///< const cTimers *Timers = Snapshot.List();
+      ///< // access the timers
   static bool Load(const char *FileName);
   static int NewTimerId(void);
   const cTimer *GetById(int Id, const char *Remote = NULL) const;
@@ -0,0 +1,653 @@
+/*
+ * timeshift.c: Timeshift buffer for live video
+ *
+ * See the main source file 'vdr.c' for copyright information and
+ * how to reach the author.
+ *
+ * $Id$
+ */
+
+#include "timeshift.h"
+#include <fcntl.h>
+#include <unistd.h>
+#include "interface.h"
+#include "recorder.h"
+#include "recording.h"
+#include "status.h"
+#include "timers.h"
+#include "videodir.h"
+
+#define TIMESHIFTBUFSIZE  (MEGABYTE(10) / TS_SIZE * TS_SIZE) // multiple of TS_SIZE
+#define TIMESHIFTFRAMES   8192 // initial number of entries in the frame index, grows as needed
+
+#define MODETIMEOUT          3 // seconds
+#define PROGRESSTIMEOUT    100 // milliseconds to wait before updating the replay progress display
+
+// --- cTimeshiftSaver -------------------------------------------------------
+
+class cTimeshiftSaver : public cThread {
+private:
+  cTimeshiftBuffer *buffer;
+  int from, to;
+protected:
+  virtual void Action(void);
+public:
+  cTimeshiftSaver(cTimeshiftBuffer *Buffer, int From, int To);
+  virtual ~cTimeshiftSaver();
+  };
+
+cTimeshiftSaver::cTimeshiftSaver(cTimeshiftBuffer *Buffer, int From, int To)
+:cThread("timeshift saving", true)
+{
+  buffer = Buffer;
+  from = From;
+  to = To;
+}
+
+cTimeshiftSaver::~cTimeshiftSaver()
+{
+  Cancel(3);
+}
+
+void cTimeshiftSaver::Action(void)
+{
+  cString FileName;
+  {
+    LOCK_CHANNELS_READ; // the timer and the recording refer to the channel
+    const cChannel *Channel = Channels->GetByNumber(buffer->ChannelNumber());
+    if (!Channel)
+       return;
+    cTimer Timer(true, false, Channel);
+    cStateKey SchedulesStateKey;
+    cSchedules::GetSchedulesRead(SchedulesStateKey);
+    cRecording Recording(&Timer, Timer.Event());
+    FileName = Recording.FileName();
+    bool Ok = MakeDirs(FileName, true);
+    if (Ok)
+       Recording.WriteInfo();
+    SchedulesStateKey.Remove();
+    if (!Ok)
+       return;
+  }
+  isyslog("saving timeshift buffer to %s", *FileName);
+  cRecordingInfo RecordingInfo(FileName);
+  if (RecordingInfo.Read() && buffer->FramesPerSecond() > 0 && !DoubleEqual(RecordingInfo.FramesPerSecond(), buffer->FramesPerSecond())) {
+     RecordingInfo.SetFramesPerSecond(buffer->FramesPerSecond());
+     RecordingInfo.Write();
+     }
+  cFileName ToFileName(FileName, true);
+  cUnbufferedFile *ToFile = ToFileName.Open();
+  cIndexFile Index(FileName, true);
+  uchar *Data = MALLOC(uchar, MAXFRAMESIZE);
+  off_t FileSize = 0;
+  bool Ok = ToFile && Data;
+  for (int i = from; Ok && i <= to && Running(); i++) {
+      bool Independent;
+      int Length = buffer->ReadFrame(i, Data, MAXFRAMESIZE, &Independent);
+      if (Length < 0) {
+         esyslog("ERROR: timeshift buffer has been overwritten while saving it");
+         Ok = false;
+         break;
+         }
+      if (Independent && FileSize > MEGABYTE(off_t(Setup.MaxVideoFileSize))) {
+         if (!(ToFile = ToFileName.NextFile())) {
+            Ok = false;
+            break;
+            }
+         FileSize = 0;
+         }
+      Index.Write(Independent, ToFileName.Number(), FileSize);
+      if (ToFile->Write(Data, Length) < 0) {
+         LOG_ERROR_STR(ToFileName.Name());
+         Ok = false;
+         break;
+         }
+      FileSize += Length;
+      }
+  free(Data);
+  ToFileName.Close();
+  LOCK_RECORDINGS_WRITE;
+  Recordings->AddByName(FileName);
+  if (Ok && Running())
+     isyslog("saved timeshift buffer to %s", *FileName);
+  else
+     esyslog("ERROR: timeshift buffer has not been completely saved to %s", *FileName);
+}
+
+// --- cTimeshiftBuffer ------------------------------------------------------
+
+cTimeshiftBuffer::cTimeshiftBuffer(const cChannel *Channel, int Priority)
+:cReceiver(Channel, Priority)
+,cThread("timeshift")
+{
+  channelNumber = Channel->Number();
+  ringBuffer = new cRingBufferLinear(TIMESHIFTBUFSIZE, MIN_TS_PACKETS_FOR_FRAME_DETECTOR * TS_SIZE, true, "Timeshift");
+  ringBuffer->SetTimeouts(0, 100);
+  frameDetector = NewFrameDetector(Channel);
+  patPmtGenerator.SetChannel(Channel);
+  writePosition = 0;
+  maxFrames = TIMESHIFTFRAMES;
+  frames = MALLOC(tTimeshiftFrame, maxFrames);
+  numFrames = 0;
+  head = 0;
+  firstFrame = 0;
+  saver = NULL;
+  if (Setup.TimeshiftSize < MINTIMESHIFTSIZE)
+     isyslog("timeshift buffer size of %d MB is too small - using %d MB", Setup.TimeshiftSize, MINTIMESHIFTSIZE);
+  size = MEGABYTE(int64_t(max(Setup.TimeshiftSize, MINTIMESHIFTSIZE))) / TS_SIZE * TS_SIZE;
+  fileName = AddDirectory(cVideoDirectory::Name(), TIMESHIFTFILE);
+  fd = open(fileName, O_RDWR | O_CREAT | O_LARGEFILE, DEFFILEMODE);
+  if (fd >= 0) {
+     // The file is allocated only once, and then reused every time:
+     struct stat st;
+     if (fstat(fd, &st) == 0 && st.st_size > size && ftruncate(fd, size) < 0)
+        LOG_ERROR_STR(*fileName);
+     if (int Error = posix_fallocate(fd, 0, size)) {
+        errno = Error;
+        LOG_ERROR_STR(*fileName);
+        close(fd);
+        fd = -1;
+        }
+     }
+  else
+     LOG_ERROR_STR(*fileName);
+}
+
+cTimeshiftBuffer::~cTimeshiftBuffer()
+{
+  Detach();
+  delete saver;
+  if (fd >= 0)
+     close(fd);
+  free(frames);
+  delete frameDetector;
+  delete ringBuffer;
+}
+
+void cTimeshiftBuffer::Activate(bool On)
+{
+  if (On)
+     Start();
+  else
+     Cancel(3);
+}
+
+void cTimeshiftBuffer::Receive(const uchar *Data, int Length)
+{
+  if (Running()) {
+     int p = ringBuffer->Put(Data, Length);
+     if (p != Length && Running())
+        ringBuffer->ReportOverflow(Length - p);
+     }
+}
+
+bool cTimeshiftBuffer::Write(const uchar *Data, int Length)
+{
+  off_t Offset = writePosition % size;
+  while (Length > 0) {
+        int n = int(min(int64_t(Length), size - Offset));
+        if (pwrite(fd, Data, n, Offset) != n) {
+           LOG_ERROR_STR(*fileName);
+           return false;
+           }
+        Data += n;
+        Length -= n;
+        cMutexLock MutexLock(&mutex);
+        writePosition += n;
+        // Drop the frames that have just been overwritten:
+        while (numFrames && frames[head].position < writePosition - size) {
+              head = (head + 1) % maxFrames;
+              numFrames--;
+              firstFrame++;
+              }
+        Offset = 0;
+        }
+  return true;
+}
+
+void cTimeshiftBuffer::AddFrame(bool Independent)
+{
+  cMutexLock MutexLock(&mutex);
+  if (numFrames == maxFrames) {
+     if (tTimeshiftFrame *NewFrames = MALLOC(tTimeshiftFrame, maxFrames * 2)) {
+        for (int i = 0; i < numFrames; i++)
+            NewFrames[i] = frames[(head + i) % maxFrames];
+        free(frames);
+        frames = NewFrames;
+        maxFrames *= 2;
+        head = 0;
+        }
+     else {
+        esyslog("ERROR: can't allocate timeshift frame index");
+        head = (head + 1) % maxFrames;
+        numFrames--;
+        firstFrame++;
+        }
+     }
+  tTimeshiftFrame *Frame = &frames[(head + numFrames) % maxFrames];
+  Frame->position = writePosition;
+  Frame->independent = Independent;
+  numFrames++;
+}
+
+void cTimeshiftBuffer::Action(void)
+{
+  bool FirstIframeSeen = false;
+  while (Running()) {
+        int r;
+        uchar *b = ringBuffer->Get(r);
+        if (b) {
+           int Count = frameDetector->Analyze(b, r);
+           if (Count) {
+              if (frameDetector->Synced() && (FirstIframeSeen || frameDetector->IndependentFrame())) {
+                 FirstIframeSeen = true; // start buffering with the first I-frame
+                 if (frameDetector->NewFrame())
+                    AddFrame(frameDetector->IndependentFrame());
+                 bool Ok = true;
+                 if (frameDetector->IndependentFrame()) {
+                    Ok = Write(patPmtGenerator.GetPat(), TS_SIZE);
+                    int Index = 0;
+                    while (uchar *pmt = Ok ? patPmtGenerator.GetPmt(Index) : NULL)
+                          Ok = Write(pmt, TS_SIZE);
+                    }
+                 if (!Ok || !Write(b, Count))
+                    break;
+                 }
+              ringBuffer->Del(Count);
+              }
+           }
+        }
+}
+
+bool cTimeshiftBuffer::GetFrames(int &First, int &Last)
+{
+  cMutexLock MutexLock(&mutex);
+  if (numFrames > 1) { // the last frame is not yet complete
+     First = firstFrame;
+     Last = firstFrame + numFrames - 2;
+     return true;
+     }
+  return false;
+}
+
+int cTimeshiftBuffer::GetIFrame(int Index, bool Forward)
+{
+  cMutexLock MutexLock(&mutex);
+  int Last = firstFrame + numFrames - 2;
+  Index = constrain(Index, firstFrame, Last);
+  while (Index >= firstFrame && Index <= Last) {
+        if (Frame(Index)->independent)
+           return Index;
+        Index += Forward ? 1 : -1;
+        }
+  return -1;
+}
+
+int cTimeshiftBuffer::ReadFrame(int Index, uchar *Data, int Size, bool *Independent)
+{
+  int64_t Position;
+  int Length;
+  {
+    cMutexLock MutexLock(&mutex);
+    if (Index < firstFrame || Index > firstFrame + numFrames - 2)
+       return -1;
+    Position = Frame(Index)->position;
+    Length = int(Frame(Index + 1)->position - Position);
+    if (Independent)
+       *Independent = Frame(Index)->independent;
+  }
+  if (Length > Size) {
+     esyslog("ERROR: frame larger than buffer (%d > %d)", Length, Size);
+     Length = Size;
+     }
+  off_t Offset = Position % size;
+  for (int Done = 0; Done < Length; ) {
+      int n = int(min(int64_t(Length - Done), size - Offset));
+      if (pread(fd, Data + Done, n, Offset) != n) {
+         LOG_ERROR_STR(*fileName);
+         return -1;
+         }
+      Done += n;
+      Offset = 0;
+      }
+  cMutexLock MutexLock(&mutex);
+  if (Position < writePosition - size)
+     return -1; // the data has been overwritten while we were reading it
+  return Length;
+}
+
+bool cTimeshiftBuffer::Save(int From, int To)
+{
+  cMutexLock MutexLock(&mutex);
+  if (Saving())
+     return false;
+  delete saver;
+  saver = new cTimeshiftSaver(this, From, To);
+  saver->Start();
+  return true;
+}
+
+bool cTimeshiftBuffer::Saving(void)
+{
+  cMutexLock MutexLock(&mutex);
+  return saver && saver->Active();
+}
+
+// --- cTimeshiftPlayer ------------------------------------------------------
+
+cTimeshiftPlayer::cTimeshiftPlayer(cTimeshiftBuffer *Buffer)
+:cThread("timeshift replay")
+{
+  buffer = Buffer;
+  frame = MALLOC(uchar, MAXFRAMESIZE);
+  length = 0;
+  done = 0;
+  readFrame = -1;
+  paused = true; // live video is paused right away
+  atEnd = false;
+}
+
+cTimeshiftPlayer::~cTimeshiftPlayer()
+{
+  Detach();
+  free(frame);
+}
+
+void cTimeshiftPlayer::Activate(bool On)
+{
+  if (On)
+     Start();
+  else
+     Cancel(9);
+}
+
+void cTimeshiftPlayer::Action(void)
+{
+  cPoller Poller;
+  while (Running()) {
+        bool Sleep = false;
+        bool Poll = false;
+        {
+          LOCK_THREAD;
+          int First, Last;
+          if (readFrame < 0) {
+             // Show the first frame as soon as it is available:
+             if (buffer->GetFrames(First, Last))
+                Goto(First);
+             Sleep = true;
+             }
+          else if (paused)
+             Sleep = true;
+          else {
+             if (done >= length) {
+                length = done = 0;
+                if (buffer->GetFrames(First, Last)) {
+                   if (readFrame < First - 1) {
+                      // We have been paused for longer than the buffer can hold:
+                      readFrame = buffer->GetIFrame(First, true) - 1;
+                      DeviceClear();
+                      }
+                   if (readFrame < Last) {
+                      int l = buffer->ReadFrame(readFrame + 1, frame, MAXFRAMESIZE);
+                      if (l > 0) {
+                         readFrame++;
+                         length = l;
+                         }
+                      }
+                   atEnd = readFrame >= Last;
+                   }
+                Sleep = !length;
+                }
+             if (done < length) {
+                int w = PlayTs(frame + done, length - done);
+                if (w > 0)
+                   done += w;
+                else if (w < 0 && FATALERRNO) {
+                   LOG_ERROR;
+                   break;
+                   }
+                else
+                   Poll = true;
+                }
+             }
+        }
+        if (Sleep)
+           cCondWait::SleepMs(10);
+        else if (Poll)
+           DevicePoll(Poller, 10);
+        }
+}
+
+void cTimeshiftPlayer::Pause(void)
+{
+  LOCK_THREAD;
+  if (!paused) {
+     DeviceFreeze();
+     paused = true;
+     }
+}
+
+void cTimeshiftPlayer::Play(void)
+{
+  LOCK_THREAD;
+  if (paused) {
+     DevicePlay();
+     paused = false;
+     }
+}
+
+void cTimeshiftPlayer::Goto(int Index)
+{
+  LOCK_THREAD;
+  int i = buffer->GetIFrame(Index, false);
+  if (i < 0)
+     i = buffer->GetIFrame(Index, true);
+  if (i < 0)
+     return;
+  DeviceClear();
+  length = done = 0;
+  readFrame = i - 1;
+  atEnd = false;
+  if (paused) {
+     int l = buffer->ReadFrame(i, frame, MAXFRAMESIZE);
+     if (l > 0)
+        DeviceStillPicture(frame, l);
+     }
+  else
+     DevicePlay();
+}
+
+void cTimeshiftPlayer::SkipSeconds(int Seconds)
+{
+  LOCK_THREAD;
+  if (readFrame >= 0)
+     Goto(readFrame + int(round(Seconds * FramesPerSecond())));
+}
+
+int cTimeshiftPlayer::CurrentFrame(void)
+{
+  LOCK_THREAD;
+  return readFrame;
+}
+
+bool cTimeshiftPlayer::GetIndex(int &Current, int &Total, bool SnapToIFrame)
+{
+  int First, Last;
+  if (buffer->GetFrames(First, Last)) {
+     Current = max(CurrentFrame() - First, 0);
+     Total = Last - First;
+     return true;
+     }
+  return false;
+}
+
+bool cTimeshiftPlayer::GetReplayMode(bool &Play, bool &Forward, int &Speed)
+{
+  Play = !paused;
+  Forward = true;
+  Speed = -1;
+  return true;
+}
+
+// --- cTimeshiftControl -----------------------------------------------------
+
+cTimeshiftControl::cTimeshiftControl(cTimeshiftBuffer *Buffer)
+:cControl(timeshiftPlayer = new cTimeshiftPlayer(Buffer))
+{
+  buffer = Buffer;
+  displayReplay = NULL;
+  visible = false;
+  timeoutShow = 0;
+  cStatus::MsgReplaying(this, GetHeader(), NULL, true);
+}
+
+cTimeshiftControl::~cTimeshiftControl()
+{
+  Hide();
+  cStatus::MsgReplaying(this, NULL, NULL, false);
+  delete timeshiftPlayer;
+  delete buffer;
+}
+
+cString cTimeshiftControl::GetHeader(void)
+{
+  LOCK_CHANNELS_READ;
+  if (const cChannel *Channel = Channels->GetByNumber(buffer->ChannelNumber()))
+     return cString::sprintf("%s - %s", tr("Timeshift"), Channel->Name());
+  return tr("Timeshift");
+}
+
+void cTimeshiftControl::Hide(void)
+{
+  if (visible) {
+     delete displayReplay;
+     displayReplay = NULL;
+     SetNeedsFastResponse(false);
+     visible = false;
+     }
+}
+
+void cTimeshiftControl::ShowTimed(int Seconds)
+{
+  ShowProgress();
+  timeoutShow = (visible && Seconds > 0) ? time(NULL) + Seconds : 0;
+}
+
+void cTimeshiftControl::ShowProgress(void)
+{
+  if (visible && !updateTimer.TimedOut())
+     return;
+  int Current, Total;
+  if (timeshiftPlayer->GetIndex(Current, Total) && Total > 0) {
+     if (!visible) {
+        displayReplay = Skins.Current()->DisplayReplay(false);
+        displayReplay->SetTitle(GetHeader());
+        SetNeedsFastResponse(true);
+        visible = true;
+        }
+     bool Play, Forward;
+     int Speed;
+     timeshiftPlayer->GetReplayMode(Play, Forward, Speed);
+     displayReplay->SetMode(Play, Forward, Speed);
+     displayReplay->SetProgress(Current, Total);
+     displayReplay->SetCurrent(IndexToHMSF(Current, false, FramesPerSecond()));
+     displayReplay->SetTotal(IndexToHMSF(Total, false, FramesPerSecond()));
+     displayReplay->Flush();
+     updateTimer.Set(PROGRESSTIMEOUT);
+     }
+}
+
+void cTimeshiftControl::Save(void)
+{
+  int First, Last;
+  if (buffer->Saving())
+     Skins.Message(mtWarning, tr("Timeshift buffer is already being saved!"));
+  else if (buffer->GetFrames(First, Last)) {
+     // Save everything from the current position up to the live video:
+     int From = buffer->GetIFrame(timeshiftPlayer->CurrentFrame(), false);
+     if (From < 0)
+        From = buffer->GetIFrame(First, true);
+     if (From >= 0 && buffer->Save(From, Last))
+        Skins.Message(mtInfo, tr("Saving timeshift buffer..."));
+     }
+}
+
+eOSState cTimeshiftControl::ProcessKey(eKeys Key)
+{
+  if (!timeshiftPlayer->Paused() && timeshiftPlayer->AtEnd() && !buffer->Saving())
+     return osEnd; // replay has caught up with live video (ending it would cancel saving the buffer)
+  if (visible) {
+     if (timeoutShow && time(NULL) > timeoutShow) {
+        Hide();
+        timeoutShow = 0;
+        }
+     else
+        ShowProgress();
+     }
+  switch (int(Key)) {
+    case kPlayPause:
+    case kPause:   if (timeshiftPlayer->Paused())
+                      timeshiftPlayer->Play();
+                   else
+                      timeshiftPlayer->Pause();
+                   ShowTimed(MODETIMEOUT);
+                   break;
+    case kPlay:    timeshiftPlayer->Play();
+                   ShowTimed(MODETIMEOUT);
+                   break;
+    case kLeft|k_Repeat:
+    case kLeft:
+    case kFastRew|k_Repeat:
+    case kFastRew:
+    case kGreen|k_Repeat:
+    case kGreen:   timeshiftPlayer->SkipSeconds(-Setup.SkipSeconds);
+                   ShowTimed(MODETIMEOUT);
+                   break;
+    case kRight|k_Repeat:
+    case kRight:
+    case kFastFwd|k_Repeat:
+    case kFastFwd:
+    case kYellow|k_Repeat:
+    case kYellow:  timeshiftPlayer->SkipSeconds(Setup.SkipSeconds);
+                   ShowTimed(MODETIMEOUT);
+                   break;
+    case kRecord:  Save();
+                   break;
+    case kOk:      if (visible && !timeoutShow)
+                      Hide();
+                   else
+                      ShowTimed();
+                   break;
+    case kStop:
+    case kBlue:
+    case kBack:    if (buffer->Saving() && !Interface->Confirm(tr("Timeshift buffer is being saved - stop anyway?")))
+                      break;
+                   return osEnd;
+    default:       return osUnknown;
+    }
+  return osContinue;
+}
+
+bool cTimeshiftControl::PauseLiveVideo(void)
+{
+  cTimeshiftBuffer *Buffer = NULL;
+  cDevice *Device = NULL;
+  {
+    LOCK_CHANNELS_READ;
+    const cChannel *Channel = Channels->GetByNumber(cDevice::CurrentChannel());
+    if (!Channel)
+       return false;
+    Device = cDevice::GetDevice(Channel, Setup.PausePriority, false);
+    if (!Device || !Device->SwitchChannel(Channel, false))
+       return false;
+    Buffer = new cTimeshiftBuffer(Channel, Setup.PausePriority);
+  }
+  if (!Buffer->Ok() || !Device->AttachReceiver(Buffer)) {
+     delete Buffer;
+     return false;
+     }
+  isyslog("pausing live video on device %d", Device->DeviceNumber() + 1);
+  cControl::Launch(new cTimeshiftControl(Buffer));
+  cControl::Attach();
+  return true;
+}
@@ -0,0 +1,139 @@
+/*
+ * timeshift.h: Timeshift buffer for live video
+ *
+ * See the main source file 'vdr.c' for copyright information and
+ * how to reach the author.
+ *
+ * $Id$
+ */
+
+#ifndef __TIMESHIFT_H
+#define __TIMESHIFT_H
+
+#include "player.h"
+#include "receiver.h"
+#include "remux.h"
+#include "ringbuffer.h"
+#include "skins.h"
+#include "thread.h"
+
+#define MINTIMESHIFTSIZE   100 // MB
+#define MAXTIMESHIFTSIZE 65536 // MB
+#define TIMESHIFTFILE  ".timeshift"
+
+struct tTimeshiftFrame {
+  int64_t position;
+  bool independent;
+  };
+
+class cTimeshiftSaver;
+
+class cTimeshiftBuffer : public cReceiver, cThread {
+private:
+  cMutex mutex;
+  cRingBufferLinear *ringBuffer;
+  cFrameDetector *frameDetector;
+  cPatPmtGenerator patPmtGenerator;
+  cString fileName;
+  int fd;
+  int64_t size;
+  int64_t writePosition;
+  tTimeshiftFrame *frames;
+  int maxFrames;
+  int numFrames;
+  int head;
+  int firstFrame;
+  int channelNumber;
+  cTimeshiftSaver *saver;
+  bool Write(const uchar *Data, int Length);
+  void AddFrame(bool Independent);
+  const tTimeshiftFrame *Frame(int Index) const { return &frames[(head + Index - firstFrame) % maxFrames]; }
+protected:
+  virtual void Activate(bool On);
+  virtual void Receive(const uchar *Data, int Length);
+  virtual void Action(void);
+public:
+  cTimeshiftBuffer(const cChannel *Channel, int Priority);
+       ///< Creates a timeshift buffer for the given Channel, which records into
+       ///< a circular file of Setup.TimeshiftSize MB (at least MINTIMESHIFTSIZE)
+       ///< in the video directory.
+       ///< The file is created (and its space allocated) only once and then
+       ///< reused, so that pausing live video doesn't create any new files or
+       ///< directories. The index of the frames in the buffer is held in memory.
+  virtual ~cTimeshiftBuffer();
+  bool Ok(void) { return fd >= 0; }
+  double FramesPerSecond(void) { return frameDetector->FramesPerSecond(); }
+  int ChannelNumber(void) { return channelNumber; }
+  bool GetFrames(int &First, int &Last);
+       ///< Returns the number of the first (oldest) and last (newest) complete
+       ///< frames in the buffer. Frame numbers keep increasing while data is
+       ///< being recorded, and frames are dropped at the beginning of the buffer
+       ///< when their data gets overwritten. Returns false if there are no
+       ///< complete frames yet.
+  int GetIFrame(int Index, bool Forward);
+       ///< Returns the number of the independent frame at or next to Index in the
+       ///< given direction, or -1 if there is none.
+  int ReadFrame(int Index, uchar *Data, int Size, bool *Independent = NULL);
+       ///< Reads the frame with the given Index into Data, which has room for
+       ///< Size bytes. Returns the length of the frame, or -1 if it is not (or no
+       ///< longer) available.
+  bool Save(int From, int To);
+       ///< Saves the frames From...To as a normal recording in the background.
+       ///< From should be an independent frame. Returns false if another range is
+       ///< still being saved.
+  bool Saving(void);
+       ///< Returns true if a range of this buffer is currently being saved.
+  };
+
+class cTimeshiftPlayer : public cPlayer, cThread {
+private:
+  cTimeshiftBuffer *buffer;
+  uchar *frame;
+  int length;
+  int done;
+  int readFrame;
+  bool paused;
+  bool atEnd;
+protected:
+  virtual void Activate(bool On);
+  virtual void Action(void);
+public:
+  cTimeshiftPlayer(cTimeshiftBuffer *Buffer);
+  virtual ~cTimeshiftPlayer();
+  void Pause(void);
+  void Play(void);
+  bool Paused(void) { return paused; }
+  bool AtEnd(void) { return atEnd; }
+       ///< Returns true if replay has caught up with the live data.
+  void Goto(int Index);
+  void SkipSeconds(int Seconds);
+  int CurrentFrame(void);
+  virtual double FramesPerSecond(void) { return buffer->FramesPerSecond(); }
+  virtual bool GetIndex(int &Current, int &Total, bool SnapToIFrame = false);
+  virtual bool GetFrameNumber(int &Current, int &Total) { return GetIndex(Current, Total); }
+  virtual bool GetReplayMode(bool &Play, bool &Forward, int &Speed);
+  };
+
+class cTimeshiftControl : public cControl {
+private:
+  cTimeshiftBuffer *buffer;
+  cTimeshiftPlayer *timeshiftPlayer;
+  cSkinDisplayReplay *displayReplay;
+  bool visible;
+  time_t timeoutShow;
+  cTimeMs updateTimer;
+  void ShowTimed(int Seconds = 0);
+  void ShowProgress(void);
+  void Save(void);
+public:
+  cTimeshiftControl(cTimeshiftBuffer *Buffer);
+  virtual ~cTimeshiftControl();
+  virtual void Hide(void);
+  virtual cString GetHeader(void);
+  virtual eOSState ProcessKey(eKeys Key);
+  static bool PauseLiveVideo(void);
+       ///< Starts buffering the current live channel and pauses live video.
+       ///< Returns false if no device can receive the current channel.
+  };
+
+#endif //__TIMESHIFT_H
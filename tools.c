@@ -2345,11 +2345,21 @@ void cDynamicBuffer::Append(const uchar *Data, int Length)
 
 // --- cHashBase -------------------------------------------------------------
 
+// The objects are stored in a single array, using linear probing. Deleted
+// slots are refilled by moving back the following entries of the same probe
+// sequence, so there are no "tombstones" and a lookup always ends at the
+// first free slot.
+
+#define HASHMINSIZE 16
+
 cHashBase::cHashBase(int Size, bool OwnObjects)
 {
-  size = Size;
+  size = HASHMINSIZE;
+  while (size < Size)
+        size <<= 1;
+  count = 0;
   ownObjects = OwnObjects;
-  hashTable = (cList<cHashObject>**)calloc(size, sizeof(cList<cHashObject>*));
+  hashTable = NULL; // allocated on first Add()
 }
 
 cHashBase::~cHashBase(void)
@@ -2358,55 +2368,109 @@ cHashBase::~cHashBase(void)
   free(hashTable);
 }
 
+void cHashBase::Resize(int NewSize)
+{
+  tHashEntry *OldTable = hashTable;
+  int OldSize = size;
+  hashTable = MALLOC(tHashEntry, NewSize);
+  if (!hashTable) {
+     esyslog("ERROR: out of memory in cHashBase::Resize()");
+     abort();
+     }
+  memset(hashTable, 0, NewSize * sizeof(tHashEntry));
+  size = NewSize;
+  if (OldTable) {
+     for (int i = 0; i < OldSize; i++) {
+         if (OldTable[i].object) {
+            unsigned int h = hashfn(OldTable[i].id);
+            while (hashTable[h].object)
+                  h = (h + 1) & (size - 1);
+            hashTable[h] = OldTable[i];
+            }
+         }
+     free(OldTable);
+     }
+}
+
 void cHashBase::Add(cListObject *Object, unsigned int Id)
 {
-  unsigned int hash = hashfn(Id);
-  if (!hashTable[hash])
-     hashTable[hash] = new cList<cHashObject>;
-  hashTable[hash]->Add(new cHashObject(Object, Id));
+  if (!hashTable)
+     Resize(size);
+  else if ((count + 1) * 4 > size * 3) // keeps the load factor below 75%
+     Resize(size * 2);
+  unsigned int h = hashfn(Id);
+  while (hashTable[h].object)
+        h = (h + 1) & (size - 1);
+  hashTable[h].id = Id;
+  hashTable[h].object = Object;
+  count++;
 }
 
 void cHashBase::Del(cListObject *Object, unsigned int Id)
 {
-  cList<cHashObject> *list = hashTable[hashfn(Id)];
-  if (list) {
-     for (cHashObject *hob = list->First(); hob; hob = list->Next(hob)) {
-         if (hob->object == Object) {
-            list->Del(hob);
-            break;
-            }
+  if (!hashTable)
+     return;
+  unsigned int Mask = size - 1;
+  for (unsigned int i = hashfn(Id); hashTable[i].object; i = (i + 1) & Mask) {
+      if (hashTable[i].object == Object) {
+         // Move back any entries that could not be stored in their home slot because of this one:
+         for (unsigned int j = (i + 1) & Mask; hashTable[j].object; j = (j + 1) & Mask) {
+             unsigned int Home = hashfn(hashTable[j].id);
+             if (((j - Home) & Mask) >= ((j - i) & Mask)) {
+                hashTable[i] = hashTable[j];
+                i = j;
+                }
+             }
+         hashTable[i].object = NULL;
+         count--;
+         break;
          }
-     }
+      }
 }
 
 void cHashBase::Clear(void)
 {
-  for (int i = 0; i < size; i++) {
-      if (ownObjects) {
-         cList<cHashObject> *list = hashTable[i];
-         if (list) {
-            for (cHashObject *hob = list->First(); hob; hob = list->Next(hob))
-                delete hob->object;
-            }
+  if (hashTable) {
+     for (int i = 0; i < size; i++) {
+         if (ownObjects)
+            delete hashTable[i].object;
+         hashTable[i].object = NULL;
          }
-      delete hashTable[i];
-      hashTable[i] = NULL;
-      }
+     }
+  count = 0;
 }
 
 cListObject *cHashBase::Get(unsigned int Id) const
 {
-  cList<cHashObject> *list = hashTable[hashfn(Id)];
-  if (list) {
-     for (cHashObject *hob = list->First(); hob; hob = list->Next(hob)) {
-         if (hob->id == Id)
-            return hob->object;
+  if (hashTable) {
+     unsigned int Mask = size - 1;
+     for (unsigned int i = hashfn(Id); hashTable[i].object; i = (i + 1) & Mask) {
+         if (hashTable[i].id == Id)
+            return hashTable[i].object;
+         }
+     }
+  return NULL;
+}
+
+cListObject *cHashBase::Next(unsigned int Id, int &Index) const
+{
+  if (hashTable) {
+     unsigned int Mask = size - 1;
+     for (unsigned int i = Index < 0 ? hashfn(Id) : (Index + 1) & Mask; hashTable[i].object; i = (i + 1) & Mask) {
+         if (hashTable[i].id == Id) {
+            Index = i;
+            return hashTable[i].object;
+            }
          }
      }
   return NULL;
 }
 
-cList<cHashObject> *cHashBase::GetList(unsigned int Id) const
+cList<cHashObject> *cHashBase::GetList(unsigned int Id, cList<cHashObject> &List) const
 {
-  return hashTable[hashfn(Id)];
+  List.Clear();
+  int Index = -1;
+  while (cListObject *Object = Next(Id, Index))
+        List.Add(new cHashObject(Object, Id));
+  return List.Count() ? &List : NULL;
 }
@@ -606,6 +606,9 @@ public:
        ///< to have the list marked as modified.
   void SetModified(void);
        ///< Unconditionally marks this list as modified.
+  int State(void) const { return stateLock.State(); }
+       ///< Returns the current state of this list's lock, which changes whenever
+       ///< the list is modified. This can be called without holding a lock.
   void Add(cListObject *Object, cListObject *After = NULL);
   void Ins(cListObject *Object, cListObject *Before = NULL);
   void Del(cListObject *Object, bool DeleteObject = true);
@@ -695,6 +698,96 @@ c##Name##_Lock Name##_Lock(true); \
 c##Class *Name __attribute__((unused)) = Name##_Lock.Name();
 #define USE_LIST_LOCK_WRITE(Class) USE_LIST_LOCK_WRITE2(Class, Class)
 
+// A cSnapshot holds a reference to an immutable copy of a list of type T.
+// Copies of a cSnapshot share the same list, which is deleted when the last
+// reference to it is gone. The list in a snapshot can be accessed without
+// any locking, and stays valid as long as the cSnapshot exists.
+
+template<class T> class cSnapshot {
+private:
+  struct tShared {
+    T *list;
+    int state;
+    int refCount;
+    };
+  tShared *shared;
+  void Release(void)
+  {
+    if (shared && __atomic_sub_fetch(&shared->refCount, 1, __ATOMIC_ACQ_REL) == 0) {
+       delete shared->list;
+       delete shared;
+       }
+    shared = NULL;
+  }
+public:
+  cSnapshot(void) { shared = NULL; }
+  cSnapshot(T *List, int State)
+  {
+    shared = new tShared;
+    shared->list = List;
+    shared->state = State;
+    shared->refCount = 1;
+  }
+  cSnapshot(const cSnapshot &Snapshot)
+  {
+    shared = Snapshot.shared;
+    if (shared)
+       __atomic_add_fetch(&shared->refCount, 1, __ATOMIC_RELAXED);
+  }
+  ~cSnapshot() { Release(); }
+  cSnapshot &operator= (const cSnapshot &Snapshot)
+  {
+    if (Snapshot.shared)
+       __atomic_add_fetch(&Snapshot.shared->refCount, 1, __ATOMIC_RELAXED);
+    Release();
+    shared = Snapshot.shared;
+    return *this;
+  }
+  const T *List(void) const { return shared ? shared->list : NULL; }
+       ///< Returns the list in this snapshot, or NULL if this is an empty snapshot.
+  int State(void) const { return shared ? shared->state : -1; }
+       ///< Returns the state the original list had when this snapshot was taken.
+  };
+
+// cSnapshots maintains the most recent snapshot of a list of type T, which
+// must have a copy constructor that makes a full copy of the given list
+// (without locking). A new snapshot is only taken if the list has been
+// modified since the previous one.
+
+#define SNAPSHOTLOCKTIMEOUT 10 // ms to wait for a read lock if there is a previous snapshot
+
+template<class T> class cSnapshots {
+private:
+  cMutex mutex;
+  cSnapshot<T> snapshot;
+public:
+  cSnapshot<T> Get(const T &List)
+       ///< Returns a snapshot of the given List. If a writer currently holds
+       ///< the list's lock, the previous snapshot is returned instead of waiting
+       ///< for the writer to finish (unless this is the very first snapshot).
+  {
+    int State = List.State();
+    bool HasSnapshot;
+    {
+      cMutexLock MutexLock(&mutex);
+      if (snapshot.List() && snapshot.State() == State)
+         return snapshot;
+      HasSnapshot = snapshot.List();
+    }
+    cStateKey StateKey;
+    if (List.Lock(StateKey, false, HasSnapshot ? SNAPSHOTLOCKTIMEOUT : 0)) {
+       cSnapshot<T> Snapshot(new T(List), List.State());
+       StateKey.Remove(false);
+       cMutexLock MutexLock(&mutex);
+       if (Snapshot.State() - snapshot.State() > 0)
+          snapshot = Snapshot;
+       return Snapshot;
+       }
+    cMutexLock MutexLock(&mutex);
+    return snapshot;
+  }
+  };
+
 template<class T> class cVector {
   ///< cVector may only be used for *simple* types, like int or pointers - not for class objects that allocate additional memory!
 private:
@@ -889,23 +982,45 @@ public:
 
 class cHashBase {
 private:
-  cList<cHashObject> **hashTable;
-  int size;
+  struct tHashEntry {
+    unsigned int id;
+    cListObject *object; // NULL if this slot is free
+    };
+  tHashEntry *hashTable;
+  int size; // always a power of 2
+  int count;
   bool ownObjects;
-  unsigned int hashfn(unsigned int Id) const { return Id % size; }
+  unsigned int hashfn(unsigned int Id) const { Id ^= Id >> 16; Id *= 0x85EBCA6B; Id ^= Id >> 13; Id *= 0xC2B2AE35; Id ^= Id >> 16; return Id & (size - 1); }
+  void Resize(int NewSize);
 protected:
   cHashBase(int Size, bool OwnObjects);
-       ///< Creates a new hash of the given Size. If OwnObjects is true, the
+       ///< Creates a new hash with room for about Size objects. The hash grows
+       ///< automatically as objects are added, so Size is only a hint.
+       ///< If OwnObjects is true, the
        ///< hash takes ownership of the objects given in the calls to Add(),
        ///< and deletes them when Clear() is called or the hash is destroyed
        ///< (unless the object has been removed from the hash by calling Del()).
+  cListObject *Next(unsigned int Id, int &Index) const;
+       ///< Returns the next object that has been added with the given Id, starting
+       ///< after the slot at Index (or at the beginning, if Index is negative),
+       ///< and sets Index to that object's slot. Returns NULL if there are no
+       ///< more such objects. The hash must not be modified while iterating.
 public:
   virtual ~cHashBase();
   void Add(cListObject *Object, unsigned int Id);
+       ///< Adds the given Object with the given Id. Several objects may have
+       ///< the same Id.
   void Del(cListObject *Object, unsigned int Id);
   void Clear(void);
+  int Count(void) const { return count; }
   cListObject *Get(unsigned int Id) const;
-  cList<cHashObject> *GetList(unsigned int Id) const;
+  cList<cHashObject> *GetList(unsigned int Id, cList<cHashObject> &List) const;
+       ///< Fills List with all objects that have been added with the given Id, and
+       ///< returns a pointer to List, or NULL if there are no such objects. Any
+       ///< previous contents of List are deleted. This function is only kept for
+       ///< existing plugins, which used to get a list from the hash itself and now
+       ///< have to provide it. New code should use cHash::First() and cHash::Next()
+       ///< instead.
   };
 
 #define HASHSIZE 512
@@ -914,6 +1029,12 @@ template<class T> class cHash : public cHashBase {
 public:
   cHash(int Size = HASHSIZE, bool OwnObjects = false) : cHashBase(Size, OwnObjects) {}
   T *Get(unsigned int Id) const { return (T *)cHashBase::Get(Id); }
+  T *First(unsigned int Id, int &Index) const { Index = -1; return (T *)cHashBase::Next(Id, Index); }
+       ///< Returns the first object with the given Id, and sets Index for use
+       ///< in subsequent calls to Next(). Typical usage:
+       ///< int Index;
+       ///< for (T *Object = Hash.First(Id, Index); Object; Object = Hash.Next(Id, Index))
+  T *Next(unsigned int Id, int &Index) const { return (T *)cHashBase::Next(Id, Index); }
 };
 
 #endif //__TOOLS_H
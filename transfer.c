@@ -17,10 +17,12 @@ cTransfer::cTransfer(const cChannel *Channel)
   lastErrorReport = 0;
   numLostPackets = 0;
   patPmtGenerator.SetChannel(Channel);
+  streamStats.Start("transfer", cString::sprintf("%d %s", Channel->Number(), Channel->Name()));
 }
 
 cTransfer::~cTransfer()
 {
+  streamStats.Stop();
   cReceiver::Detach();
   cPlayer::Detach();
 }
@@ -48,12 +50,17 @@ void cTransfer::Receive(const uchar *Data, int Length)
      // buffering here. The TS packets *must* get through here! However, every
      // now and then there may be conditions where the packet just can't be
      // handled when offered the first time, so that's why we try several times:
+     streamStats.Packet(Data);
+     uint64_t WriteStart = cStreamStats::Now();
      for (int i = 0; i < MAXRETRIES; i++) {
-         if (PlayTs(Data, Length) > 0)
+         if (PlayTs(Data, Length) > 0) {
+            streamStats.Written(cStreamStats::Now() - WriteStart);
             return;
+            }
          cCondWait::SleepMs(RETRYWAIT);
          }
      DeviceClear();
+     streamStats.Lost();
      numLostPackets++;
      if (time(NULL) - lastErrorReport > ERRORDELTA) {
         esyslog("ERROR: %d TS packet(s) not accepted in Transfer Mode", numLostPackets);
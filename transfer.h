@@ -13,12 +13,14 @@
 #include "player.h"
 #include "receiver.h"
 #include "remux.h"
+#include "streamstats.h"
 
 class cTransfer : public cReceiver, public cPlayer {
 private:
   time_t lastErrorReport;
   int numLostPackets;
   cPatPmtGenerator patPmtGenerator;
+  cStreamStats streamStats;
 protected:
   virtual void Activate(bool On);
   virtual void Receive(const uchar *Data, int Length);
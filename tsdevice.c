@@ -0,0 +1,684 @@
+/*
+ * tsdevice.c: A virtual device that plays Transport Stream files
+ *
+ * See the main source file 'vdr.c' for copyright information and
+ * how to reach the author.
+ *
+ * $Id$
+ */
+
+#include "tsdevice.h"
+#include <fcntl.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#include "remux.h"
+
+#define TSBUFFERSIZE   MEGABYTE(16)
+#define TSCHUNKSIZE    (TS_SIZE * 348) // number of bytes read from the file at once
+#define TSDVRBUFFER    MEGABYTE(2) // socket buffer for the DVR
+#define TSSCANSIZE     MEGABYTE(8) // how far to look for the PAT when scanning a file
+#define PCRTICKSPERMS  (PCRFACTOR * PTSTICKS / 1000)
+#define MAXPCRGAP      2000 // ms; a bigger gap between two PCRs is a discontinuity
+#define MAXPCRLAG      1000 // ms; if delivery lags behind by more than this, the timing is reset
+#define LOCKPOLLTIME     10 // ms
+
+// --- cTsSectionFilter ------------------------------------------------------
+
+class cTsSectionFilter : public cListObject {
+public:
+  int pid;
+  uchar tid;
+  uchar mask;
+  int fd; // our end of the socket pair
+  int handle; // the end that is given to the section handler
+  cTsSectionFilter(int Pid, uchar Tid, uchar Mask, int Fd, int Handle) { pid = Pid; tid = Tid; mask = Mask; fd = Fd; handle = Handle; }
+  ~cTsSectionFilter() { close(fd); }
+  };
+
+// --- cTsSectionAssembler ---------------------------------------------------
+
+class cTsSectionAssembler {
+private:
+  uchar data[MAX_SECTION_SIZE];
+  int length;
+  int lastCc;
+  bool synced;
+  const cList<cTsSectionFilter> *filters;
+  int pid;
+  void Put(const uchar *Data, int Length);
+  void Deliver(void);
+public:
+  int numFilters;
+  cTsSectionAssembler(int Pid, const cList<cTsSectionFilter> *Filters) { pid = Pid; filters = Filters; numFilters = 0; Reset(); }
+  void Reset(void) { length = 0; lastCc = -1; synced = false; }
+  void Process(const uchar *Data);
+       ///< Processes the TS packet in Data and delivers any section that is
+       ///< complete to the filters that match it.
+  };
+
+void cTsSectionAssembler::Deliver(void)
+{
+  for (const cTsSectionFilter *f = filters->First(); f; f = filters->Next(f)) {
+      if (f->pid == pid && (data[0] & f->mask) == (f->tid & f->mask))
+         send(f->fd, data, length, MSG_DONTWAIT | MSG_NOSIGNAL); // sections are dropped if the filter isn't read, just like with a real demux
+      }
+}
+
+void cTsSectionAssembler::Put(const uchar *Data, int Length)
+{
+  while (Length > 0 && synced) {
+        if (length == 0 && *Data == 0xFF) {
+           synced = false; // stuffing up to the end of the packet
+           break;
+           }
+        int SectionLength = length < 3 ? 3 : 3 + (((int(data[1]) & 0x0F) << 8) | data[2]);
+        int n = min(SectionLength - length, Length);
+        memcpy(data + length, Data, n);
+        length += n;
+        Data += n;
+        Length -= n;
+        if (length == 3) {
+           SectionLength = 3 + (((int(data[1]) & 0x0F) << 8) | data[2]);
+           if (SectionLength <= 3 || SectionLength > MAX_SECTION_SIZE) {
+              Reset();
+              break;
+              }
+           }
+        if (length > 3 && length == SectionLength) {
+           Deliver();
+           length = 0;
+           }
+        }
+}
+
+void cTsSectionAssembler::Process(const uchar *Data)
+{
+  int Cc = TsContinuityCounter(Data);
+  if (lastCc >= 0 && Cc != ((lastCc + 1) & TS_CONT_CNT_MASK) && Cc != lastCc)
+     synced = false;
+  lastCc = Cc;
+  bool PayloadStart = TsPayloadStart(Data);
+  const uchar *p = Data;
+  int l = TsGetPayload(&p);
+  if (l <= 0)
+     return;
+  if (PayloadStart) {
+     int Pointer = *p++;
+     l--;
+     if (Pointer >= l) {
+        Reset();
+        return;
+        }
+     Put(p, Pointer); // completes the previous section
+     p += Pointer;
+     l -= Pointer;
+     length = 0;
+     synced = true;
+     }
+  Put(p, l);
+}
+
+// --- cTsFileReader ---------------------------------------------------------
+
+class cTsFileReader : public cThread {
+private:
+  cMutex mutex;
+  cCondWait condWait;
+  const cStringList *fileNames;
+  bool fast;
+  int requestedFile;
+  int playingFile;
+  int fd;
+  bool locked;
+  int dvr;
+  int newDvr;
+  uchar *output;
+  int outputLength;
+  int overflows;
+  int pidCount[MAXPID];
+  cTsSectionAssembler *assemblers[MAXPID];
+  cList<cTsSectionFilter> filters;
+  int pcrPid;
+  int64_t pcrBase;
+  cTimeMs pcrTimer;
+  bool Open(void);
+  int Pace(const uchar *Data);
+  int Process(const uchar *Data, int Length, int &Wait);
+  void Flush(void);
+protected:
+  virtual void Action(void);
+public:
+  cTsFileReader(const cStringList *FileNames, bool Fast, int DeviceNumber);
+  virtual ~cTsFileReader();
+  void Tune(int File);
+  bool Locked(void);
+  void SetPid(int Pid, bool On);
+  int OpenFilter(int Pid, uchar Tid, uchar Mask);
+  bool CloseFilter(int Handle);
+  int OpenDvr(void);
+  };
+
+cTsFileReader::cTsFileReader(const cStringList *FileNames, bool Fast, int DeviceNumber)
+:cThread(cString::sprintf("device %d TS file reader", DeviceNumber))
+{
+  fileNames = FileNames;
+  fast = Fast;
+  requestedFile = playingFile = -1;
+  fd = -1;
+  locked = false;
+  dvr = newDvr = -1;
+  output = MALLOC(uchar, TSCHUNKSIZE);
+  outputLength = 0;
+  overflows = 0;
+  memset(pidCount, 0, sizeof(pidCount));
+  memset(assemblers, 0, sizeof(assemblers));
+  pcrPid = -1;
+  pcrBase = -1;
+}
+
+cTsFileReader::~cTsFileReader()
+{
+  Cancel(-1);
+  condWait.Signal();
+  Cancel(3);
+  if (fd >= 0)
+     close(fd);
+  if (dvr >= 0)
+     close(dvr);
+  if (newDvr >= 0)
+     close(newDvr);
+  for (int i = 0; i < MAXPID; i++)
+      delete assemblers[i];
+  free(output);
+}
+
+void cTsFileReader::Tune(int File)
+{
+  cMutexLock MutexLock(&mutex);
+  if (File != requestedFile) {
+     requestedFile = File;
+     locked = false;
+     condWait.Signal();
+     }
+  if (!Active())
+     Start();
+}
+
+bool cTsFileReader::Locked(void)
+{
+  cMutexLock MutexLock(&mutex);
+  return locked;
+}
+
+void cTsFileReader::SetPid(int Pid, bool On)
+{
+  cMutexLock MutexLock(&mutex);
+  if (On)
+     pidCount[Pid]++;
+  else if (pidCount[Pid] > 0)
+     pidCount[Pid]--;
+}
+
+int cTsFileReader::OpenFilter(int Pid, uchar Tid, uchar Mask)
+{
+  int sv[2];
+  if (socketpair(AF_UNIX, SOCK_SEQPACKET, 0, sv) < 0) {
+     LOG_ERROR;
+     return -1;
+     }
+  fcntl(sv[1], F_SETFL, fcntl(sv[1], F_GETFL) | O_NONBLOCK);
+  cMutexLock MutexLock(&mutex);
+  filters.Add(new cTsSectionFilter(Pid, Tid, Mask, sv[0], sv[1]));
+  if (!assemblers[Pid])
+     assemblers[Pid] = new cTsSectionAssembler(Pid, &filters);
+  assemblers[Pid]->numFilters++;
+  return sv[1];
+}
+
+bool cTsFileReader::CloseFilter(int Handle)
+{
+  cMutexLock MutexLock(&mutex);
+  for (cTsSectionFilter *f = filters.First(); f; f = filters.Next(f)) {
+      if (f->handle == Handle) {
+         int Pid = f->pid;
+         filters.Del(f);
+         if (--assemblers[Pid]->numFilters == 0) {
+            delete assemblers[Pid];
+            assemblers[Pid] = NULL;
+            }
+         return true;
+         }
+      }
+  return false;
+}
+
+int cTsFileReader::OpenDvr(void)
+{
+  int sv[2];
+  if (socketpair(AF_UNIX, SOCK_STREAM, 0, sv) < 0) {
+     LOG_ERROR;
+     return -1;
+     }
+  int Size = TSDVRBUFFER;
+  setsockopt(sv[1], SOL_SOCKET, SO_SNDBUF, &Size, sizeof(Size));
+  fcntl(sv[0], F_SETFL, fcntl(sv[0], F_GETFL) | O_NONBLOCK);
+  fcntl(sv[1], F_SETFL, fcntl(sv[1], F_GETFL) | O_NONBLOCK);
+  cMutexLock MutexLock(&mutex);
+  if (newDvr >= 0)
+     close(newDvr);
+  newDvr = sv[1]; // the write end is only ever used (and closed) by the reader thread
+  condWait.Signal();
+  return sv[0];
+}
+
+bool cTsFileReader::Open(void)
+{
+  cMutexLock MutexLock(&mutex);
+  if (newDvr >= 0) {
+     if (dvr >= 0)
+        close(dvr);
+     dvr = newDvr;
+     newDvr = -1;
+     }
+  if (requestedFile != playingFile) {
+     if (fd >= 0)
+        close(fd);
+     fd = -1;
+     playingFile = requestedFile;
+     for (int i = 0; i < MAXPID; i++) {
+         if (assemblers[i])
+            assemblers[i]->Reset();
+         }
+     pcrPid = -1;
+     pcrBase = -1;
+     if (playingFile >= 0) {
+        const char *FileName = (*fileNames)[playingFile];
+        fd = open(FileName, O_RDONLY);
+        if (fd >= 0)
+           dsyslog("playing TS file '%s'", FileName);
+        else
+           LOG_ERROR_STR(FileName);
+        }
+     }
+  locked = fd >= 0;
+  return locked;
+}
+
+int cTsFileReader::Pace(const uchar *Data)
+{
+  int64_t Pcr = TsGetPcr(Data);
+  if (Pcr < 0)
+     return 0;
+  int Pid = TsPid(Data);
+  if (pcrPid < 0)
+     pcrPid = Pid;
+  else if (Pid != pcrPid)
+     return 0;
+  if (pcrBase >= 0) {
+     int64_t Delta = Pcr - pcrBase;
+     if (Delta < 0)
+        Delta += MAX27MHZ + 1;
+     int64_t Due = Delta / PCRTICKSPERMS;
+     int64_t Elapsed = pcrTimer.Elapsed();
+     if (Due - Elapsed <= MAXPCRGAP && Elapsed - Due <= MAXPCRLAG)
+        return max(Due - Elapsed, int64_t(0));
+     // discontinuity (or the file has started over), so the timing is reset
+     }
+  pcrBase = Pcr;
+  pcrTimer.Set();
+  return 0;
+}
+
+int cTsFileReader::Process(const uchar *Data, int Length, int &Wait)
+{
+  cMutexLock MutexLock(&mutex);
+  int Done = 0;
+  Wait = 0;
+  while (Length - Done >= TS_SIZE) {
+        const uchar *p = Data + Done;
+        if (int Skipped = TS_SYNC(p, Length - Done)) {
+           Done += Skipped;
+           continue;
+           }
+        if ((!fast || dvr < 0) && (Wait = Pace(p)) > 0) // without a receiver there's nothing to hurry for
+           break;
+        int Pid = TsPid(p);
+        if (assemblers[Pid])
+           assemblers[Pid]->Process(p);
+        if (pidCount[Pid] && dvr >= 0) {
+           memcpy(output + outputLength, p, TS_SIZE);
+           outputLength += TS_SIZE;
+           }
+        Done += TS_SIZE;
+        }
+  return Done;
+}
+
+void cTsFileReader::Flush(void)
+{
+  uchar *p = output;
+  while (outputLength > 0 && dvr >= 0 && Running()) {
+        int w = send(dvr, p, outputLength, MSG_DONTWAIT | MSG_NOSIGNAL);
+        if (w > 0) {
+           p += w;
+           outputLength -= w;
+           }
+        else if (errno == EAGAIN) {
+           if (!fast) {
+              if (overflows++ == 0)
+                 esyslog("ERROR: DVR buffer overflow while playing TS file '%s'", (*fileNames)[playingFile]);
+              break;
+              }
+           cPoller Poller(dvr, true);
+           Poller.Poll(100);
+           }
+        else if (errno != EINTR) {
+           if (errno != EPIPE && errno != ECONNRESET)
+              LOG_ERROR;
+           close(dvr); // the DVR has been closed
+           dvr = -1;
+           }
+        }
+  outputLength = 0;
+}
+
+void cTsFileReader::Action(void)
+{
+  uchar *Buffer = MALLOC(uchar, TSCHUNKSIZE);
+  int Length = 0;
+  while (Running()) {
+        int PlayingFile = playingFile;
+        if (!Open()) {
+           Length = 0;
+           condWait.Wait(100);
+           continue;
+           }
+        if (playingFile != PlayingFile)
+           Length = 0;
+        int r = safe_read(fd, Buffer + Length, TSCHUNKSIZE - Length);
+        if (r == 0) {
+           // start over at the beginning of the file:
+           lseek(fd, 0, SEEK_SET);
+           Length = 0;
+           continue;
+           }
+        else if (r < 0) {
+           LOG_ERROR;
+           condWait.Wait(100);
+           continue;
+           }
+        Length += r;
+        int Done = 0;
+        while (Length - Done >= TS_SIZE && Running()) {
+              int Wait;
+              Done += Process(Buffer + Done, Length - Done, Wait);
+              Flush();
+              if (Wait > 0) {
+                 condWait.Wait(Wait);
+                 cMutexLock MutexLock(&mutex);
+                 if (requestedFile != playingFile || newDvr >= 0)
+                    break;
+                 }
+              }
+        if (Done < Length)
+           memmove(Buffer, Buffer + Done, Length - Done);
+        Length -= Done;
+        }
+  free(Buffer);
+}
+
+// --- cTsDevice -------------------------------------------------------------
+
+cStringList cTsDevice::deviceFiles;
+bool cTsDevice::fast = false;
+
+static int GetTransportStreamId(const char *FileName)
+{
+  int Tid = -1;
+  int f = open(FileName, O_RDONLY);
+  if (f >= 0) {
+     uchar *Buffer = MALLOC(uchar, TSCHUNKSIZE);
+     int Scanned = 0;
+     while (Tid < 0 && Scanned < TSSCANSIZE) {
+           int r = safe_read(f, Buffer, TSCHUNKSIZE);
+           if (r < TS_SIZE)
+              break;
+           Scanned += r;
+           for (int i = 0; i + TS_SIZE <= r; i += TS_SIZE) {
+               const uchar *p = Buffer + i;
+               if (*p == TS_SYNC_BYTE && TsPid(p) == PATPID && TsPayloadStart(p)) {
+                  int l = TsGetPayload(&p);
+                  if (l > 8 && p[0] + 6 < l && p[1 + p[0]] == 0x00) { // pointer field, table id of PAT
+                     p += 1 + p[0];
+                     Tid = (int(p[3]) << 8) | p[4];
+                     break;
+                     }
+                  }
+               }
+           }
+     free(Buffer);
+     close(f);
+     }
+  else
+     LOG_ERROR_STR(FileName);
+  return Tid;
+}
+
+bool cTsDevice::AddDevice(const char *FileNames)
+{
+  cStringList Files;
+  char *s = strdup(FileNames);
+  char *strtok_next;
+  for (char *p = strtok_r(s, ",", &strtok_next); p; p = strtok_r(NULL, ",", &strtok_next)) {
+      if (access(p, R_OK) != 0) {
+         free(s);
+         return false;
+         }
+      }
+  free(s);
+  deviceFiles.Append(strdup(FileNames));
+  return true;
+}
+
+bool cTsDevice::Initialize(void)
+{
+  for (int i = 0; i < deviceFiles.Size(); i++)
+      new cTsDevice(deviceFiles[i]);
+  if (deviceFiles.Size())
+     isyslog("found %d virtual TS device%s", deviceFiles.Size(), deviceFiles.Size() > 1 ? "s" : "");
+  return deviceFiles.Size() > 0;
+}
+
+cTsDevice::cTsDevice(const char *FileNames)
+{
+  char *s = strdup(FileNames);
+  char *strtok_next;
+  for (char *p = strtok_r(s, ",", &strtok_next); p; p = strtok_r(NULL, ",", &strtok_next)) {
+      int Tid = GetTransportStreamId(p);
+      if (Tid >= 0)
+         dsyslog("device %d: TS file '%s' has transport stream id %d", DeviceNumber() + 1, p, Tid);
+      else
+         esyslog("ERROR: no PAT found in TS file '%s'", p);
+      fileNames.Append(strdup(p));
+      transportStreamIds.Append(Tid);
+      }
+  free(s);
+  reader = new cTsFileReader(&fileNames, fast, DeviceNumber() + 1);
+  tsBuffer = NULL;
+  fd_dvr = -1;
+  tunedFile = -1;
+  StartSectionHandler();
+}
+
+cTsDevice::~cTsDevice()
+{
+  StopSectionHandler();
+  CloseDvr();
+  delete reader;
+}
+
+cString cTsDevice::DeviceType(void) const
+{
+  return "TS";
+}
+
+cString cTsDevice::DeviceName(void) const
+{
+  return tunedFile >= 0 ? fileNames[tunedFile] : fileNames[0];
+}
+
+int cTsDevice::FileIndex(const cChannel *Channel) const
+{
+  for (int i = 0; i < transportStreamIds.Size(); i++) {
+      if (transportStreamIds[i] == Channel->Tid())
+         return i;
+      }
+  return -1;
+}
+
+bool cTsDevice::ProvidesSource(int Source) const
+{
+  return true; // the files don't care where their data came from
+}
+
+bool cTsDevice::ProvidesTransponder(const cChannel *Channel) const
+{
+  return FileIndex(Channel) >= 0 && DeviceHooksProvidesTransponder(Channel);
+}
+
+bool cTsDevice::ProvidesChannel(const cChannel *Channel, int Priority, bool *NeedsDetachReceivers) const
+{
+  bool result = false;
+  bool hasPriority = Priority == IDLEPRIORITY || Priority > this->Priority();
+  bool needsDetachReceivers = false;
+
+  if (ProvidesTransponder(Channel)) {
+     result = hasPriority;
+     if (Priority > IDLEPRIORITY) {
+        if (Receiving()) {
+           if (IsTunedToTransponder(Channel))
+              result = true;
+           else
+              needsDetachReceivers = true;
+           }
+        }
+     }
+  if (NeedsDetachReceivers)
+     *NeedsDetachReceivers = needsDetachReceivers;
+  return result;
+}
+
+bool cTsDevice::ProvidesEIT(void) const
+{
+  return DeviceHooksProvidesEIT();
+}
+
+int cTsDevice::NumProvidedSystems(void) const
+{
+  return 1;
+}
+
+int cTsDevice::SignalStrength(void) const
+{
+  return reader->Locked() ? 100 : 0;
+}
+
+int cTsDevice::SignalQuality(void) const
+{
+  return reader->Locked() ? 100 : 0;
+}
+
+const cChannel *cTsDevice::GetCurrentlyTunedTransponder(void) const
+{
+  return tunedFile >= 0 ? &channel : NULL;
+}
+
+bool cTsDevice::IsTunedToTransponder(const cChannel *Channel) const
+{
+  return tunedFile >= 0 && FileIndex(Channel) == tunedFile;
+}
+
+bool cTsDevice::SetChannelDevice(const cChannel *Channel, bool LiveView)
+{
+  int File = FileIndex(Channel);
+  if (File >= 0) {
+     channel = *Channel;
+     tunedFile = File;
+     reader->Tune(File);
+     return true;
+     }
+  return false;
+}
+
+bool cTsDevice::HasLock(int TimeoutMs) const
+{
+  cTimeMs Timer(TimeoutMs);
+  while (!reader->Locked()) {
+        if (Timer.TimedOut())
+           return false;
+        cCondWait::SleepMs(LOCKPOLLTIME);
+        }
+  return true;
+}
+
+bool cTsDevice::SetPid(cPidHandle *Handle, int Type, bool On)
+{
+  if (Handle->pid >= 0 && Handle->pid < MAXPID) {
+     // Handle->handle remembers whether this PID handle has been counted:
+     if (On || Handle->used) {
+        if (Handle->handle < 0) {
+           reader->SetPid(Handle->pid, true);
+           Handle->handle = Handle->pid;
+           }
+        }
+     else if (Handle->handle >= 0) {
+        reader->SetPid(Handle->pid, false);
+        Handle->handle = -1;
+        }
+     }
+  return true;
+}
+
+int cTsDevice::OpenFilter(u_short Pid, u_char Tid, u_char Mask)
+{
+  if (Pid < MAXPID)
+     return reader->OpenFilter(Pid, Tid, Mask);
+  return -1;
+}
+
+void cTsDevice::CloseFilter(int Handle)
+{
+  reader->CloseFilter(Handle);
+  close(Handle);
+}
+
+bool cTsDevice::OpenDvr(void)
+{
+  CloseDvr();
+  fd_dvr = reader->OpenDvr();
+  if (fd_dvr >= 0) {
+     tsBuffer = new cTSBuffer(fd_dvr, TSBUFFERSIZE, DeviceNumber() + 1);
+     streamStats.SetRingBuffer(tsBuffer->RingBuffer());
+     }
+  return fd_dvr >= 0;
+}
+
+void cTsDevice::CloseDvr(void)
+{
+  if (fd_dvr >= 0) {
+     streamStats.SetRingBuffer(NULL);
+     delete tsBuffer;
+     tsBuffer = NULL;
+     close(fd_dvr); // the reader notices this and closes the other end
+     fd_dvr = -1;
+     }
+}
+
+bool cTsDevice::GetTSPacket(uchar *&Data)
+{
+  if (tsBuffer) {
+     Data = tsBuffer->Get();
+     return true;
+     }
+  return false;
+}
@@ -0,0 +1,87 @@
+/*
+ * tsdevice.h: A virtual device that plays Transport Stream files
+ *
+ * See the main source file 'vdr.c' for copyright information and
+ * how to reach the author.
+ *
+ * $Id$
+ */
+
+#ifndef __TSDEVICE_H
+#define __TSDEVICE_H
+
+#include "device.h"
+
+class cTsFileReader;
+
+/// The cTsDevice implements a virtual tuner that plays captured Transport
+/// Stream files instead of receiving data from DVB hardware. Each file is
+/// treated as one transponder, identified by the transport stream id in its
+/// PAT, and is played in an endless loop. The data is delivered at the
+/// original bitrate (paced by the PCR), or as fast as the receivers can take
+/// it. Section filters and signal lock are provided just like on a real
+/// device, so recordings, EPG scanning and zapping can be tested without any
+/// DVB hardware.
+
+class cTsDevice : public cDevice {
+private:
+  static cStringList deviceFiles;
+  cStringList fileNames;
+  cVector<int> transportStreamIds;
+  cTsFileReader *reader;
+  cTSBuffer *tsBuffer;
+  int fd_dvr;
+  cChannel channel;
+  int tunedFile;
+  int FileIndex(const cChannel *Channel) const;
+public:
+  static bool fast;
+  static bool AddDevice(const char *FileNames);
+         ///< Adds a virtual device that plays the given comma separated list of
+         ///< Transport Stream files. Returns false if any of the files can't be
+         ///< read. The device is actually created by Initialize().
+  static bool Initialize(void);
+         ///< Creates the devices that have been added by AddDevice().
+         ///< Returns true if any devices are available.
+  cTsDevice(const char *FileNames);
+  virtual ~cTsDevice();
+  virtual cString DeviceType(void) const;
+  virtual cString DeviceName(void) const;
+
+// Channel facilities
+
+public:
+  virtual bool ProvidesSource(int Source) const;
+  virtual bool ProvidesTransponder(const cChannel *Channel) const;
+  virtual bool ProvidesChannel(const cChannel *Channel, int Priority = IDLEPRIORITY, bool *NeedsDetachReceivers = NULL) const;
+  virtual bool ProvidesEIT(void) const;
+  virtual int NumProvidedSystems(void) const;
+  virtual int SignalStrength(void) const;
+  virtual int SignalQuality(void) const;
+  virtual const cChannel *GetCurrentlyTunedTransponder(void) const;
+  virtual bool IsTunedToTransponder(const cChannel *Channel) const;
+protected:
+  virtual bool SetChannelDevice(const cChannel *Channel, bool LiveView);
+public:
+  virtual bool HasLock(int TimeoutMs = 0) const;
+
+// PID handle facilities
+
+protected:
+  virtual bool SetPid(cPidHandle *Handle, int Type, bool On);
+
+// Section filter facilities
+
+public:
+  virtual int OpenFilter(u_short Pid, u_char Tid, u_char Mask);
+  virtual void CloseFilter(int Handle);
+
+// Receiver facilities
+
+protected:
+  virtual bool OpenDvr(void);
+  virtual void CloseDvr(void);
+  virtual bool GetTSPacket(uchar *&Data);
+  };
+
+#endif //__TSDEVICE_H
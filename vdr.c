@@ -65,11 +65,13 @@
 #include "sourceparams.h"
 #include "sources.h"
 #include "status.h"
+#include "streamstats.h"
 #include "svdrp.h"
 #include "themes.h"
 #include "timers.h"
 #include "tools.h"
 #include "transfer.h"
+#include "tsdevice.h"
 #include "videodir.h"
 
 #define MINCHANNELWAIT        10 // seconds to wait between failed channel switchings
@@ -301,7 +303,10 @@ int main(int argc, char *argv[])
       { "showargs", optional_argument, NULL, 's' | 0x200 },
       { "shutdown", required_argument, NULL, 's' },
       { "split",    no_argument,       NULL, 's' | 0x100 },
+      { "statsfile",required_argument, NULL, 's' | 0x300 },
       { "terminal", required_argument, NULL, 't' },
+      { "tsdevice", required_argument, NULL, 't' | 0x100 },
+      { "tsfast",   no_argument,       NULL, 't' | 0x200 },
       { "updindex", required_argument, NULL, 'u' | 0x200 },
       { "user",     required_argument, NULL, 'u' },
       { "userdump", no_argument,       NULL, 'u' | 0x100 },
@@ -493,12 +498,23 @@ int main(int argc, char *argv[])
                         printf("%s\n", v[i]);
                     return 0;
                     }
+          case 's' | 0x300:
+                    cStreamStats::SetStatsFile(optarg);
+                    break;
           case 't': Terminal = optarg;
                     if (access(Terminal, R_OK | W_OK) < 0) {
                        fprintf(stderr, "vdr: can't access terminal: %s\n", Terminal);
                        return 2;
                        }
                     break;
+          case 't' | 0x100:
+                    if (cTsDevice::AddDevice(optarg))
+                       break;
+                    fprintf(stderr, "vdr: can't read TS file(s): %s\n", optarg);
+                    return 2;
+          case 't' | 0x200:
+                    cTsDevice::fast = true;
+                    break;
           case 'u': if (*optarg)
                        VdrUser = optarg;
                     break;
@@ -617,7 +633,17 @@ int main(int argc, char *argv[])
                "                           useful in conjunction with --edit)\n"
                "            --showargs[=DIR] print the arguments read from DIR and exit\n"
                "                           (default: %s)\n"
+               "            --statsfile=FILE\n"
+               "                           write the health and throughput data of all\n"
+               "                           recordings, transfers and devices into FILE\n"
                "  -t TTY,   --terminal=TTY controlling tty\n"
+               "            --tsdevice=FILE[,FILE...]\n"
+               "                           add a virtual device that plays the given Transport\n"
+               "                           Stream FILEs in a loop, one transponder per file\n"
+               "                           (selected by the transport stream id in the file's\n"
+               "                           PAT); there may be several --tsdevice options\n"
+               "            --tsfast       let virtual devices deliver their data as fast as\n"
+               "                           possible instead of at the original bitrate\n"
                "  -u USER,  --user=USER    run as user USER; only applicable if started as\n"
                "                           root; USER can be a user name or a numerical id\n"
                "            --updindex=REC update index for recording REC and exit\n"
@@ -795,6 +821,7 @@ int main(int argc, char *argv[])
   // Recordings:
 
   cRecordings::Update();
+  cMuxRecorder::Extract();
 
   // EPG data:
 
@@ -817,6 +844,7 @@ int main(int argc, char *argv[])
 
   cDvbDevice::Initialize();
   cDvbDevice::BondDevices(Setup.DeviceBondings);
+  cTsDevice::Initialize();
 
   // Initialize plugins:
 
@@ -1186,10 +1214,12 @@ int main(int argc, char *argv[])
           // Delete expired timers:
           if (Timers->DeleteExpired())
              TimersModified = true;
-          // Make sure there is enough free disk space for ongoing recordings:
+          // Make sure there is enough free disk space for ongoing and upcoming recordings:
           int MaxPriority = Timers->GetMaxPriority();
           if (MaxPriority >= 0)
              AssertFreeDiskSpace(MaxPriority);
+          else
+             PrepareFreeDiskSpace();
           TimersStateKey.Remove(TimersModified);
         }
         // Recordings:
@@ -1589,6 +1619,9 @@ int main(int argc, char *argv[])
            }
 
         ReportEpgBugFixStats();
+        cStateLock::LogStatistics();
+        cStreamStats::WriteStatsFile();
+        cMuxRecorder::Housekeeping();
 
         // Main thread hooks of plugins:
         PluginManager.MainThreadHook();
@@ -1609,10 +1642,13 @@ Exit:
   StopSVDRPHandler();
   ChannelCamRelations.Save();
   cRecordControls::Shutdown();
+  cMuxRecorder::Shutdown();
+  cStatus::Shutdown();
   PluginManager.StopPlugins();
   RecordingsHandler.DelAll();
   delete Menu;
   cControl::Shutdown();
+  cRecordings::SaveCache();
   delete Interface;
   cOsdProvider::Shutdown();
   Remotes.Clear();
@@ -194,7 +194,6 @@ bool cVideoDirectory::IsOnVideoDirectoryFileSystem(const char *FileName)
 // --- cVideoDiskUsage -------------------------------------------------------
 
 #define DISKSPACECHEK     5 // seconds between disk space checks
-#define MB_PER_MINUTE 25.75 // this is just an estimate!
 
 int cVideoDiskUsage::state = 0;
 time_t cVideoDiskUsage::lastChecked = 0;
@@ -84,6 +84,8 @@ public:
   static bool IsOnVideoDirectoryFileSystem(const char *FileName);
   };
 
+#define MB_PER_MINUTE 25.75 // this is just an estimate!
+
 class cVideoDiskUsage {
 private:
   static int state;